@@ -16,10 +16,18 @@ limitations under the License.
 #ifndef TENSORFLOW_COMPILER_JIT_DEVICE_EXECUTABLE_PERSISTOR_H_
 #define TENSORFLOW_COMPILER_JIT_DEVICE_EXECUTABLE_PERSISTOR_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/log.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/jit/xla_compilation_cache.pb.h"
 #include "tensorflow/compiler/jit/xla_device_compiler_client.h"
 #include "tensorflow/compiler/tf2xla/xla_compiler.h"
@@ -28,6 +36,8 @@ limitations under the License.
 #include "xla/util.h"
 #include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/statusor.h"
@@ -74,11 +84,31 @@ class DeviceExecutablePersistor {
 
     // Cache is read-only if set to true.
     bool persistent_cache_directory_read_only = false;
+
+    // Identifies the compiler (version, flags, target features) that produced
+    // the persisted executables. Entries written with a different fingerprint
+    // are never loaded. Zero means that no fingerprint is part of the key.
+    uint64 compiler_fingerprint = 0;
+
+    // If positive, the total size of the entries with `persistence_prefix` in
+    // `persistent_cache_directory` is kept below this many bytes by evicting
+    // the least recently used entries whenever a new entry is persisted.
+    int64_t max_cache_size_bytes = 0;
+
+    // If true, all entries matching this persistor are read from
+    // `persistent_cache_directory` by a background thread started at
+    // construction, so that later loads are served from memory. Each entry is
+    // dropped from memory once it has been loaded.
+    bool prefetch = false;
+
+    // The prefetch stops once it has read this many bytes of entries; the rest
+    // are loaded from disk on demand.
+    int64_t max_prefetch_bytes = int64_t{256} << 20;
   };
 
   DeviceExecutablePersistor(const Config& config,
                             const DeviceType& device_type);
-  virtual ~DeviceExecutablePersistor() = default;
+  virtual ~DeviceExecutablePersistor();
 
   // Returns std::nullopt if persistence is not enabled (i.e.
   // `persistent_cache_directory_` is empty) or if the serialized entry is not
@@ -109,6 +139,11 @@ class DeviceExecutablePersistor {
   const std::string& persistent_cache_directory() const {
     return persistent_cache_directory_;
   }
+  uint64 compiler_fingerprint() const { return compiler_fingerprint_; }
+
+  // Blocks until the background prefetch started at construction (if any) has
+  // finished.
+  void WaitForPrefetch() const;
 
  private:
   // Returns a cache key proto that identifies an entry in the compilation
@@ -146,6 +181,22 @@ class DeviceExecutablePersistor {
       const XlaSerializedCacheKey& key) const;
   std::string GetFilePath(const XlaSerializedCacheKey& key) const;
 
+  // Returns true if `file_name` in `persistent_cache_directory_` may hold an
+  // entry written with this persistor's prefix.
+  bool IsCacheEntryFileName(absl::string_view file_name) const;
+
+  // Reads all entries matching this persistor's device type, prefix and
+  // compiler fingerprint into `prefetched_entries_`. Runs on
+  // `prefetch_thread_`.
+  void PrefetchEntries();
+
+  // Deletes the least recently used entries until the cache fits in
+  // `max_cache_size_bytes_`. The entry at `keep_path` is never deleted.
+  void EvictLeastRecentlyUsedEntries(const std::string& keep_path) const;
+
+  // Records that the entry at `file_path` has just been read or written.
+  void MarkUsed(const std::string& file_path) const;
+
   const DeviceType device_type_;
   const bool disable_strict_signature_checks_;
   const std::string persistence_prefix_;
@@ -157,6 +208,24 @@ class DeviceExecutablePersistor {
   // Cache is read-only if set to true.
   const bool persistent_cache_directory_read_only_;
 
+  const uint64 compiler_fingerprint_;
+  const int64_t max_cache_size_bytes_;
+  const int64_t max_prefetch_bytes_;
+
+  mutable mutex mu_;
+  // Entries read by the background prefetch, keyed by file path. An entry is
+  // removed once it has been handed out by `TryToReadSerializedEntry`.
+  mutable absl::flat_hash_map<std::string, XlaSerializedCacheEntry>
+      prefetched_entries_ TF_GUARDED_BY(mu_);
+  // Last time (in microseconds) an entry was read or written by this process.
+  // Used in addition to file modification times to order evictions.
+  mutable absl::flat_hash_map<std::string, uint64> last_used_micros_
+      TF_GUARDED_BY(mu_);
+  mutable condition_variable prefetch_cv_;
+  bool prefetch_done_ TF_GUARDED_BY(mu_) = true;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::unique_ptr<Thread> prefetch_thread_;
+
   DeviceExecutablePersistor(const DeviceExecutablePersistor&) = delete;
   void operator=(const DeviceExecutablePersistor&) = delete;
 };
@@ -170,7 +239,164 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::
       persistence_prefix_(config.persistence_prefix),
       persistent_cache_directory_(config.persistent_cache_directory),
       persistent_cache_directory_read_only_(
-          config.persistent_cache_directory_read_only) {}
+          config.persistent_cache_directory_read_only),
+      compiler_fingerprint_(config.compiler_fingerprint),
+      max_cache_size_bytes_(config.max_cache_size_bytes),
+      max_prefetch_bytes_(config.max_prefetch_bytes) {
+  if (config.prefetch && !persistent_cache_directory_.empty()) {
+    {
+      mutex_lock lock(mu_);
+      prefetch_done_ = false;
+    }
+    prefetch_thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "xla_persistent_cache_prefetch",
+        [this]() { PrefetchEntries(); }));
+  }
+}
+
+template <typename ExecutableType, typename ClientType>
+DeviceExecutablePersistor<ExecutableType,
+                          ClientType>::~DeviceExecutablePersistor() {
+  {
+    mutex_lock lock(mu_);
+    cancelled_ = true;
+  }
+  // Joins the prefetch thread.
+  prefetch_thread_.reset();
+}
+
+template <typename ExecutableType, typename ClientType>
+void DeviceExecutablePersistor<ExecutableType, ClientType>::WaitForPrefetch()
+    const {
+  mutex_lock lock(mu_);
+  while (!prefetch_done_) {
+    prefetch_cv_.wait(lock);
+  }
+}
+
+template <typename ExecutableType, typename ClientType>
+bool DeviceExecutablePersistor<ExecutableType, ClientType>::
+    IsCacheEntryFileName(absl::string_view file_name) const {
+  if (!absl::EndsWith(file_name, ".pb")) return false;
+  return persistence_prefix_.empty() ||
+         absl::StartsWith(file_name, absl::StrCat(persistence_prefix_, "__"));
+}
+
+template <typename ExecutableType, typename ClientType>
+void DeviceExecutablePersistor<ExecutableType, ClientType>::PrefetchEntries() {
+  XLA_SCOPED_LOGGING_TIMER(absl::StrCat("Prefetching persistent cache from ",
+                                        persistent_cache_directory_));
+  Env* env = Env::Default();
+  std::vector<std::string> children;
+  Status status = env->GetChildren(persistent_cache_directory_, &children);
+  if (!status.ok()) {
+    VLOG(1) << "Not prefetching persistent cache entries: " << status;
+    children.clear();
+  }
+  int num_prefetched = 0;
+  int64_t prefetched_bytes = 0;
+  for (const std::string& child : children) {
+    {
+      mutex_lock lock(mu_);
+      if (cancelled_) break;
+    }
+    if (!IsCacheEntryFileName(child)) continue;
+    const std::string file_path =
+        io::JoinPath(persistent_cache_directory_, child);
+    XlaSerializedCacheEntry entry;
+    status = ReadBinaryProto(env, file_path, &entry);
+    if (!status.ok()) {
+      VLOG(1) << "Skipping unreadable cache entry " << file_path << ": "
+              << status;
+      continue;
+    }
+    // Only keep entries that a load by this persistor could ask for; the file
+    // name is derived from the key, so this also rejects renamed files.
+    if (entry.key().device_type() != device_type_.type_string() ||
+        entry.key().prefix() != persistence_prefix_ ||
+        entry.key().compiler_fingerprint() != compiler_fingerprint_ ||
+        GetFilePath(entry.key()) != file_path) {
+      continue;
+    }
+    prefetched_bytes += entry.ByteSizeLong();
+    if (prefetched_bytes > max_prefetch_bytes_) {
+      VLOG(1) << "Stopping persistent cache prefetch after "
+              << max_prefetch_bytes_ << " bytes";
+      break;
+    }
+    mutex_lock lock(mu_);
+    prefetched_entries_.insert_or_assign(file_path, std::move(entry));
+    ++num_prefetched;
+  }
+  VLOG(1) << "Prefetched " << num_prefetched
+          << " persistent cache entries from " << persistent_cache_directory_;
+  mutex_lock lock(mu_);
+  prefetch_done_ = true;
+  prefetch_cv_.notify_all();
+}
+
+template <typename ExecutableType, typename ClientType>
+void DeviceExecutablePersistor<ExecutableType, ClientType>::MarkUsed(
+    const std::string& file_path) const {
+  if (max_cache_size_bytes_ <= 0) return;
+  const uint64 now = Env::Default()->NowMicros();
+  mutex_lock lock(mu_);
+  last_used_micros_[file_path] = now;
+}
+
+template <typename ExecutableType, typename ClientType>
+void DeviceExecutablePersistor<ExecutableType, ClientType>::
+    EvictLeastRecentlyUsedEntries(const std::string& keep_path) const {
+  Env* env = Env::Default();
+  std::vector<std::string> children;
+  if (!env->GetChildren(persistent_cache_directory_, &children).ok()) return;
+
+  struct CacheFile {
+    std::string path;
+    uint64 last_used_micros;
+    int64_t size;
+  };
+  std::vector<CacheFile> files;
+  int64_t total_size = 0;
+  for (const std::string& child : children) {
+    if (!IsCacheEntryFileName(child)) continue;
+    std::string path = io::JoinPath(persistent_cache_directory_, child);
+    FileStatistics stat;
+    if (!env->Stat(path, &stat).ok()) continue;
+    // Loads from other processes are not visible here, so the modification
+    // time is all we know about entries this process has not touched.
+    const uint64 mtime_micros = stat.mtime_nsec / 1000;
+    files.push_back({std::move(path), mtime_micros, stat.length});
+    total_size += stat.length;
+  }
+  if (total_size <= max_cache_size_bytes_) return;
+  {
+    mutex_lock lock(mu_);
+    for (CacheFile& file : files) {
+      if (auto it = last_used_micros_.find(file.path);
+          it != last_used_micros_.end()) {
+        file.last_used_micros = std::max(file.last_used_micros, it->second);
+      }
+    }
+  }
+
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile& a, const CacheFile& b) {
+              return a.last_used_micros < b.last_used_micros;
+            });
+  for (const CacheFile& file : files) {
+    if (total_size <= max_cache_size_bytes_) break;
+    if (file.path == keep_path) continue;
+    // Another process may have evicted the file already.
+    if (env->DeleteFile(file.path).ok()) {
+      VLOG(1) << "Evicted persistent cache entry " << file.path;
+    }
+    total_size -= file.size;
+    mutex_lock lock(mu_);
+    last_used_micros_.erase(file.path);
+    prefetched_entries_.erase(file.path);
+  }
+}
 
 template <typename ExecutableType, typename ClientType>
 std::string DeviceExecutablePersistor<ExecutableType, ClientType>::
@@ -181,6 +407,11 @@ std::string DeviceExecutablePersistor<ExecutableType, ClientType>::
       key.signature_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.cluster_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.device_type(),
+      key.compiler_fingerprint() == 0
+          ? ""
+          : absl::StrCat(
+                kXlaSerializedCacheKeySeparator,
+                absl::Hex(key.compiler_fingerprint(), absl::kZeroPad16)),
       key.compiled_using_pjrt()
           ? absl::StrCat(kXlaSerializedCacheKeySeparator, "pjrt")
           : "");
@@ -205,6 +436,7 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::BuildSerializedCacheKey(
   key.set_device_type(device_type().type_string());
   key.set_prefix(persistence_prefix());
   key.set_compiled_using_pjrt(compiled_using_pjrt);
+  key.set_compiler_fingerprint(compiler_fingerprint_);
   return key;
 }
 
@@ -231,6 +463,17 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::TryToReadSerializedEntry(
     const XlaSerializedCacheKey& key) const {
   Env* env = Env::Default();
   const std::string file_path = GetFilePath(key);
+  {
+    mutex_lock lock(mu_);
+    auto it = prefetched_entries_.find(file_path);
+    if (it != prefetched_entries_.end()) {
+      // The loaded executable is kept by the in-memory compilation cache, so
+      // the serialized copy is not needed anymore.
+      std::optional<XlaSerializedCacheEntry> entry(std::move(it->second));
+      prefetched_entries_.erase(it);
+      return entry;
+    }
+  }
   if (!env->FileExists(file_path).ok()) {
     return StatusOr<std::optional<XlaSerializedCacheEntry>>(std::nullopt);
   }
@@ -306,7 +549,13 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::SaveSerializedEntry(
         "Could not create a unique file inside ", persistent_cache_directory_));
   }
   TF_RETURN_IF_ERROR(WriteBinaryProto(env, temp_path, entry));
-  return env->RenameFile(temp_path, GetFilePath(entry.key()));
+  const std::string file_path = GetFilePath(entry.key());
+  TF_RETURN_IF_ERROR(env->RenameFile(temp_path, file_path));
+  if (max_cache_size_bytes_ > 0) {
+    MarkUsed(file_path);
+    EvictLeastRecentlyUsedEntries(file_path);
+  }
+  return OkStatus();
 }
 
 template <typename ExecutableType, typename ClientType>
@@ -374,6 +623,7 @@ DeviceExecutablePersistor<ExecutableType, ClientType>::TryToLoadExecutable(
 
   TF_RETURN_IF_ERROR(
       VerifyLoadedCacheEntry(cache_key, hlo_module, *serialized_entry));
+  MarkUsed(GetFilePath(cache_key));
 
   VLOG(1) << "Loading cached entry for: " << signature_str;
   return compiler_client->LoadExecutable(options, compilation_result,
@@ -201,6 +201,11 @@ std::string GetFilePath(XlaSerializedCacheKey key,
       key.signature_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.cluster_fingerprint(), kXlaSerializedCacheKeySeparator,
       key.device_type(),
+      key.compiler_fingerprint() == 0
+          ? ""
+          : absl::StrCat(
+                kXlaSerializedCacheKeySeparator,
+                absl::Hex(key.compiler_fingerprint(), absl::kZeroPad16)),
       key.compiled_using_pjrt()
           ? absl::StrCat(kXlaSerializedCacheKeySeparator, "pjrt")
           : "",
@@ -221,7 +226,7 @@ XlaSerializedCacheKey CreateCacheKey(
     uint64 signature_hash,
     const XlaCompiler::CompilationResult& compilation_result,
     const DeviceType& device_type, const std::string& persistence_prefix,
-    bool compiled_using_pjrt = false) {
+    bool compiled_using_pjrt = false, uint64 compiler_fingerprint = 0) {
   XlaSerializedCacheKey key;
   key.set_signature_fingerprint(signature_hash);
   key.set_cluster_fingerprint(
@@ -229,6 +234,7 @@ XlaSerializedCacheKey CreateCacheKey(
   key.set_device_type(device_type.type_string());
   key.set_prefix(persistence_prefix);
   key.set_compiled_using_pjrt(compiled_using_pjrt);
+  key.set_compiler_fingerprint(compiler_fingerprint);
   return key;
 }
 
@@ -628,5 +634,173 @@ TEST_F(DeviceExecutionPersistorTest, PersistPjRtAndXlaExecutables) {
   EXPECT_EQ(entry.executable(), serialized_xla_executable_);
 }
 
+
+TEST_F(DeviceExecutionPersistorTest, LoadCompilerFingerprintMismatch) {
+  const std::string cache_dir = io::JoinPath(cache_dir_, "fingerprint");
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/cache_dir,
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  config.compiler_fingerprint = 0xabc;
+  XlaDeviceExecutablePersistor persistor(config,
+                                         DefaultXlaOptions().device_type);
+
+  MockXlaCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillOnce(Return(serialized_xla_executable_));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  TF_EXPECT_OK(persistor.TryToPersistExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, *executable, &mock_client));
+
+  auto key = CreateCacheKey(
+      /*signature_hash=*/123, compilation_result_add_, persistor.device_type(),
+      persistor.persistence_prefix(), /*compiled_using_pjrt=*/false,
+      /*compiler_fingerprint=*/0xabc);
+  TF_ASSERT_OK_AND_ASSIGN(auto entry, ReadCacheEntryFromFile(key, cache_dir));
+  EXPECT_EQ(entry.executable(), serialized_xla_executable_);
+
+  // An executable produced by a different compiler is never loaded.
+  config.compiler_fingerprint = 0xdef;
+  XlaDeviceExecutablePersistor other_persistor(config,
+                                               DefaultXlaOptions().device_type);
+  auto loaded_executable = other_persistor.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, &mock_client);
+  EXPECT_FALSE(loaded_executable.has_value());
+
+  TF_ASSERT_OK_AND_ASSIGN(executable, BuildSampleExecutable());
+  EXPECT_CALL(mock_client, LoadExecutable(_, _, serialized_xla_executable_))
+      .WillOnce(Return(ByMove(std::move(executable))));
+  loaded_executable = persistor.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, &mock_client);
+  ASSERT_TRUE(loaded_executable.has_value());
+  TF_EXPECT_OK(loaded_executable->status());
+}
+
+TEST_F(DeviceExecutionPersistorTest, PersistEvictsLeastRecentlyUsed) {
+  const std::string cache_dir = io::JoinPath(cache_dir_, "lru");
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/cache_dir,
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  MockXlaCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillRepeatedly(Return(std::string(4096, 'x')));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+
+  // Persist two entries without a size limit.
+  {
+    XlaDeviceExecutablePersistor persistor(config,
+                                           DefaultXlaOptions().device_type);
+    for (uint64 signature_hash : {1, 2}) {
+      TF_EXPECT_OK(persistor.TryToPersistExecutable(
+          signature_hash, "signature_string", DefaultXlaOptions(),
+          compilation_result_add_, *executable, &mock_client));
+    }
+  }
+  auto key = [&](uint64 signature_hash) {
+    return CreateCacheKey(signature_hash, compilation_result_add_,
+                          DefaultXlaOptions().device_type, "xla");
+  };
+  uint64 entry_size = 0;
+  TF_ASSERT_OK(
+      Env::Default()->GetFileSize(GetFilePath(key(1), cache_dir), &entry_size));
+
+  // With room for two entries, persisting a third one evicts the least
+  // recently used entry. Loading entry 1 makes entry 2 the oldest one.
+  config.max_cache_size_bytes = 2 * entry_size + entry_size / 2;
+  XlaDeviceExecutablePersistor persistor(config,
+                                         DefaultXlaOptions().device_type);
+  EXPECT_CALL(mock_client, LoadExecutable(_, _, _))
+      .WillOnce(Return(ByMove(std::move(executable))));
+  auto loaded_executable = persistor.TryToLoadExecutable(
+      /*signature_hash=*/1, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, &mock_client);
+  ASSERT_TRUE(loaded_executable.has_value());
+  TF_ASSERT_OK(loaded_executable->status());
+
+  TF_EXPECT_OK(persistor.TryToPersistExecutable(
+      /*signature_hash=*/3, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, **loaded_executable.value(), &mock_client));
+
+  Env* env = Env::Default();
+  TF_EXPECT_OK(env->FileExists(GetFilePath(key(1), cache_dir)));
+  EXPECT_FALSE(env->FileExists(GetFilePath(key(2), cache_dir)).ok());
+  TF_EXPECT_OK(env->FileExists(GetFilePath(key(3), cache_dir)));
+}
+
+TEST_F(DeviceExecutionPersistorTest, LoadPrefetchedEntry) {
+  const std::string cache_dir = io::JoinPath(cache_dir_, "prefetch");
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/cache_dir,
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  MockXlaCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillOnce(Return(serialized_xla_executable_));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  {
+    XlaDeviceExecutablePersistor persistor(config,
+                                           DefaultXlaOptions().device_type);
+    TF_EXPECT_OK(persistor.TryToPersistExecutable(
+        /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+        compilation_result_add_, *executable, &mock_client));
+  }
+
+  config.prefetch = true;
+  XlaDeviceExecutablePersistor persistor(config,
+                                         DefaultXlaOptions().device_type);
+  persistor.WaitForPrefetch();
+
+  // The entry is served from memory once it has been prefetched.
+  auto key = CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
+                            persistor.device_type(), "xla");
+  TF_ASSERT_OK(Env::Default()->DeleteFile(GetFilePath(key, cache_dir)));
+
+  EXPECT_CALL(mock_client, LoadExecutable(_, _, serialized_xla_executable_))
+      .WillOnce(Return(ByMove(std::move(executable))));
+  auto loaded_executable = persistor.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, &mock_client);
+  ASSERT_TRUE(loaded_executable.has_value());
+  TF_EXPECT_OK(loaded_executable->status());
+}
+
+TEST_F(DeviceExecutionPersistorTest, PrefetchStopsAtMaxBytes) {
+  const std::string cache_dir = io::JoinPath(cache_dir_, "prefetch_max");
+  XlaDeviceExecutablePersistor::Config config(
+      /*persistent_cache_directory=*/cache_dir,
+      /*disable_strict_signature_checks=*/false,
+      /*persistence_prefix=*/"xla");
+  MockXlaCompilerClient mock_client;
+  EXPECT_CALL(mock_client, SerializeExecutable(_))
+      .WillOnce(Return(serialized_xla_executable_));
+  TF_ASSERT_OK_AND_ASSIGN(auto executable, BuildSampleExecutable());
+  {
+    XlaDeviceExecutablePersistor persistor(config,
+                                           DefaultXlaOptions().device_type);
+    TF_EXPECT_OK(persistor.TryToPersistExecutable(
+        /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+        compilation_result_add_, *executable, &mock_client));
+  }
+
+  config.prefetch = true;
+  config.max_prefetch_bytes = 1;
+  XlaDeviceExecutablePersistor persistor(config,
+                                         DefaultXlaOptions().device_type);
+  persistor.WaitForPrefetch();
+
+  // The entry is larger than the prefetch budget, so it is only on disk.
+  auto key = CreateCacheKey(/*signature_hash=*/123, compilation_result_add_,
+                            persistor.device_type(), "xla");
+  TF_ASSERT_OK(Env::Default()->DeleteFile(GetFilePath(key, cache_dir)));
+  auto loaded_executable = persistor.TryToLoadExecutable(
+      /*signature_hash=*/123, "signature_string", DefaultXlaOptions(),
+      compilation_result_add_, &mock_client);
+  EXPECT_FALSE(loaded_executable.has_value());
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -175,6 +175,16 @@ void AppendMarkForCompilationPassFlagsInternal(std::vector<Flag>* flag_list) {
            &mark_for_compilation_flags->tf_xla_persistent_cache_prefix,
            "Specifies the persistance cache prefix. Default is "
            "\"xla_compile_cache\""),
+      Flag("tf_xla_persistent_cache_max_size_mb",
+           &mark_for_compilation_flags->tf_xla_persistent_cache_max_size_mb,
+           "If positive, the least recently used entries of the persistent "
+           "cache are evicted to keep its size below this many megabytes. "
+           "Defaults to 0 (unbounded)."),
+      Flag("tf_xla_persistent_cache_prefetch",
+           &mark_for_compilation_flags->tf_xla_persistent_cache_prefetch,
+           "If true, existing persistent cache entries are read in the "
+           "background when the XLA compiler for a device is created. "
+           "Defaults to false."),
       Flag("tf_xla_sparse_core_disable_table_stacking",
            &sparse_core_flags->tf_xla_sparse_core_disable_table_stacking,
            "Disable table stacking for all the tables passed to the SparseCore"
@@ -245,6 +255,8 @@ void AllocateAndParseFlags() {
   mark_for_compilation_flags->tf_xla_disable_strict_signature_checks = false;
   mark_for_compilation_flags->tf_xla_persistent_cache_prefix =
       "xla_compile_cache";
+  mark_for_compilation_flags->tf_xla_persistent_cache_max_size_mb = 0;
+  mark_for_compilation_flags->tf_xla_persistent_cache_prefetch = false;
 
   device_flags = new XlaDeviceFlags;
   device_flags->tf_xla_compile_on_demand = false;
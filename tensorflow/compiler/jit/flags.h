@@ -111,6 +111,15 @@ struct MarkForCompilationPassFlags {
 
   // Specifies the persistance cache prefix. Default is "xla_compile_cache"
   string tf_xla_persistent_cache_prefix;
+
+  // If positive, the least recently used entries of the persistent cache are
+  // evicted to keep its size below this many megabytes. Defaults to 0
+  // (unbounded).
+  int64_t tf_xla_persistent_cache_max_size_mb;
+
+  // If true, existing persistent cache entries are read in the background when
+  // the compiler for a device is created. Defaults to false.
+  bool tf_xla_persistent_cache_prefetch;
 };
 
 // Flags associated with XLA Sparse Core.
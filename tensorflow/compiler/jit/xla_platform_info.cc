@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/compiler/jit/xla_platform_info.h"
 
+#include <cstdlib>
 #include <memory>
 #include <optional>
 #include <set>
@@ -24,6 +25,7 @@ limitations under the License.
 
 #include "absl/algorithm/container.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/jit/device_executable_persistor.h"
@@ -31,6 +33,7 @@ limitations under the License.
 #include "tensorflow/compiler/jit/pjrt_device_compiler_client.h"
 #include "tensorflow/compiler/jit/xla_compile_util.h"
 #include "tensorflow/compiler/jit/xla_device_compiler_client.h"
+#include "tensorflow/compiler/tf2xla/xla_op_registry.h"
 #include "xla/client/client_library.h"
 #include "xla/client/local_client.h"
 #include "xla/pjrt/pjrt_client.h"
@@ -38,7 +41,10 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/public/version.h"
 #include "tensorflow/core/tfrt/common/create_pjrt_client_util.h"
 #include "tensorflow/core/tfrt/common/global_state.h"
 #include "tensorflow/core/tfrt/common/pjrt_util.h"
@@ -56,6 +62,49 @@ using XlaDeviceExecutablePersistor =
 using PjRtDeviceExecutablePersistor =
     DeviceExecutablePersistor<xla::PjRtLoadedExecutable, xla::PjRtClient>;
 
+// Returns a fingerprint of everything besides the cluster itself that affects
+// the executables compiled for `device_type`, so that persisted executables are
+// not reused across TensorFlow versions, `XLA_FLAGS` changes or, for CPU, hosts
+// with a different instruction set.
+uint64 GetPersistentCacheCompilerFingerprint(const DeviceType& device_type) {
+  std::string fingerprint_str =
+      absl::StrCat(TF_VERSION_STRING, ";", device_type.type_string());
+  if (const char* xla_flags = std::getenv("XLA_FLAGS")) {
+    absl::StrAppend(&fingerprint_str, ";", xla_flags);
+  }
+  if (device_type == DEVICE_CPU || device_type == DEVICE_CPU_XLA_JIT) {
+    absl::StrAppend(&fingerprint_str, ";", port::CPUVendorIDString(), ";",
+                    port::CPUFamily(), ";", port::CPUModelNum(), ";");
+    for (int feature = 0; feature <= port::AMX_BF16; ++feature) {
+      absl::StrAppend(&fingerprint_str,
+                      port::TestCPUFeature(
+                          static_cast<port::CPUFeature>(feature)) ? "1" : "0");
+    }
+  }
+  return Fingerprint64(fingerprint_str);
+}
+
+// Builds the persistor config for `compilation_device_type` from the
+// `tf_xla_persistent_cache_*` flags.
+template <typename PersistorType>
+typename PersistorType::Config BuildPersistorConfig(
+    const DeviceType& compilation_device_type) {
+  const MarkForCompilationPassFlags* flags = GetMarkForCompilationPassFlags();
+  typename PersistorType::Config config(
+      GetPersistentCacheDirectory(compilation_device_type),
+      flags->tf_xla_disable_strict_signature_checks,
+      flags->tf_xla_persistent_cache_prefix,
+      flags->tf_xla_persistent_cache_read_only);
+  if (!config.persistent_cache_directory.empty()) {
+    config.compiler_fingerprint =
+        GetPersistentCacheCompilerFingerprint(compilation_device_type);
+    config.max_cache_size_bytes =
+        flags->tf_xla_persistent_cache_max_size_mb * 1024 * 1024;
+    config.prefetch = flags->tf_xla_persistent_cache_prefetch;
+  }
+  return config;
+}
+
 XlaDeviceCompiler* CreateXlaDeviceCompiler(
     const XlaDeviceExecutablePersistor::Config& persistor_config,
     DeviceType compilation_device_type, xla::LocalClient* local_client) {
@@ -67,14 +116,9 @@ XlaDeviceCompiler* CreateXlaDeviceCompiler(
 
 PjRtDeviceCompiler* CreatePjRtDeviceCompiler(DeviceType compilation_device_type,
                                              xla::PjRtClient* pjrt_client) {
-  std::string persistent_cache_directory =
-      GetPersistentCacheDirectory(compilation_device_type);
-
-  PjRtDeviceExecutablePersistor::Config persistor_config(
-      persistent_cache_directory,
-      GetMarkForCompilationPassFlags()->tf_xla_disable_strict_signature_checks,
-      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_prefix,
-      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_read_only);
+  PjRtDeviceExecutablePersistor::Config persistor_config =
+      BuildPersistorConfig<PjRtDeviceExecutablePersistor>(
+          compilation_device_type);
 
   return new PjRtDeviceCompiler(
       std::make_unique<PjRtDeviceExecutablePersistor>(
@@ -191,14 +235,9 @@ xla::StatusOr<std::optional<std::set<int>>> ParseVisibleDeviceList(
 Status BuildXlaDeviceCompiler(DeviceBase* device, FunctionLibraryRuntime* flr,
                               const XlaPlatformInfo& platform_info,
                               XlaDeviceCompiler** xla_device_compiler) {
-  std::string persistent_cache_directory =
-      GetPersistentCacheDirectory(platform_info.device_type());
-
-  XlaDeviceExecutablePersistor::Config persistor_config(
-      persistent_cache_directory,
-      GetMarkForCompilationPassFlags()->tf_xla_disable_strict_signature_checks,
-      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_prefix,
-      GetMarkForCompilationPassFlags()->tf_xla_persistent_cache_read_only);
+  XlaDeviceExecutablePersistor::Config persistor_config =
+      BuildPersistorConfig<XlaDeviceExecutablePersistor>(
+          platform_info.device_type());
 
   if (platform_info.xla_device_metadata()) {
     *xla_device_compiler = CreateXlaDeviceCompiler(
@@ -40,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/util/device_name_utils.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 
@@ -87,6 +88,37 @@ const char* GetCollectiveName(const CollectiveParams* cp, bool nccl) {
   }
 }
 
+// Reductions of CPU tensors of at most this many bytes use the recursive
+// halving-doubling algorithm, which takes fewer steps than the ring. 0, the
+// default, disables the selection by size.
+constexpr char kHalvingDoublingMaxBytesEnvVar[] =
+    "TF_COLLECTIVE_HALVING_DOUBLING_MAX_BYTES";
+
+// Returns true if the non-NCCL reduction `cp` should use the recursive
+// halving-doubling algorithm rather than the ring. The choice only depends on
+// the instance and the environment, so all the members of the group agree.
+bool UseHalvingDoubling(const CollectiveParams* cp) {
+  if (cp->instance.type != REDUCTION_COLLECTIVE ||
+      cp->group.device_type != DEVICE_CPU) {
+    return false;
+  }
+  if (cp->instance.impl_details.communication_hint == "halving_doubling") {
+    return true;
+  }
+  static const int64_t max_bytes = []() {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar(kHalvingDoublingMaxBytesEnvVar, 0, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << "Invalid " << kHalvingDoublingMaxBytesEnvVar << ": " << s;
+      return static_cast<int64_t>(0);
+    }
+    return value;
+  }();
+  const int64_t bytes =
+      cp->instance.shape.num_elements() * DataTypeSize(cp->instance.data_type);
+  return max_bytes > 0 && bytes <= max_bytes;
+}
+
 string TaskNameFromDeviceName(const string& device_name) {
   DeviceNameUtils::ParsedName parsed_device;
   CHECK(DeviceNameUtils::ParseFullName(device_name, &parsed_device));
@@ -698,7 +730,9 @@ void CollectiveParamResolverLocal::AssignCollectiveType(CollectiveParams* cp) {
       cp->group.device_type == DEVICE_GPU &&
       CollectiveRegistry::LookupParamResolverInstance("NcclReduce", &col_impl)
           .ok();
-  cp->instance.impl_details.collective_name = GetCollectiveName(cp, use_nccl);
+  cp->instance.impl_details.collective_name =
+      !use_nccl && UseHalvingDoubling(cp) ? "HalvingDoublingReduce"
+                                          : GetCollectiveName(cp, use_nccl);
   VLOG(1) << "AssignCollectiveType "
           << cp->instance.impl_details.collective_name;
 }
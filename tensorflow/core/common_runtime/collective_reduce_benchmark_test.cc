@@ -0,0 +1,155 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the CPU all-reduce implementations among N local workers,
+// e.g. to pick the TF_COLLECTIVE_RING_SEGMENT_BYTES and
+// TF_COLLECTIVE_HALVING_DOUBLING_MAX_BYTES of a host:
+//
+//   bazel run -c opt \
+//     //tensorflow/core/common_runtime:collective_reduce_benchmark_test -- \
+//     --benchmark_filter=all
+
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/collective_test_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/process_util.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kRingSegmentBytesEnvVar[] = "TF_COLLECTIVE_RING_SEGMENT_BYTES";
+
+std::unique_ptr<OpKernel> GetKernel(const string& op, DeviceBase* device) {
+  NodeDef node_def;
+  NodeDefBuilder builder(strings::StrCat(op, "_node"), op);
+  TF_CHECK_OK(builder.Attr("T", DT_FLOAT)
+                  .Input(FakeInput(DT_FLOAT))
+                  .Input(FakeInput(DT_FLOAT))
+                  .Finalize(&node_def));
+  Status status;
+  std::unique_ptr<OpKernel> k = CreateOpKernel(
+      DEVICE_CPU, device, device->GetAllocator(AllocatorAttributes()),
+      node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  return k;
+}
+
+// Averages a float tensor of `tensor_bytes` bytes among `num_workers` local
+// workers with one CPU device each, with the collective `collective_name`.
+void RunReduceBenchmark(::testing::benchmark::State& state,
+                        const string& collective_name, int num_workers,
+                        int64_t tensor_bytes) {
+  std::unique_ptr<CollectiveTestEnv> test_env =
+      CreateCollectiveTestEnv(num_workers, /*num_devices_per_worker=*/1,
+                              DEVICE_CPU);
+  const TensorShape shape({tensor_bytes / DataTypeSize(DT_FLOAT)});
+  std::vector<Device*> devices(num_workers);
+  std::vector<std::unique_ptr<OpKernel>> merge_ops, final_ops;
+  std::vector<Tensor> tensors;
+  for (int rank = 0; rank < num_workers; ++rank) {
+    auto col_params = CreateCollectiveParams(
+        *test_env, rank, collective_name, REDUCTION_COLLECTIVE, DT_FLOAT,
+        shape);
+    TF_CHECK_OK(test_env->device_mgr->LookupDevice(
+        col_params->group.members[rank].device.name(), &devices[rank]));
+    merge_ops.push_back(GetKernel("Add", devices[rank]));
+    final_ops.push_back(GetKernel("Div", devices[rank]));
+    tensors.emplace_back(DT_FLOAT, shape);
+    tensors.back().flat<float>().setConstant(rank);
+  }
+
+  for (auto s : state) {
+    BlockingCounter counter(num_workers);
+    for (int rank = 0; rank < num_workers; ++rank) {
+      SchedClosure([&, rank] {
+        // The params are initialized by each run of the collective, so they
+        // can't be reused.
+        auto col_params = CreateCollectiveParams(
+            *test_env, rank, collective_name, REDUCTION_COLLECTIVE, DT_FLOAT,
+            shape);
+        // Let the ring pick its subdivisions and segments.
+        col_params->instance.impl_details.subdiv_offsets.clear();
+        col_params->merge_op = merge_ops[rank].get();
+        col_params->final_op = final_ops[rank].get();
+        TF_CHECK_OK(RunCollective(test_env.get(), col_params.get(),
+                                  devices[rank], &tensors[rank],
+                                  &tensors[rank]));
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetBytesProcessed(state.iterations() * tensor_bytes);
+}
+
+void BM_RingReduce(::testing::benchmark::State& state) {
+  RunReduceBenchmark(state, "RingReduce", state.range(0), state.range(1));
+}
+
+// Sweeps the segment size of the pipelined ring, the last argument.
+void BM_PipelinedRingReduce(::testing::benchmark::State& state) {
+  setenv(kRingSegmentBytesEnvVar, strings::StrCat(state.range(2)).c_str(),
+         /*overwrite=*/1);
+  RunReduceBenchmark(state, "RingReduce", state.range(0), state.range(1));
+  unsetenv(kRingSegmentBytesEnvVar);
+}
+
+void BM_HalvingDoublingReduce(::testing::benchmark::State& state) {
+  RunReduceBenchmark(state, "HalvingDoublingReduce", state.range(0),
+                     state.range(1));
+}
+
+// Arguments: number of workers, tensor bytes.
+void ReduceArgs(::benchmark::internal::Benchmark* b) {
+  for (int num_workers : {2, 4, 6, 8}) {
+    for (int64_t tensor_bytes : {1 << 10, 1 << 14, 1 << 18, 1 << 22, 1 << 26}) {
+      b->Args({num_workers, tensor_bytes});
+    }
+  }
+}
+
+// Arguments: number of workers, tensor bytes, segment bytes.
+void PipelinedReduceArgs(::benchmark::internal::Benchmark* b) {
+  for (int num_workers : {4, 8}) {
+    for (int64_t tensor_bytes : {1 << 22, 1 << 26}) {
+      for (int64_t segment_bytes : {1 << 14, 1 << 16, 1 << 18, 1 << 20}) {
+        b->Args({num_workers, tensor_bytes, segment_bytes});
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_RingReduce)->UseRealTime()->Apply(ReduceArgs);
+BENCHMARK(BM_PipelinedRingReduce)->UseRealTime()->Apply(PipelinedReduceArgs);
+BENCHMARK(BM_HalvingDoublingReduce)->UseRealTime()->Apply(ReduceArgs);
+
+}  // namespace
+}  // namespace tensorflow
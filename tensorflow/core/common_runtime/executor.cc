@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -35,7 +36,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/config/flag_defs.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -62,6 +65,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/context.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/logging.h"
@@ -131,6 +135,25 @@ void SetMemory(NodeExecStatsInterface* stats, OpKernelContext* ctx) {
 
 }  // namespace nodestats
 
+// Statistics accumulated by one work-stealing worker loop, reported to
+// `metrics::UpdateExecutorWorkStealingStats()` when the loop exits.
+struct WorkStealingStats {
+  int64_t nodes_dequeued = 0;
+  int64_t nodes_processed = 0;
+  int64_t steals = 0;
+  int64_t queue_wait_nsec = 0;
+};
+
+// The work-stealing worker loop running on the current thread, if any. `state`
+// is the `ExecutorState` that owns the loop; kernels may run nested executors
+// synchronously, so each loop saves and restores the previous value.
+struct WorkStealingWorker {
+  const void* state = nullptr;
+  int slot = -1;
+  WorkStealingStats* stats = nullptr;
+};
+thread_local WorkStealingWorker current_work_stealing_worker;
+
 // Time the execution of kernels (in CPU cycles).  Used to dynamically identify
 // inexpensive kernels which can be dispatched inline.
 struct KernelTimer {
@@ -346,6 +369,51 @@ class ExecutorState {
   template <typename Closure>
   void RunTask(Closure&& c, int sample_rate = 0);
 
+  // Work-stealing dispatch, used instead of one `RunTask()` per expensive node
+  // when the `enable_executor_work_stealing` flag is set.
+  //
+  // Each worker slot owns a bounded deque of ready nodes. A worker loop that
+  // claims a slot pushes the expensive successors of the nodes it runs to the
+  // front of its own deque and pops them LIFO, while idle workers steal the
+  // oldest entries from the back of other deques. Nodes that become ready
+  // outside of a worker loop (the roots, or completions of asynchronous
+  // kernels) go to a shared injection queue. At most one closure is scheduled
+  // on `runner_` per idle slot, however many nodes become ready at once.
+  struct StealableNode {
+    absl::optional<TaggedNode> tagged_node;
+    int64_t scheduled_nsec = 0;
+    int64_t enqueued_nsec = 0;
+  };
+  typedef Eigen::RunQueue<StealableNode, 256> WorkStealingQueue;
+
+  struct WorkerSlot {
+    std::atomic<bool> claimed{false};
+    // Allocated by the first worker loop that claims the slot.
+    std::atomic<WorkStealingQueue*> queue{nullptr};
+  };
+
+  // Enqueues `nodes` for the worker loops and starts more loops if needed.
+  // The caller must hold a reference on `num_outstanding_ops_` for each node.
+  void EnqueueReadyNodes(const TaggedNodeSeq& nodes, int64_t scheduled_nsec);
+
+  // Claims idle worker slots, until `num_nodes` loops are running or all slots
+  // are claimed, and appends them to `slots`. Each claimed slot holds a
+  // reference on `num_outstanding_ops_` until its loop exits.
+  void ClaimWorkerSlots(int num_nodes, gtl::InlinedVector<int, 4>* slots);
+
+  // Schedules a worker loop for each of the claimed `slots`.
+  void StartWorkers(const gtl::InlinedVector<int, 4>& slots, int num_nodes);
+
+  // Runs ready nodes until no worker deque and the injection queue hold any.
+  void WorkerLoop(int slot);
+
+  // Returns the next node for the loop owning `slot`, or an empty node.
+  StealableNode NextReadyNode(int slot, WorkStealingQueue* own_queue,
+                              WorkStealingStats* stats);
+
+  // Returns true if any worker deque or the injection queue holds a node.
+  bool HasQueuedNodes();
+
   // Clean up when this executor is done.
   void Finish();
   void ScheduleFinish();
@@ -394,10 +462,22 @@ class ExecutorState {
   absl::optional<ManagedStackTrace> stack_trace_ = absl::nullopt;
   // If not null, use this device to schedule intra-op operation
   std::unique_ptr<DeviceBase> user_device_;
+  // If not null, small tensors with default attributes are carved out of this
+  // arena, which is released when the step ends.
+  StepArenaAllocator* step_arena_ = nullptr;
   Executor::Args::Runner runner_;
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
 
+  // Work-stealing state. Only used if `work_stealing_` is true.
+  const bool work_stealing_;
+  const int num_worker_slots_;
+  std::unique_ptr<WorkerSlot[]> worker_slots_;
+  std::atomic<int> num_active_workers_{0};
+  mutex injection_mu_;
+  std::deque<StealableNode> injection_queue_ TF_GUARDED_BY(injection_mu_);
+  std::atomic<int64_t> num_injected_nodes_{0};
+
   PropagatorStateType propagator_;
 
   // Invoked when the execution finishes.
@@ -446,8 +526,20 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
+      work_stealing_(!args.run_all_kernels_inline &&
+                     flags::Global().enable_executor_work_stealing.value()),
+      num_worker_slots_(work_stealing_ ? std::max(1, port::MaxParallelism())
+                                       : 0),
       propagator_(immutable_state, step_id_, vlog_),
       num_outstanding_ops_(0) {
+  if (work_stealing_) {
+    worker_slots_ = std::make_unique<WorkerSlot[]>(num_worker_slots_);
+  }
+  if (flags::Global().enable_executor_step_arena.value() &&
+      immutable_state_.params().device->device_type() == DEVICE_CPU) {
+    step_arena_ = new StepArenaAllocator(
+        immutable_state_.params().device->GetAllocator(AllocatorAttributes()));
+  }
   if (args.user_intra_op_threadpool != nullptr) {
     Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
@@ -460,6 +552,12 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
   if (device_context_) {
     device_context_->Unref();
   }
+  for (int i = 0; i < num_worker_slots_; ++i) {
+    delete worker_slots_[i].queue.load(std::memory_order_acquire);
+  }
+  if (step_arena_) {
+    step_arena_->Release();
+  }
   delete slice_reader_cache_;
 }
 
@@ -757,6 +855,7 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   params->start_time_usecs = start_time_usecs_;
   params->deadline = deadline_;
   params->log_memory = log_memory_;
+  params->step_allocator = step_arena_;
   params->rendezvous = rendezvous_;
   params->collective_executor = collective_executor_;
   params->session_state = session_state_;
@@ -804,8 +903,13 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   bool completed = false;
   int64_t last_iter_num = -1;
   std::unique_ptr<profiler::TraceMeConsumer> iteration_scope;
+  WorkStealingStats* const work_stealing_stats =
+      current_work_stealing_worker.state == this
+          ? current_work_stealing_worker.stats
+          : nullptr;
   while (!inline_ready->empty()) {
     TaggedNode tagged_node = inline_ready->front();
+    if (work_stealing_stats) ++work_stealing_stats->nodes_processed;
 
     int64_t current_iter_num = tagged_node.get_iter_num();
     if (current_iter_num != last_iter_num) {
@@ -1298,10 +1402,14 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
     if (inline_ready == nullptr) {
-      // Schedule to run all the ready ops in thread pool.
-      for (auto& tagged_node : *ready) {
-        RunTask([=]() { Process(tagged_node, scheduled_nsec); },
-                /*sample_rate=*/ready->size());
+      if (work_stealing_) {
+        EnqueueReadyNodes(*ready, scheduled_nsec);
+      } else {
+        // Schedule to run all the ready ops in thread pool.
+        for (auto& tagged_node : *ready) {
+          RunTask([=]() { Process(tagged_node, scheduled_nsec); },
+                  /*sample_rate=*/ready->size());
+        }
       }
     } else {
       for (auto& tagged_node : *ready) {
@@ -1327,7 +1435,9 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
     if (!expensive_nodes.empty()) {
-      if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
+      if (work_stealing_) {
+        EnqueueReadyNodes(expensive_nodes, scheduled_nsec);
+      } else if (expensive_nodes.size() < kInlineScheduleReadyThreshold) {
         for (auto& tagged_node : expensive_nodes) {
           RunTask(std::bind(&ExecutorState::Process, this, tagged_node,
                             scheduled_nsec),
@@ -1371,6 +1481,169 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   ready->clear();
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::EnqueueReadyNodes(
+    const TaggedNodeSeq& nodes, int64_t scheduled_nsec) {
+  // Once the nodes are visible, other worker loops can run them and complete
+  // the step, which deletes `this`. The caller's references on the nodes keep
+  // the step alive until then, and this one until we are done with `this`.
+  num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+  const int num_nodes = static_cast<int>(nodes.size());
+  // The loops that run the nodes are claimed before the nodes are published.
+  gtl::InlinedVector<int, 4> slots;
+  ClaimWorkerSlots(num_nodes, &slots);
+
+  const int64_t enqueued_nsec = nodestats::NowInNsec();
+  const WorkStealingWorker& worker = current_work_stealing_worker;
+  WorkStealingQueue* own_queue =
+      worker.state == this
+          ? worker_slots_[worker.slot].queue.load(std::memory_order_relaxed)
+          : nullptr;
+
+  std::vector<StealableNode> overflow;
+  for (const TaggedNode& tagged_node : nodes) {
+    StealableNode node{tagged_node, scheduled_nsec, enqueued_nsec};
+    if (own_queue != nullptr) {
+      // `PushFront()` hands the node back if the deque is full.
+      node = own_queue->PushFront(std::move(node));
+      if (!node.tagged_node) continue;
+    }
+    overflow.push_back(std::move(node));
+  }
+  if (!overflow.empty()) {
+    mutex_lock l(injection_mu_);
+    for (StealableNode& node : overflow) {
+      injection_queue_.push_back(std::move(node));
+    }
+    num_injected_nodes_.fetch_add(overflow.size(), std::memory_order_relaxed);
+  }
+
+  const int num_claimed = static_cast<int>(slots.size());
+  if (num_claimed < num_nodes) {
+    // Pairs with the fence in `WorkerLoop()`: either a worker that is about to
+    // exit observes these nodes, or we observe its released slot.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ClaimWorkerSlots(num_nodes - num_claimed, &slots);
+  }
+  StartWorkers(slots, num_nodes);
+
+  if (num_outstanding_ops_.fetch_sub(1) == 1) {
+    ScheduleFinish();
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ClaimWorkerSlots(
+    int num_nodes, gtl::InlinedVector<int, 4>* slots) {
+  for (int i = 0; i < num_worker_slots_ && num_nodes > 0; ++i) {
+    if (num_active_workers_.load() >= num_worker_slots_) return;
+    bool claimed = false;
+    if (worker_slots_[i].claimed.load(std::memory_order_relaxed) ||
+        !worker_slots_[i].claimed.compare_exchange_strong(claimed, true)) {
+      continue;
+    }
+    num_active_workers_.fetch_add(1);
+    // A running worker loop keeps the step alive, so that it can safely touch
+    // `this` after the last node completes.
+    num_outstanding_ops_.fetch_add(1, std::memory_order_relaxed);
+    slots->push_back(i);
+    --num_nodes;
+  }
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::StartWorkers(
+    const gtl::InlinedVector<int, 4>& slots, int num_nodes) {
+  for (int slot : slots) {
+    RunTask([this, slot]() { WorkerLoop(slot); }, /*sample_rate=*/num_nodes);
+  }
+}
+
+template <class PropagatorStateType>
+typename ExecutorState<PropagatorStateType>::StealableNode
+ExecutorState<PropagatorStateType>::NextReadyNode(int slot,
+                                                  WorkStealingQueue* own_queue,
+                                                  WorkStealingStats* stats) {
+  StealableNode node = own_queue->PopFront();
+  if (node.tagged_node) return node;
+
+  if (num_injected_nodes_.load(std::memory_order_relaxed) > 0) {
+    mutex_lock l(injection_mu_);
+    if (!injection_queue_.empty()) {
+      node = std::move(injection_queue_.front());
+      injection_queue_.pop_front();
+      num_injected_nodes_.fetch_sub(1, std::memory_order_relaxed);
+      return node;
+    }
+  }
+
+  for (int i = 1; i < num_worker_slots_; ++i) {
+    WorkStealingQueue* victim =
+        worker_slots_[(slot + i) % num_worker_slots_].queue.load(
+            std::memory_order_acquire);
+    if (victim == nullptr || victim->Empty()) continue;
+    node = victim->PopBack();
+    if (node.tagged_node) {
+      ++stats->steals;
+      return node;
+    }
+  }
+  return node;
+}
+
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::HasQueuedNodes() {
+  if (num_injected_nodes_.load() > 0) return true;
+  for (int i = 0; i < num_worker_slots_; ++i) {
+    WorkStealingQueue* queue =
+        worker_slots_[i].queue.load(std::memory_order_acquire);
+    if (queue != nullptr && !queue->Empty()) return true;
+  }
+  return false;
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::WorkerLoop(int slot) {
+  WorkerSlot& worker_slot = worker_slots_[slot];
+  WorkStealingQueue* own_queue =
+      worker_slot.queue.load(std::memory_order_acquire);
+  if (own_queue == nullptr) {
+    own_queue = new WorkStealingQueue();
+    worker_slot.queue.store(own_queue, std::memory_order_release);
+  }
+
+  WorkStealingStats stats;
+  const WorkStealingWorker saved_worker = current_work_stealing_worker;
+  current_work_stealing_worker = {this, slot, &stats};
+  while (true) {
+    StealableNode node = NextReadyNode(slot, own_queue, &stats);
+    if (!node.tagged_node) {
+      worker_slot.claimed.store(false);
+      num_active_workers_.fetch_sub(1);
+      // Pairs with the fence in `EnqueueReadyNodes()`.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      bool claimed = false;
+      if (!HasQueuedNodes() ||
+          !worker_slot.claimed.compare_exchange_strong(claimed, true)) {
+        break;
+      }
+      num_active_workers_.fetch_add(1);
+      continue;
+    }
+    ++stats.nodes_dequeued;
+    stats.queue_wait_nsec += nodestats::NowInNsec() - node.enqueued_nsec;
+    Process(*node.tagged_node, node.scheduled_nsec);
+  }
+  current_work_stealing_worker = saved_worker;
+
+  metrics::UpdateExecutorWorkStealingStats(
+      stats.steals, stats.nodes_processed - stats.nodes_dequeued,
+      stats.queue_wait_nsec / EnvTime::kMicrosToNanos);
+  if (num_outstanding_ops_.fetch_sub(1) == 1) {
+    ScheduleFinish();
+  }
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleFinish() {
   // Checks condition to decide if needs to invoke Finish(). If there are
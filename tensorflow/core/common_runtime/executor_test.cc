@@ -30,11 +30,13 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/config/flag_defs.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/local_rendezvous.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
@@ -432,6 +434,89 @@ TEST_F(ExecutorTest, RecvInvalidRefDtype) {
   rendez->Unref();
 }
 
+TEST_F(ExecutorTest, WorkStealingWideGraph) {
+  // 64 chains of 4 doublings of a, summed into c.
+  flags::Global().enable_executor_work_stealing.reset(true);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  Node* sum = nullptr;
+  for (int i = 0; i < 64; ++i) {
+    Node* v = in0;
+    for (int j = 0; j < 4; ++j) {
+      v = test::graph::Add(g.get(), v, v);
+    }
+    sum = sum ? test::graph::Add(g.get(), sum, v) : v;
+  }
+  test::graph::Send(g.get(), sum, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int step = 0; step < 10; ++step) {
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(1024.0, V(out));
+  }
+  flags::Global().enable_executor_work_stealing.reset(false);
+}
+
+TEST_F(ExecutorTest, WorkStealingManyShortSteps) {
+  // Every step enqueues 32 roots and finishes quickly, so the worker loops
+  // often complete a step while its roots are still being enqueued. Run under
+  // ASAN or TSAN to catch accesses to the state of a finished step.
+  flags::Global().enable_executor_work_stealing.reset(true);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Node* sum = nullptr;
+  for (int i = 0; i < 32; ++i) {
+    Node* c = test::graph::Constant(g.get(), V(1.0));
+    sum = sum ? test::graph::Add(g.get(), sum, c) : c;
+  }
+  test::graph::Send(g.get(), sum, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  for (int step = 0; step < 2000; ++step) {
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(32.0, V(out));
+  }
+  flags::Global().enable_executor_work_stealing.reset(false);
+}
+
+TEST_F(ExecutorTest, StepArenaDoesNotServeEscapingOutputs) {
+  // The result is received after the executor state, and with it the arena,
+  // has been released. Outputs may escape the step like this, so they must
+  // not pin an arena block.
+  flags::Global().enable_executor_step_arena.reset(true);
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  Node* v = in0;
+  for (int i = 0; i < 8; ++i) {
+    v = test::graph::Add(g.get(), v, in0);
+  }
+  test::graph::Send(g.get(), v, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));
+  TF_ASSERT_OK(Run(rendez_));
+  flags::Global().enable_executor_step_arena.reset(false);
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_EQ(9.0, V(out));
+  TensorDescription description;
+  out.FillDescription(&description);
+  EXPECT_NE(description.allocation_description().allocator_name(),
+            "step_arena");
+}
+
 TEST_F(ExecutorTest, NoInputTensors) {
   // Create a graph where none of the nodes have input tensors.
   auto g = std::make_unique<Graph>(OpRegistry::Global());
@@ -494,6 +579,87 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// Create a graph of 'width' independent chains that are each 'depth' small
+// MatMuls deep, and run it with the work-stealing ready queue enabled iff the
+// third argument is nonzero. The MatMuls stay above the executor's "expensive"
+// threshold, so every successor goes through the ready queue.
+static void BM_executor_work_stealing(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool work_stealing = state.range(2) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor weights(DT_FLOAT, TensorShape({32, 32}));
+  weights.flat<float>().setConstant(1.0f / 32);
+  Node* w = test::graph::Constant(g, weights);
+  for (int i = 0; i < width; ++i) {
+    Node* v = w;
+    for (int j = 0; j < depth; ++j) {
+      v = test::graph::Matmul(g, v, w, false, false);
+    }
+  }
+  FixupSourceAndSinkEdges(g);
+
+  flags::Global().enable_executor_work_stealing.reset(work_stealing);
+  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  flags::Global().enable_executor_work_stealing.reset(false);
+
+  state.SetLabel(strings::StrCat("Nodes = ", 1 + width * depth));
+  state.SetItemsProcessed(width * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+// Wide graphs
+BENCHMARK(BM_executor_work_stealing)
+    ->UseRealTime()
+    ->Args({1024, 1, 0})
+    ->Args({1024, 1, 1})
+    ->Args({256, 8, 0})
+    ->Args({256, 8, 1});
+
+// Deep graphs
+BENCHMARK(BM_executor_work_stealing)
+    ->UseRealTime()
+    ->Args({4, 512, 0})
+    ->Args({4, 512, 1})
+    ->Args({16, 128, 0})
+    ->Args({16, 128, 1});
+
+// Create a graph of 'width' chains of 'depth' scalar Adds, whose cost is
+// dominated by per-node overhead, and run it with the per-step arena enabled
+// iff the third argument is nonzero. The Adds allocate no step temps, so this
+// measures the fixed per-step cost of the arena.
+static void BM_executor_step_arena(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool step_arena = state.range(2) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* one = test::graph::Constant(g, V(1.0));
+  for (int i = 0; i < width; ++i) {
+    Node* v = one;
+    for (int j = 0; j < depth; ++j) {
+      v = test::graph::Add(g, v, one);
+    }
+  }
+  FixupSourceAndSinkEdges(g);
+
+  flags::Global().enable_executor_step_arena.reset(step_arena);
+  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  flags::Global().enable_executor_step_arena.reset(false);
+
+  state.SetLabel(strings::StrCat("Nodes = ", 1 + width * depth));
+  state.SetItemsProcessed(width * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_executor_step_arena)
+    ->UseRealTime()
+    ->Args({1, 1024, 0})
+    ->Args({1, 1024, 1})
+    ->Args({64, 64, 0})
+    ->Args({64, 64, 1});
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
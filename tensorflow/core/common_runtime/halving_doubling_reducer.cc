@@ -0,0 +1,279 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/halving_doubling_reducer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "tensorflow/core/common_runtime/collective_rma_local.h"
+#include "tensorflow/core/common_runtime/collective_util.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the largest power of two not larger than `n`.
+int LargestPowerOfTwo(int n) {
+  int p = 1;
+  while (p * 2 <= n) p *= 2;
+  return p;
+}
+
+}  // namespace
+
+HalvingDoublingReducer::HalvingDoublingReducer()
+    : col_ctx_(nullptr), col_params_(nullptr), num_pieces_(0) {}
+
+Status HalvingDoublingReducer::InitializeCollectiveParams(
+    CollectiveParams* col_params) {
+  if (col_params->instance.type != REDUCTION_COLLECTIVE) {
+    return errors::Internal("HalvingDoublingReduce expects a reduction, got ",
+                            col_params->instance.type);
+  }
+  if (col_params->group.device_type != DEVICE_CPU) {
+    return errors::Unimplemented(
+        "HalvingDoublingReduce is only implemented on CPU, got ",
+        col_params->group.device_type.type_string());
+  }
+  return OkStatus();
+}
+
+Status HalvingDoublingReducer::InitializeCollectiveContext(
+    std::shared_ptr<CollectiveContext> col_ctx) {
+  DCHECK(col_ctx->dev_mgr);
+  col_ctx_ = col_ctx;
+  col_params_ = col_ctx->col_params.get();
+  return collective_util::InitializeDeviceAndLocality(
+      col_ctx->dev_mgr, col_ctx->device_name, &col_ctx->device,
+      &col_ctx->device_locality);
+}
+
+void HalvingDoublingReducer::Run(StatusCallback done) {
+  CHECK(col_ctx_);
+  CHECK(col_params_);
+  // Like `RingReducer`, this doesn't require non-overlapping collectives.
+  col_ctx_->col_exec->UnblockDependencies(*col_params_);
+
+  // Start by copying input to output if they're not already the same, i.e. if
+  // we're not computing in-place on the input tensor.
+  if ((col_ctx_->input != col_ctx_->output) &&
+      (DMAHelper::base(col_ctx_->input) != DMAHelper::base(col_ctx_->output))) {
+    Notification note;
+    Status status;
+    profiler::TraceMe activity("MemCpyAsync", profiler::TraceMeLevel::kInfo);
+    CollectiveRemoteAccessLocal::MemCpyAsync(
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->op_device_context(), col_ctx_->device,
+        col_ctx_->device, col_ctx_->op_ctx->input_alloc_attr(0),
+        col_ctx_->op_ctx->output_alloc_attr(0), col_ctx_->input,
+        col_ctx_->output, 0 /*dev_to_dev_stream_index*/,
+        [&note, &status](const Status& s) {
+          status.Update(s);
+          note.Notify();
+        });
+    note.WaitForNotification();
+    if (!status.ok()) {
+      done(status);
+      return;
+    }
+  }
+
+  num_pieces_ = LargestPowerOfTwo(col_params_->group.group_size);
+  AllocatorAttributes attr = col_ctx_->op_ctx->output_alloc_attr(0);
+  ca_.reset(MakeCollectiveAdapter(col_ctx_->output, num_pieces_,
+                                  col_ctx_->device->GetAllocator(attr)));
+  Status s = RunSteps();
+  if (s.ok()) {
+    ca_->ConsumeFinalValue(col_ctx_->output);
+  } else {
+    LOG(ERROR) << "Aborting HalvingDoublingReduce with " << s;
+    // As in RingAlg::StartAbort, a cancellation already cancels the pending
+    // sends and receives.
+    if (col_ctx_->op_ctx->cancellation_manager() == nullptr ||
+        (!col_ctx_->op_ctx->cancellation_manager()->IsCancelled() &&
+         !col_ctx_->op_ctx->cancellation_manager()->IsCancelling())) {
+      col_ctx_->col_exec->StartAbort(s);
+    }
+  }
+  ca_.reset();
+  done(s);
+}
+
+// Note that this function is blocking and must not run in any thread
+// which cannot be blocked.
+Status HalvingDoublingReducer::RunSteps() {
+  const int group_size = col_params_->group.group_size;
+  const int rank = col_params_->default_rank;
+  // The first 2 * num_extra ranks are paired up, and the even rank of each pair
+  // sits out of the halving and doubling steps.
+  const int num_extra = group_size - num_pieces_;
+  int num_steps = 0;
+  for (int mask = 1; mask < num_pieces_; mask *= 2) ++num_steps;
+  const int post_step = 2 * num_steps + 1;
+  Tensor value = ca_->Value();
+  Allocator* allocator =
+      col_ctx_->device->GetAllocator(col_ctx_->op_ctx->output_alloc_attr(0));
+
+  if (rank < 2 * num_extra) {
+    if (rank % 2 == 0) {
+      // Hand the value over to the next rank, and wait for the result.
+      TF_RETURN_IF_ERROR(Exchange(0, rank + 1, &value, nullptr));
+      return Exchange(post_step, rank + 1, nullptr, &value);
+    }
+    Tensor received(allocator, value.dtype(), value.shape());
+    TF_RETURN_IF_ERROR(Exchange(0, rank - 1, nullptr, &received));
+    TF_RETURN_IF_ERROR(Reduce(&value, &received));
+  }
+  // The rank among the devices taking part in the halving and doubling steps.
+  const int new_rank = rank < 2 * num_extra ? rank / 2 : rank - num_extra;
+  auto peer_rank = [num_extra](int new_peer) {
+    return new_peer < num_extra ? 2 * new_peer + 1 : new_peer + num_extra;
+  };
+
+  // Reduce-scatter by recursive halving. At each step the pieces [begin, end)
+  // this device is reducing are split in two, the half not containing piece
+  // `new_rank` is sent to the peer, and the peer's copy of the other half is
+  // reduced into it.
+  int begin = 0;
+  int end = num_pieces_;
+  int step = 1;
+  for (int mask = num_pieces_ / 2; mask >= 1; mask /= 2, ++step) {
+    const int mid = begin + mask;
+    int send_begin = mid, send_end = end;
+    if (new_rank & mask) {
+      send_begin = begin;
+      send_end = mid;
+      begin = mid;
+    } else {
+      end = mid;
+    }
+    Tensor send = PieceRangeAlias(send_begin, send_end);
+    Tensor keep = PieceRangeAlias(begin, end);
+    Tensor received(allocator, keep.dtype(), keep.shape());
+    TF_RETURN_IF_ERROR(
+        Exchange(step, peer_rank(new_rank ^ mask), &send, &received));
+    TF_RETURN_IF_ERROR(Reduce(&keep, &received));
+  }
+  DCHECK_EQ(begin, new_rank);
+
+  Tensor piece = PieceRangeAlias(new_rank, new_rank + 1);
+  if (col_params_->final_op && piece.NumElements() > 0) {
+    Tensor group_size_tensor = ca_->Scalar(group_size);
+    TF_RETURN_IF_ERROR(collective_util::ComputeBinOp(
+        col_ctx_->op_ctx, col_ctx_->op_params, col_ctx_->device,
+        col_params_->final_op, &piece, &group_size_tensor));
+  }
+
+  // Allgather by recursive doubling. At each step the reduced pieces this
+  // device has are exchanged with the peer's, which are adjacent to them.
+  for (int mask = 1; mask < num_pieces_; mask *= 2, ++step) {
+    const int own_begin = new_rank & ~(mask - 1);
+    const int peer_begin = (new_rank ^ mask) & ~(mask - 1);
+    Tensor send = PieceRangeAlias(own_begin, own_begin + mask);
+    Tensor recv = PieceRangeAlias(peer_begin, peer_begin + mask);
+    TF_RETURN_IF_ERROR(
+        Exchange(step, peer_rank(new_rank ^ mask), &send, &recv));
+  }
+  DCHECK_EQ(step, post_step);
+
+  if (rank < 2 * num_extra) {
+    TF_RETURN_IF_ERROR(Exchange(post_step, rank - 1, &value, nullptr));
+  }
+  return OkStatus();
+}
+
+Tensor HalvingDoublingReducer::PieceRangeAlias(int begin, int end) const {
+  const Tensor& value = ca_->Value();
+  const int64_t total_elts = value.NumElements();
+  const int64_t piece_elts = CollectiveAdapter::AlignedChunkElts(
+      DataTypeSize(value.dtype()), total_elts, num_pieces_);
+  const int64_t start = std::min(total_elts, begin * piece_elts);
+  const int64_t limit = std::min(total_elts, end * piece_elts);
+  // As in CollectiveAdapter::ChunkAlias, empty ranges are taken from the front
+  // of the tensor to keep the slice offset valid.
+  return start < limit ? value.Slice(start, limit) : value.Slice(0, 0);
+}
+
+Status HalvingDoublingReducer::Exchange(int step, int peer, const Tensor* send,
+                                        Tensor* recv) {
+  // Both devices agree on the size of the exchanged pieces, so empty pieces
+  // are skipped on both sides.
+  if (send != nullptr && send->NumElements() == 0) send = nullptr;
+  if (recv != nullptr && recv->NumElements() == 0) recv = nullptr;
+  const int rank = col_params_->default_rank;
+  const CollGroupMember& member = col_params_->group.members[peer];
+  Notification send_note, recv_note;
+  Status send_status, recv_status;
+  if (send != nullptr) {
+    const string send_key =
+        strings::StrCat(col_ctx_->exec_key, ":", step, ":", rank);
+    VLOG(3) << "HalvingDoublingReduce rank=" << rank << " send key "
+            << send_key << " to " << peer;
+    col_ctx_->col_exec->remote_access()->PostToPeer(
+        member.device.name(), member.task, send_key, col_ctx_->device,
+        col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->output_alloc_attr(0), send,
+        col_ctx_->device_locality, col_ctx_->op_ctx->cancellation_manager(),
+        [&send_note, &send_status](const Status& s) {
+          send_status = s;
+          send_note.Notify();
+        });
+  }
+  if (recv != nullptr) {
+    const string recv_key =
+        strings::StrCat(col_ctx_->exec_key, ":", step, ":", peer);
+    VLOG(3) << "HalvingDoublingReduce rank=" << rank << " recv key "
+            << recv_key << " from " << peer;
+    col_ctx_->col_exec->remote_access()->RecvFromPeer(
+        member.device.name(), member.task, member.is_local, recv_key,
+        col_ctx_->device, col_ctx_->op_ctx->op_device_context(),
+        col_ctx_->op_ctx->output_alloc_attr(0), recv,
+        col_ctx_->device_locality, 0 /*dev_to_dev_stream_index*/,
+        col_ctx_->op_ctx->cancellation_manager(),
+        [&recv_note, &recv_status](const Status& s) {
+          recv_status = s;
+          recv_note.Notify();
+        });
+  }
+  if (send != nullptr) send_note.WaitForNotification();
+  if (recv != nullptr) recv_note.WaitForNotification();
+  TF_RETURN_IF_ERROR(send_status);
+  return recv_status;
+}
+
+Status HalvingDoublingReducer::Reduce(Tensor* output, Tensor* input) {
+  if (output->NumElements() == 0) return OkStatus();
+  return collective_util::ComputeBinOp(col_ctx_->op_ctx, col_ctx_->op_params,
+                                       col_ctx_->device, col_params_->merge_op,
+                                       output, input);
+}
+
+namespace {
+REGISTER_COLLECTIVE(HalvingDoublingReduce, HalvingDoublingReducer);
+}  // namespace
+
+}  // namespace tensorflow
@@ -0,0 +1,74 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/common_runtime/base_collective_executor.h"
+#include "tensorflow/core/framework/collective.h"
+#include "tensorflow/core/framework/device.h"
+
+namespace tensorflow {
+
+// Recursive halving-doubling implementation of collective all-reduce on CPU.
+//
+// The tensor is reduce-scattered by recursive halving: at each of the log2(n)
+// steps every device exchanges half of the part it is reducing with a partner,
+// and keeps reducing the other half. The reduced parts are then all-gathered
+// by recursive doubling. Each device sends and receives about twice the size
+// of the tensor, as with a ring, but in 2 * log2(n) rather than 2 * (n - 1)
+// steps, which makes it faster for small tensors where the latency of the
+// steps dominates. When the group size n isn't a power of two, the extra
+// devices first hand their tensor over to a neighbor, and receive the result
+// at the end.
+class HalvingDoublingReducer : public CollectiveImplementationInterface {
+ public:
+  HalvingDoublingReducer();
+
+  Status InitializeCollectiveParams(CollectiveParams* col_params) override;
+
+  // Initializes members of CollectiveContext not yet initialized, i.e. device
+  // and device_locality.  Also saves the CollectiveContext in this object.
+  Status InitializeCollectiveContext(
+      std::shared_ptr<CollectiveContext> col_ctx) override;
+
+  // Must be called in a blockable thread.
+  void Run(StatusCallback done) override;
+
+ private:
+  Status RunSteps();
+
+  // Returns the tensor aliasing the pieces [begin, end) of the value.
+  Tensor PieceRangeAlias(int begin, int end) const;
+
+  // Sends `send` to and receives `recv` from the device of rank `peer` at step
+  // `step`, and waits for both. Either tensor can be null.
+  Status Exchange(int step, int peer, const Tensor* send, Tensor* recv);
+
+  // Reduces `input` into `output` with the merge op.
+  Status Reduce(Tensor* output, Tensor* input);
+
+  std::shared_ptr<CollectiveContext> col_ctx_;
+  const CollectiveParams* col_params_;  // Not owned
+  std::unique_ptr<CollectiveAdapter> ca_;
+  // Number of pieces the value is split into, i.e. the largest power of two
+  // not larger than the group size.
+  int num_pieces_;
+};
+
+}  // namespace tensorflow
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_HALVING_DOUBLING_REDUCER_H_
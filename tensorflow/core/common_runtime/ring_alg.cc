@@ -16,9 +16,11 @@ limitations under the License.
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/collective_rma_local.h"
 #include "tensorflow/core/common_runtime/collective_util.h"
@@ -39,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 
 // Set true for greater intelligibility of debug mode log messages.
 #define READABLE_KEYS false
@@ -53,6 +56,16 @@ constexpr size_t kMaxChunkSizeBytes = (4 * 1024 * 1024);
 // through the collectives API. A reasonable value would be a small
 // multiple of the number of NICs adjacent to each device.
 constexpr int kMaxSubdivsPerDeviceDefault = 2;
+// Ring reductions on CPU can pipeline the transfer and the reduction of each
+// chunk by splitting it into segments of at most this many bytes, which are
+// sent, received and reduced independently: a segment is reduced while the
+// next ones are in flight. Segments are only generated when the subdivision
+// offsets aren't specified, and every member of the group must use the same
+// value.
+constexpr char kRingSegmentBytesEnvVar[] = "TF_COLLECTIVE_RING_SEGMENT_BYTES";
+// Upper bound on the number of RingFields, i.e. on the number of chunks times
+// the number of subdivisions, once segmented.
+constexpr int kMaxRingFields = 4096;
 
 namespace tensorflow {
 namespace {
@@ -175,6 +188,41 @@ Status GenerateSubdivsInCollectiveParams(CollectiveParams* col_params) {
 
   return OkStatus();
 }
+
+// Splits the chunks of the subdivisions into segments of at most
+// kRingSegmentBytesEnvVar bytes, by repeating the subdivision offsets: the
+// ring of each subdivision is reused by its segments.
+Status SegmentSubdivsInCollectiveParams(CollectiveParams* col_params) {
+  int64_t segment_bytes;
+  TF_RETURN_IF_ERROR(
+      ReadInt64FromEnvVar(kRingSegmentBytesEnvVar, 0, &segment_bytes));
+  if (segment_bytes <= 0) {
+    return OkStatus();
+  }
+  std::vector<int>& subdiv_offsets =
+      col_params->instance.impl_details.subdiv_offsets;
+  const int num_chunks =
+      col_params->group.group_size * static_cast<int>(subdiv_offsets.size());
+  const int64_t tensor_size = col_params->instance.shape.num_elements() *
+                              DataTypeSize(col_params->instance.data_type);
+  const int64_t chunk_size = tensor_size / num_chunks;
+  const int64_t num_segments =
+      std::min<int64_t>((chunk_size + segment_bytes - 1) / segment_bytes,
+                        kMaxRingFields / num_chunks);
+  if (num_segments <= 1) {
+    return OkStatus();
+  }
+  std::vector<int> segment_offsets;
+  segment_offsets.reserve(num_segments * subdiv_offsets.size());
+  for (int segment = 0; segment < num_segments; ++segment) {
+    segment_offsets.insert(segment_offsets.end(), subdiv_offsets.begin(),
+                           subdiv_offsets.end());
+  }
+  subdiv_offsets = std::move(segment_offsets);
+  VLOG(2) << "Split chunks of " << chunk_size << " bytes into " << num_segments
+          << " segments for pipelining";
+  return OkStatus();
+}
 }  // namespace
 
 Status RingAlg::InitializeCollectiveParams(CollectiveParams* col_params) {
@@ -206,6 +254,10 @@ Status RingAlg::InitializeCollectiveParams(CollectiveParams* col_params) {
 
   if (col_params->instance.impl_details.subdiv_offsets.empty()) {
     TF_RETURN_IF_ERROR(GenerateSubdivsInCollectiveParams(col_params));
+    if (type_ == REDUCTION_COLLECTIVE &&
+        col_params->group.device_type == DEVICE_CPU) {
+      TF_RETURN_IF_ERROR(SegmentSubdivsInCollectiveParams(col_params));
+    }
   }
 
   // Generate a ring permutation for requested offset.
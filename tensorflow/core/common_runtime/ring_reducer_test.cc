@@ -164,6 +164,9 @@ class RingReducerTest : public ::testing::Test {
         col_params_->instance.impl_details.subdiv_offsets =
             GenerateEvenSubdivOffsets(test_env->num_devices_per_worker,
                                       num_subdivs);
+      } else if (num_subdivs < 0) {
+        // Let the RingReducer generate the subdivisions.
+        col_params_->instance.impl_details.subdiv_offsets.clear();
       }
       string dev_name = col_params_->group.members[rank].device.name();
       TF_CHECK_OK(test_env_->device_mgr->LookupDevice(dev_name, &device_))
@@ -374,6 +377,32 @@ TEST_F(RingReducerInitParamsTest, AutomaticSubdivDisabled) {
   RunSubdivPermsTest(cp.get(), {{0, 1, 2, 3}}, {0});
 }
 
+TEST_F(RingReducerInitParamsTest, AutomaticSubdivSegments) {
+  const int kNumDevsPerWorker = 1;
+  const int kNumWorkers = 4;
+  auto test_env =
+      CreateCollectiveTestEnv(kNumWorkers, kNumDevsPerWorker, DEVICE_CPU);
+  auto cp =
+      CreateCollectiveParams(*test_env, /*rank*/ 0, "RingReduce",
+                             REDUCTION_COLLECTIVE, DT_FLOAT, TensorShape({1}));
+
+  // Chunks of 4 KiB are split into 4 segments of 1 KiB, each with its own
+  // copy of the ring.
+  setenv("TF_COLLECTIVE_RING_SEGMENT_BYTES", "1024", /*overwrite=*/1);
+  cp->default_rank = 0;
+  cp->instance.impl_details.subdiv_offsets.clear();
+  cp->instance.impl_details.max_subdivs_per_device = 0;
+  cp->instance.shape = TensorShape({4096});
+  RunSubdivPermsTest(cp.get(),
+                     {{0, 1, 2, 3}, {0, 1, 2, 3}, {0, 1, 2, 3}, {0, 1, 2, 3}},
+                     {0, 0, 0, 0});
+
+  // Specified subdivisions aren't segmented.
+  cp->instance.impl_details.subdiv_offsets = {0};
+  RunSubdivPermsTest(cp.get(), {{0, 1, 2, 3}}, {0});
+  unsetenv("TF_COLLECTIVE_RING_SEGMENT_BYTES");
+}
+
 // TODO(b/113171733): change to use TEST_P.
 #define DEF_TEST(B, T, W, D, S, L, A)                                         \
   TEST_F(RingReducerTest,                                                     \
@@ -427,6 +456,17 @@ DEF_TEST(INT64, CPU, 2, 8, 3, 4095, 0)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 1)
 DEF_TEST(FLOAT, CPU, 2, 8, 1, 9408, 7)
 DEF_TEST(FLOAT, CPU, 2, 8, 2, 9408, 11)
+
+TEST_F(RingReducerTest, SegmentedSubdivs) {
+  setenv("TF_COLLECTIVE_RING_SEGMENT_BYTES", "1024", /*overwrite=*/1);
+  RunTest<float>(DT_FLOAT, DEVICE_CPU, /*num_workers=*/4, /*num_devices=*/1,
+                 /*num_subdivs=*/-1, /*tensor_len=*/4099, /*fail_after=*/0);
+  unsetenv("TF_COLLECTIVE_RING_SEGMENT_BYTES");
+  // Chunks of 4099 bytes are split into 5 segments.
+  EXPECT_EQ(instances_[0]
+                ->col_params_->instance.impl_details.subdiv_permutations.size(),
+            5);
+}
 #endif
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
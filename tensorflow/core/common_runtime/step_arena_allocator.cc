@@ -0,0 +1,116 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace {
+
+// Blocks of the default size are recycled across steps, so that a step does
+// not pay for a large allocation (often an mmap) and page faults on its first
+// small tensor.
+constexpr size_t kMaxPooledBlocks = 32;
+
+mutex block_pool_mu(LINKER_INITIALIZED);
+std::vector<char*>* block_pool TF_GUARDED_BY(block_pool_mu) = nullptr;
+
+char* AllocateBlock(size_t block_size) {
+  if (block_size == StepArenaAllocator::kDefaultBlockSize) {
+    mutex_lock l(block_pool_mu);
+    if (block_pool != nullptr && !block_pool->empty()) {
+      char* block = block_pool->back();
+      block_pool->pop_back();
+      return block;
+    }
+  }
+  void* block =
+      port::AlignedMalloc(block_size, Allocator::kAllocatorAlignment);
+  CHECK(block != nullptr) << "Failed to allocate a step arena block of "
+                          << block_size << " bytes";
+  return static_cast<char*>(block);
+}
+
+void FreeBlock(char* block, size_t block_size) {
+  if (block_size == StepArenaAllocator::kDefaultBlockSize) {
+    mutex_lock l(block_pool_mu);
+    if (block_pool == nullptr) block_pool = new std::vector<char*>;
+    if (block_pool->size() < kMaxPooledBlocks) {
+      block_pool->push_back(block);
+      return;
+    }
+  }
+  port::AlignedFree(block);
+}
+
+size_t RoundUpToAlignment(size_t num_bytes) {
+  constexpr size_t kAlignment = Allocator::kAllocatorAlignment;
+  return (std::max<size_t>(num_bytes, 1) + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+}  // namespace
+
+StepArenaAllocator::StepArenaAllocator(Allocator* wrapped, size_t block_size,
+                                       size_t max_allocation_size)
+    : wrapped_(wrapped),
+      block_size_(block_size),
+      max_allocation_size_(max_allocation_size),
+      block_(AllocateBlock(block_size)) {}
+
+StepArenaAllocator::~StepArenaAllocator() { FreeBlock(block_, block_size_); }
+
+void StepArenaAllocator::Release() { Unref(); }
+
+void StepArenaAllocator::Unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+size_t StepArenaAllocator::bytes_used() const {
+  return std::min(offset_.load(std::memory_order_relaxed), block_size_);
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  // Buffers call back into this allocator to free their memory, so every
+  // allocation, including forwarded ones, holds a reference.
+  refs_.fetch_add(1, std::memory_order_relaxed);
+  if (num_bytes <= max_allocation_size_ &&
+      alignment <= Allocator::kAllocatorAlignment &&
+      offset_.load(std::memory_order_relaxed) < block_size_) {
+    const size_t size = RoundUpToAlignment(num_bytes);
+    const size_t offset = offset_.fetch_add(size, std::memory_order_relaxed);
+    if (offset + size <= block_size_) {
+      return block_ + offset;
+    }
+  }
+  void* ptr = wrapped_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) Unref();
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (!Owns(ptr)) {
+    wrapped_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+}  // namespace tensorflow
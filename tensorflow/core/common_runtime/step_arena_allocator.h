@@ -0,0 +1,88 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "tensorflow/core/framework/allocator.h"
+
+namespace tensorflow {
+
+// An allocator for the scalar and small tensors of one executor step.
+//
+// Like `core::Arena`, it carves allocations out of one contiguous block with a
+// bump pointer and never frees them individually. Unlike `core::Arena` it is
+// thread-safe and lock-free, and the block is released in bulk: once the step
+// has called `Release()` and every allocation made through the allocator has
+// been deallocated, the block goes back to a process-wide pool for later steps.
+// Tensors that outlive the step therefore stay valid; they just keep the
+// block alive until they are destroyed.
+//
+// Requests larger than `max_allocation_size`, with an alignment stricter than
+// `Allocator::kAllocatorAlignment`, or that no longer fit in the block are
+// forwarded to `wrapped`.
+class StepArenaAllocator : public Allocator {
+ public:
+  static constexpr size_t kDefaultBlockSize = 256 << 10;
+  static constexpr size_t kDefaultMaxAllocationSize = 1 << 10;
+
+  // `wrapped` is not owned and must outlive every allocation made through this
+  // allocator.
+  explicit StepArenaAllocator(
+      Allocator* wrapped, size_t block_size = kDefaultBlockSize,
+      size_t max_allocation_size = kDefaultMaxAllocationSize);
+
+  StepArenaAllocator(const StepArenaAllocator&) = delete;
+  void operator=(const StepArenaAllocator&) = delete;
+
+  // Drops the step's reference. The allocator deletes itself once every
+  // allocation made through it has been deallocated. Must be called exactly
+  // once, after which no new allocations may be made.
+  void Release();
+
+  std::string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  AllocatorMemoryType GetMemoryType() const override {
+    return wrapped_->GetMemoryType();
+  }
+
+  // Returns true if `ptr` was carved from this allocator's block.
+  bool Owns(const void* ptr) const {
+    return ptr >= block_ && ptr < block_ + block_size_;
+  }
+
+  // Returns the number of bytes handed out from the block so far.
+  size_t bytes_used() const;
+
+ private:
+  ~StepArenaAllocator() override;
+  void Unref();
+
+  Allocator* const wrapped_;
+  const size_t block_size_;
+  const size_t max_allocation_size_;
+  char* const block_;
+  std::atomic<size_t> offset_{0};
+  // One reference for the step plus one per live allocation.
+  std::atomic<int64_t> refs_{1};
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,97 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StepArenaAllocatorTest, SmallAllocationsComeFromTheBlock) {
+  StepArenaAllocator* arena = new StepArenaAllocator(cpu_allocator());
+  void* a = arena->AllocateRaw(Allocator::kAllocatorAlignment, 4);
+  void* b = arena->AllocateRaw(Allocator::kAllocatorAlignment, 100);
+  EXPECT_TRUE(arena->Owns(a));
+  EXPECT_TRUE(arena->Owns(b));
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(a) % Allocator::kAllocatorAlignment);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(b) % Allocator::kAllocatorAlignment);
+  EXPECT_EQ(64 + 128, arena->bytes_used());
+  arena->DeallocateRaw(a);
+  arena->DeallocateRaw(b);
+  arena->Release();
+}
+
+TEST(StepArenaAllocatorTest, LargeAllocationsAreForwarded) {
+  StepArenaAllocator* arena = new StepArenaAllocator(
+      cpu_allocator(), /*block_size=*/4096, /*max_allocation_size=*/256);
+  void* large = arena->AllocateRaw(Allocator::kAllocatorAlignment, 1024);
+  EXPECT_FALSE(arena->Owns(large));
+  EXPECT_EQ(0, arena->bytes_used());
+
+  // Fill the block; the next small allocation is forwarded too.
+  std::vector<void*> small;
+  for (int i = 0; i < 4096 / 256; ++i) {
+    small.push_back(arena->AllocateRaw(Allocator::kAllocatorAlignment, 256));
+    EXPECT_TRUE(arena->Owns(small.back()));
+  }
+  void* overflow = arena->AllocateRaw(Allocator::kAllocatorAlignment, 8);
+  EXPECT_FALSE(arena->Owns(overflow));
+
+  arena->DeallocateRaw(large);
+  arena->DeallocateRaw(overflow);
+  for (void* ptr : small) arena->DeallocateRaw(ptr);
+  arena->Release();
+}
+
+TEST(StepArenaAllocatorTest, TensorsOutliveTheStep) {
+  StepArenaAllocator* arena = new StepArenaAllocator(cpu_allocator());
+  Tensor scalar(arena, DT_FLOAT, TensorShape({}));
+  scalar.scalar<float>()() = 42.0f;
+  Tensor large(arena, DT_FLOAT, TensorShape({1024}));
+  large.flat<float>().setConstant(1.0f);
+  arena->Release();
+
+  // The arena is kept alive by the tensors allocated from it.
+  EXPECT_EQ(42.0f, scalar.scalar<float>()());
+  EXPECT_EQ(1.0f, large.flat<float>()(1023));
+}
+
+void BM_StepArenaAllocator(::testing::benchmark::State& state) {
+  const bool use_arena = state.range(0) != 0;
+  constexpr int kAllocationsPerStep = 1000;
+  for (auto s : state) {
+    StepArenaAllocator* arena = new StepArenaAllocator(cpu_allocator());
+    Allocator* allocator = use_arena ? arena : cpu_allocator();
+    std::vector<Tensor> tensors;
+    tensors.reserve(kAllocationsPerStep);
+    for (int i = 0; i < kAllocationsPerStep; ++i) {
+      tensors.emplace_back(allocator, DT_FLOAT, TensorShape({i % 16}));
+    }
+    tensors.clear();
+    arena->Release();
+  }
+  state.SetItemsProcessed(state.iterations() * kAllocationsPerStep);
+}
+
+BENCHMARK(BM_StepArenaAllocator)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace tensorflow
@@ -56,6 +56,13 @@ class Flags {
   TF_DECLARE_FLAG(enable_aggressive_constant_replication, true,
                   "Replicate constants across CPU devices and even for local "
                   "CPUs within the same task if available.")
+  TF_DECLARE_FLAG(enable_executor_work_stealing, false,
+                  "Dispatch expensive ready nodes of the dataflow executor "
+                  "through per-worker work-stealing queues instead of one "
+                  "inter-op closure per node.")
+  TF_DECLARE_FLAG(enable_executor_step_arena, false,
+                  "Carve small CPU tensors of each executor step out of a "
+                  "per-step arena instead of the device allocator.")
   // LINT.ThenChange(//tensorflow/core/config/flags_api_wrapper.cc)
 };
 
@@ -53,5 +53,7 @@ PYBIND11_MODULE(flags_pybind, m) {
   TF_PY_DECLARE_FLAG(more_stack_traces);
   TF_PY_DECLARE_FLAG(publish_function_graphs);
   TF_PY_DECLARE_FLAG(enable_aggressive_constant_replication);
+  TF_PY_DECLARE_FLAG(enable_executor_work_stealing);
+  TF_PY_DECLARE_FLAG(enable_executor_step_arena);
   // LINT.ThenChange(//tensorflow/core/config/flag_defs.h)
 };
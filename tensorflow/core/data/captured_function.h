@@ -137,6 +137,12 @@ struct InstantiateCapturedFunctionParams {
     runner = ctx->runner();
   }
 
+  explicit InstantiateCapturedFunctionParams(AnyContext ctx) {
+    flr = ctx.flr;
+    function_handle_cache = nullptr;
+    runner = ctx.runner;
+  }
+
   FunctionLibraryRuntime* flr;
   FunctionHandleCache* function_handle_cache;
   std::function<void(std::function<void()>)>* runner;
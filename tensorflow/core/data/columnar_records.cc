@@ -0,0 +1,447 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/columnar_records.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/stringpiece.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kMagic[] = "TFCOLREC";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+// Footer size and magic.
+constexpr size_t kTrailerSize = sizeof(uint64_t) + kMagicSize;
+
+template <typename T>
+void ComputeMinMax(const Tensor& values, ColumnChunkStats* stats) {
+  const auto flat = values.flat<T>();
+  if (flat.size() == 0) return;
+  double min = static_cast<double>(flat(0));
+  double max = min;
+  for (int64_t i = 1; i < flat.size(); ++i) {
+    const double value = static_cast<double>(flat(i));
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+  stats->has_min_max = true;
+  stats->min = min;
+  stats->max = max;
+}
+
+ColumnChunkStats ComputeStats(const Tensor& values) {
+  ColumnChunkStats stats;
+  if (values.dtype() == DT_STRING) {
+    const auto flat = values.flat<tstring>();
+    for (int64_t i = 0; i < flat.size(); ++i) {
+      stats.uncompressed_bytes += flat(i).size();
+    }
+    return stats;
+  }
+  stats.uncompressed_bytes = values.TotalBytes();
+  switch (values.dtype()) {
+#define HANDLE_TYPE(T)                \
+  case DataTypeToEnum<T>::value:      \
+    ComputeMinMax<T>(values, &stats); \
+    break;
+    TF_CALL_REAL_NUMBER_TYPES(HANDLE_TYPE);
+#undef HANDLE_TYPE
+    default:
+      break;
+  }
+  return stats;
+}
+
+uint64_t DoubleToBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double BitsToDouble(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void EncodeFooter(const std::vector<ColumnarRecordsColumn>& columns,
+                  const std::vector<ColumnarRecordsChunk>& chunks,
+                  std::string* footer) {
+  core::PutVarint32(footer, columns.size());
+  for (const ColumnarRecordsColumn& column : columns) {
+    core::PutVarint32(footer, column.name.size());
+    footer->append(column.name);
+    core::PutVarint32(footer, column.dtype);
+    core::PutVarint32(footer, column.shape.dims());
+    for (const int64_t dim : column.shape.dim_sizes()) {
+      core::PutVarint64(footer, dim);
+    }
+  }
+  core::PutVarint64(footer, chunks.size());
+  for (const ColumnarRecordsChunk& chunk : chunks) {
+    core::PutVarint64(footer, chunk.num_records);
+    for (const ColumnChunk& column : chunk.columns) {
+      core::PutVarint64(footer, column.offset);
+      core::PutVarint64(footer, column.size);
+      core::PutVarint64(footer, column.stats.uncompressed_bytes);
+      footer->push_back(column.stats.has_min_max ? 1 : 0);
+      if (column.stats.has_min_max) {
+        core::PutFixed64(footer, DoubleToBits(column.stats.min));
+        core::PutFixed64(footer, DoubleToBits(column.stats.max));
+      }
+    }
+  }
+}
+
+Status FooterError() {
+  return errors::DataLoss("Corrupted columnar records footer.");
+}
+
+bool GetFixed64(StringPiece* input, uint64_t* value) {
+  if (input->size() < sizeof(uint64_t)) return false;
+  *value = core::DecodeFixed64(input->data());
+  input->remove_prefix(sizeof(uint64_t));
+  return true;
+}
+
+// Returns an error if two columns have the same name.
+Status CheckUniqueColumnNames(
+    const std::vector<ColumnarRecordsColumn>& columns) {
+  absl::flat_hash_set<absl::string_view> names;
+  for (const ColumnarRecordsColumn& column : columns) {
+    if (!names.insert(column.name).second) {
+      return errors::InvalidArgument("Columnar records have two columns named ",
+                                     column.name);
+    }
+  }
+  return OkStatus();
+}
+
+Status DecodeFooter(StringPiece footer,
+                    std::vector<ColumnarRecordsColumn>* columns,
+                    std::vector<ColumnarRecordsChunk>* chunks) {
+  uint32 num_columns;
+  if (!core::GetVarint32(&footer, &num_columns)) return FooterError();
+  // Each column takes at least one byte for the size of its name, its type and
+  // its rank.
+  if (num_columns > footer.size() / 3) return FooterError();
+  columns->resize(num_columns);
+  for (ColumnarRecordsColumn& column : *columns) {
+    uint32 name_size, dtype, rank;
+    if (!core::GetVarint32(&footer, &name_size) || footer.size() < name_size) {
+      return FooterError();
+    }
+    column.name = std::string(footer.substr(0, name_size));
+    footer.remove_prefix(name_size);
+    // The records of a chunk add a dimension to the shape of the column.
+    if (!core::GetVarint32(&footer, &dtype) ||
+        !core::GetVarint32(&footer, &rank) || !DataType_IsValid(dtype) ||
+        rank > footer.size() || rank >= TensorShape::MaxDimensions()) {
+      return FooterError();
+    }
+    column.dtype = static_cast<DataType>(dtype);
+    std::vector<int64_t> dims(rank);
+    for (int64_t& dim : dims) {
+      uint64 value;
+      if (!core::GetVarint64(&footer, &value)) return FooterError();
+      dim = value;
+    }
+    TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(dims, &column.shape));
+  }
+  if (!CheckUniqueColumnNames(*columns).ok()) return FooterError();
+  uint64 num_chunks;
+  if (!core::GetVarint64(&footer, &num_chunks)) return FooterError();
+  // Each chunk takes at least one byte per column.
+  if (num_chunks > footer.size()) return FooterError();
+  chunks->resize(num_chunks);
+  uint64 total_records = 0;
+  for (ColumnarRecordsChunk& chunk : *chunks) {
+    uint64 num_records;
+    if (!core::GetVarint64(&footer, &num_records) ||
+        num_records > static_cast<uint64>(std::numeric_limits<int64_t>::max()) -
+                          total_records) {
+      return FooterError();
+    }
+    total_records += num_records;
+    chunk.num_records = num_records;
+    chunk.columns.resize(num_columns);
+    for (ColumnChunk& column : chunk.columns) {
+      uint64 uncompressed_bytes;
+      if (!core::GetVarint64(&footer, &column.offset) ||
+          !core::GetVarint64(&footer, &column.size) ||
+          !core::GetVarint64(&footer, &uncompressed_bytes) || footer.empty()) {
+        return FooterError();
+      }
+      column.stats.uncompressed_bytes = uncompressed_bytes;
+      column.stats.has_min_max = footer[0] != 0;
+      footer.remove_prefix(1);
+      if (column.stats.has_min_max) {
+        uint64_t min, max;
+        if (!GetFixed64(&footer, &min) || !GetFixed64(&footer, &max)) {
+          return FooterError();
+        }
+        column.stats.min = BitsToDouble(min);
+        column.stats.max = BitsToDouble(max);
+      }
+    }
+  }
+  if (!footer.empty()) return FooterError();
+  return OkStatus();
+}
+
+}  // namespace
+
+Status ColumnarRecordsWriter::Create(
+    Env* env, const std::string& filename,
+    std::vector<ColumnarRecordsColumn> columns,
+    const ColumnarRecordsWriterOptions& options,
+    std::unique_ptr<ColumnarRecordsWriter>* writer) {
+  if (columns.empty()) {
+    return errors::InvalidArgument("Columnar records need a column.");
+  }
+  TF_RETURN_IF_ERROR(CheckUniqueColumnNames(columns));
+  if (options.records_per_chunk <= 0) {
+    return errors::InvalidArgument(
+        "The number of records per chunk must be positive, got ",
+        options.records_per_chunk);
+  }
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename, &file));
+  TF_RETURN_IF_ERROR(file->Append(StringPiece(kMagic, kMagicSize)));
+  writer->reset(
+      new ColumnarRecordsWriter(std::move(file), std::move(columns), options));
+  return OkStatus();
+}
+
+ColumnarRecordsWriter::ColumnarRecordsWriter(
+    std::unique_ptr<WritableFile> file,
+    std::vector<ColumnarRecordsColumn> columns,
+    const ColumnarRecordsWriterOptions& options)
+    : file_(std::move(file)),
+      columns_(std::move(columns)),
+      options_(options),
+      offset_(kMagicSize),
+      pending_(columns_.size()) {}
+
+Status ColumnarRecordsWriter::Write(const std::vector<Tensor>& values) {
+  if (closed_) {
+    return errors::FailedPrecondition("The columnar records file is closed.");
+  }
+  if (values.size() != columns_.size()) {
+    return errors::InvalidArgument("Expected values for ", columns_.size(),
+                                   " columns, got ", values.size());
+  }
+  int64_t num_records = -1;
+  for (int i = 0; i < columns_.size(); ++i) {
+    const ColumnarRecordsColumn& column = columns_[i];
+    const Tensor& column_values = values[i];
+    if (column_values.dtype() != column.dtype ||
+        column_values.dims() != column.shape.dims() + 1) {
+      return errors::InvalidArgument(
+          "Expected ", DataTypeString(column.dtype), " values of shape [n] + ",
+          column.shape.DebugString(), " for column ", column.name, ", got ",
+          DataTypeString(column_values.dtype()), " values of shape ",
+          column_values.shape().DebugString());
+    }
+    TensorShape record_shape = column_values.shape();
+    record_shape.RemoveDim(0);
+    if (record_shape != column.shape) {
+      return errors::InvalidArgument(
+          "Expected values of shape [n] + ", column.shape.DebugString(),
+          " for column ", column.name, ", got ",
+          column_values.shape().DebugString());
+    }
+    if (num_records != -1 && column_values.dim_size(0) != num_records) {
+      return errors::InvalidArgument(
+          "All the columns must have the same number of records.");
+    }
+    num_records = column_values.dim_size(0);
+  }
+  if (num_records == 0) return OkStatus();
+
+  for (int i = 0; i < columns_.size(); ++i) {
+    pending_[i].push_back(values[i]);
+  }
+  num_pending_records_ += num_records;
+  while (num_pending_records_ >= options_.records_per_chunk) {
+    TF_RETURN_IF_ERROR(WriteChunk(options_.records_per_chunk));
+  }
+  return OkStatus();
+}
+
+Status ColumnarRecordsWriter::WriteChunk(int64_t num_records) {
+  ColumnarRecordsChunk chunk;
+  chunk.num_records = num_records;
+  for (int i = 0; i < columns_.size(); ++i) {
+    Tensor pending;
+    if (pending_[i].size() == 1) {
+      pending = pending_[i][0];
+    } else {
+      TF_RETURN_IF_ERROR(tensor::Concat(pending_[i], &pending));
+    }
+    pending_[i].clear();
+    const int64_t num_pending_records = pending.dim_size(0);
+    if (num_pending_records > num_records) {
+      pending_[i].push_back(pending.Slice(num_records, num_pending_records));
+    }
+    const Tensor values = pending.Slice(0, num_records);
+
+    CompressedElement compressed;
+    TF_RETURN_IF_ERROR(
+        CompressElement({values}, options_.compression, &compressed));
+    const std::string serialized = compressed.SerializeAsString();
+    TF_RETURN_IF_ERROR(file_->Append(serialized));
+    ColumnChunk& column = chunk.columns.emplace_back();
+    column.offset = offset_;
+    column.size = serialized.size();
+    column.stats = ComputeStats(values);
+    offset_ += serialized.size();
+  }
+  num_pending_records_ -= num_records;
+  chunks_.push_back(std::move(chunk));
+  return OkStatus();
+}
+
+Status ColumnarRecordsWriter::Close() {
+  if (closed_) return OkStatus();
+  closed_ = true;
+  if (num_pending_records_ > 0) {
+    TF_RETURN_IF_ERROR(WriteChunk(num_pending_records_));
+  }
+  std::string footer;
+  EncodeFooter(columns_, chunks_, &footer);
+  core::PutFixed64(&footer, footer.size());
+  footer.append(kMagic, kMagicSize);
+  TF_RETURN_IF_ERROR(file_->Append(footer));
+  return file_->Close();
+}
+
+Status ColumnarRecordsReader::Open(
+    Env* env, const std::string& filename,
+    std::unique_ptr<ColumnarRecordsReader>* reader) {
+  uint64_t file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  std::unique_ptr<ColumnarRecordsReader> new_reader(
+      new ColumnarRecordsReader(std::move(file)));
+  Status status = new_reader->ReadFooter(file_size);
+  if (!status.ok()) {
+    return errors::CreateWithUpdatedMessage(
+        status, absl::StrCat("Failed to read columnar records file ", filename,
+                             ": ", status.message()));
+  }
+  *reader = std::move(new_reader);
+  return OkStatus();
+}
+
+Status ColumnarRecordsReader::ReadFooter(uint64_t file_size) {
+  if (file_size < kMagicSize + kTrailerSize) {
+    return errors::DataLoss("The file is too small.");
+  }
+  char trailer_scratch[kTrailerSize];
+  StringPiece trailer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - kTrailerSize, kTrailerSize,
+                                 &trailer, trailer_scratch));
+  if (trailer.size() != kTrailerSize ||
+      trailer.substr(sizeof(uint64_t)) != StringPiece(kMagic, kMagicSize)) {
+    return errors::DataLoss("The file is not a columnar records file.");
+  }
+  const uint64_t footer_size = core::DecodeFixed64(trailer.data());
+  if (footer_size > file_size - kMagicSize - kTrailerSize) {
+    return FooterError();
+  }
+  std::string footer_scratch(footer_size, '\0');
+  StringPiece footer;
+  TF_RETURN_IF_ERROR(file_->Read(file_size - kTrailerSize - footer_size,
+                                 footer_size, &footer, &footer_scratch[0]));
+  if (footer.size() != footer_size) return FooterError();
+  TF_RETURN_IF_ERROR(DecodeFooter(footer, &columns_, &chunks_));
+  for (const ColumnarRecordsChunk& chunk : chunks_) {
+    for (const ColumnChunk& column : chunk.columns) {
+      if (column.offset < kMagicSize || column.size > file_size ||
+          column.offset > file_size - column.size) {
+        return FooterError();
+      }
+    }
+    num_records_ += chunk.num_records;
+  }
+  return OkStatus();
+}
+
+int ColumnarRecordsReader::ColumnIndex(absl::string_view name) const {
+  for (int i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].name == name) return i;
+  }
+  return -1;
+}
+
+Status ColumnarRecordsReader::ReadColumn(int64_t chunk, int column,
+                                         Tensor* values) const {
+  if (chunk < 0 || chunk >= chunks_.size() || column < 0 ||
+      column >= columns_.size()) {
+    return errors::InvalidArgument("Invalid column ", column, " of chunk ",
+                                   chunk);
+  }
+  TensorShape expected_shape = columns_[column].shape;
+  if (!expected_shape.InsertDimWithStatus(0, chunks_[chunk].num_records).ok()) {
+    return errors::DataLoss("Corrupted column ", columns_[column].name,
+                            " of chunk ", chunk);
+  }
+  const ColumnChunk& column_chunk = chunks_[chunk].columns[column];
+  std::string scratch(column_chunk.size, '\0');
+  StringPiece serialized;
+  TF_RETURN_IF_ERROR(file_->Read(column_chunk.offset, column_chunk.size,
+                                 &serialized, &scratch[0]));
+  CompressedElement compressed;
+  if (serialized.size() != column_chunk.size ||
+      !compressed.ParseFromArray(serialized.data(), serialized.size())) {
+    return errors::DataLoss("Corrupted column ", columns_[column].name,
+                            " of chunk ", chunk);
+  }
+  std::vector<Tensor> uncompressed;
+  TF_RETURN_IF_ERROR(UncompressElement(compressed, &uncompressed));
+  if (uncompressed.size() != 1 ||
+      uncompressed[0].dtype() != columns_[column].dtype ||
+      uncompressed[0].shape() != expected_shape) {
+    return errors::DataLoss("Corrupted column ", columns_[column].name,
+                            " of chunk ", chunk);
+  }
+  *values = std::move(uncompressed[0]);
+  return OkStatus();
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,159 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_COLUMNAR_RECORDS_H_
+#define TENSORFLOW_CORE_DATA_COLUMNAR_RECORDS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+// Columnar records files store records made of named, fixed-shape features
+// ("columns") so that readers only read and decode the columns they need.
+//
+// The records are split into chunks of consecutive records. The values of a
+// column for the records of a chunk are stored contiguously, as a tensor of
+// shape `[num_records] + column shape` compressed into a `CompressedElement`.
+// The footer describes the columns and, for each chunk, the location and
+// statistics of its columns:
+//
+//   magic
+//   chunk 0: column 0, column 1, ..., column n - 1
+//   ...
+//   chunk m - 1: column 0, column 1, ..., column n - 1
+//   footer
+//   footer size (fixed64)
+//   magic
+
+struct ColumnarRecordsColumn {
+  std::string name;
+  DataType dtype = DT_INVALID;
+  // Shape of the values of the column for one record.
+  TensorShape shape;
+};
+
+// Statistics of the values of a column in a chunk.
+struct ColumnChunkStats {
+  int64_t uncompressed_bytes = 0;
+  // Minimum and maximum of the values of numeric columns.
+  bool has_min_max = false;
+  double min = 0;
+  double max = 0;
+};
+
+struct ColumnChunk {
+  // Location of the compressed column in the file.
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  ColumnChunkStats stats;
+};
+
+struct ColumnarRecordsChunk {
+  int64_t num_records = 0;
+  // One per column, in the order of the columns.
+  std::vector<ColumnChunk> columns;
+};
+
+struct ColumnarRecordsWriterOptions {
+  // Number of records of each chunk but the last one.
+  int64_t records_per_chunk = 1024;
+  CompressionOptions compression;
+};
+
+// Writes a columnar records file. Not thread-safe.
+class ColumnarRecordsWriter {
+ public:
+  static Status Create(Env* env, const std::string& filename,
+                       std::vector<ColumnarRecordsColumn> columns,
+                       const ColumnarRecordsWriterOptions& options,
+                       std::unique_ptr<ColumnarRecordsWriter>* writer);
+
+  // Appends records. `values` has a tensor per column, of shape
+  // `[num_records] + column shape`, with the same number of records for all
+  // columns.
+  Status Write(const std::vector<Tensor>& values);
+
+  // Writes the remaining records and the footer, and closes the file.
+  Status Close();
+
+ private:
+  ColumnarRecordsWriter(std::unique_ptr<WritableFile> file,
+                        std::vector<ColumnarRecordsColumn> columns,
+                        const ColumnarRecordsWriterOptions& options);
+
+  // Writes a chunk of the first `num_records` pending records.
+  Status WriteChunk(int64_t num_records);
+
+  std::unique_ptr<WritableFile> file_;
+  const std::vector<ColumnarRecordsColumn> columns_;
+  const ColumnarRecordsWriterOptions options_;
+  uint64_t offset_ = 0;
+  // Records not written yet, by column.
+  std::vector<std::vector<Tensor>> pending_;
+  int64_t num_pending_records_ = 0;
+  std::vector<ColumnarRecordsChunk> chunks_;
+  bool closed_ = false;
+};
+
+// Reads a columnar records file. Thread-safe.
+class ColumnarRecordsReader {
+ public:
+  // Opens `filename` and reads its footer.
+  static Status Open(Env* env, const std::string& filename,
+                     std::unique_ptr<ColumnarRecordsReader>* reader);
+
+  const std::vector<ColumnarRecordsColumn>& columns() const {
+    return columns_;
+  }
+  const std::vector<ColumnarRecordsChunk>& chunks() const { return chunks_; }
+  int64_t num_records() const { return num_records_; }
+
+  // Returns the index of the column named `name`, or -1.
+  int ColumnIndex(absl::string_view name) const;
+
+  // Reads and decodes the values of `column` for the records of `chunk`, into
+  // a tensor of shape `[num_records] + column shape`. Only the bytes of the
+  // column are read.
+  Status ReadColumn(int64_t chunk, int column, Tensor* values) const;
+
+ private:
+  explicit ColumnarRecordsReader(std::unique_ptr<RandomAccessFile> file)
+      : file_(std::move(file)) {}
+
+  Status ReadFooter(uint64_t file_size);
+
+  const std::unique_ptr<RandomAccessFile> file_;
+  std::vector<ColumnarRecordsColumn> columns_;
+  std::vector<ColumnarRecordsChunk> chunks_;
+  int64_t num_records_ = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_COLUMNAR_RECORDS_H_
@@ -0,0 +1,299 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/columnar_records.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::vector<ColumnarRecordsColumn> TestColumns() {
+  return {{"id", DT_INT64, TensorShape({})},
+          {"embedding", DT_FLOAT, TensorShape({2})},
+          {"query", DT_STRING, TensorShape({})}};
+}
+
+// Values of the columns for records [start, start + n).
+std::vector<Tensor> TestValues(int64_t start, int64_t n) {
+  std::vector<int64_t> ids;
+  std::vector<float> embeddings;
+  std::vector<tstring> queries;
+  for (int64_t i = start; i < start + n; ++i) {
+    ids.push_back(i);
+    embeddings.push_back(i);
+    embeddings.push_back(-i);
+    queries.push_back(absl::StrCat("query ", i));
+  }
+  return {test::AsTensor<int64_t>(ids, {n}),
+          test::AsTensor<float>(embeddings, {n, 2}),
+          test::AsTensor<tstring>(queries, {n})};
+}
+
+class ColumnarRecordsTest : public ::testing::TestWithParam<std::string> {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename_));
+  }
+
+  ColumnarRecordsWriterOptions Options(int64_t records_per_chunk) {
+    ColumnarRecordsWriterOptions options;
+    options.records_per_chunk = records_per_chunk;
+    TF_CHECK_OK(
+        ParseCompressionCodec(GetParam(), &options.compression.codec));
+    return options;
+  }
+
+  std::string filename_;
+};
+
+TEST_P(ColumnarRecordsTest, WriteAndRead) {
+  std::unique_ptr<ColumnarRecordsWriter> writer;
+  TF_ASSERT_OK(ColumnarRecordsWriter::Create(Env::Default(), filename_,
+                                             TestColumns(), Options(4),
+                                             &writer));
+  // Writes that are split over several chunks or fill part of a chunk.
+  TF_ASSERT_OK(writer->Write(TestValues(0, 3)));
+  TF_ASSERT_OK(writer->Write(TestValues(3, 6)));
+  TF_ASSERT_OK(writer->Write(TestValues(9, 0)));
+  TF_ASSERT_OK(writer->Write(TestValues(9, 2)));
+  TF_ASSERT_OK(writer->Close());
+
+  std::unique_ptr<ColumnarRecordsReader> reader;
+  TF_ASSERT_OK(ColumnarRecordsReader::Open(Env::Default(), filename_, &reader));
+  ASSERT_EQ(reader->columns().size(), 3);
+  EXPECT_EQ(reader->columns()[1].name, "embedding");
+  EXPECT_EQ(reader->columns()[1].dtype, DT_FLOAT);
+  EXPECT_EQ(reader->columns()[1].shape, TensorShape({2}));
+  EXPECT_EQ(reader->ColumnIndex("query"), 2);
+  EXPECT_EQ(reader->ColumnIndex("label"), -1);
+  EXPECT_EQ(reader->num_records(), 11);
+  ASSERT_EQ(reader->chunks().size(), 3);
+  EXPECT_EQ(reader->chunks()[0].num_records, 4);
+  EXPECT_EQ(reader->chunks()[1].num_records, 4);
+  EXPECT_EQ(reader->chunks()[2].num_records, 3);
+
+  int64_t start = 0;
+  for (int64_t chunk = 0; chunk < reader->chunks().size(); ++chunk) {
+    const int64_t num_records = reader->chunks()[chunk].num_records;
+    const std::vector<Tensor> expected = TestValues(start, num_records);
+    for (int column = 0; column < expected.size(); ++column) {
+      Tensor values;
+      TF_ASSERT_OK(reader->ReadColumn(chunk, column, &values));
+      test::ExpectEqual(values, expected[column]);
+    }
+    start += num_records;
+  }
+}
+
+TEST_P(ColumnarRecordsTest, ChunkStats) {
+  std::unique_ptr<ColumnarRecordsWriter> writer;
+  TF_ASSERT_OK(ColumnarRecordsWriter::Create(Env::Default(), filename_,
+                                             TestColumns(), Options(5),
+                                             &writer));
+  TF_ASSERT_OK(writer->Write(TestValues(0, 7)));
+  TF_ASSERT_OK(writer->Close());
+
+  std::unique_ptr<ColumnarRecordsReader> reader;
+  TF_ASSERT_OK(ColumnarRecordsReader::Open(Env::Default(), filename_, &reader));
+  ASSERT_EQ(reader->chunks().size(), 2);
+  const ColumnChunkStats& ids = reader->chunks()[1].columns[0].stats;
+  EXPECT_TRUE(ids.has_min_max);
+  EXPECT_EQ(ids.min, 5);
+  EXPECT_EQ(ids.max, 6);
+  EXPECT_EQ(ids.uncompressed_bytes, 2 * sizeof(int64_t));
+  const ColumnChunkStats& embeddings = reader->chunks()[0].columns[1].stats;
+  EXPECT_TRUE(embeddings.has_min_max);
+  EXPECT_EQ(embeddings.min, -4);
+  EXPECT_EQ(embeddings.max, 4);
+  const ColumnChunkStats& queries = reader->chunks()[1].columns[2].stats;
+  EXPECT_FALSE(queries.has_min_max);
+  EXPECT_EQ(queries.uncompressed_bytes, 2 * std::string("query 5").size());
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, ColumnarRecordsTest,
+                         ::testing::Values("none", "snappy", "zstd"));
+
+TEST(ColumnarRecordsWriterTest, RejectsInvalidValues) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  std::unique_ptr<ColumnarRecordsWriter> writer;
+  TF_ASSERT_OK(ColumnarRecordsWriter::Create(Env::Default(), filename,
+                                             TestColumns(),
+                                             ColumnarRecordsWriterOptions(),
+                                             &writer));
+  std::vector<Tensor> values = TestValues(0, 2);
+  values.pop_back();
+  EXPECT_TRUE(errors::IsInvalidArgument(writer->Write(values)));
+  values = TestValues(0, 2);
+  values[1] = test::AsTensor<float>({1, 2, 3, 4}, {1, 4});
+  EXPECT_TRUE(errors::IsInvalidArgument(writer->Write(values)));
+  values = TestValues(0, 2);
+  values[0] = test::AsTensor<int64_t>({1, 2, 3}, {3});
+  EXPECT_TRUE(errors::IsInvalidArgument(writer->Write(values)));
+  values = TestValues(0, 2);
+  values[2] = test::AsTensor<int32>({1, 2}, {2});
+  EXPECT_TRUE(errors::IsInvalidArgument(writer->Write(values)));
+}
+
+TEST(ColumnarRecordsWriterTest, RejectsDuplicateColumns) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  std::vector<ColumnarRecordsColumn> columns = TestColumns();
+  columns[2].name = "id";
+  std::unique_ptr<ColumnarRecordsWriter> writer;
+  EXPECT_TRUE(errors::IsInvalidArgument(ColumnarRecordsWriter::Create(
+      Env::Default(), filename, columns, ColumnarRecordsWriterOptions(),
+      &writer)));
+}
+
+TEST(ColumnarRecordsReaderTest, RejectsOtherFiles) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename,
+                                 "not a columnar records file"));
+  std::unique_ptr<ColumnarRecordsReader> reader;
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+}
+
+// Writes a columnar records file with the given encoded columns, and a chunk
+// of each of `chunk_records` records whose columns are all empty.
+void WriteFooter(const std::string& filename, const std::string& columns,
+                 const std::vector<uint64>& chunk_records = {}) {
+  uint32 num_columns;
+  StringPiece input = columns;
+  ASSERT_TRUE(core::GetVarint32(&input, &num_columns));
+  std::string footer = columns;
+  core::PutVarint64(&footer, chunk_records.size());
+  for (uint64 num_records : chunk_records) {
+    core::PutVarint64(&footer, num_records);
+    for (uint32 i = 0; i < num_columns; ++i) {
+      core::PutVarint64(&footer, 8);  // Offset, after the magic.
+      core::PutVarint64(&footer, 0);  // Size.
+      core::PutVarint64(&footer, 0);  // Uncompressed bytes.
+      footer.push_back(0);            // No min and max.
+    }
+  }
+  std::string file = "TFCOLREC";
+  file.append(footer);
+  core::PutFixed64(&file, footer.size());
+  file.append("TFCOLREC");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, file));
+}
+
+TEST(ColumnarRecordsReaderTest, RejectsCorruptedFooters) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  std::string column;
+  core::PutVarint32(&column, 1);
+  column.append("a");
+  core::PutVarint32(&column, DT_INT64);
+  core::PutVarint32(&column, 0);
+  std::unique_ptr<ColumnarRecordsReader> reader;
+
+  std::string one_column;
+  core::PutVarint32(&one_column, 1);
+  WriteFooter(filename, one_column + column);
+  TF_EXPECT_OK(ColumnarRecordsReader::Open(Env::Default(), filename, &reader));
+
+  std::string duplicate_columns;
+  core::PutVarint32(&duplicate_columns, 2);
+  WriteFooter(filename, duplicate_columns + column + column);
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+
+  // More columns than the footer can hold.
+  std::string too_many_columns;
+  core::PutVarint32(&too_many_columns, std::numeric_limits<uint32>::max());
+  WriteFooter(filename, too_many_columns + column);
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+
+  std::string large_rank = one_column;
+  core::PutVarint32(&large_rank, 1);
+  large_rank.append("a");
+  core::PutVarint32(&large_rank, DT_INT64);
+  core::PutVarint32(&large_rank, std::numeric_limits<uint32>::max());
+  WriteFooter(filename, large_rank);
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+
+  // The records of a chunk add a dimension to the shape of its columns.
+  for (int rank : {TensorShape::MaxDimensions() - 1,
+                   TensorShape::MaxDimensions()}) {
+    std::string max_rank = one_column;
+    core::PutVarint32(&max_rank, 1);
+    max_rank.append("a");
+    core::PutVarint32(&max_rank, DT_INT64);
+    core::PutVarint32(&max_rank, rank);
+    for (int i = 0; i < rank; ++i) core::PutVarint64(&max_rank, 1);
+    WriteFooter(filename, max_rank);
+    const Status status =
+        ColumnarRecordsReader::Open(Env::Default(), filename, &reader);
+    if (rank < TensorShape::MaxDimensions()) {
+      TF_EXPECT_OK(status);
+    } else {
+      EXPECT_TRUE(errors::IsDataLoss(status));
+    }
+  }
+
+  // More records than a dimension can hold.
+  const uint64 max_records = std::numeric_limits<int64_t>::max();
+  WriteFooter(filename, one_column + column, {max_records});
+  TF_EXPECT_OK(ColumnarRecordsReader::Open(Env::Default(), filename, &reader));
+  EXPECT_EQ(reader->num_records(), std::numeric_limits<int64_t>::max());
+  WriteFooter(filename, one_column + column, {max_records + 1});
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+  WriteFooter(filename, one_column + column, {max_records, 1});
+  EXPECT_TRUE(errors::IsDataLoss(
+      ColumnarRecordsReader::Open(Env::Default(), filename, &reader)));
+}
+
+TEST(ColumnarRecordsReaderTest, RejectsColumnsOfTooManyElements) {
+  std::string filename;
+  ASSERT_TRUE(Env::Default()->LocalTempFilename(&filename));
+  // A column of shape [2^40] in a chunk of 2^40 records.
+  std::string columns;
+  core::PutVarint32(&columns, 1);
+  core::PutVarint32(&columns, 1);
+  columns.append("a");
+  core::PutVarint32(&columns, DT_INT64);
+  core::PutVarint32(&columns, 1);
+  core::PutVarint64(&columns, uint64{1} << 40);
+  WriteFooter(filename, columns, {uint64{1} << 40});
+  std::unique_ptr<ColumnarRecordsReader> reader;
+  TF_ASSERT_OK(ColumnarRecordsReader::Open(Env::Default(), filename, &reader));
+  Tensor values;
+  EXPECT_TRUE(errors::IsDataLoss(reader->ReadColumn(0, 0, &values)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -14,19 +14,30 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/compression_utils.h"
 
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
+#include "tensorflow/core/platform/env_time.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/platform.h"
 #include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/types.h"
 
+// zstd is not linked into mobile builds, where the zstd codec is unavailable.
+#if !defined(IS_MOBILE_PLATFORM)
+#include "zstd.h"  // from @net_zstd
+#endif  // !IS_MOBILE_PLATFORM
+
 namespace tensorflow {
 namespace data {
 namespace {
@@ -34,7 +45,11 @@ namespace {
 // Increment this when making changes to the `CompressedElement` proto. The
 // `UncompressElement` function will determine what to read according to the
 // version.
-constexpr int kCompressedElementVersion = 0;
+constexpr int kCompressedElementVersion = 1;
+
+// Snappy-compressed elements are still written as version 0, which predates
+// the `codec` field, so that older readers can read them.
+constexpr int kSnappyCompressedElementVersion = 0;
 
 }  // namespace
 
@@ -61,7 +76,217 @@ class Iov {
   size_t num_bytes_;
 };
 
+namespace {
+
+#if !defined(IS_MOBILE_PLATFORM)
+struct ZstdCCtxDeleter {
+  void operator()(ZSTD_CCtx* cctx) const { ZSTD_freeCCtx(cctx); }
+};
+
+struct ZstdDCtxDeleter {
+  void operator()(ZSTD_DCtx* dctx) const { ZSTD_freeDCtx(dctx); }
+};
+
+// zstd contexts are expensive to create, so each thread reuses its own.
+// Returns nullptr if the context could not be allocated; the next call on the
+// thread tries again.
+ZSTD_CCtx* ThreadLocalZstdCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> cctx;
+  if (cctx == nullptr) cctx.reset(ZSTD_createCCtx());
+  return cctx.get();
+}
+
+ZSTD_DCtx* ThreadLocalZstdDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> dctx;
+  if (dctx == nullptr) dctx.reset(ZSTD_createDCtx());
+  return dctx.get();
+}
+#endif  // !IS_MOBILE_PLATFORM
+
+Status SnappyCompress(Iov& iov, std::string* out) {
+  if (iov.NumBytes() > kuint32max) {
+    return errors::OutOfRange("Encountered dataset element of size ",
+                              iov.NumBytes(),
+                              ", exceeding the 4GB Snappy limit.");
+  }
+  if (!port::Snappy_CompressFromIOVec(iov.Data(), iov.NumBytes(), out)) {
+    return errors::Internal("Failed to compress using snappy.");
+  }
+  return OkStatus();
+}
+
+Status SnappyUncompress(const std::string& compressed_data, Iov& iov) {
+  size_t uncompressed_size;
+  if (!port::Snappy_GetUncompressedLength(
+          compressed_data.data(), compressed_data.size(), &uncompressed_size)) {
+    return errors::Internal(
+        "Could not get snappy uncompressed length. Compressed data size: ",
+        compressed_data.size());
+  }
+  if (uncompressed_size != static_cast<size_t>(iov.NumBytes())) {
+    return errors::Internal(
+        "Uncompressed size mismatch. Snappy expects ", uncompressed_size,
+        " whereas the tensor metadata suggests ", iov.NumBytes());
+  }
+  if (!port::Snappy_UncompressToIOVec(compressed_data.data(),
+                                      compressed_data.size(), iov.Data(),
+                                      iov.NumPieces())) {
+    return errors::Internal("Failed to perform snappy decompression.");
+  }
+  return OkStatus();
+}
+
+#if !defined(IS_MOBILE_PLATFORM)
+// Streams the pieces of `iov` through one zstd frame, so the element is never
+// gathered into a contiguous buffer.
+Status ZstdCompress(Iov& iov, int level, std::string* out) {
+  ZSTD_CCtx* cctx = ThreadLocalZstdCCtx();
+  if (cctx == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context.");
+  }
+  ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+  size_t result = ZSTD_CCtx_setParameter(
+      cctx, ZSTD_c_compressionLevel, level == 0 ? ZSTD_CLEVEL_DEFAULT : level);
+  if (!ZSTD_isError(result)) {
+    result = ZSTD_CCtx_setPledgedSrcSize(cctx, iov.NumBytes());
+  }
+  if (ZSTD_isError(result)) {
+    return errors::InvalidArgument("Failed to configure zstd compression: ",
+                                   ZSTD_getErrorName(result));
+  }
+
+  out->resize(ZSTD_compressBound(iov.NumBytes()));
+  ZSTD_outBuffer output = {&(*out)[0], out->size(), 0};
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    ZSTD_inBuffer input = {iov.Data()[i].iov_base, iov.Data()[i].iov_len, 0};
+    while (input.pos < input.size) {
+      result = ZSTD_compressStream2(cctx, &output, &input, ZSTD_e_continue);
+      if (ZSTD_isError(result)) {
+        return errors::Internal("Failed to compress using zstd: ",
+                                ZSTD_getErrorName(result));
+      }
+    }
+  }
+  ZSTD_inBuffer end = {nullptr, 0, 0};
+  do {
+    result = ZSTD_compressStream2(cctx, &output, &end, ZSTD_e_end);
+    if (ZSTD_isError(result)) {
+      return errors::Internal("Failed to compress using zstd: ",
+                              ZSTD_getErrorName(result));
+    }
+  } while (result != 0);
+  out->resize(output.pos);
+  return OkStatus();
+}
+
+Status ZstdUncompress(const std::string& compressed_data, Iov& iov) {
+  const unsigned long long uncompressed_size =  // NOLINT
+      ZSTD_getFrameContentSize(compressed_data.data(), compressed_data.size());
+  if (uncompressed_size == ZSTD_CONTENTSIZE_ERROR ||
+      uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return errors::Internal(
+        "Could not get zstd uncompressed length. Compressed data size: ",
+        compressed_data.size());
+  }
+  if (uncompressed_size != iov.NumBytes()) {
+    return errors::Internal(
+        "Uncompressed size mismatch. Zstd expects ", uncompressed_size,
+        " whereas the tensor metadata suggests ", iov.NumBytes());
+  }
+
+  ZSTD_DCtx* dctx = ThreadLocalZstdDCtx();
+  if (dctx == nullptr) {
+    return errors::ResourceExhausted("Failed to create a zstd context.");
+  }
+  ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+  ZSTD_inBuffer input = {compressed_data.data(), compressed_data.size(), 0};
+  size_t result = 1;
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    ZSTD_outBuffer output = {iov.Data()[i].iov_base, iov.Data()[i].iov_len, 0};
+    while (output.pos < output.size) {
+      const size_t input_pos = input.pos;
+      const size_t output_pos = output.pos;
+      result = ZSTD_decompressStream(dctx, &output, &input);
+      if (ZSTD_isError(result)) {
+        return errors::Internal("Failed to perform zstd decompression: ",
+                                ZSTD_getErrorName(result));
+      }
+      if (input.pos == input_pos && output.pos == output_pos) {
+        return errors::Internal("Truncated zstd compressed data.");
+      }
+    }
+  }
+  // Consume the end of the frame.
+  while (result != 0) {
+    const size_t input_pos = input.pos;
+    ZSTD_outBuffer output = {nullptr, 0, 0};
+    result = ZSTD_decompressStream(dctx, &output, &input);
+    if (ZSTD_isError(result) || input.pos == input_pos) {
+      return errors::Internal("Failed to perform zstd decompression.");
+    }
+  }
+  return OkStatus();
+}
+#else   // !IS_MOBILE_PLATFORM
+Status ZstdCompress(Iov& iov, int level, std::string* out) {
+  return errors::Unimplemented(
+      "zstd compression is not supported on mobile platforms.");
+}
+
+Status ZstdUncompress(const std::string& compressed_data, Iov& iov) {
+  return errors::Unimplemented(
+      "zstd decompression is not supported on mobile platforms.");
+}
+#endif  // !IS_MOBILE_PLATFORM
+
+void CopyFromIov(Iov& iov, std::string* out) {
+  out->resize(iov.NumBytes());
+  char* pos = &(*out)[0];
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    std::memcpy(pos, iov.Data()[i].iov_base, iov.Data()[i].iov_len);
+    pos += iov.Data()[i].iov_len;
+  }
+}
+
+Status CopyToIov(const std::string& data, Iov& iov) {
+  if (data.size() != iov.NumBytes()) {
+    return errors::Internal("Uncompressed size mismatch. The element holds ",
+                            data.size(),
+                            " bytes whereas the tensor metadata suggests ",
+                            iov.NumBytes());
+  }
+  const char* pos = data.data();
+  for (size_t i = 0; i < iov.NumPieces(); ++i) {
+    std::memcpy(iov.Data()[i].iov_base, pos, iov.Data()[i].iov_len);
+    pos += iov.Data()[i].iov_len;
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+Status ParseCompressionCodec(absl::string_view name,
+                             CompressedElement::Codec* codec) {
+  if (name == "snappy") {
+    *codec = CompressedElement::CODEC_SNAPPY;
+  } else if (name == "zstd") {
+    *codec = CompressedElement::CODEC_ZSTD;
+  } else if (name == "none") {
+    *codec = CompressedElement::CODEC_NONE;
+  } else {
+    return errors::InvalidArgument("Unknown compression codec: ", name,
+                                   ". Must be one of snappy, zstd or none.");
+  }
+  return OkStatus();
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       CompressedElement* out) {
+  return CompressElement(element, CompressionOptions(), out);
+}
+
 Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionOptions& options,
                        CompressedElement* out) {
   // First pass: preprocess the non`memcpy`able tensors.
   size_t num_string_tensors = 0;
@@ -120,16 +345,25 @@ Status CompressElement(const std::vector<Tensor>& element,
     }
   }
 
-  if (iov.NumBytes() > kuint32max) {
-    return errors::OutOfRange("Encountered dataset element of size ",
-                              iov.NumBytes(),
-                              ", exceeding the 4GB Snappy limit.");
+  switch (options.codec) {
+    case CompressedElement::CODEC_SNAPPY:
+      TF_RETURN_IF_ERROR(SnappyCompress(iov, out->mutable_data()));
+      out->set_version(kSnappyCompressedElementVersion);
+      break;
+    case CompressedElement::CODEC_ZSTD:
+      TF_RETURN_IF_ERROR(
+          ZstdCompress(iov, options.level, out->mutable_data()));
+      out->set_version(kCompressedElementVersion);
+      break;
+    case CompressedElement::CODEC_NONE:
+      CopyFromIov(iov, out->mutable_data());
+      out->set_version(kCompressedElementVersion);
+      break;
+    default:
+      return errors::InvalidArgument("Unsupported compression codec: ",
+                                     options.codec);
   }
-  if (!port::Snappy_CompressFromIOVec(iov.Data(), iov.NumBytes(),
-                                      out->mutable_data())) {
-    return errors::Internal("Failed to compress using snappy.");
-  }
-  out->set_version(kCompressedElementVersion);
+  out->set_codec(options.codec);
   VLOG(3) << "Compressed element from " << iov.NumBytes() << " bytes to "
           << out->data().size() << " bytes";
   return OkStatus();
@@ -137,10 +371,15 @@ Status CompressElement(const std::vector<Tensor>& element,
 
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out) {
-  if (compressed.version() != kCompressedElementVersion) {
+  if (compressed.version() != kSnappyCompressedElementVersion &&
+      compressed.version() != kCompressedElementVersion) {
     return errors::Internal("Unsupported compressed element version: ",
                             compressed.version());
   }
+  const CompressedElement::Codec codec =
+      compressed.version() == kSnappyCompressedElementVersion
+          ? CompressedElement::CODEC_SNAPPY
+          : compressed.codec();
   int num_components = compressed.component_metadata_size();
   out->clear();
   out->reserve(num_components);
@@ -190,23 +429,18 @@ Status UncompressElement(const CompressedElement& compressed,
   }
 
   // Step 2: Uncompress into the iovec.
-  const std::string& compressed_data = compressed.data();
-  size_t uncompressed_size;
-  if (!port::Snappy_GetUncompressedLength(
-          compressed_data.data(), compressed_data.size(), &uncompressed_size)) {
-    return errors::Internal(
-        "Could not get snappy uncompressed length. Compressed data size: ",
-        compressed_data.size());
-  }
-  if (uncompressed_size != static_cast<size_t>(iov.NumBytes())) {
-    return errors::Internal(
-        "Uncompressed size mismatch. Snappy expects ", uncompressed_size,
-        " whereas the tensor metadata suggests ", iov.NumBytes());
-  }
-  if (!port::Snappy_UncompressToIOVec(compressed_data.data(),
-                                      compressed_data.size(), iov.Data(),
-                                      iov.NumPieces())) {
-    return errors::Internal("Failed to perform snappy decompression.");
+  switch (codec) {
+    case CompressedElement::CODEC_SNAPPY:
+      TF_RETURN_IF_ERROR(SnappyUncompress(compressed.data(), iov));
+      break;
+    case CompressedElement::CODEC_ZSTD:
+      TF_RETURN_IF_ERROR(ZstdUncompress(compressed.data(), iov));
+      break;
+    case CompressedElement::CODEC_NONE:
+      TF_RETURN_IF_ERROR(CopyToIov(compressed.data(), iov));
+      break;
+    default:
+      return errors::Internal("Unsupported compression codec: ", codec);
   }
 
   // Third pass: deserialize nonstring, non`memcpy`able tensors.
@@ -231,8 +465,106 @@ Status UncompressElement(const CompressedElement& compressed,
   return OkStatus();
 }
 
+void LocalElement::Encode(VariantTensorData* data) const {
+  data->set_type_name(TypeName());
+  for (const Tensor& component : components) {
+    *data->add_tensors() = component;
+  }
+}
+
+bool LocalElement::Decode(VariantTensorData data) {
+  components = std::move(data.tensors_);
+  return true;
+}
+
+std::string LocalElement::DebugString() const {
+  return absl::StrCat("LocalElement<", components.size(), " components>");
+}
+
+Status UncompressElement(const Variant& variant, std::vector<Tensor>* out) {
+  if (const LocalElement* local = variant.get<LocalElement>()) {
+    *out = local->components;
+    return OkStatus();
+  }
+  if (const CompressedElement* compressed = variant.get<CompressedElement>()) {
+    return UncompressElement(*compressed, out);
+  }
+  return errors::InvalidArgument(
+      "Input does not contain a compressed element. Instead got ",
+      variant.DebugString());
+}
+
+AdaptiveElementCompressor::AdaptiveElementCompressor(
+    double network_bytes_per_second, int zstd_level)
+    : network_bytes_per_second_(network_bytes_per_second),
+      zstd_level_(zstd_level) {}
+
+CompressedElement::Codec AdaptiveElementCompressor::codec() const {
+  tf_shared_lock l(mu_);
+  return codec_;
+}
+
+Status AdaptiveElementCompressor::Compress(const std::vector<Tensor>& element,
+                                           CompressedElement* out) {
+  bool probe;
+  CompressionOptions options;
+  options.level = zstd_level_;
+  {
+    mutex_lock l(mu_);
+    probe = num_elements_++ % kProbeInterval == 0;
+    options.codec = codec_;
+  }
+  if (probe) return Probe(element, out);
+  return CompressElement(element, options, out);
+}
+
+Status AdaptiveElementCompressor::Probe(const std::vector<Tensor>& element,
+                                        CompressedElement* out) {
+  Status status;
+  double best_cost = std::numeric_limits<double>::infinity();
+  CompressedElement::Codec best_codec = CompressedElement::CODEC_SNAPPY;
+  for (CompressedElement::Codec codec :
+       {CompressedElement::CODEC_NONE, CompressedElement::CODEC_SNAPPY,
+        CompressedElement::CODEC_ZSTD}) {
+    CompressionOptions options;
+    options.codec = codec;
+    options.level = zstd_level_;
+    CompressedElement compressed;
+    std::vector<Tensor> uncompressed;
+    const uint64 start_nsec = EnvTime::NowNanos();
+    status = CompressElement(element, options, &compressed);
+    if (!status.ok()) continue;
+    const uint64 compressed_nsec = EnvTime::NowNanos();
+    status = UncompressElement(compressed, &uncompressed);
+    if (!status.ok()) continue;
+    const uint64 end_nsec = EnvTime::NowNanos();
+    const double cost = (end_nsec - start_nsec) * 1e-9 +
+                        compressed.data().size() / network_bytes_per_second_;
+    VLOG(3) << "Codec " << CompressedElement::Codec_Name(codec)
+            << ": compress " << (compressed_nsec - start_nsec)
+            << "ns, uncompress " << (end_nsec - compressed_nsec) << "ns, "
+            << compressed.data().size() << " bytes";
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_codec = codec;
+      *out = std::move(compressed);
+    }
+  }
+  if (best_cost == std::numeric_limits<double>::infinity()) return status;
+
+  mutex_lock l(mu_);
+  if (codec_ != best_codec) {
+    VLOG(2) << "Switching dataset element compression to "
+            << CompressedElement::Codec_Name(best_codec);
+  }
+  codec_ = best_codec;
+  return OkStatus();
+}
+
 REGISTER_UNARY_VARIANT_DECODE_FUNCTION(CompressedElement,
                                        "tensorflow.data.CompressedElement");
+REGISTER_UNARY_VARIANT_DECODE_FUNCTION(LocalElement,
+                                       "tensorflow.data.LocalElement");
 
 }  // namespace data
 }  // namespace tensorflow
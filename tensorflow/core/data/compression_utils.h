@@ -15,28 +15,102 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_COMPRESSION_UTILS_H_
 #define TENSORFLOW_CORE_DATA_COMPRESSION_UTILS_H_
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace data {
 
+struct CompressionOptions {
+  CompressedElement::Codec codec = CompressedElement::CODEC_SNAPPY;
+  // Compression level of codecs that have levels (zstd). 0 selects the
+  // codec's default level.
+  int level = 0;
+};
+
+// Parses a codec name ("snappy", "zstd" or "none").
+Status ParseCompressionCodec(absl::string_view name,
+                             CompressedElement::Codec* codec);
+
 // Compresses the components of `element` into the `CompressedElement` proto.
 //
 // In addition to writing the actual compressed bytes, `Compress` fills
-// out the per-component metadata for the `CompressedElement`.
+// out the per-component metadata for the `CompressedElement`. The codec is
+// recorded in the proto, so `UncompressElement` needs no options.
 //
-// Returns an error if the uncompressed size of the element exceeds 4GB.
+// With Snappy, returns an error if the uncompressed size of the element exceeds
+// 4GB.
+Status CompressElement(const std::vector<Tensor>& element,
+                       CompressedElement* out);
 Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionOptions& options,
                        CompressedElement* out);
 
 // Uncompresses a `CompressedElement` into a vector of tensor components.
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
 
+// An uncompressed element passed by reference where a `CompressedElement` is
+// expected, e.g. from a tf.data service worker to a client in the same
+// process. `UncompressElement` returns its components without copying them.
+struct LocalElement {
+  std::vector<Tensor> components;
+
+  std::string TypeName() const { return "tensorflow.data.LocalElement"; }
+  void Encode(VariantTensorData* data) const;
+  bool Decode(VariantTensorData data);
+  std::string DebugString() const;
+};
+
+// Uncompresses a `CompressedElement` or `LocalElement` held by `variant`.
+Status UncompressElement(const Variant& variant, std::vector<Tensor>* out);
+
+// Compresses a stream of elements with the codec that is cheapest end to end.
+//
+// Every `kProbeInterval` elements (starting with the first), the element is
+// compressed and uncompressed with every codec, and the codec minimizing
+//
+//   compress time + uncompress time + compressed bytes / network bandwidth
+//
+// is used for the following elements. CPU-bound consumers thus get a cheap
+// codec, while slow links get a stronger one. Thread-safe.
+class AdaptiveElementCompressor {
+ public:
+  static constexpr int64_t kProbeInterval = 1000;
+
+  // `network_bytes_per_second` is the throughput of the link the compressed
+  // elements are sent over. `zstd_level` is the level used for zstd.
+  explicit AdaptiveElementCompressor(double network_bytes_per_second,
+                                     int zstd_level = 0);
+
+  Status Compress(const std::vector<Tensor>& element, CompressedElement* out);
+
+  // Returns the codec picked by the last probe.
+  CompressedElement::Codec codec() const;
+
+ private:
+  // Compresses `element` with every codec, updates `codec_` and returns the
+  // element compressed with the cheapest codec in `out`.
+  Status Probe(const std::vector<Tensor>& element, CompressedElement* out);
+
+  const double network_bytes_per_second_;
+  const int zstd_level_;
+  mutable mutex mu_;
+  int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+  CompressedElement::Codec codec_ TF_GUARDED_BY(mu_) =
+      CompressedElement::CODEC_SNAPPY;
+};
+
 }  // namespace data
 }  // namespace tensorflow
 
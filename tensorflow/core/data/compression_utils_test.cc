@@ -17,9 +17,13 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tsl/platform/status_matchers.h"
 
@@ -98,15 +102,189 @@ TEST_P(ParameterizedCompressionUtilsTest, VersionMismatch) {
   CompressedElement compressed;
   TF_ASSERT_OK(CompressElement(element, &compressed));
 
-  compressed.set_version(1);
+  compressed.set_version(2);
   std::vector<Tensor> round_trip_element;
   EXPECT_THAT(UncompressElement(compressed, &round_trip_element),
               StatusIs(error::INTERNAL));
 }
 
+TEST_P(ParameterizedCompressionUtilsTest, RoundTripWithEveryCodec) {
+  std::vector<Tensor> element = GetParam();
+  for (CompressedElement::Codec codec :
+       {CompressedElement::CODEC_NONE, CompressedElement::CODEC_SNAPPY,
+        CompressedElement::CODEC_ZSTD}) {
+    CompressionOptions options;
+    options.codec = codec;
+    CompressedElement compressed;
+    TF_ASSERT_OK(CompressElement(element, options, &compressed));
+    EXPECT_EQ(compressed.codec(), codec);
+    EXPECT_EQ(compressed.version(),
+              codec == CompressedElement::CODEC_SNAPPY ? 0 : 1);
+    std::vector<Tensor> round_trip_element;
+    TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+    TF_EXPECT_OK(
+        ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+  }
+}
+
+TEST_P(ParameterizedCompressionUtilsTest, AdaptiveRoundTrip) {
+  std::vector<Tensor> element = GetParam();
+  AdaptiveElementCompressor compressor(
+      /*network_bytes_per_second=*/1e8);
+  for (int i = 0; i < 3; ++i) {
+    CompressedElement compressed;
+    TF_ASSERT_OK(compressor.Compress(element, &compressed));
+    EXPECT_EQ(compressed.codec(), compressor.codec());
+    std::vector<Tensor> round_trip_element;
+    TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+    TF_EXPECT_OK(
+        ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedCompressionUtilsTest,
                          ::testing::ValuesIn(TestCases()));
 
+TEST(CompressionUtilsTest, ZstdCompressesRedundantData) {
+  std::vector<Tensor> element = {CreateTensor<int64_t>(TensorShape{4096})};
+  element[0].flat<int64_t>().setConstant(7);
+  CompressionOptions options;
+  options.codec = CompressedElement::CODEC_ZSTD;
+  options.level = 19;
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, options, &compressed));
+  EXPECT_LT(compressed.data().size(), 4096 * sizeof(int64_t) / 100);
+}
+
+TEST(CompressionUtilsTest, CorruptZstdData) {
+  std::vector<Tensor> element = {
+      CreateTensor<int64_t>(TensorShape{64, 64}),
+      CreateTensor<tstring>(TensorShape{2}, {"abc", "xyz"})};
+  CompressionOptions options;
+  options.codec = CompressedElement::CODEC_ZSTD;
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, options, &compressed));
+  compressed.mutable_data()->resize(compressed.data().size() / 2);
+  std::vector<Tensor> round_trip_element;
+  EXPECT_THAT(UncompressElement(compressed, &round_trip_element),
+              StatusIs(error::INTERNAL));
+}
+
+TEST(CompressionUtilsTest, LocalElementIsNotCopied) {
+  std::vector<Tensor> element = {
+      CreateTensor<int64_t>(TensorShape{64, 64}),
+      CreateTensor<tstring>(TensorShape{2}, {"abc", "xyz"})};
+  LocalElement local_element;
+  local_element.components = element;
+  Variant variant = std::move(local_element);
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(variant, &round_trip_element));
+  ASSERT_EQ(round_trip_element.size(), element.size());
+  for (int i = 0; i < element.size(); ++i) {
+    EXPECT_TRUE(round_trip_element[i].SharesBufferWith(element[i]));
+  }
+}
+
+TEST(CompressionUtilsTest, UncompressVariant) {
+  std::vector<Tensor> element = {CreateTensor<int64_t>(TensorShape{8, 8})};
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, &compressed));
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(Variant(compressed), &round_trip_element));
+  TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual(element, round_trip_element,
+                                               /*compare_order=*/true));
+  EXPECT_THAT(UncompressElement(Variant(element[0]), &round_trip_element),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+TEST(CompressionUtilsTest, ParseCompressionCodec) {
+  CompressedElement::Codec codec;
+  TF_EXPECT_OK(ParseCompressionCodec("zstd", &codec));
+  EXPECT_EQ(codec, CompressedElement::CODEC_ZSTD);
+  TF_EXPECT_OK(ParseCompressionCodec("none", &codec));
+  EXPECT_EQ(codec, CompressedElement::CODEC_NONE);
+  EXPECT_THAT(ParseCompressionCodec("lzma", &codec),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+// Representative elements: a batch of noisy images (hard to compress), a
+// batch of smooth images and a batch of serialized records.
+std::vector<Tensor> BenchmarkElement(int kind) {
+  random::PhiloxRandom philox(42);
+  random::SimplePhilox rng(&philox);
+  switch (kind) {
+    case 0: {
+      Tensor images(DT_UINT8, TensorShape{32, 64, 64, 3});
+      auto flat = images.flat<uint8>();
+      for (int64_t i = 0; i < flat.size(); ++i) flat(i) = rng.Uniform(256);
+      return {images};
+    }
+    case 1: {
+      Tensor images(DT_FLOAT, TensorShape{32, 64, 64, 3});
+      auto flat = images.flat<float>();
+      for (int64_t i = 0; i < flat.size(); ++i) flat(i) = (i / 3) % 64;
+      return {images};
+    }
+    default: {
+      Tensor records(DT_STRING, TensorShape{256});
+      auto flat = records.flat<tstring>();
+      for (int64_t i = 0; i < flat.size(); ++i) {
+        flat(i) = absl::StrCat("feature_", i % 16, ":", rng.Uniform(1000),
+                                  std::string(200, 'a' + i % 26));
+      }
+      return {records};
+    }
+  }
+}
+
+CompressionOptions BenchmarkOptions(int codec) {
+  CompressionOptions options;
+  options.codec = static_cast<CompressedElement::Codec>(codec);
+  return options;
+}
+
+void BM_CompressElement(::testing::benchmark::State& state) {
+  const std::vector<Tensor> element = BenchmarkElement(state.range(0));
+  const CompressionOptions options = BenchmarkOptions(state.range(1));
+  size_t compressed_bytes = 0;
+  for (auto s : state) {
+    CompressedElement compressed;
+    TF_CHECK_OK(CompressElement(element, options, &compressed));
+    compressed_bytes = compressed.data().size();
+  }
+  size_t uncompressed_bytes = 0;
+  for (const Tensor& t : element) uncompressed_bytes += t.TotalBytes();
+  state.SetBytesProcessed(state.iterations() * uncompressed_bytes);
+  state.counters["ratio"] =
+      static_cast<double>(uncompressed_bytes) / compressed_bytes;
+}
+
+void BM_UncompressElement(::testing::benchmark::State& state) {
+  const std::vector<Tensor> element = BenchmarkElement(state.range(0));
+  CompressedElement compressed;
+  TF_CHECK_OK(
+      CompressElement(element, BenchmarkOptions(state.range(1)), &compressed));
+  for (auto s : state) {
+    std::vector<Tensor> uncompressed;
+    TF_CHECK_OK(UncompressElement(compressed, &uncompressed));
+  }
+  size_t uncompressed_bytes = 0;
+  for (const Tensor& t : element) uncompressed_bytes += t.TotalBytes();
+  state.SetBytesProcessed(state.iterations() * uncompressed_bytes);
+}
+
+// Args: element kind (noisy images, smooth images, records), codec.
+BENCHMARK(BM_CompressElement)
+    ->ArgsProduct({{0, 1, 2},
+                   {CompressedElement::CODEC_NONE,
+                    CompressedElement::CODEC_SNAPPY,
+                    CompressedElement::CODEC_ZSTD}});
+BENCHMARK(BM_UncompressElement)
+    ->ArgsProduct({{0, 1, 2},
+                   {CompressedElement::CODEC_NONE,
+                    CompressedElement::CODEC_SNAPPY,
+                    CompressedElement::CODEC_ZSTD}});
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
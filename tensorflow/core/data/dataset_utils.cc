@@ -479,6 +479,65 @@ bool MatchesAnyVersion(StringPiece op_prefix, StringPiece op_to_match) {
   return (op_to_match[index] == 'V') && (op_prefix.length() == index);
 }
 
+bool IsKnownDeterministic(const DatasetBase& dataset) {
+  // Datasets whose order or elements differ between iterations.
+  static constexpr std::array<const char*, 9> kRandomOps = {
+      "DataServiceDataset",
+      "DirectedInterleaveDataset",
+      "ExperimentalDirectedInterleaveDataset",
+      "ExperimentalRandomDataset",
+      "ExperimentalSamplingDataset",
+      "RandomDataset",
+      "SamplingDataset",
+      "ShuffleAndRepeatDataset",
+      "ShuffleDataset",
+  };
+  // Datasets that may produce elements out of order unless determinism is
+  // required, e.g. when the `make_sloppy` rewrite relaxed them.
+  static constexpr std::array<const char*, 10> kParallelOps = {
+      "ExperimentalMapAndBatchDataset",
+      "ExperimentalParallelInterleaveDataset",
+      "ExperimentalParseExampleDataset",
+      "LegacyParallelInterleaveDataset",
+      "MapAndBatchDataset",
+      "ParallelBatchDataset",
+      "ParallelFilterDataset",
+      "ParallelInterleaveDataset",
+      "ParallelMapDataset",
+      "ParseExampleDataset",
+  };
+  if (!dataset.CheckExternalState().ok()) {
+    return false;
+  }
+  const bool determinism_required = OpDeterminismRequired();
+  std::vector<const DatasetBase*> datasets = {&dataset};
+  while (!datasets.empty()) {
+    const DatasetBase* current = datasets.back();
+    datasets.pop_back();
+    const Options& options = current->options();
+    if (!determinism_required &&
+        options.optional_deterministic_case() == Options::kDeterministic &&
+        !options.deterministic()) {
+      return false;
+    }
+    const string& op = current->type_string();
+    for (const char* random_op : kRandomOps) {
+      if (MatchesAnyVersion(random_op, op)) return false;
+    }
+    if (!determinism_required) {
+      for (const char* parallel_op : kParallelOps) {
+        if (MatchesAnyVersion(parallel_op, op)) return false;
+      }
+    }
+    std::vector<const DatasetBase*> inputs;
+    if (!current->InputDatasets(&inputs).ok()) {
+      return false;
+    }
+    datasets.insert(datasets.end(), inputs.begin(), inputs.end());
+  }
+  return true;
+}
+
 absl::flat_hash_set<string> GetExperiments() {
   return GetExperiments(tsl::port::JobName(), tsl::port::TaskId(),
                         [](const tstring& str) { return Hash64(str); });
@@ -1009,6 +1068,8 @@ REGISTER_DATASET_EXPERIMENT("reduce_array_record_dataset_memory_usage",
                             RandomJobSamplePercentage<50>, AllTasks);
 REGISTER_DATASET_EXPERIMENT("map_fusion", RandomJobSamplePercentage<0>,
                             AllTasks);
+REGISTER_DATASET_EXPERIMENT("spill_memory_cache", RandomJobSamplePercentage<0>,
+                            AllTasks);
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -246,6 +246,14 @@ class DummyResourceOp : public OpKernel {
 // MatchesAnyVersion("PaddedBatchDataset", "BatchDataset") == false
 bool MatchesAnyVersion(StringPiece op_prefix, StringPiece op_to_match);
 
+// Returns whether `dataset` is known to produce the same elements in the same
+// order each time it is iterated. The check is conservative: it is false if
+// the dataset or one of its inputs has external state (e.g. stateful
+// functions), shuffles or samples its input, may reorder elements computed in
+// parallel (unless op determinism is required), allows nondeterminism through
+// its options, or does not report its inputs.
+bool IsKnownDeterministic(const DatasetBase& dataset);
+
 // Returns the index-th slice of a given tensor. If the index-th slice of
 // the tensor is not aligned, returns a deep copy of the tensor.
 Tensor MaybeCopySubSlice(const Tensor& tensor, int64 index);
@@ -299,6 +307,12 @@ struct CopyBatchParams {
     runner = ctx->runner();
     runner_threadpool_size = GetRunnerThreadpoolSizeFromOpKernelContext(ctx);
   }
+
+  explicit CopyBatchParams(AnyContext ctx) {
+    allocator = ctx.allocator;
+    runner = ctx.runner;
+    runner_threadpool_size = ctx.runner_threadpool_size;
+  }
 };
 
 // Copies the input elements to a batch.
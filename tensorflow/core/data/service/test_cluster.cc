@@ -84,6 +84,7 @@ Status TestCluster::AddWorker(std::optional<int> port) {
       port.has_value() ? absl::StrCat("localhost:", *port) : "localhost:%port%";
   config.set_worker_address(worker_address);
   config.set_heartbeat_interval_ms(config_.worker_heartbeat_interval_ms);
+  config.set_local_zero_copy_transfer(config_.worker_local_zero_copy_transfer);
   TF_RETURN_IF_ERROR(NewWorkerServer(config, worker));
   TF_RETURN_IF_ERROR(worker->Start());
   worker_addresses_.push_back(absl::StrCat("localhost:", worker->BoundPort()));
@@ -55,6 +55,8 @@ class TestCluster {
     int64_t job_gc_check_interval_ms = 0;
     int64_t job_gc_timeout_ms = 0;
     std::string work_dir;
+    // Sets `WorkerConfig.local_zero_copy_transfer` on the workers.
+    bool worker_local_zero_copy_transfer = false;
   };
 
   // Creates a new test cluster with a dispatcher and `num_workers` workers.
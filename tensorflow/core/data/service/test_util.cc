@@ -133,6 +133,43 @@ DatasetDef RangeSquareDataset(const int64_t range) {
   return dataset_def;
 }
 
+DatasetDef RangeCompressedDataset(const int64_t range) {
+  DatasetDef dataset_def;
+  *dataset_def.mutable_graph() = GDef(
+      {NDef("start", "Const", /*inputs=*/{},
+            {{"value", AsScalar<int64_t>(0)}, {"dtype", DT_INT64}}),
+       NDef("stop", "Const", /*inputs=*/{},
+            {{"value", AsScalar<int64_t>(range)}, {"dtype", DT_INT64}}),
+       NDef("step", "Const", /*inputs=*/{},
+            {{"value", AsScalar<int64_t>(1)}, {"dtype", DT_INT64}}),
+       NDef("range", "RangeDataset", /*inputs=*/{"start", "stop", "step"},
+            {{"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape()}},
+             {"output_types", gtl::ArraySlice<DataType>{DT_INT64}}}),
+       NDef("num_parallel_calls", "Const", /*inputs=*/{},
+            {{"value", AsScalar<int64_t>(-1)}, {"dtype", DT_INT64}}),
+       NDef("compress", "ParallelMapDatasetV2",
+            /*inputs=*/{"range", "num_parallel_calls"},
+            {{"f", FunctionDefHelper::FunctionRef("Compress")},
+             {"Targuments", {}},
+             {"output_shapes", gtl::ArraySlice<TensorShape>{TensorShape()}},
+             {"output_types", gtl::ArraySlice<DataType>{DT_VARIANT}},
+             {"deterministic", "default"}}),
+       NDef("dataset", "_Retval", /*inputs=*/{"compress"},
+            {{"T", DT_VARIANT}, {"index", 0}})},
+      {FunctionDefHelper::Create(
+          /*function_name=*/"Compress",
+          /*in_def=*/{"x: int64"},
+          /*out_def=*/{"y: variant"},
+          /*attr_def=*/{},
+          /*node_def=*/
+          {{{"compressed"},
+            "CompressElement",
+            {"x"},
+            {{"input_types", gtl::ArraySlice<DataType>{DT_INT64}}}}},
+          /*ret_def=*/{{"y", "compressed:compressed:0"}})});
+  return dataset_def;
+}
+
 DatasetDef RangeDatasetWithShardHint(const int64_t range) {
   DatasetDef dataset_def;
   *dataset_def.mutable_graph() = GDef(
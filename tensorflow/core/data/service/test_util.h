@@ -43,6 +43,10 @@ DatasetDef RangeDataset(int64_t range);
 // tf.data.Dataset.range(range).map(lambda x: x*x).
 DatasetDef RangeSquareDataset(int64_t range);
 
+// Returns a test dataset representing tf.data.Dataset.range(range) with the
+// compression map that the tf.data service adds to compressed datasets.
+DatasetDef RangeCompressedDataset(int64_t range);
+
 // Returns a test dataset representing
 // tf.data.Dataset.range(range).shard(SHARD_HINT, SHARD_HINT).
 DatasetDef RangeDatasetWithShardHint(int64_t range);
@@ -209,7 +209,7 @@ class LocalDataTransferClient : public DataTransferClient {
     TF_ASSIGN_OR_RETURN(std::shared_ptr<DataServiceWorkerImpl> worker,
                         GetWorker(req));
     int64_t start_time_us = env_->NowMicros();
-    Status s = worker->GetElementResult(&req, &result);
+    Status s = worker->GetLocalElementResult(&req, &result);
     int64_t end_time_us = env_->NowMicros();
     TF_RETURN_IF_ERROR(s);
     metrics::RecordTFDataServiceGetElementDuration(kLocalTransferProtocol,
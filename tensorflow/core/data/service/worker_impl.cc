@@ -29,6 +29,7 @@ limitations under the License.
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_transfer.h"
@@ -47,8 +48,11 @@ limitations under the License.
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/grappler/optimizers/data/remove_compression_map.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/env_time.h"
@@ -253,6 +257,17 @@ DataServiceWorkerImpl::CreateDispatcherClient() const TF_LOCKS_EXCLUDED(mu_) {
 
 Status DataServiceWorkerImpl::GetElementResult(
     const GetElementRequest* request, struct GetElementResult* result) {
+  return GetElementResultInternal(request, /*local_client=*/false, result);
+}
+
+Status DataServiceWorkerImpl::GetLocalElementResult(
+    const GetElementRequest* request, struct GetElementResult* result) {
+  return GetElementResultInternal(request, /*local_client=*/true, result);
+}
+
+Status DataServiceWorkerImpl::GetElementResultInternal(
+    const GetElementRequest* request, bool local_client,
+    struct GetElementResult* result) {
   Task* task = nullptr;
   {
     mutex_lock l(mu_);
@@ -294,8 +309,13 @@ Status DataServiceWorkerImpl::GetElementResult(
     task->outstanding_requests--;
     cv_.notify_all();
   });
-  TF_RETURN_IF_ERROR(EnsureTaskInitialized(*task));
+  TF_RETURN_IF_ERROR(EnsureTaskInitialized(*task, local_client));
   TF_RETURN_IF_ERROR(task->task_runner->GetNext(*request, *result));
+  if (task->deferred_compression != nullptr && !result->end_of_sequence &&
+      !result->skip) {
+    TF_RETURN_IF_ERROR(
+        task->deferred_compression->Apply(local_client, result->components));
+  }
 
   if (result->end_of_sequence) {
     mutex_lock l(mu_);
@@ -330,7 +350,7 @@ Status DataServiceWorkerImpl::ProcessTaskInternal(const TaskDef& task_def)
 }
 
 Status DataServiceWorkerImpl::EnsureTaskInitialized(
-    DataServiceWorkerImpl::Task& task) {
+    DataServiceWorkerImpl::Task& task, bool local_client) {
   if (task.task_def.worker_address() != worker_address_) {
     return errors::Internal(absl::Substitute(
         "Dispatcher's worker address $0 does not match worker's address $1.",
@@ -342,8 +362,10 @@ Status DataServiceWorkerImpl::EnsureTaskInitialized(
     return OkStatus();
   }
   TF_ASSIGN_OR_RETURN(DatasetDef dataset_def, GetDatasetDef(task.task_def));
-  TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Dataset> dataset,
-                      MakeDataset(dataset_def, task.task_def));
+  TF_ASSIGN_OR_RETURN(
+      std::unique_ptr<standalone::Dataset> dataset,
+      MakeDataset(dataset_def, task.task_def, local_client,
+                  task.deferred_compression));
   TF_ASSIGN_OR_RETURN(std::unique_ptr<standalone::Iterator> iterator,
                       MakeDatasetIterator(*dataset, task.task_def));
   auto task_iterator = std::make_unique<StandaloneTaskIterator>(
@@ -404,9 +426,64 @@ StatusOr<bool> DataServiceWorkerImpl::DisableCompressionAtRuntime(
   return response.compression_disabled_at_runtime();
 }
 
+Status DataServiceWorkerImpl::DeferredCompression::Apply(
+    bool local_client, std::vector<Tensor>& element) {
+  Tensor tensor(DT_VARIANT, TensorShape({}));
+  if (local_client) {
+    LocalElement local_element;
+    local_element.components = std::move(element);
+    tensor.scalar<Variant>()() = std::move(local_element);
+  } else {
+    CompressedElement compressed;
+    if (adaptive_compressor) {
+      TF_RETURN_IF_ERROR(adaptive_compressor->Compress(element, &compressed));
+    } else {
+      TF_RETURN_IF_ERROR(CompressElement(element, options, &compressed));
+    }
+    tensor.scalar<Variant>()() = std::move(compressed);
+  }
+  element.clear();
+  element.push_back(std::move(tensor));
+  return OkStatus();
+}
+
+StatusOr<std::unique_ptr<DataServiceWorkerImpl::DeferredCompression>>
+DataServiceWorkerImpl::GetDeferredCompression(const GraphDef& graph,
+                                              bool local_client) const {
+  // Only clients in this process can read elements uncompressed. Tasks that
+  // are first read by a remote client keep the compression map, so that their
+  // elements are compressed in parallel ahead of the requests.
+  if (!local_client || !config_.local_zero_copy_transfer() ||
+      LocalWorkers::Get(worker_address_) == nullptr) {
+    return nullptr;
+  }
+  // Look for the same node that `RemoveCompressionMapRewriter` removes.
+  NodeDef compress_node;
+  if (!grappler::GetCompressionMapNode(graph, &compress_node).ok()) {
+    return nullptr;
+  }
+  std::string codec = "snappy";
+  float network_bytes_per_second = 1.25e9;
+  auto deferred_compression = std::make_unique<DeferredCompression>();
+  TryGetNodeAttr(compress_node, "codec", &codec);
+  TryGetNodeAttr(compress_node, "level", &deferred_compression->options.level);
+  TryGetNodeAttr(compress_node, "network_bytes_per_second",
+                 &network_bytes_per_second);
+  if (codec == "auto") {
+    deferred_compression->adaptive_compressor =
+        std::make_unique<AdaptiveElementCompressor>(
+            network_bytes_per_second, deferred_compression->options.level);
+  } else {
+    TF_RETURN_IF_ERROR(
+        ParseCompressionCodec(codec, &deferred_compression->options.codec));
+  }
+  return deferred_compression;
+}
+
 StatusOr<std::unique_ptr<standalone::Dataset>>
-DataServiceWorkerImpl::MakeDataset(const DatasetDef& dataset_def,
-                                   const TaskDef& task_def) const {
+DataServiceWorkerImpl::MakeDataset(
+    const DatasetDef& dataset_def, const TaskDef& task_def, bool local_client,
+    std::unique_ptr<DeferredCompression>& deferred_compression) const {
   TF_ASSIGN_OR_RETURN(bool compression_disabled_at_runtime,
                       DisableCompressionAtRuntime(task_def.dataset_id()));
   GraphDef graph = dataset_def.graph();
@@ -415,7 +492,11 @@ DataServiceWorkerImpl::MakeDataset(const DatasetDef& dataset_def,
     DumpGraphDefToFile(absl::StrCat(prefix, "-prerewrite_GraphDef"), graph);
     DumpProtoToFile(absl::StrCat(prefix, "-prerewrite_TaskDef"), task_def);
   }
-  if (compression_disabled_at_runtime) {
+  if (!compression_disabled_at_runtime) {
+    TF_ASSIGN_OR_RETURN(deferred_compression,
+                        GetDeferredCompression(graph, local_client));
+  }
+  if (compression_disabled_at_runtime || deferred_compression != nullptr) {
     RemoveCompressionMapRewriter remove_compression_map_rewriter;
     TF_ASSIGN_OR_RETURN(
         graph, remove_compression_map_rewriter.ApplyRemoveCompressionMapRewrite(
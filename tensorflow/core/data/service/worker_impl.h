@@ -25,6 +25,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/dispatcher_client.h"
@@ -34,6 +35,8 @@ limitations under the License.
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/status.h"
@@ -65,6 +68,13 @@ class DataServiceWorkerImpl {
   // worker.proto for GetElement API documentation.
   Status GetElementResult(const GetElementRequest* request,
                           GetElementResult* result);
+  // Like `GetElementResult`, for clients in the same process. If the task's
+  // compression is deferred (see `WorkerConfig.local_zero_copy_transfer`),
+  // elements are returned as `LocalElement`s instead of being compressed.
+  // Compression is deferred for tasks whose first request comes from a client
+  // in the same process.
+  Status GetLocalElementResult(const GetElementRequest* request,
+                               struct GetElementResult* result);
 
   // Deletes the local task and iterator. Only called by local clients to delete
   // unused task iterators assuming the task is not read by remote clients. This
@@ -90,6 +100,20 @@ class DataServiceWorkerImpl {
   WorkerStateExport ExportState() const;
 
  private:
+  // The compression of a task's dataset, removed from the dataset so that
+  // clients in the same process can skip it. Elements for remote clients of
+  // the task are compressed when they are handed out instead.
+  struct DeferredCompression {
+    CompressionOptions options;
+    // Set for the "auto" codec.
+    std::unique_ptr<AdaptiveElementCompressor> adaptive_compressor;
+
+    // Replaces the components of `element` with one scalar variant tensor,
+    // holding a `LocalElement` if `local_client` is true and a
+    // `CompressedElement` otherwise.
+    Status Apply(bool local_client, std::vector<Tensor>& element);
+  };
+
   struct Task {
     explicit Task(TaskDef task_def) : task_def(std::move(task_def)) {}
 
@@ -98,6 +122,9 @@ class DataServiceWorkerImpl {
     bool initialized TF_GUARDED_BY(mu) = false;
     int64_t outstanding_requests TF_GUARDED_BY(&DataServiceWorkerImpl::mu_) = 0;
     std::unique_ptr<TaskRunner> task_runner;
+    // Set by `EnsureTaskInitialized` if the compression map was removed from
+    // the task's dataset.
+    std::unique_ptr<DeferredCompression> deferred_compression;
   };
 
   struct SnapshotTask {
@@ -122,6 +149,11 @@ class DataServiceWorkerImpl {
 
   // Validates the worker config.
   Status ValidateWorkerConfig() const;
+  // Serves a GetElement request from a client in this process if
+  // `local_client` is true, and from a remote client otherwise.
+  Status GetElementResultInternal(const GetElementRequest* request,
+                                  bool local_client,
+                                  struct GetElementResult* result);
   // Creates and initializes a dispatcher client.
   StatusOr<std::unique_ptr<DataServiceDispatcherClient>>
   CreateDispatcherClient() const TF_LOCKS_EXCLUDED(mu_);
@@ -130,7 +162,9 @@ class DataServiceWorkerImpl {
   // Creates an iterator to process a task.
   Status ProcessTaskInternal(const TaskDef& task)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
-  Status EnsureTaskInitialized(Task& task);
+  // Initializes `task` if needed, for a request from a client in this process
+  // if `local_client` is true.
+  Status EnsureTaskInitialized(Task& task, bool local_client);
   // Stops a task, cancelling the task's outstanding requests and waiting for
   // them to finish.
   void StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_);
@@ -165,9 +199,17 @@ class DataServiceWorkerImpl {
   std::vector<SnapshotTaskProgress> GetSnapshotTaskProgress() const;
   // Gets the DatasetDef for `task_def`.
   StatusOr<DatasetDef> GetDatasetDef(const TaskDef& task_def) const;
-  // Creates a dataset from `dataset_def`.
+  // Returns the compression to defer for `graph`, or nullptr if `graph` is not
+  // compressed or compression should not be deferred. `local_client` is true
+  // if the task is initialized for a client in this process.
+  StatusOr<std::unique_ptr<DeferredCompression>> GetDeferredCompression(
+      const GraphDef& graph, bool local_client) const;
+  // Creates a dataset from `dataset_def`. If the dataset's compression is
+  // deferred, it is removed from the dataset and returned in
+  // `deferred_compression`.
   StatusOr<std::unique_ptr<standalone::Dataset>> MakeDataset(
-      const DatasetDef& dataset_def, const TaskDef& task_def) const;
+      const DatasetDef& dataset_def, const TaskDef& task_def, bool local_client,
+      std::unique_ptr<DeferredCompression>& deferred_compression) const;
   // Creates an iterator for `dataset`.
   StatusOr<std::unique_ptr<standalone::Iterator>> MakeDatasetIterator(
       standalone::Dataset& dataset, const TaskDef& task_def) const;
@@ -18,14 +18,29 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/common.pb.h"
+#include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/test_cluster.h"
+#include "tensorflow/core/data/service/test_util.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/statusor.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
+using ::tensorflow::data::testing::RangeCompressedDataset;
+using ::tensorflow::data::testing::WaitWhile;
+using ::tensorflow::testing::IsOkAndHolds;
 using ::testing::IsNull;
 using ::testing::NotNull;
 
@@ -77,6 +92,88 @@ TEST_F(LocalWorkersTest, NoLocalWorker) {
   EXPECT_TRUE(LocalWorkers::Empty());
 }
 
+class LocalZeroCopyTransferTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TestCluster::Config config;
+    config.num_workers = 1;
+    config.worker_local_zero_copy_transfer = true;
+    test_cluster_ = std::make_unique<TestCluster>(config);
+    TF_ASSERT_OK(test_cluster_->Initialize());
+    worker_ = LocalWorkers::Get(test_cluster_->WorkerAddress(0));
+    ASSERT_THAT(worker_, NotNull());
+
+    DatasetClient<int64_t> dataset_client(*test_cluster_);
+    TF_ASSERT_OK_AND_ASSIGN(
+        int64_t iteration_client_id,
+        dataset_client.CreateIteration(RangeCompressedDataset(10)));
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<TaskInfo> tasks,
+                            dataset_client.GetTasks(iteration_client_id));
+    ASSERT_EQ(tasks.size(), 1);
+    task_id_ = tasks[0].task_id();
+  }
+
+  // Reads the next element of the task, through the local client API if
+  // `local_client` is true and through the RPC one otherwise.
+  StatusOr<Variant> GetElement(bool local_client) {
+    GetElementRequest request;
+    request.set_task_id(task_id_);
+    GetElementResult result;
+    TF_RETURN_IF_ERROR(WaitWhile([&]() -> StatusOr<bool> {
+      Status s = local_client
+                     ? worker_->GetLocalElementResult(&request, &result)
+                     : worker_->GetElementResult(&request, &result);
+      // The worker may not have received the task yet.
+      if (errors::IsUnavailable(s)) {
+        return true;
+      }
+      TF_RETURN_IF_ERROR(s);
+      return false;
+    }));
+    if (result.end_of_sequence || result.components.size() != 1) {
+      return errors::Internal("Expected one compressed component.");
+    }
+    return result.components[0].scalar<Variant>()();
+  }
+
+  // Returns the value of the range element held by `variant`.
+  StatusOr<int64_t> Value(const Variant& variant) {
+    std::vector<Tensor> components;
+    TF_RETURN_IF_ERROR(UncompressElement(variant, &components));
+    if (components.size() != 1) {
+      return errors::Internal("Expected one component.");
+    }
+    return components[0].scalar<int64_t>()();
+  }
+
+  std::unique_ptr<TestCluster> test_cluster_;
+  std::shared_ptr<DataServiceWorkerImpl> worker_;
+  int64_t task_id_ = 0;
+};
+
+TEST_F(LocalZeroCopyTransferTest, LocalClient) {
+  TF_ASSERT_OK_AND_ASSIGN(Variant element, GetElement(/*local_client=*/true));
+  EXPECT_THAT(element.get<LocalElement>(), NotNull());
+  EXPECT_THAT(Value(element), IsOkAndHolds(0));
+
+  // Remote clients of the same task get compressed elements.
+  TF_ASSERT_OK_AND_ASSIGN(element, GetElement(/*local_client=*/false));
+  EXPECT_THAT(element.get<CompressedElement>(), NotNull());
+  EXPECT_THAT(Value(element), IsOkAndHolds(1));
+}
+
+TEST_F(LocalZeroCopyTransferTest, RemoteClient) {
+  // The task is first read by a remote client, so it keeps the compression map
+  // and every client gets compressed elements.
+  TF_ASSERT_OK_AND_ASSIGN(Variant element, GetElement(/*local_client=*/false));
+  EXPECT_THAT(element.get<CompressedElement>(), NotNull());
+  EXPECT_THAT(Value(element), IsOkAndHolds(0));
+
+  TF_ASSERT_OK_AND_ASSIGN(element, GetElement(/*local_client=*/true));
+  EXPECT_THAT(element.get<CompressedElement>(), NotNull());
+  EXPECT_THAT(Value(element), IsOkAndHolds(1));
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -46,6 +46,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/rpc/rpc_rendezvous_mgr.h"
 #include "tensorflow/core/distributed_runtime/rpc_collective_executor_mgr.h"
 #include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
 #include "tensorflow/core/distributed_runtime/worker_cache_wrapper.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/framework/op.h"
@@ -93,6 +94,11 @@ class ReusePortOption : public ::grpc::ServerBuilderOption {
 
 // static utility function
 RendezvousMgrInterface* NewRpcRendezvousMgr(const WorkerEnv* env) {
+  // The workers on the same host exchange tensors through shared memory if
+  // the transport is enabled, see ShmTransportOptions.
+  if (ShmTransportOptions::FromEnv().enabled()) {
+    return new ShmRendezvousMgr(env);
+  }
   return new RpcRendezvousMgr(env);
 }
 
@@ -223,7 +229,7 @@ Status GrpcServer::Init(const GrpcServerOptions& opts) {
   worker_env_.experimental_num_shards = master_env_.experimental_num_shards;
 
   worker_env_.rendezvous_mgr = opts.rendezvous_mgr_func == nullptr
-                                   ? new RpcRendezvousMgr(&worker_env_)
+                                   ? NewRpcRendezvousMgr(&worker_env_)
                                    : opts.rendezvous_mgr_func(&worker_env_);
   string unused;
   string default_worker_name;
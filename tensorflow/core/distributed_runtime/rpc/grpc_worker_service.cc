@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/distributed_runtime/graph_mgr.h"
 #include "tensorflow/core/distributed_runtime/rendezvous_mgr_interface.h"
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_worker_service_impl.h"
@@ -48,6 +49,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -416,6 +418,34 @@ class GrpcWorkerService : public tsl::AsyncServiceInterface {
   void operator=(const GrpcWorkerService&) = delete;
 };
 
+// Returns true if `request` comes from a worker on the same host that can read
+// the tensor from shared memory, see ShmRendezvousMgr.
+bool IsSameHostShmRequest(const RecvTensorRequest& request) {
+  if (!request.transport_options().Is<ShmRecvTensorOptions>()) return false;
+  ShmRecvTensorOptions options;
+  const std::string& host_id = ShmHostId();
+  return request.transport_options().UnpackTo(&options) && !host_id.empty() &&
+         options.host_id() == host_id;
+}
+
+// Copies the content of `val` into `pool` and encodes the rest of the response
+// in `result`. Returns false if `val` can't be sent through `pool`.
+bool EncodeTensorToShm(const Tensor& val, ShmSegmentPool* pool,
+                       ::grpc::ByteBuffer* result) {
+  if (!DataTypeCanUseMemcpy(val.dtype()) || val.TotalBytes() == 0) {
+    return false;
+  }
+  ShmTensorDescriptor descriptor;
+  if (!pool->TryWrite(val.tensor_data(), &descriptor)) return false;
+  RecvTensorResponse response;
+  response.set_send_start_micros(Env::Default()->NowMicros());
+  response.mutable_tensor()->set_dtype(val.dtype());
+  val.shape().AsProto(response.mutable_tensor()->mutable_tensor_shape());
+  response.mutable_transport_options()->PackFrom(descriptor);
+  grpc::EncodeRecvTensorResponseToByteBuffer(response, result);
+  return true;
+}
+
 }  // namespace
 
 GrpcWorker::GrpcWorker(WorkerEnv* worker_env, const ConfigProto& config)
@@ -427,8 +457,17 @@ GrpcWorker::GrpcWorker(WorkerEnv* worker_env, const ConfigProto& config)
   if (config.rpc_options().cache_rpc_response()) {
     EnableResponseCache();
   }
+  const ShmTransportOptions shm_options = ShmTransportOptions::FromEnv();
+  if (shm_options.enabled()) {
+    Status s = ShmSegmentPool::Create(shm_options, &shm_pool_);
+    if (!s.ok()) {
+      LOG(WARNING) << "Sending tensors through gRPC only: " << s;
+    }
+  }
 }
 
+GrpcWorker::~GrpcWorker() {}
+
 void GrpcWorker::EnableResponseCache() {
   VLOG(3) << "Enabling gRPC tensor response cache.";
   response_cache_ = std::make_unique<RpcResponseCache>();
@@ -446,11 +485,17 @@ void GrpcWorker::GrpcRecvTensorAsync(CallOptions* opts,
   const int64_t step_id = request->step_id();
 
   bool cache_enabled = (response_cache_ != nullptr && request_id != 0);
+  // The slots of the shared memory pool are returned by the receiver, so they
+  // can't back the responses that the cache may send again.
+  const bool shm_enabled =
+      !cache_enabled && shm_pool_ != nullptr && IsSameHostShmRequest(*request);
 
-  auto do_response = [response, done, cache_enabled](const Tensor& tensor,
-                                                     bool is_dead,
-                                                     const Status& status) {
-    if (status.ok()) {
+  auto do_response = [this, response, done, cache_enabled, shm_enabled](
+                         const Tensor& tensor, bool is_dead,
+                         const Status& status) {
+    if (status.ok() &&
+        !(shm_enabled && !is_dead &&
+          EncodeTensorToShm(tensor, shm_pool_.get(), response))) {
       grpc::EncodeTensorToByteBuffer(is_dead, tensor, cache_enabled, response);
     }
     done(status);
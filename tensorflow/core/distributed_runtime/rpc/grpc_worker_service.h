@@ -40,10 +40,12 @@ class ConfigProto;
 struct WorkerEnv;
 class WorkerSession;
 class RpcResponseCache;
+class ShmSegmentPool;
 
 class GrpcWorker : public Worker {
  public:
   GrpcWorker(WorkerEnv* env, const ConfigProto& config);
+  ~GrpcWorker() override;
 
   // Specialized version of RecvTensor for gRPC, which avoids a copy.
   virtual void GrpcRecvTensorAsync(CallOptions* opts,
@@ -70,6 +72,9 @@ class GrpcWorker : public Worker {
  private:
   std::unique_ptr<RpcResponseCache> response_cache_;
   const int32 recv_buf_max_chunk_;
+  // Sends tensors to the workers on the same host, if the shared memory
+  // transport is enabled, see ShmTransportOptions.
+  std::unique_ptr<ShmSegmentPool> shm_pool_;
 };
 
 std::unique_ptr<GrpcWorker> NewGrpcWorker(WorkerEnv* worker_env,
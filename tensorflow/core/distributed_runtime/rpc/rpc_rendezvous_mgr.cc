@@ -20,6 +20,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/distributed_runtime/request_id.h"
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
 #include "tensorflow/core/distributed_runtime/tensor_coding.h"
 #include "tensorflow/core/distributed_runtime/worker_cache.h"
 #include "tensorflow/core/distributed_runtime/worker_interface.h"
@@ -38,8 +39,11 @@ namespace {
 
 class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  public:
-  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id)
-      : BaseRemoteRendezvous(env, step_id) {}
+  // `shm_reader`, if not null, reads the tensors that the workers on the same
+  // host send through shared memory. Not owned.
+  RpcRemoteRendezvous(const WorkerEnv* env, int64_t step_id,
+                      ShmSegmentReader* shm_reader)
+      : BaseRemoteRendezvous(env, step_id), shm_reader_(shm_reader) {}
 
  protected:
   void RecvFromRemoteAsync(const Rendezvous::ParsedKey& parsed,
@@ -49,6 +53,8 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
  private:
   ~RpcRemoteRendezvous() override {}
 
+  ShmSegmentReader* const shm_reader_;
+
   RpcRemoteRendezvous(const RpcRemoteRendezvous&) = delete;
   void operator=(const RpcRemoteRendezvous&) = delete;
 };
@@ -56,11 +62,13 @@ class RpcRemoteRendezvous : public BaseRemoteRendezvous {
 // Used only to retrieve tensors from remote processes.
 class RpcRecvTensorCall : public BaseRecvTensorCall {
  public:
-  RpcRecvTensorCall() : wi_(nullptr), dst_device_(nullptr) {}
+  RpcRecvTensorCall()
+      : wi_(nullptr), dst_device_(nullptr), shm_reader_(nullptr) {}
 
   void Init(WorkerInterface* wi, int64_t step_id, StringPiece key,
             AllocatorAttributes alloc_attrs, Device* dst_device,
-            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done) {
+            const Rendezvous::Args& recv_args, Rendezvous::DoneCallback done,
+            ShmSegmentReader* shm_reader) {
     wi_ = wi;
     alloc_attrs_ = alloc_attrs;
     dst_device_ = dst_device;
@@ -69,6 +77,16 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     req_.set_step_id(step_id);
     req_.set_rendezvous_key(key.data(), key.size());
     req_.set_request_id(GetUniqueRequestId());
+    // Only tensors received into host memory can be read from shared memory,
+    // and the source worker only uses it if it runs on the same host.
+    const std::string& host_id = ShmHostId();
+    if (shm_reader != nullptr && !host_id.empty() &&
+        (alloc_attrs.on_host() || dst_device->device_type() == "CPU")) {
+      shm_reader_ = shm_reader;
+      ShmRecvTensorOptions shm_options;
+      shm_options.set_host_id(host_id);
+      req_.mutable_transport_options()->PackFrom(shm_options);
+    }
   }
 
   void Reset() {
@@ -79,6 +97,7 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
 
     alloc_attrs_ = AllocatorAttributes();
     dst_device_ = nullptr;
+    shm_reader_ = nullptr;
     // We don't clear opts_ and assume that Init will set up the state for
     // opts_ appropriately.
     req_.Clear();
@@ -142,9 +161,15 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
       // Make sure the Rendezvous abort checking is finished before running the
       // callback, which might destroy the current call object.
       abort_checked->WaitForNotification();
-      if (!s.ok()) {
+      Status status = s;
+      if (status.ok()) {
+        status = MaybeReadShmTensor();
+      } else {
+        MaybeReleaseShmTensor();
+      }
+      if (!status.ok()) {
         mutex_lock l(mu_);
-        status_.Update(s);
+        status_.Update(status);
       }
       recv_done();
     };
@@ -167,11 +192,43 @@ class RpcRecvTensorCall : public BaseRecvTensorCall {
     abort_checked->Notify();
   }
 
+  // Copies the content of the received tensor out of shared memory, if the
+  // source worker sent it that way. The slot is returned to the source worker
+  // whether the copy succeeds or not.
+  Status MaybeReadShmTensor() {
+    const auto& transport_options = resp_.metadata().transport_options();
+    if (!transport_options.Is<ShmTensorDescriptor>()) return OkStatus();
+    ShmTensorDescriptor descriptor;
+    if (shm_reader_ == nullptr || !transport_options.UnpackTo(&descriptor)) {
+      // The source worker takes the slot back when its lease expires.
+      return errors::Internal("Unexpected shared memory tensor for ",
+                              req_.rendezvous_key());
+    }
+    StringPiece buf = resp_.tensor().tensor_data();
+    return shm_reader_->Read(descriptor, const_cast<char*>(buf.data()),
+                             buf.size());
+  }
+
+  // Returns the shared memory slot of a response that failed, if any, rather
+  // than waiting for its lease to expire.
+  void MaybeReleaseShmTensor() {
+    const auto& transport_options = resp_.metadata().transport_options();
+    ShmTensorDescriptor descriptor;
+    if (shm_reader_ == nullptr ||
+        !transport_options.Is<ShmTensorDescriptor>() ||
+        !transport_options.UnpackTo(&descriptor)) {
+      return;
+    }
+    Status s = shm_reader_->Release(descriptor);
+    if (!s.ok()) VLOG(1) << "Not returning a shared memory slot: " << s;
+  }
+
   string src_worker_;
   string src_rel_device_;
   WorkerInterface* wi_;  // Not owned.
   AllocatorAttributes alloc_attrs_;
   Device* dst_device_;
+  ShmSegmentReader* shm_reader_;  // Not owned.
   CallOptions opts_;
   RecvTensorRequest req_;
   TensorResponse resp_;
@@ -270,7 +327,7 @@ void RpcRemoteRendezvous::RecvFromRemoteAsync(
   }
 
   call->Init(rwi, step_id_, parsed.FullKey(), recv_args.alloc_attrs, dst_device,
-             recv_args, std::move(done));
+             recv_args, std::move(done), shm_reader_);
 
   // Record "call" in calls_ so that it can be aborted cleanly.
   RegisterCall(call, recv_args);
@@ -313,7 +370,18 @@ RpcRendezvousMgr::RpcRendezvousMgr(const WorkerEnv* env)
 tsl::core::RefCountPtr<BaseRemoteRendezvous> RpcRendezvousMgr::Create(
     int64_t step_id, const WorkerEnv* worker_env) {
   return tsl::core::RefCountPtr<BaseRemoteRendezvous>(
-      new RpcRemoteRendezvous(worker_env, step_id));
+      new RpcRemoteRendezvous(worker_env, step_id, /*shm_reader=*/nullptr));
+}
+
+ShmRendezvousMgr::ShmRendezvousMgr(const WorkerEnv* env)
+    : BaseRendezvousMgr(env) {}
+
+ShmRendezvousMgr::~ShmRendezvousMgr() {}
+
+tsl::core::RefCountPtr<BaseRemoteRendezvous> ShmRendezvousMgr::Create(
+    int64_t step_id, const WorkerEnv* worker_env) {
+  return tsl::core::RefCountPtr<BaseRemoteRendezvous>(
+      new RpcRemoteRendezvous(worker_env, step_id, &shm_reader_));
 }
 
 }  // end namespace tensorflow
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
 
 #include "tensorflow/core/distributed_runtime/base_rendezvous_mgr.h"
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
 #include "tensorflow/core/distributed_runtime/worker_env.h"
 #include "tensorflow/core/platform/macros.h"
 
@@ -55,6 +56,25 @@ class RpcRendezvousMgr : public BaseRendezvousMgr {
   void operator=(const RpcRendezvousMgr&) = delete;
 };
 
+// An RpcRendezvousMgr that also receives, through shared memory, the tensors
+// that the workers on the same host send from their ShmSegmentPool. The RPCs
+// then only carry the metadata of the tensors.
+class ShmRendezvousMgr : public BaseRendezvousMgr {
+ public:
+  explicit ShmRendezvousMgr(const WorkerEnv* env);
+  ~ShmRendezvousMgr() override;
+
+ protected:
+  tsl::core::RefCountPtr<BaseRemoteRendezvous> Create(
+      int64_t step_id, const WorkerEnv* worker_env) override;
+
+ private:
+  ShmSegmentReader shm_reader_;
+
+  ShmRendezvousMgr(const ShmRendezvousMgr&) = delete;
+  void operator=(const ShmRendezvousMgr&) = delete;
+};
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_RPC_RPC_RENDEZVOUS_MGR_H_
@@ -0,0 +1,564 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kSlotBytesEnvVar[] = "TF_GRPC_SHM_SLOT_BYTES";
+constexpr char kNumSlotsEnvVar[] = "TF_GRPC_SHM_NUM_SLOTS";
+constexpr char kLeaseSecsEnvVar[] = "TF_GRPC_SHM_LEASE_SECS";
+constexpr int64_t kMicrosPerSecond = 1000 * 1000;
+
+auto* shm_read_bytes = monitoring::Counter<0>::New(
+    "/tensorflow/core/distributed_runtime/shm_read_bytes",
+    "The number of tensor bytes read from the shared memory of other workers.");
+
+// Readers only map segments with this prefix, whatever the descriptors they
+// receive say.
+constexpr char kSegmentNamePrefix[] = "/tf_shm_";
+// Identifies the layout of the segments below.
+constexpr uint64 kSegmentMagic = 0x54465348'4d535632ULL;
+// Slots are page aligned, which satisfies the alignment of any tensor.
+constexpr int64_t kSlotAlignment = 4096;
+constexpr int64_t kCacheLineBytes = 64;
+// How many times a push waits for a concurrent pop to release its cell.
+constexpr int kMaxPushRetries = 1000;
+
+// The free slot queue is shared by processes, so it can only use atomics that
+// don't rely on a lock of the process.
+static_assert(std::atomic<uint64>::is_always_lock_free,
+              "64-bit atomics must be lock-free");
+
+// The phases of a slot, in the low bits of its state. The other bits count the
+// writes of the slot, so that the descriptor of an earlier write doesn't match.
+constexpr uint64 kSlotFree = 0;
+constexpr uint64 kSlotWritten = 1;
+constexpr uint64 kSlotReading = 2;
+constexpr int kSlotPhaseBits = 2;
+
+uint64 SlotState(uint64 generation, uint64 phase) {
+  return generation << kSlotPhaseBits | phase;
+}
+uint64 SlotGeneration(uint64 state) { return state >> kSlotPhaseBits; }
+uint64 SlotPhase(uint64 state) {
+  return state & ((uint64{1} << kSlotPhaseBits) - 1);
+}
+
+// An entry of the free slot queue.
+struct Cell {
+  std::atomic<uint64> sequence;
+  int64_t slot;
+};
+
+// The start of a segment, which is followed by the cells of the free slot
+// queue, by the states of the slots and by the slots.
+struct SegmentHeader {
+  uint64 magic;
+  int64_t total_bytes;
+  int64_t slot_bytes;
+  int64_t states_offset;
+  int64_t slots_offset;
+  int32 num_slots;
+  // The number of cells of the free slot queue, a power of two, minus 1.
+  uint32 queue_mask;
+  alignas(kCacheLineBytes) std::atomic<uint64> enqueue_pos;
+  alignas(kCacheLineBytes) std::atomic<uint64> dequeue_pos;
+};
+
+int64_t RoundUp(int64_t n, int64_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+constexpr int64_t kCellsOffset =
+    (sizeof(SegmentHeader) + kCacheLineBytes - 1) / kCacheLineBytes *
+    kCacheLineBytes;
+
+#if defined(__linux__)
+// Returns the first line of `path`, or an empty string.
+std::string ReadFirstLine(const char* path) {
+  std::string line;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return line;
+  char buf[128];
+  const ssize_t n = read(fd, buf, sizeof(buf));
+  close(fd);
+  if (n > 0) {
+    line.assign(buf, n);
+    line = line.substr(0, line.find('\n'));
+  }
+  return line;
+}
+
+// Returns the target of the symbolic link `path`, or an empty string.
+std::string ReadLink(const char* path) {
+  char buf[128];
+  const ssize_t n = readlink(path, buf, sizeof(buf));
+  return n > 0 ? std::string(buf, n) : std::string();
+}
+#endif
+
+}  // namespace
+
+// A mapping of a segment.
+//
+// The free slot queue is the bounded multi-producer multi-consumer queue of
+// D. Vyukov: the sequence number of each cell tells whether it can be written
+// or read at a given position of the queue, so that pushes and pops only
+// contend on the compare-and-swap of their position.
+class ShmSegment {
+ public:
+  ShmSegment(std::string name, char* base, int64_t size, bool owner)
+      : name_(std::move(name)), base_(base), size_(size), owner_(owner) {}
+
+  ~ShmSegment() {
+#if defined(__linux__)
+    munmap(base_, size_);
+    if (owner_) shm_unlink(name_.c_str());
+#endif
+  }
+
+  const std::string& name() const { return name_; }
+  SegmentHeader* header() const {
+    return reinterpret_cast<SegmentHeader*>(base_);
+  }
+  Cell* cells() const { return reinterpret_cast<Cell*>(base_ + kCellsOffset); }
+  std::atomic<uint64>* states() const {
+    return reinterpret_cast<std::atomic<uint64>*>(base_ +
+                                                  header()->states_offset);
+  }
+  char* slot(int64_t i) const {
+    return base_ + header()->slots_offset + i * header()->slot_bytes;
+  }
+
+  // Checks that the header of a segment mapped by a reader describes a layout
+  // that fits in the mapping.
+  Status Validate() const {
+    if (size_ < static_cast<int64_t>(kCellsOffset)) {
+      return errors::DataLoss("Shared memory segment ", name_, " is too small");
+    }
+    const SegmentHeader* h = header();
+    const int64_t num_cells = static_cast<int64_t>(h->queue_mask) + 1;
+    if (h->magic != kSegmentMagic || h->total_bytes != size_ ||
+        h->num_slots <= 0 || h->slot_bytes <= 0 ||
+        (num_cells & (num_cells - 1)) != 0 || num_cells < h->num_slots ||
+        kCellsOffset + num_cells * static_cast<int64_t>(sizeof(Cell)) >
+            h->states_offset ||
+        h->states_offset % kCacheLineBytes != 0 ||
+        h->states_offset +
+                h->num_slots *
+                    static_cast<int64_t>(sizeof(std::atomic<uint64>)) >
+            h->slots_offset ||
+        h->slots_offset + h->num_slots * h->slot_bytes > size_) {
+      return errors::DataLoss("Shared memory segment ", name_,
+                              " has an invalid header");
+    }
+    return OkStatus();
+  }
+
+  bool PushFreeSlot(int64_t slot) {
+    SegmentHeader* h = header();
+    uint64 pos = h->enqueue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (int retries = 0;;) {
+      cell = &cells()[pos & h->queue_mask];
+      const uint64 sequence = cell->sequence.load(std::memory_order_acquire);
+      const int64_t diff = static_cast<int64_t>(sequence - pos);
+      if (diff == 0) {
+        if (h->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The queue is full, or the pop that took the previous slot of the
+        // cell hasn't released it yet. The queue never holds more than all the
+        // slots, so only the latter can happen unless a slot is returned
+        // twice, and the pop is only given a bounded time to finish in case
+        // its process died.
+        const int64_t size = static_cast<int64_t>(
+            pos - h->dequeue_pos.load(std::memory_order_relaxed));
+        if (size > h->queue_mask || ++retries > kMaxPushRetries) {
+          return false;
+        }
+        std::this_thread::yield();
+        pos = h->enqueue_pos.load(std::memory_order_relaxed);
+      } else {
+        pos = h->enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->slot = slot;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool PopFreeSlot(int64_t* slot) {
+    SegmentHeader* h = header();
+    uint64 pos = h->dequeue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells()[pos & h->queue_mask];
+      const uint64 sequence = cell->sequence.load(std::memory_order_acquire);
+      const int64_t diff = static_cast<int64_t>(sequence - (pos + 1));
+      if (diff == 0) {
+        if (h->dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                 std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // Empty, or the push into the cell hasn't finished, in which case
+        // the caller falls back to another transport as well.
+        return false;
+      } else {
+        pos = h->dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    *slot = cell->slot;
+    cell->sequence.store(pos + h->queue_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves `slot` from `state` to free and returns it to the free queue. Returns
+  // Aborted if the slot isn't in `state` anymore, e.g. because its lease
+  // expired.
+  Status FreeSlot(int64_t slot, uint64 state) {
+    if (!states()[slot].compare_exchange_strong(
+            state, SlotState(SlotGeneration(state), kSlotFree),
+            std::memory_order_acq_rel)) {
+      return errors::Aborted("Slot ", slot, " of the shared memory segment ",
+                             name_, " was taken back by its pool");
+    }
+    if (!PushFreeSlot(slot)) {
+      return errors::Internal("Slot ", slot,
+                              " returned twice to the shared memory segment ",
+                              name_);
+    }
+    return OkStatus();
+  }
+
+  int NumFreeSlots() const {
+    const SegmentHeader* h = header();
+    return static_cast<int>(h->enqueue_pos.load(std::memory_order_relaxed) -
+                            h->dequeue_pos.load(std::memory_order_relaxed));
+  }
+
+ private:
+  const std::string name_;
+  char* const base_;
+  const int64_t size_;
+  // Whether this mapping created the segment, and unlinks it.
+  const bool owner_;
+};
+
+const std::string& ShmHostId() {
+  static const std::string* host_id = []() {
+    std::string id;
+#if defined(__linux__)
+    // Processes in the same IPC and mount namespaces of the same boot of a
+    // host see the same /dev/shm.
+    const std::string boot_id(absl::StripAsciiWhitespace(
+        ReadFirstLine("/proc/sys/kernel/random/boot_id")));
+    const std::string ipc_ns = ReadLink("/proc/self/ns/ipc");
+    const std::string mnt_ns = ReadLink("/proc/self/ns/mnt");
+    if (!boot_id.empty() && !ipc_ns.empty() && !mnt_ns.empty()) {
+      id = absl::StrCat(boot_id, "/", ipc_ns, "/", mnt_ns);
+    }
+#endif
+    return new std::string(id);
+  }();
+  return *host_id;
+}
+
+ShmTransportOptions ShmTransportOptions::FromEnv() {
+  ShmTransportOptions options;
+  int64_t num_slots;
+  int64_t lease_secs;
+  Status s = ReadInt64FromEnvVar(kSlotBytesEnvVar, 0, &options.slot_bytes);
+  if (s.ok()) {
+    s = ReadInt64FromEnvVar(kNumSlotsEnvVar, options.num_slots, &num_slots);
+  }
+  if (s.ok()) {
+    s = ReadInt64FromEnvVar(kLeaseSecsEnvVar,
+                            options.lease_micros / kMicrosPerSecond,
+                            &lease_secs);
+  }
+  if (s.ok() && lease_secs <= 0) {
+    s = errors::InvalidArgument(kLeaseSecsEnvVar, " must be positive");
+  }
+  if (!s.ok()) {
+    LOG(ERROR) << "Disabling the shared memory transport: " << s;
+    return ShmTransportOptions();
+  }
+  options.num_slots = static_cast<int>(num_slots);
+  options.lease_micros = lease_secs * kMicrosPerSecond;
+  return options;
+}
+
+ShmSegmentPool::ShmSegmentPool(std::unique_ptr<ShmSegment> segment,
+                               int64_t lease_micros)
+    : segment_(std::move(segment)),
+      lease_micros_(lease_micros),
+      write_micros_(
+          new std::atomic<uint64>[segment_->header()->num_slots]()) {}
+
+ShmSegmentPool::~ShmSegmentPool() {}
+
+Status ShmSegmentPool::Create(const ShmTransportOptions& options,
+                              std::unique_ptr<ShmSegmentPool>* pool) {
+  if (!options.enabled()) {
+    return errors::InvalidArgument("The shared memory transport is disabled");
+  }
+#if defined(__linux__)
+  const int64_t slot_bytes = RoundUp(options.slot_bytes, kSlotAlignment);
+  uint32 num_cells = 1;
+  while (num_cells < static_cast<uint32>(options.num_slots)) num_cells *= 2;
+  const int64_t states_offset =
+      RoundUp(kCellsOffset + num_cells * sizeof(Cell), kCacheLineBytes);
+  const int64_t slots_offset = RoundUp(
+      states_offset + options.num_slots * sizeof(std::atomic<uint64>),
+      kSlotAlignment);
+  const int64_t total_bytes = slots_offset + options.num_slots * slot_bytes;
+  const std::string name =
+      absl::StrCat(kSegmentNamePrefix, getpid(), "_", random::New64());
+
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    return errors::IOError(
+        absl::StrCat("Creating the shared memory segment ", name), errno);
+  }
+  // Reserving the memory turns a lack of shared memory into an error here,
+  // rather than into a SIGBUS when writing a slot.
+  int error = posix_fallocate(fd, 0, total_bytes);
+  void* base = MAP_FAILED;
+  if (error == 0) {
+    base = mmap(nullptr, total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                0);
+    if (base == MAP_FAILED) error = errno;
+  }
+  close(fd);
+  if (error != 0) {
+    shm_unlink(name.c_str());
+    return errors::IOError(absl::StrCat("Allocating ", total_bytes,
+                                        " bytes of shared memory for ", name),
+                           error);
+  }
+
+  auto segment = std::make_unique<ShmSegment>(name, static_cast<char*>(base),
+                                              total_bytes, /*owner=*/true);
+  SegmentHeader* header = new (base) SegmentHeader();
+  header->total_bytes = total_bytes;
+  header->slot_bytes = slot_bytes;
+  header->states_offset = states_offset;
+  header->slots_offset = slots_offset;
+  header->num_slots = options.num_slots;
+  header->queue_mask = num_cells - 1;
+  header->enqueue_pos.store(0, std::memory_order_relaxed);
+  header->dequeue_pos.store(0, std::memory_order_relaxed);
+  Cell* cells = segment->cells();
+  for (uint32 i = 0; i < num_cells; ++i) {
+    new (&cells[i]) Cell();
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+    cells[i].slot = -1;
+  }
+  std::atomic<uint64>* states = segment->states();
+  for (int i = 0; i < options.num_slots; ++i) {
+    new (&states[i]) std::atomic<uint64>(SlotState(0, kSlotFree));
+    CHECK(segment->PushFreeSlot(i));  // Crash ok.
+  }
+  header->magic = kSegmentMagic;
+  VLOG(1) << "Created the shared memory segment " << name << " of "
+          << options.num_slots << " slots of " << slot_bytes << " bytes";
+  pool->reset(new ShmSegmentPool(std::move(segment), options.lease_micros));
+  return OkStatus();
+#else
+  return errors::Unimplemented(
+      "The shared memory transport is only supported on Linux");
+#endif
+}
+
+bool ShmSegmentPool::TryWrite(StringPiece data,
+                              ShmTensorDescriptor* descriptor) {
+  if (static_cast<int64_t>(data.size()) > segment_->header()->slot_bytes) {
+    return false;
+  }
+  int64_t slot;
+  if (!segment_->PopFreeSlot(&slot)) {
+    ReclaimExpiredSlots();
+    if (!segment_->PopFreeSlot(&slot)) {
+      VLOG(2) << "No free slot in the shared memory segment " << name();
+      return false;
+    }
+  }
+  std::atomic<uint64>& state = segment_->states()[slot];
+  const uint64 generation =
+      SlotGeneration(state.load(std::memory_order_relaxed)) + 1;
+  memcpy(segment_->slot(slot), data.data(), data.size());
+  // The write time is published by the state, which ReclaimExpiredSlots reads
+  // first.
+  write_micros_[slot].store(Env::Default()->NowMicros(),
+                            std::memory_order_relaxed);
+  state.store(SlotState(generation, kSlotWritten), std::memory_order_release);
+  descriptor->set_segment_name(name());
+  descriptor->set_slot(slot);
+  descriptor->set_num_bytes(data.size());
+  descriptor->set_generation(generation);
+  return true;
+}
+
+void ShmSegmentPool::ReclaimExpiredSlots() {
+  const int64_t now = Env::Default()->NowMicros();
+  for (int i = 0; i < segment_->header()->num_slots; ++i) {
+    const uint64 state = segment_->states()[i].load(std::memory_order_acquire);
+    if (SlotPhase(state) == kSlotFree ||
+        now - static_cast<int64_t>(write_micros_[i].load(
+                  std::memory_order_relaxed)) < lease_micros_) {
+      continue;
+    }
+    // Fails if the receiver returned the slot meanwhile.
+    Status s = segment_->FreeSlot(i, state);
+    if (s.ok()) {
+      VLOG(1) << "Took back slot " << i << " of the shared memory segment "
+              << name() << " from its receiver";
+    } else if (!errors::IsAborted(s)) {
+      LOG(ERROR) << s;
+    }
+  }
+}
+
+const std::string& ShmSegmentPool::name() const { return segment_->name(); }
+
+int ShmSegmentPool::num_free_slots() const { return segment_->NumFreeSlots(); }
+
+ShmSegmentReader::ShmSegmentReader() {}
+
+ShmSegmentReader::~ShmSegmentReader() {}
+
+Status ShmSegmentReader::GetSegment(const std::string& name,
+                                    ShmSegment** segment) {
+  mutex_lock l(mu_);
+  auto it = segments_.find(name);
+  if (it != segments_.end()) {
+    *segment = it->second.get();
+    return OkStatus();
+  }
+#if defined(__linux__)
+  if (!absl::StartsWith(name, kSegmentNamePrefix) ||
+      name.find('/', 1) != std::string::npos) {
+    return errors::InvalidArgument("Invalid shared memory segment name ",
+                                   name);
+  }
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    return errors::IOError(
+        absl::StrCat("Opening the shared memory segment ", name), errno);
+  }
+  struct stat st;
+  void* base = MAP_FAILED;
+  int error = 0;
+  if (fstat(fd, &st) != 0) {
+    error = errno;
+  } else {
+    base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) error = errno;
+  }
+  close(fd);
+  if (error != 0) {
+    return errors::IOError(
+        absl::StrCat("Mapping the shared memory segment ", name), error);
+  }
+  auto mapped = std::make_unique<ShmSegment>(name, static_cast<char*>(base),
+                                             st.st_size, /*owner=*/false);
+  TF_RETURN_IF_ERROR(mapped->Validate());
+  *segment = mapped.get();
+  segments_[name] = std::move(mapped);
+  return OkStatus();
+#else
+  return errors::Unimplemented(
+      "The shared memory transport is only supported on Linux");
+#endif
+}
+
+Status ShmSegmentReader::Read(const ShmTensorDescriptor& descriptor, char* dst,
+                              int64_t num_bytes) {
+  ShmSegment* segment;
+  TF_RETURN_IF_ERROR(GetSegment(descriptor.segment_name(), &segment));
+  const SegmentHeader* header = segment->header();
+  const int64_t slot = descriptor.slot();
+  if (slot < 0 || slot >= header->num_slots) {
+    return errors::Internal("Invalid shared memory descriptor ",
+                            descriptor.ShortDebugString());
+  }
+  const uint64 written = SlotState(descriptor.generation(), kSlotWritten);
+  if (descriptor.num_bytes() != num_bytes || num_bytes > header->slot_bytes) {
+    // The content can't be read anyway, so the slot is returned right away
+    // rather than when its lease expires.
+    segment->FreeSlot(slot, written).IgnoreError();
+    return errors::Internal("Invalid shared memory descriptor ",
+                            descriptor.ShortDebugString(), " of a tensor of ",
+                            num_bytes, " bytes");
+  }
+  // Marks the slot as being read, so that its pool doesn't take it back while
+  // it is copied, unless the lease expires meanwhile.
+  uint64 state = written;
+  const uint64 reading = SlotState(descriptor.generation(), kSlotReading);
+  if (!segment->states()[slot].compare_exchange_strong(
+          state, reading, std::memory_order_acq_rel)) {
+    return errors::Aborted("The shared memory slot of descriptor ",
+                           descriptor.ShortDebugString(),
+                           " was taken back by its pool");
+  }
+  memcpy(dst, segment->slot(slot), num_bytes);
+  TF_RETURN_IF_ERROR(segment->FreeSlot(slot, reading));
+  shm_read_bytes->GetCell()->IncrementBy(num_bytes);
+  return OkStatus();
+}
+
+Status ShmSegmentReader::Release(const ShmTensorDescriptor& descriptor) {
+  ShmSegment* segment;
+  TF_RETURN_IF_ERROR(GetSegment(descriptor.segment_name(), &segment));
+  const int64_t slot = descriptor.slot();
+  if (slot < 0 || slot >= segment->header()->num_slots) {
+    return errors::Internal("Invalid shared memory descriptor ",
+                            descriptor.ShortDebugString());
+  }
+  return segment->FreeSlot(slot,
+                           SlotState(descriptor.generation(), kSlotWritten));
+}
+
+}  // namespace tensorflow
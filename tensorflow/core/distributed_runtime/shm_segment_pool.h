@@ -0,0 +1,145 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_SEGMENT_POOL_H_
+#define TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_SEGMENT_POOL_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+
+class ShmSegment;
+
+// Returns an identifier of the host, and of the IPC and mount namespaces, of
+// this process. Processes with the same identifier can share POSIX shared
+// memory segments. Returns an empty string if the identifier can't be
+// determined, e.g. on platforms other than Linux.
+const std::string& ShmHostId();
+
+// The options of the shared memory transport of tensors between the workers
+// of a host, see ShmSegmentPool.
+struct ShmTransportOptions {
+  // The size of a slot, i.e. of the largest tensor sent through shared memory.
+  // 0 disables the transport.
+  int64_t slot_bytes = 0;
+  // The number of slots, i.e. of tensors that can be in flight at once.
+  int num_slots = 16;
+  // How long a slot may stay with its receiver before the pool takes it back,
+  // in case the receiver failed or never got the descriptor of the slot.
+  int64_t lease_micros = 60 * 1000 * 1000;
+
+  bool enabled() const { return slot_bytes > 0 && num_slots > 0; }
+
+  // Returns the options set by the TF_GRPC_SHM_SLOT_BYTES,
+  // TF_GRPC_SHM_NUM_SLOTS and TF_GRPC_SHM_LEASE_SECS environment variables.
+  // The transport is disabled by default.
+  static ShmTransportOptions FromEnv();
+};
+
+// A POSIX shared memory segment of fixed-size slots, through which a worker
+// passes the content of tensors to the workers on the same host instead of
+// encoding them in RPC responses.
+//
+// The free slots are kept in a lock-free bounded queue in the segment itself:
+// the owner of the pool takes a slot from the queue and copies a tensor into
+// it, and the worker that receives the tensor copies it out and puts the slot
+// back into the queue (see ShmSegmentReader).
+//
+// Each slot also has a state in the segment, which counts the tensors written
+// into the slot and tells whether the current one is being read. A slot that
+// isn't returned within the lease of the options, e.g. because the RPC that
+// carried its descriptor failed or because its receiver crashed, is taken back
+// by the owner when the queue is empty. The count lets the receiver detect that
+// its descriptor is stale, in which case it fails to read it.
+//
+// The memory of the segment is reserved when the pool is created, so that
+// running out of shared memory fails the creation rather than a later write.
+// The segment is unlinked when the pool is destroyed.
+//
+// This class is thread-safe.
+class ShmSegmentPool {
+ public:
+  static Status Create(const ShmTransportOptions& options,
+                       std::unique_ptr<ShmSegmentPool>* pool);
+
+  ~ShmSegmentPool();
+
+  // Copies `data` into a free slot and describes the slot in `descriptor`.
+  // Returns false if `data` doesn't fit in a slot or if all the slots are in
+  // use, in which case the data must be sent another way.
+  bool TryWrite(StringPiece data, ShmTensorDescriptor* descriptor);
+
+  const std::string& name() const;
+
+  // Returns the number of slots in the free queue. Racy, for tests.
+  int num_free_slots() const;
+
+ private:
+  ShmSegmentPool(std::unique_ptr<ShmSegment> segment, int64_t lease_micros);
+
+  // Returns the slots whose lease expired to the free queue.
+  void ReclaimExpiredSlots();
+
+  std::unique_ptr<ShmSegment> segment_;
+  const int64_t lease_micros_;
+  // The time at which each slot was last written, which only the owner needs.
+  std::unique_ptr<std::atomic<uint64>[]> write_micros_;
+};
+
+// Maps the ShmSegmentPools of the other workers of the host, to read the
+// tensors they describe with ShmTensorDescriptors. The segments stay mapped
+// until the reader is destroyed.
+//
+// This class is thread-safe.
+class ShmSegmentReader {
+ public:
+  ShmSegmentReader();
+  ~ShmSegmentReader();
+
+  // Copies the content of the slot described by `descriptor` into `dst`, which
+  // has `num_bytes` bytes, and returns the slot to its pool. The slot is also
+  // returned if `num_bytes` doesn't match the descriptor. Returns Aborted if
+  // the pool took the slot back before it was read.
+  Status Read(const ShmTensorDescriptor& descriptor, char* dst,
+              int64_t num_bytes);
+
+  // Returns the slot described by `descriptor` to its pool without reading it.
+  Status Release(const ShmTensorDescriptor& descriptor);
+
+ private:
+  // Returns the mapping of the segment `name`, mapping it the first time.
+  Status GetSegment(const std::string& name, ShmSegment** segment);
+
+  mutex mu_;
+  absl::flat_hash_map<std::string, std::unique_ptr<ShmSegment>> segments_
+      TF_GUARDED_BY(mu_);
+
+  ShmSegmentReader(const ShmSegmentReader&) = delete;
+  void operator=(const ShmSegmentReader&) = delete;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DISTRIBUTED_RUNTIME_SHM_SEGMENT_POOL_H_
@@ -0,0 +1,210 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/distributed_runtime/shm_segment_pool.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/protobuf/transport_options.pb.h"
+
+namespace tensorflow {
+namespace {
+
+#if defined(__linux__)
+
+std::unique_ptr<ShmSegmentPool> CreatePool(
+    int64_t slot_bytes, int num_slots,
+    int64_t lease_micros = ShmTransportOptions().lease_micros) {
+  ShmTransportOptions options;
+  options.slot_bytes = slot_bytes;
+  options.num_slots = num_slots;
+  options.lease_micros = lease_micros;
+  std::unique_ptr<ShmSegmentPool> pool;
+  TF_CHECK_OK(ShmSegmentPool::Create(options, &pool));
+  return pool;
+}
+
+TEST(ShmSegmentPoolTest, HostId) { EXPECT_FALSE(ShmHostId().empty()); }
+
+TEST(ShmSegmentPoolTest, Disabled) {
+  std::unique_ptr<ShmSegmentPool> pool;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      ShmSegmentPool::Create(ShmTransportOptions(), &pool)));
+}
+
+TEST(ShmSegmentPoolTest, WriteAndRead) {
+  auto pool = CreatePool(/*slot_bytes=*/1000, /*num_slots=*/2);
+  EXPECT_EQ(pool->num_free_slots(), 2);
+  ShmSegmentReader reader;
+  for (int i = 0; i < 5; ++i) {
+    // Slots are rounded up to a page.
+    const std::string data(4096 - i, 'a' + i);
+    ShmTensorDescriptor descriptor;
+    ASSERT_TRUE(pool->TryWrite(data, &descriptor));
+    EXPECT_EQ(descriptor.segment_name(), pool->name());
+    EXPECT_EQ(descriptor.num_bytes(), data.size());
+    EXPECT_EQ(pool->num_free_slots(), 1);
+
+    std::string read(data.size(), ' ');
+    TF_ASSERT_OK(reader.Read(descriptor, &read[0], read.size()));
+    EXPECT_EQ(read, data);
+    EXPECT_EQ(pool->num_free_slots(), 2);
+  }
+}
+
+TEST(ShmSegmentPoolTest, TooLarge) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/2);
+  ShmTensorDescriptor descriptor;
+  EXPECT_FALSE(pool->TryWrite(std::string(4097, 'a'), &descriptor));
+  EXPECT_EQ(pool->num_free_slots(), 2);
+}
+
+TEST(ShmSegmentPoolTest, AllSlotsInUse) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/3);
+  std::vector<ShmTensorDescriptor> descriptors(3);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(pool->TryWrite(std::string(10, 'a' + i), &descriptors[i]));
+  }
+  ShmTensorDescriptor descriptor;
+  EXPECT_FALSE(pool->TryWrite("x", &descriptor));
+
+  ShmSegmentReader reader;
+  std::string read(10, ' ');
+  TF_ASSERT_OK(reader.Read(descriptors[1], &read[0], read.size()));
+  EXPECT_EQ(read, std::string(10, 'b'));
+  ASSERT_TRUE(pool->TryWrite("x", &descriptor));
+  EXPECT_EQ(descriptor.slot(), descriptors[1].slot());
+}
+
+TEST(ShmSegmentPoolTest, InvalidDescriptors) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/2);
+  ShmTensorDescriptor descriptor;
+  ASSERT_TRUE(pool->TryWrite("abcd", &descriptor));
+  ShmSegmentReader reader;
+  char buf[8];
+
+  ShmTensorDescriptor bad_slot = descriptor;
+  bad_slot.set_slot(2);
+  EXPECT_TRUE(errors::IsInternal(reader.Read(bad_slot, buf, 4)));
+
+  ShmTensorDescriptor bad_name = descriptor;
+  bad_name.set_segment_name("/dev/shm/tf_shm_0");
+  EXPECT_TRUE(errors::IsInvalidArgument(reader.Read(bad_name, buf, 4)));
+  bad_name.set_segment_name("/tf_shm_does_not_exist");
+  EXPECT_TRUE(errors::IsNotFound(reader.Read(bad_name, buf, 4)));
+
+  ShmTensorDescriptor stale = descriptor;
+  stale.set_generation(descriptor.generation() - 1);
+  EXPECT_TRUE(errors::IsAborted(reader.Read(stale, buf, 4)));
+  EXPECT_EQ(pool->num_free_slots(), 1);
+
+  TF_ASSERT_OK(reader.Read(descriptor, buf, 4));
+  EXPECT_EQ(std::string(buf, 4), "abcd");
+  EXPECT_TRUE(errors::IsAborted(reader.Read(descriptor, buf, 4)));
+  EXPECT_EQ(pool->num_free_slots(), 2);
+}
+
+TEST(ShmSegmentPoolTest, MismatchedSizeReturnsSlot) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/2);
+  ShmTensorDescriptor descriptor;
+  ASSERT_TRUE(pool->TryWrite("abcd", &descriptor));
+  ShmSegmentReader reader;
+  char buf[8];
+  EXPECT_TRUE(errors::IsInternal(reader.Read(descriptor, buf, 8)));
+  EXPECT_EQ(pool->num_free_slots(), 2);
+  EXPECT_TRUE(errors::IsAborted(reader.Read(descriptor, buf, 4)));
+}
+
+TEST(ShmSegmentPoolTest, Release) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/2);
+  ShmTensorDescriptor descriptor;
+  ASSERT_TRUE(pool->TryWrite("abcd", &descriptor));
+  ShmSegmentReader reader;
+  TF_ASSERT_OK(reader.Release(descriptor));
+  EXPECT_EQ(pool->num_free_slots(), 2);
+  EXPECT_TRUE(errors::IsAborted(reader.Release(descriptor)));
+  EXPECT_EQ(pool->num_free_slots(), 2);
+}
+
+TEST(ShmSegmentPoolTest, ExpiredSlotsAreReclaimed) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/2,
+                         /*lease_micros=*/1000);
+  // Lost, e.g. because their RPCs failed.
+  std::vector<ShmTensorDescriptor> lost(2);
+  ASSERT_TRUE(pool->TryWrite("lost0", &lost[0]));
+  ASSERT_TRUE(pool->TryWrite("lost1", &lost[1]));
+  Env::Default()->SleepForMicroseconds(2000);
+
+  ShmTensorDescriptor descriptor;
+  ASSERT_TRUE(pool->TryWrite("abcd", &descriptor));
+  EXPECT_EQ(pool->num_free_slots(), 1);
+  ShmSegmentReader reader;
+  char buf[5];
+  for (const ShmTensorDescriptor& d : lost) {
+    EXPECT_TRUE(errors::IsAborted(reader.Read(d, buf, 5)));
+  }
+  TF_ASSERT_OK(reader.Read(descriptor, buf, 4));
+  EXPECT_EQ(std::string(buf, 4), "abcd");
+  EXPECT_EQ(pool->num_free_slots(), 2);
+}
+
+TEST(ShmSegmentPoolTest, SlotsInLeaseAreNotReclaimed) {
+  auto pool = CreatePool(/*slot_bytes=*/4096, /*num_slots=*/1);
+  ShmTensorDescriptor descriptor;
+  ASSERT_TRUE(pool->TryWrite("abcd", &descriptor));
+  ShmTensorDescriptor other;
+  EXPECT_FALSE(pool->TryWrite("efgh", &other));
+
+  ShmSegmentReader reader;
+  char buf[4];
+  TF_ASSERT_OK(reader.Read(descriptor, buf, 4));
+  EXPECT_EQ(std::string(buf, 4), "abcd");
+}
+
+TEST(ShmSegmentPoolTest, ConcurrentWritersAndReaders) {
+  const int kNumSlots = 4;
+  const int kNumThreads = 8;
+  const int kNumWrites = 1000;
+  auto pool = CreatePool(/*slot_bytes=*/4096, kNumSlots);
+  ShmSegmentReader reader;
+  {
+    thread::ThreadPool threads(Env::Default(), "shm_test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      threads.Schedule([&pool, &reader, t]() {
+        const std::string data(64 + t, 'a' + t);
+        for (int i = 0; i < kNumWrites; ++i) {
+          ShmTensorDescriptor descriptor;
+          if (!pool->TryWrite(data, &descriptor)) continue;
+          std::string read(data.size(), ' ');
+          TF_ASSERT_OK(reader.Read(descriptor, &read[0], read.size()));
+          ASSERT_EQ(read, data);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(pool->num_free_slots(), kNumSlots);
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,134 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+#if defined(__linux__)
+
+using ::tensorflow::monitoring::testing::CellReader;
+
+constexpr char kShmSlotBytesEnvVar[] = "TF_GRPC_SHM_SLOT_BYTES";
+constexpr char kShmNumSlotsEnvVar[] = "TF_GRPC_SHM_NUM_SLOTS";
+constexpr char kShmReadBytesMetric[] =
+    "/tensorflow/core/distributed_runtime/shm_read_bytes";
+
+// Starts two workers of the job "localhost" in this process, with the shared
+// memory transport enabled, and returns the target of the first one.
+std::string StartServers(std::vector<std::unique_ptr<ServerInterface>>* servers,
+                         int num_slots) {
+  // The workers read the options of the transport when they are created.
+  setenv(kShmSlotBytesEnvVar, "65536", /*overwrite=*/1);
+  setenv(kShmNumSlotsEnvVar, strings::StrCat(num_slots).c_str(),
+         /*overwrite=*/1);
+  std::vector<int> ports(2);
+  for (int& port : ports) port = testing::PickUnusedPortOrDie();
+  for (int task = 0; task < 2; ++task) {
+    ServerDef server_def;
+    server_def.set_protocol("grpc");
+    server_def.set_job_name("localhost");
+    server_def.set_task_index(task);
+    auto* job_def = server_def.mutable_cluster()->add_job();
+    job_def->set_name("localhost");
+    for (int i = 0; i < 2; ++i) {
+      (*job_def->mutable_tasks())[i] = strings::StrCat("localhost:", ports[i]);
+    }
+    (*server_def.mutable_default_session_config()
+          ->mutable_device_count())["CPU"] = 1;
+    std::unique_ptr<ServerInterface> server;
+    TF_CHECK_OK(NewServer(server_def, &server));
+    TF_CHECK_OK(server->Start());
+    servers->push_back(std::move(server));
+  }
+  unsetenv(kShmSlotBytesEnvVar);
+  unsetenv(kShmNumSlotsEnvVar);
+  return strings::StrCat("grpc://localhost:", ports[0]);
+}
+
+// Passes the fed tensor through task 1 and then task 0, so that each step sends
+// it from task 1 to task 0.
+GraphDef CreateGraphDef() {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+  Scope s = Scope::NewRootScope();
+  Scope task0 = s.WithDevice("/job:localhost/replica:0/task:0/device:CPU:0");
+  Scope task1 = s.WithDevice("/job:localhost/replica:0/task:1/device:CPU:0");
+  Output x = Placeholder(task1.WithOpName("x"), DT_FLOAT);
+  Output x1 = Identity(task1.WithOpName("x1"), x);
+  Identity(task0.WithOpName("y"), x1);
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+  return def;
+}
+
+TEST(ShmTransportTest, SendsTensorsBetweenWorkers) {
+  constexpr int kNumSlots = 2;
+  std::vector<std::unique_ptr<ServerInterface>> servers;
+  SessionOptions options;
+  options.target = StartServers(&servers, kNumSlots);
+  // Keep the graph as built, so that each step sends the tensor.
+  GraphOptions* graph_options = options.config.mutable_graph_options();
+  graph_options->mutable_optimizer_options()->set_opt_level(
+      OptimizerOptions::L0);
+  graph_options->mutable_rewrite_options()->set_disable_meta_optimizer(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(CreateGraphDef()));
+
+  CellReader<int64_t> shm_read_bytes(kShmReadBytesMetric);
+  // More steps than slots, which the receiver must return to the sender.
+  for (int step = 0; step < 3 * kNumSlots; ++step) {
+    const int size = 1000 + step;
+    Tensor x(DT_FLOAT, TensorShape({size}));
+    for (int i = 0; i < size; ++i) x.flat<float>()(i) = step + 0.5f * i;
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->Run({{"x", x}}, {"y:0"}, {}, &outputs));
+    test::ExpectTensorEqual<float>(outputs[0], x);
+    EXPECT_EQ(shm_read_bytes.Delta(),
+              size * static_cast<int64_t>(sizeof(float)));
+  }
+
+  // Too large for a slot, so sent through gRPC.
+  Tensor x(DT_FLOAT, TensorShape({65536}));
+  for (int i = 0; i < 65536; ++i) x.flat<float>()(i) = i;
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->Run({{"x", x}}, {"y:0"}, {}, &outputs));
+  test::ExpectTensorEqual<float>(outputs[0], x);
+  EXPECT_EQ(shm_read_bytes.Delta(), 0);
+  TF_ASSERT_OK(session->Close());
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace
+}  // namespace tensorflow
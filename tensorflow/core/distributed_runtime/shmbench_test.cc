@@ -0,0 +1,155 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares sending tensors between two workers of a host through the gRPC
+// loopback with sending them through the shared memory transport (see
+// ShmRendezvousMgr), over a range of tensor sizes:
+//
+//   bazel run -c opt //tensorflow/core/distributed_runtime:shmbench_test -- \
+//     --benchmark_filter=all
+
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/distributed_runtime/server_lib.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/rewriter_config.pb.h"
+#include "tensorflow/core/protobuf/tensorflow_server.pb.h"
+#include "tensorflow/core/public/session.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr char kShmSlotBytesEnvVar[] = "TF_GRPC_SHM_SLOT_BYTES";
+constexpr char kShmNumSlotsEnvVar[] = "TF_GRPC_SHM_NUM_SLOTS";
+constexpr int64_t kMaxTensorBytes = 1 << 26;
+
+// Two workers in this process that talk to each other through gRPC, and
+// through shared memory if `use_shm`. The transport is the same as between
+// two processes of the host.
+class Cluster {
+ public:
+  explicit Cluster(bool use_shm) {
+    // The workers read the options of the transport when they are created.
+    if (use_shm) {
+      setenv(kShmSlotBytesEnvVar, strings::StrCat(kMaxTensorBytes).c_str(),
+             /*overwrite=*/1);
+      setenv(kShmNumSlotsEnvVar, "2", /*overwrite=*/1);
+    }
+    std::vector<int> ports(2);
+    for (int& port : ports) port = testing::PickUnusedPortOrDie();
+    for (int task = 0; task < 2; ++task) {
+      ServerDef server_def;
+      server_def.set_protocol("grpc");
+      server_def.set_job_name("localhost");
+      server_def.set_task_index(task);
+      auto* job_def = server_def.mutable_cluster()->add_job();
+      job_def->set_name("localhost");
+      for (int i = 0; i < 2; ++i) {
+        (*job_def->mutable_tasks())[i] =
+            strings::StrCat("localhost:", ports[i]);
+      }
+      (*server_def.mutable_default_session_config()
+            ->mutable_device_count())["CPU"] = 1;
+      std::unique_ptr<ServerInterface> server;
+      TF_CHECK_OK(NewServer(server_def, &server));
+      TF_CHECK_OK(server->Start());
+      servers_.push_back(std::move(server));
+    }
+    unsetenv(kShmSlotBytesEnvVar);
+    unsetenv(kShmNumSlotsEnvVar);
+
+    options_.target = strings::StrCat("grpc://localhost:", ports[0]);
+    // Keep the graph as built, so that every step sends the whole tensor.
+    GraphOptions* graph_options = options_.config.mutable_graph_options();
+    graph_options->mutable_optimizer_options()->set_opt_level(
+        OptimizerOptions::L0);
+    graph_options->mutable_rewrite_options()->set_disable_meta_optimizer(true);
+  }
+
+  const SessionOptions& options() const { return options_; }
+
+ private:
+  std::vector<std::unique_ptr<ServerInterface>> servers_;
+  SessionOptions options_;
+};
+
+const Cluster* GetCluster(bool use_shm) {
+  static Cluster* grpc_cluster = new Cluster(/*use_shm=*/false);
+  static Cluster* shm_cluster = new Cluster(/*use_shm=*/true);
+  return use_shm ? shm_cluster : grpc_cluster;
+}
+
+// Fills a float tensor of the fed size on task 1 and takes its size on task 0,
+// so that each step sends the tensor from task 1 to task 0.
+GraphDef CreateGraphDef() {
+  using namespace ::tensorflow::ops;  // NOLINT(build/namespaces)
+  Scope s = Scope::NewRootScope();
+  Scope task0 = s.WithDevice("/job:localhost/replica:0/task:0/device:CPU:0");
+  Scope task1 = s.WithDevice("/job:localhost/replica:0/task:1/device:CPU:0");
+  Output dims = Placeholder(task1.WithOpName("dims"), DT_INT32);
+  Output x = Fill(task1.WithOpName("x"), dims, 1.0f);
+  Size(task0.WithOpName("y"), x);
+  GraphDef def;
+  TF_CHECK_OK(s.ToGraphDef(&def));
+  return def;
+}
+
+void BM_Helper(::testing::benchmark::State& state, bool use_shm) {
+  const int64_t tensor_bytes = state.range(0);
+  const Cluster* cluster = GetCluster(use_shm);
+  std::unique_ptr<Session> session(NewSession(cluster->options()));
+  TF_CHECK_OK(session->Create(CreateGraphDef()));
+  Tensor dims(DT_INT32, TensorShape({1}));
+  dims.flat<int32>()(0) = tensor_bytes / sizeof(float);
+
+  std::vector<Tensor> outputs;
+  // Do a few warmup iterations.
+  for (int i = 0; i < 3; ++i) {
+    TF_CHECK_OK(session->Run({{"dims", dims}}, {"y:0"}, {}, &outputs));
+  }
+  for (auto s : state) {
+    TF_CHECK_OK(session->Run({{"dims", dims}}, {"y:0"}, {}, &outputs));
+  }
+  CHECK_EQ(outputs[0].scalar<int32>()(), dims.flat<int32>()(0));
+  state.SetBytesProcessed(state.iterations() * tensor_bytes);
+  TF_CHECK_OK(session->Close());
+}
+
+void BM_GrpcLoopback(::testing::benchmark::State& state) {
+  BM_Helper(state, /*use_shm=*/false);
+}
+
+void BM_SharedMemory(::testing::benchmark::State& state) {
+  BM_Helper(state, /*use_shm=*/true);
+}
+
+BENCHMARK(BM_GrpcLoopback)->UseRealTime()->RangeMultiplier(4)->Range(
+    1 << 10, kMaxTensorBytes);
+BENCHMARK(BM_SharedMemory)->UseRealTime()->RangeMultiplier(4)->Range(
+    1 << 10, kMaxTensorBytes);
+
+}  // namespace
+}  // namespace tensorflow
@@ -1158,6 +1158,32 @@ Status GetDatasetFromVariantTensor(const Tensor& tensor,
 // The ownership of `dataset` is transferred to `tensor`.
 Status StoreDatasetInVariantTensor(DatasetBase* dataset, Tensor* tensor);
 
+// The context of a random access `DatasetBase::Get()`, which is either called
+// by an op, with an `OpKernelContext`, or by an iterator that reads its input
+// by index, with an `IteratorContext`.
+struct AnyContext {
+  Allocator* allocator;
+  FunctionLibraryRuntime* flr;
+  std::function<void(std::function<void()>)>* runner;
+  int64_t runner_threadpool_size;
+  // Only set when called by an op.
+  OpKernelContext* op_kernel_context = nullptr;
+
+  // Implicit, so that ops and datasets pass their context as is.
+  AnyContext(OpKernelContext* ctx)  // NOLINT
+      : allocator(ctx->get_allocator({})),
+        flr(ctx->function_library()),
+        runner(ctx->runner()),
+        runner_threadpool_size(GetRunnerThreadpoolSizeFromOpKernelContext(ctx)),
+        op_kernel_context(ctx) {}
+
+  AnyContext(IteratorContext* ctx)  // NOLINT
+      : allocator(ctx->allocator({})),
+        flr(ctx->flr()),
+        runner(ctx->runner()),
+        runner_threadpool_size(ctx->runner_threadpool_size()) {}
+};
+
 // Represents a (potentially infinite) range of outputs, where each
 // output is a tuple of tensors.
 class DatasetBase : public core::RefCounted {
@@ -1290,7 +1316,9 @@ class DatasetBase : public core::RefCounted {
   Status CheckRandomAccessCompatible(const int64 index) const;
 
   // Return the element at a particular index for a randomly accessible dataset.
-  virtual Status Get(OpKernelContext* ctx, int64 index,
+  // Called by the `GetElementAtIndex` op, and by iterators which read their
+  // input by index, such as the global shuffle iterator.
+  virtual Status Get(AnyContext ctx, int64 index,
                      std::vector<Tensor>* out_tensors) const;
 
   // Return a finalized version of the dataset.  The returned DatasetBase is
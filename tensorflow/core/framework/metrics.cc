@@ -52,6 +52,21 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* executor_work_stealing_steals = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/executor_work_stealing_steals",
+    "The number of ready nodes that a work-stealing executor worker took from "
+    "another worker's queue.");
+
+auto* executor_work_stealing_inline_runs = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/executor_work_stealing_inline_runs",
+    "The number of nodes that a work-stealing executor worker ran inline "
+    "without going through a ready queue.");
+
+auto* executor_ready_queue_wait_usecs = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/executor_ready_queue_wait_usecs",
+    "The total time ready nodes spent in the work-stealing executor queues, "
+    "in microseconds.");
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -368,6 +383,22 @@ auto* graph_optimization_cache_load_count = tsl::monitoring::Counter<1>::New(
     "source"  // graph optimization source
 );
 
+auto* grappler_cache_lookup_count = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/grappler_cache_lookup_count",
+    "The number of lookups in the Grappler meta optimizer result cache.",
+    "result");
+
+auto* grappler_cache_saving_time_usecs = tsl::monitoring::Counter<0>::New(
+    "/tensorflow/core/grappler_cache_saving_time_usecs",
+    "The amount of time TensorFlow has saved by restoring optimized graphs "
+    "from the Grappler meta optimizer result cache, in microseconds.");
+
+auto* grappler_cache_eviction_count = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/grappler_cache_eviction_count",
+    "The number of entries evicted from the Grappler meta optimizer result "
+    "cache.",
+    "tier");
+
 auto* xla_compilations = tsl::monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilations",
     "The number of XLA compilations used to collect "
@@ -723,6 +754,19 @@ void UpdateGraphPendingQueueLength(uint64 len) {
   graph_pending_queue_length_cell->Add(len);
 }
 
+void UpdateExecutorWorkStealingStats(int64_t steals, int64_t inline_runs,
+                                     int64_t queue_wait_usecs) {
+  static auto* steals_cell = executor_work_stealing_steals->GetCell();
+  static auto* inline_runs_cell = executor_work_stealing_inline_runs->GetCell();
+  static auto* queue_wait_usecs_cell =
+      executor_ready_queue_wait_usecs->GetCell();
+  if (steals > 0) steals_cell->IncrementBy(steals);
+  if (inline_runs > 0) inline_runs_cell->IncrementBy(inline_runs);
+  if (queue_wait_usecs > 0) {
+    queue_wait_usecs_cell->IncrementBy(queue_wait_usecs);
+  }
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -812,6 +856,35 @@ int64_t GetFunctionGraphOptimizationCacheLoadCount(
   return graph_optimization_cache_load_count->GetCell(mapped_source)->value();
 }
 
+void RecordGrapplerCacheLookup(const std::string& result) {
+  grappler_cache_lookup_count->GetCell(result)->IncrementBy(1);
+}
+
+int64_t GetGrapplerCacheLookupCount(const std::string& result) {
+  return grappler_cache_lookup_count->GetCell(result)->value();
+}
+
+void UpdateGrapplerCacheSavingTime(const uint64 saving_time_usecs) {
+  if (saving_time_usecs > 0) {
+    static auto* grappler_cache_saving_time_usecs_cell =
+        grappler_cache_saving_time_usecs->GetCell();
+    grappler_cache_saving_time_usecs_cell->IncrementBy(saving_time_usecs);
+  }
+}
+
+uint64 GetGrapplerCacheSavingTimeUsecs() {
+  return grappler_cache_saving_time_usecs->GetCell()->value();
+}
+
+void IncrementGrapplerCacheEvictionCount(const int count,
+                                         const std::string& tier) {
+  grappler_cache_eviction_count->GetCell(tier)->IncrementBy(count);
+}
+
+int64_t GetGrapplerCacheEvictionCount(const std::string& tier) {
+  return grappler_cache_eviction_count->GetCell(tier)->value();
+}
+
 void UpdateTpuVariableDistributionTime(const uint64 distribution_time_usecs) {
   if (distribution_time_usecs > 0) {
     tpu_variable_distribution_time_usecs->GetCell()->IncrementBy(
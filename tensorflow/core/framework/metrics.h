@@ -240,6 +240,12 @@ void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records the activity of one work-stealing worker of the dataflow executor:
+// the ready nodes it stole from other workers, the nodes it ran inline after
+// a dequeued node, and the total time its dequeued nodes spent queued.
+void UpdateExecutorWorkStealingStats(int64_t steals, int64_t inline_runs,
+                                     int64_t queue_wait_usecs);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -304,6 +310,30 @@ void IncrementFunctionGraphOptimizationCacheLoadCount(
 int64_t GetFunctionGraphOptimizationCacheLoadCount(
     GraphOptimizationSource source);
 
+// Records a lookup in the Grappler meta optimizer result cache. `result` is
+// "memory_hit", "disk_hit", "miss" or "invalid", for a cache file that could
+// not be read or validated.
+void RecordGrapplerCacheLookup(const std::string& result);
+
+// Gets the number of lookups in the Grappler meta optimizer result cache with
+// the given `result`.
+int64_t GetGrapplerCacheLookupCount(const std::string& result);
+
+// Updates the time saved by restoring optimized graphs from the Grappler meta
+// optimizer result cache, in microseconds.
+void UpdateGrapplerCacheSavingTime(uint64 saving_time_usecs);
+
+// Retrieves the total time saved by the Grappler meta optimizer result cache.
+uint64 GetGrapplerCacheSavingTimeUsecs();
+
+// Increments the number of entries evicted from the `tier` ("memory" or
+// "disk") of the Grappler meta optimizer result cache.
+void IncrementGrapplerCacheEvictionCount(int count, const std::string& tier);
+
+// Gets the number of entries evicted from the `tier` of the Grappler meta
+// optimizer result cache.
+int64_t GetGrapplerCacheEvictionCount(const std::string& tier);
+
 // Records the activity of the first phase of the mlir bridge using the
 // tf_metadata.tf_mlir_bridge_first_phase_count metric.
 // device_type: tpu, cpu, gpu, etc.
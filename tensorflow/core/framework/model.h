@@ -174,7 +174,7 @@ class RamBudgetManager {
   // Returns whether the request succeeded.
   bool RequestModelAllocation(int64_t total_bytes) {
     mutex_lock l(mu_);
-    if (total_bytes > budget_ - legacy_prefetch_allocated_) {
+    if (total_bytes > budget_ - legacy_prefetch_allocated_ - cache_allocated_) {
       return false;
     }
     model_allocated_ = total_bytes;
@@ -194,7 +194,8 @@ class RamBudgetManager {
     // memory.
     if (delta_elements > 0) {
       int64_t max_delta_elements = static_cast<int64_t>(
-          (budget_ - legacy_prefetch_allocated_ - model_allocated_) /
+          (budget_ - legacy_prefetch_allocated_ - model_allocated_ -
+           cache_allocated_) /
           element_size);
       if (max_delta_elements < 0) {
         return 0;
@@ -217,17 +218,35 @@ class RamBudgetManager {
   // request. If not, no bytes are allocated.
   bool RequestLegacyPrefetchBytes(int64_t delta_bytes) {
     mutex_lock l(mu_);
-    if (delta_bytes > budget_ - legacy_prefetch_allocated_ - model_allocated_) {
+    if (delta_bytes > budget_ - legacy_prefetch_allocated_ - model_allocated_ -
+                          cache_allocated_) {
       return false;
     }
     legacy_prefetch_allocated_ += delta_bytes;
     return true;
   }
 
+  // Requests `delta_bytes` additional bytes for elements held in memory by
+  // caching transformations. `delta_bytes` can be negative to release memory.
+  //
+  // Returns whether there were enough bytes left in the budget to serve the
+  // request. If not, no bytes are allocated and the caller is expected to keep
+  // the element outside of memory (e.g. by spilling it to disk).
+  bool RequestCacheBytes(int64_t delta_bytes) {
+    mutex_lock l(mu_);
+    if (delta_bytes > 0 &&
+        delta_bytes > budget_ - legacy_prefetch_allocated_ - model_allocated_ -
+                          cache_allocated_) {
+      return false;
+    }
+    cache_allocated_ += delta_bytes;
+    return true;
+  }
+
   // The total number of bytes that the model could potentially use.
   int64_t AvailableModelRam() const {
     tf_shared_lock l(mu_);
-    return budget_ - legacy_prefetch_allocated_;
+    return budget_ - legacy_prefetch_allocated_ - cache_allocated_;
   }
 
   void UpdateBudget(int64_t budget) {
@@ -243,6 +262,8 @@ class RamBudgetManager {
   int64_t legacy_prefetch_allocated_ TF_GUARDED_BY(mu_) = 0;
   // Number of bytes allocated by the model.
   int64_t model_allocated_ TF_GUARDED_BY(mu_) = 0;
+  // Number of bytes held in memory by caching transformations.
+  int64_t cache_allocated_ TF_GUARDED_BY(mu_) = 0;
 };
 
 // Abstract representation of a TensorFlow input pipeline node. It collects
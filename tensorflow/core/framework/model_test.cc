@@ -3548,6 +3548,22 @@ TEST(RamBudgetManagerTest, RequestAllocationsWithBudgetAdjustment) {
   EXPECT_TRUE(rbm.RequestLegacyPrefetchBytes(4));
 }
 
+TEST(RamBudgetManagerTest, RequestCacheBytes) {
+  RamBudgetManager rbm(10);
+  EXPECT_TRUE(rbm.RequestModelAllocation(4));
+  // Over budget
+  EXPECT_FALSE(rbm.RequestCacheBytes(7));
+  EXPECT_TRUE(rbm.RequestCacheBytes(6));
+  EXPECT_EQ(rbm.AvailableModelRam(), 4);
+  // Cached bytes are not available to the model or to prefetching.
+  EXPECT_FALSE(rbm.RequestModelAllocation(5));
+  EXPECT_FALSE(rbm.RequestLegacyPrefetchBytes(1));
+  // Releasing cached bytes always succeeds and makes room again.
+  EXPECT_TRUE(rbm.RequestCacheBytes(-6));
+  EXPECT_TRUE(rbm.RequestModelAllocation(5));
+  EXPECT_TRUE(rbm.RequestLegacyPrefetchBytes(5));
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
@@ -877,6 +877,41 @@ Status OpKernelContext::allocate_temp(DataType type, const TensorShape& shape,
   return allocate_temp(type, shape, out_temp, AllocatorAttributes());
 }
 
+Status OpKernelContext::allocate_step_temp(DataType type,
+                                           const TensorShape& shape,
+                                           Tensor* out_temp,
+                                           AllocatorAttributes allocator_attr) {
+  // Tracked allocations go through the wrapped device allocators, and other
+  // attributes may need memory the arena does not provide.
+  if (params_->step_allocator == nullptr || allocator_attr.value != 0 ||
+      allocator_attr.scope_id != 0 || track_allocations() ||
+      record_memory_consumption_) {
+    return allocate_temp(type, shape, out_temp, allocator_attr);
+  }
+  Tensor new_tensor(params_->step_allocator, type, shape,
+                    AllocationAttributes(/*retry_on_failure=*/true,
+                                         /*allocation_will_be_logged=*/true,
+                                         /*freed_by_func=*/nullptr));
+  if (!new_tensor.IsInitialized()) {
+    return errors::ResourceExhausted(
+        "OOM when allocating tensor with shape", shape.DebugString(),
+        " and type ", DataTypeString(type), " on ", params_->device->name(),
+        " by allocator ", params_->step_allocator->Name());
+  }
+  if (params_->log_memory) {
+    LogMemory::RecordTensorAllocation(params_->op_kernel->name(),
+                                      params_->step_id, new_tensor);
+  }
+  *out_temp = std::move(new_tensor);
+  return OkStatus();
+}
+
+Status OpKernelContext::allocate_step_temp(DataType type,
+                                           const TensorShape& shape,
+                                           Tensor* out_temp) {
+  return allocate_step_temp(type, shape, out_temp, AllocatorAttributes());
+}
+
 Status OpKernelContext::get_input_index(StringPiece name,
                                         int* out_index) const {
   int start, stop;
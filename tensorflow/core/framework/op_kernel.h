@@ -619,6 +619,11 @@ class OpKernelContext {
     bool track_allocations = false;
     bool log_memory = false;
 
+    // If not null, serves the allocate_step_temp calls with default
+    // attributes instead of the device allocator. The executor sets it to a
+    // per-step arena for small tensors (see `StepArenaAllocator`). Not owned.
+    Allocator* step_allocator = nullptr;
+
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
@@ -1013,6 +1018,16 @@ class OpKernelContext {
   Status allocate_temp(DataType type, const TensorShape& shape,
                        Tensor* out_temp);
 
+  // Like allocate_temp, for scratch storage that does not escape the step:
+  // the caller must not pass `out_temp`, or a Tensor sharing its buffer, to
+  // set_output or store it anywhere that outlives the step (e.g. a resource
+  // or a queue). Such tensors may be carved out of `Params::step_allocator`.
+  Status allocate_step_temp(DataType type, const TensorShape& shape,
+                            Tensor* out_temp,
+                            AllocatorAttributes allocator_attr);
+  Status allocate_step_temp(DataType type, const TensorShape& shape,
+                            Tensor* out_temp);
+
   // Copies a tensor (allocated by the caller) to the specified output
   // index.  REQUIRES: !IsRefType(expected_output_dtype(index))
   // REQUIRES: 'tensor' must have the same MemoryType as
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel_test_base.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -524,6 +525,67 @@ TEST_F(OpKernelTest, AllocateOutput) {
   EXPECT_THAT(s.message(), ::testing::ContainsRegex("bad index=1"));
 }
 
+// Forwards to the CPU allocator under a distinct name.
+class NamedAllocator : public Allocator {
+ public:
+  std::string Name() override { return "step"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+};
+
+std::string AllocatorName(const Tensor& t) {
+  TensorDescription description;
+  t.FillDescription(&description);
+  return description.allocation_description().allocator_name();
+}
+
+TEST_F(OpKernelTest, StepAllocatorOnlyServesStepTemps) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  DummyDevice device(env);
+  params.device = &device;
+  NamedAllocator step_allocator;
+  params.step_allocator = &step_allocator;
+  Status status;
+  std::unique_ptr<OpKernel> op(
+      CreateOpKernel(DEVICE_CPU, params.device, cpu_allocator(),
+                     CreateNodeDef("Test1", {DT_FLOAT, DT_INT32}),
+                     TF_GRAPH_DEF_VERSION, &status));
+  TF_ASSERT_OK(status);
+  params.op_kernel = op.get();
+  Tensor a(DT_FLOAT, TensorShape({}));
+  Tensor b(DT_INT32, TensorShape({}));
+  gtl::InlinedVector<TensorValue, 4> inputs{TensorValue(&a), TensorValue(&b)};
+  params.inputs = inputs;
+  auto ctx = std::make_unique<OpKernelContext>(&params);
+
+  // Outputs and ordinary temps may escape the step (e.g. into a variable or a
+  // queue), so they never come from the step allocator.
+  Tensor* output = nullptr;
+  TF_ASSERT_OK(ctx->allocate_output(0, TensorShape({4}), &output));
+  EXPECT_NE(AllocatorName(*output), "step");
+  Tensor temp;
+  TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({4}), &temp));
+  EXPECT_NE(AllocatorName(temp), "step");
+
+  Tensor step_temp;
+  TF_ASSERT_OK(
+      ctx->allocate_step_temp(DT_FLOAT, TensorShape({4}), &step_temp));
+  EXPECT_EQ(AllocatorName(step_temp), "step");
+
+  // Step temps with other attributes need memory the step allocator may not
+  // provide.
+  AllocatorAttributes on_host;
+  on_host.set_on_host(true);
+  TF_ASSERT_OK(ctx->allocate_step_temp(DT_FLOAT, TensorShape({4}), &step_temp,
+                                       on_host));
+  EXPECT_NE(AllocatorName(step_temp), "step");
+}
+
 // A mock device that mimics the behavior of scoped allocator upon calling
 // GetAllocator with a positive scope_id.
 class ScopedAllocatorDevice : public DeviceBase {
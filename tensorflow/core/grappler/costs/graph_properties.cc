@@ -977,8 +977,8 @@ class SymbolicShapeRefiner {
         // Forward tensor value to output_tensors_as_shape.
         MaybeTensorProtoToShape(ic, outprop.value(),
                                 &ctx->output_tensors_as_shapes[output]);
-        const_tensors_to_propagate_.push_back(outprop.value());
-        ctx->output_tensor_protos[output] = &const_tensors_to_propagate_.back();
+        ctx->output_tensor_protos[output] =
+            AddConstTensorToPropagate(outprop.value());
       }
       output++;
     }
@@ -1387,11 +1387,23 @@ class SymbolicShapeRefiner {
     return s;
   }
 
+  // Creates the context of the node if it doesn't have one yet, in which case
+  // <added> is set to true. Nodes can be updated concurrently, but not added.
+  Status AddNodeIfMissing(const NodeDef* node, bool* added) {
+    if (GetNodeContext(node) != nullptr) {
+      return OkStatus();
+    }
+    TF_RETURN_IF_ERROR(AddNode(node));
+    *added = true;
+    return OkStatus();
+  }
+
  private:
   // Return the one ShapeHandle used to denote a fully unknown shape for a node
   // output.
   ShapeHandle GetUnknownOutputShape(const NodeDef* node, int index) {
     ShapeId id{node, index};
+    mutex_lock l(mu_);
     auto it = unknown_shapes_.find(id);
     if (it != unknown_shapes_.end()) {
       return it->second;
@@ -1406,6 +1418,7 @@ class SymbolicShapeRefiner {
   DimensionHandle GetUnknownOutputDim(const NodeDef* node, int index,
                                       int dim_id) {
     DimId id{node, index, dim_id};
+    mutex_lock l(mu_);
     auto it = unknown_dims_.find(id);
     if (it != unknown_dims_.end()) {
       return it->second;
@@ -1416,6 +1429,13 @@ class SymbolicShapeRefiner {
     return dim;
   }
 
+  // Stores <tensor_proto> for the lifetime of the refiner.
+  const TensorProto* AddConstTensorToPropagate(TensorProto tensor_proto) {
+    mutex_lock l(mu_);
+    const_tensors_to_propagate_.push_back(std::move(tensor_proto));
+    return &const_tensors_to_propagate_.back();
+  }
+
   // Returns true if all the output tensors have known values.
   bool AllOutputValuesKnown(NodeContext* c) {
     InferenceContext* ic = c->inference_context.get();
@@ -1626,8 +1646,8 @@ class SymbolicShapeRefiner {
       // Set output_tensor_protos.
       TensorProto tensor_proto;
       t->AsProtoTensorContent(&tensor_proto);
-      const_tensors_to_propagate_.push_back(tensor_proto);
-      c->output_tensor_protos[k] = &const_tensors_to_propagate_.back();
+      c->output_tensor_protos[k] =
+          AddConstTensorToPropagate(std::move(tensor_proto));
     }
     return OkStatus();
   }
@@ -1723,31 +1743,28 @@ class SymbolicShapeRefiner {
         if (ic->RankKnown(ic->input(0))) {
           // Propagate rank value.
           int32_t rank = ic->Rank(ic->input(0));
-          const_tensors_to_propagate_.push_back(
-              MakeIntegerScalarTensorProto(DT_INT32, rank));
           c->output_tensor_protos.resize(1);
-          c->output_tensor_protos[0] = &const_tensors_to_propagate_.back();
+          c->output_tensor_protos[0] = AddConstTensorToPropagate(
+              MakeIntegerScalarTensorProto(DT_INT32, rank));
         }
       } else if (IsSize(node)) {
         DimensionHandle size = ic->NumElements(ic->input(0));
         if (ic->ValueKnown(size)) {
           // Propagate size value.
           int64_t sz = ic->Value(size);
-          bool valid = false;
+          const TensorProto* size_proto = nullptr;
           if (node.attr().at("out_type").type() == DT_INT32) {
             if (sz < std::numeric_limits<int32>::max()) {
-              const_tensors_to_propagate_.push_back(
+              size_proto = AddConstTensorToPropagate(
                   MakeIntegerScalarTensorProto(DT_INT32, sz));
-              valid = true;
             }
           } else {
-            const_tensors_to_propagate_.push_back(
+            size_proto = AddConstTensorToPropagate(
                 MakeIntegerScalarTensorProto(DT_INT64, sz));
-            valid = true;
           }
-          if (valid) {
+          if (size_proto != nullptr) {
             c->output_tensor_protos.resize(1);
-            c->output_tensor_protos[0] = &const_tensors_to_propagate_.back();
+            c->output_tensor_protos[0] = size_proto;
           }
         }
       } else if (IsShape(node)) {
@@ -2045,8 +2062,11 @@ class SymbolicShapeRefiner {
   const GraphView& graph_;
   int graph_def_version_;
   absl::flat_hash_map<const NodeDef*, NodeContext> node_to_context_;
-  absl::flat_hash_map<ShapeId, ShapeHandle> unknown_shapes_;
-  absl::flat_hash_map<DimId, DimensionHandle> unknown_dims_;
+  // Guards the state shared by the nodes updated concurrently.
+  mutex mu_;
+  absl::flat_hash_map<ShapeId, ShapeHandle> unknown_shapes_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<DimId, DimensionHandle> unknown_dims_ TF_GUARDED_BY(mu_);
   // Store function instantiations only for valid function. If function
   // instantiation failed it will have an `absl::nullopt`.
   absl::flat_hash_map<string, absl::optional<GrapplerFunctionItem>>
@@ -2057,7 +2077,7 @@ class SymbolicShapeRefiner {
   // not vector, as we use pointers to the TensorProtos in this container.
   // Vector may resize and copy the objects into a new buffer, then the existing
   // pointers become dangling pointers.
-  std::deque<TensorProto> const_tensors_to_propagate_;
+  std::deque<TensorProto> const_tensors_to_propagate_ TF_GUARDED_BY(mu_);
 
   // For more aggressive shape and value inference.
   bool aggressive_shape_inference_;
@@ -2367,6 +2387,107 @@ Status GraphProperties::UpdateShapes(
   return OkStatus();
 }
 
+namespace {
+
+// Enqueues the fanout of <n>, whose shapes changed, in <new_shapes>.
+void EnqueueFanout(
+    const SymbolicShapeRefiner& shape_refiner,
+    const absl::flat_hash_map<const NodeDef*, const NodeDef*>& resource_handles,
+    const NodeDef* n, TopoQueue* new_shapes) {
+  for (const auto& fanout : shape_refiner.graph().GetFanouts(
+           *n, /*include_controlled_nodes=*/false)) {
+    new_shapes->push(fanout.node);
+  }
+  // Make sure the corresponding queue nodes are (re)processed.
+  if (IsEnqueue(*n)) {
+    auto it = resource_handles.find(n);
+    if (it != resource_handles.end()) {
+      new_shapes->push(it->second);
+    }
+  }
+}
+
+// Returns true if the shapes of <n> must be updated on their own, since
+// updating them changes the shapes of other nodes or depends on the
+// processing order.
+bool MustUpdateShapesAlone(const NodeDef& n) {
+  return IsEnter(n) || IsMerge(n) || IsEnqueue(n) || IsQueue(n);
+}
+
+// Bounds the size of the frontiers, to keep the order in which nodes are
+// processed close to the topological order.
+constexpr int kMaxFrontierSize = 256;
+
+// The approximate cost of the shape inference of a node, in cycles.
+constexpr int64_t kShapeInferenceCostPerNode = 10000;
+
+}  // namespace
+
+Status GraphProperties::UpdateFrontierShapes(
+    SymbolicShapeRefiner* shape_refiner, TopoQueue* new_shapes,
+    const absl::flat_hash_map<const NodeDef*, const NodeDef*>& resource_handles,
+    int64_t* num_nodes) const {
+  std::vector<const NodeDef*> frontier;
+  absl::flat_hash_set<const NodeDef*> in_frontier;
+  while (!new_shapes->empty() &&
+         static_cast<int>(frontier.size()) < kMaxFrontierSize) {
+    const NodeDef* n = new_shapes->pop();
+    bool depends_on_frontier = false;
+    for (const auto& fanin : shape_refiner->graph().GetFanins(
+             *n, /*include_controlling_nodes=*/false)) {
+      if (in_frontier.contains(fanin.node)) {
+        depends_on_frontier = true;
+        break;
+      }
+    }
+    if (depends_on_frontier ||
+        (!frontier.empty() && MustUpdateShapesAlone(*n))) {
+      new_shapes->push(n);
+      break;
+    }
+    frontier.push_back(n);
+    in_frontier.insert(n);
+    if (MustUpdateShapesAlone(*n)) {
+      break;
+    }
+  }
+  *num_nodes = frontier.size();
+
+  if (frontier.size() == 1) {
+    bool updated = false;
+    TF_RETURN_IF_ERROR(
+        UpdateShapes(shape_refiner, resource_handles, frontier[0], &updated));
+    if (updated) {
+      EnqueueFanout(*shape_refiner, resource_handles, frontier[0], new_shapes);
+    }
+    return OkStatus();
+  }
+
+  // The contexts of the nodes are created upfront, since the refiner can't
+  // add nodes concurrently.
+  std::unique_ptr<bool[]> updated(new bool[frontier.size()]());
+  for (int i = 0, end = frontier.size(); i < end; ++i) {
+    TF_RETURN_IF_ERROR(
+        shape_refiner->AddNodeIfMissing(frontier[i], &updated[i]));
+  }
+  std::vector<Status> statuses(frontier.size());
+  thread_pool_->ParallelFor(
+      frontier.size(), kShapeInferenceCostPerNode,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          statuses[i] = UpdateShapes(shape_refiner, resource_handles,
+                                     frontier[i], &updated[i]);
+        }
+      });
+  for (int i = 0, end = frontier.size(); i < end; ++i) {
+    TF_RETURN_IF_ERROR(statuses[i]);
+    if (updated[i]) {
+      EnqueueFanout(*shape_refiner, resource_handles, frontier[i], new_shapes);
+    }
+  }
+  return OkStatus();
+}
+
 // Propagates the shapes in the transitive fan-out of <new_shapes>.
 Status GraphProperties::PropagateShapes(
     SymbolicShapeRefiner* shape_refiner, TopoQueue* new_shapes,
@@ -2391,23 +2512,21 @@ Status GraphProperties::PropagateShapes(
   do {
     int64_t num_loop_iterations = 0;
     while (!new_shapes->empty() &&
-           num_loop_iterations++ < max_loop_iterations) {
+           num_loop_iterations < max_loop_iterations) {
+      if (thread_pool_ != nullptr) {
+        int64_t num_nodes = 0;
+        TF_RETURN_IF_ERROR(UpdateFrontierShapes(shape_refiner, new_shapes,
+                                                resource_handles, &num_nodes));
+        num_loop_iterations += num_nodes;
+        continue;
+      }
+      ++num_loop_iterations;
       const NodeDef* n = new_shapes->pop();
       bool updated = false;
       TF_RETURN_IF_ERROR(
           UpdateShapes(shape_refiner, resource_handles, n, &updated));
       if (updated) {
-        for (const auto& fanout : shape_refiner->graph().GetFanouts(
-                 *n, /*include_controlled_nodes=*/false)) {
-          new_shapes->push(fanout.node);
-        }
-        // Make sure the corresponding queue nodes are (re)processed.
-        if (IsEnqueue(*n)) {
-          auto it = resource_handles.find(n);
-          if (it != resource_handles.end()) {
-            new_shapes->push(it->second);
-          }
-        }
+        EnqueueFanout(*shape_refiner, resource_handles, n, new_shapes);
       }
     }
   } while (!new_shapes->empty() &&
@@ -2756,6 +2875,207 @@ Status GraphProperties::InferStatically(bool assume_valid_feeds,
   TF_RETURN_IF_ERROR(VerboseShapeInferenceLogging(item_.graph, refiner.get(),
                                                   shape_manager.get()));
 
+  static_inference_options_ = StaticInferenceOptions{
+      assume_valid_feeds, aggressive_shape_inference,
+      include_input_tensor_values, include_output_tensor_values};
+  return OkStatus();
+}
+
+Status GraphProperties::UpdateStatically(
+    const MutableGraphView& graph_view,
+    const absl::flat_hash_set<string>& updated_nodes) {
+  if (!static_inference_options_.has_value()) {
+    return errors::FailedPrecondition(
+        "The properties must be inferred statically before being updated");
+  }
+  if (graph_view.graph() != &item_.graph) {
+    return errors::InvalidArgument(
+        "The graph view must be a view of the graph of the item");
+  }
+
+  // Forget the deleted nodes.
+  for (auto* properties : {&input_properties_, &output_properties_}) {
+    for (auto it = properties->begin(); it != properties->end();) {
+      if (graph_view.GetNode(it->first) == nullptr) {
+        properties->erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+  for (auto it = incompatible_shape_nodes_.begin();
+       it != incompatible_shape_nodes_.end();) {
+    if (graph_view.GetNode(*it) == nullptr) {
+      it = incompatible_shape_nodes_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // Collect the transitive fanout of the updated nodes, as well as the nodes
+  // without properties feeding it, e.g. the nodes added by the pass.
+  absl::flat_hash_set<const NodeDef*> fanout;
+  std::vector<const NodeDef*> to_visit;
+  auto visit = [&](const NodeDef* node) {
+    if (node != nullptr && fanout.insert(node).second) {
+      to_visit.push_back(node);
+    }
+  };
+  for (const string& node_name : updated_nodes) {
+    visit(graph_view.GetNode(node_name));
+  }
+  while (!to_visit.empty()) {
+    const NodeDef* node = to_visit.back();
+    to_visit.pop_back();
+    for (const auto& fanout_port :
+         graph_view.GetFanouts(*node, /*include_controlled_nodes=*/false)) {
+      visit(fanout_port.node);
+    }
+    for (const auto& fanin :
+         graph_view.GetFanins(*node, /*include_controlling_nodes=*/false)) {
+      auto it = output_properties_.find(fanin.node->name());
+      if (it == output_properties_.end() ||
+          static_cast<int>(it->second.size()) <= fanin.port_id) {
+        visit(fanin.node);
+      }
+    }
+    // The shapes of a queue, and therefore of its dequeues, depend on the
+    // shapes of its enqueues.
+    if (IsEnqueue(*node)) {
+      const NodeDef* queue = node;
+      while (queue != nullptr && queue->input_size() > 0 &&
+             (queue == node || IsEnter(*queue))) {
+        queue = graph_view.GetNode(ParseTensorName(queue->input(0)).node());
+      }
+      if (queue != nullptr && IsQueue(*queue)) {
+        visit(queue);
+      }
+    }
+  }
+  if (fanout.empty()) {
+    return OkStatus();
+  }
+  VLOG(1) << "Updating the properties of " << fanout.size() << " nodes out of "
+          << item_.graph.node_size();
+
+  // Build a graph of the fanout, whose inputs are either copies of the nodes
+  // without inputs feeding it, or constants and placeholders with the
+  // properties of the other nodes feeding it.
+  GrapplerItem fanout_item;
+  fanout_item.id = item_.id;
+  *fanout_item.graph.mutable_versions() = item_.graph.versions();
+  *fanout_item.graph.mutable_library() = item_.graph.library();
+  absl::flat_hash_set<string> fanout_graph_nodes;
+  auto add_input = [&](const string& input, const NodeDef& fanin,
+                       int port) -> string {
+    if (!HasRegularInputs(fanin)) {
+      if (fanout_graph_nodes.insert(fanin.name()).second) {
+        NodeDef* source = fanout_item.graph.add_node();
+        *source = fanin;
+        source->clear_input();
+      }
+      return input;
+    }
+    const string name =
+        strings::StrCat(fanin.name(), "/UpdateStatically_", port);
+    if (fanout_graph_nodes.insert(name).second) {
+      const OpInfo::TensorProperties& properties =
+          output_properties_.at(fanin.name())[port];
+      NodeDef* placeholder = fanout_item.graph.add_node();
+      placeholder->set_name(name);
+      (*placeholder->mutable_attr())["dtype"].set_type(properties.dtype());
+      if (properties.has_value() && properties.dtype() != DT_RESOURCE &&
+          properties.dtype() != DT_VARIANT) {
+        placeholder->set_op("Const");
+        *(*placeholder->mutable_attr())["value"].mutable_tensor() =
+            properties.value();
+      } else {
+        placeholder->set_op("Placeholder");
+        TensorShapeProto* shape =
+            (*placeholder->mutable_attr())["shape"].mutable_shape();
+        *shape = properties.shape();
+        NormalizeShapeForOutput(shape);
+      }
+    }
+    return name;
+  };
+  for (const NodeDef& node : item_.graph.node()) {
+    if (!fanout.contains(&node)) {
+      continue;
+    }
+    fanout_graph_nodes.insert(node.name());
+    NodeDef* copy = fanout_item.graph.add_node();
+    *copy = node;
+    copy->clear_input();
+    for (const string& input : node.input()) {
+      if (IsControlInput(input)) {
+        continue;
+      }
+      const TensorId tensor = ParseTensorName(input);
+      const NodeDef* fanin = graph_view.GetNode(tensor.node());
+      if (fanin == nullptr || fanout.contains(fanin)) {
+        copy->add_input(input);
+      } else {
+        copy->add_input(add_input(input, *fanin, tensor.index()));
+      }
+    }
+  }
+  for (const auto& feed : item_.feed) {
+    if (fanout_graph_nodes.contains(ParseTensorName(feed.first).node())) {
+      fanout_item.feed.push_back(feed);
+    }
+  }
+
+  GraphProperties fanout_properties(fanout_item);
+  fanout_properties.set_thread_pool(thread_pool_);
+  const StaticInferenceOptions& options = *static_inference_options_;
+  TF_RETURN_IF_ERROR(fanout_properties.InferStatically(
+      options.assume_valid_feeds, options.aggressive_shape_inference,
+      options.include_input_tensor_values,
+      options.include_output_tensor_values));
+
+  // Renumber the symbolic dimensions of the fanout, so that they don't alias
+  // the symbolic dimensions of the rest of the graph.
+  int64_t min_dim = -1;
+  for (const auto* properties : {&input_properties_, &output_properties_}) {
+    for (const auto& node_properties : *properties) {
+      for (const auto& tensor_properties : node_properties.second) {
+        for (const auto& dim : tensor_properties.shape().dim()) {
+          min_dim = std::min(min_dim, dim.size());
+        }
+      }
+    }
+  }
+  using PropertiesMap =
+      absl::flat_hash_map<string, std::vector<OpInfo::TensorProperties>>;
+  auto update = [min_dim](const string& node_name, const PropertiesMap& from,
+                          PropertiesMap* to) {
+    auto it = from.find(node_name);
+    if (it == from.end()) {
+      to->erase(node_name);
+      return;
+    }
+    std::vector<OpInfo::TensorProperties>& properties = (*to)[node_name];
+    properties = it->second;
+    for (auto& tensor_properties : properties) {
+      for (auto& dim : *tensor_properties.mutable_shape()->mutable_dim()) {
+        if (dim.size() < -1) {
+          dim.set_size(dim.size() + min_dim + 1);
+        }
+      }
+    }
+  };
+  for (const NodeDef* node : fanout) {
+    update(node->name(), fanout_properties.input_properties_,
+           &input_properties_);
+    update(node->name(), fanout_properties.output_properties_,
+           &output_properties_);
+    if (fanout_properties.CheckShapeIncompatible(node->name())) {
+      incompatible_shape_nodes_.insert(node->name());
+    } else {
+      incompatible_shape_nodes_.erase(node->name());
+    }
+  }
   return OkStatus();
 }
 
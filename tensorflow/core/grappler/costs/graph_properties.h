@@ -21,10 +21,13 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/framework/shape_inference.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 
@@ -69,6 +72,7 @@ ABSL_CONST_INIT const char kOutputTypes[] = "_output_dtype_vector";
 // Outputs TensorShapeProto vector.
 ABSL_CONST_INIT const char kOutputShapes[] = "_output_shape_vector";
 
+class MutableGraphView;
 class SymbolicShapeRefiner;
 class TopoQueue;
 
@@ -114,6 +118,17 @@ class GraphProperties {
                            /*aggressive_shape_inference=*/false,
                            /*include_tensor_values=*/true);
   }
+  // Re-infers the shapes of the nodes in the transitive fanout of
+  // `updated_nodes`, e.g. the nodes an optimization pass added or rewired
+  // through `graph_view`, which must be a view of the graph of the item. The
+  // options of the last call to InferStatically are reused. The properties of
+  // the other nodes are kept, and used as the inputs of the fanout, so that the
+  // cost is proportional to the size of the fanout rather than of the graph.
+  // The symbolic dimensions shared between the fanout and the rest of the graph
+  // are lost, and so are the shapes of the resources flowing into the fanout
+  // from nodes with inputs. The properties of the deleted nodes are cleared.
+  Status UpdateStatically(const MutableGraphView& graph_view,
+                          const absl::flat_hash_set<string>& updated_nodes);
   // Infer the shape by running the graph on the specified cluster and recording
   // the shapes of the processed tensors.
   Status InferDynamically(Cluster* cluster);
@@ -158,6 +173,14 @@ class GraphProperties {
     output_properties_.clear();
   }
 
+  // Infers the shapes of the nodes that don't depend on each other
+  // concurrently on `thread_pool`, which must outlive the properties and must
+  // not be the pool running the inference. By default, the shapes are inferred
+  // on the calling thread.
+  void set_thread_pool(thread::ThreadPool* thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
  private:
   // Relaxes shapes <shapes_and_types>, determined from an EnqueueV2 node, into
   // <*queue_shapes_and_types>.
@@ -199,6 +222,22 @@ class GraphProperties {
       const absl::flat_hash_map<const NodeDef*, const NodeDef*>&
           resource_handles,
       int num_loops) const;
+  // Pops a frontier of nodes that don't depend on each other from new_shapes,
+  // updates their shapes concurrently, and enqueues the fanout of the nodes
+  // whose shapes changed. Sets <num_nodes> to the size of the frontier.
+  Status UpdateFrontierShapes(
+      SymbolicShapeRefiner* shape_refiner, TopoQueue* new_shapes,
+      const absl::flat_hash_map<const NodeDef*, const NodeDef*>&
+          resource_handles,
+      int64_t* num_nodes) const;
+
+  // The options of InferStatically, reused by UpdateStatically.
+  struct StaticInferenceOptions {
+    bool assume_valid_feeds;
+    bool aggressive_shape_inference;
+    bool include_input_tensor_values;
+    bool include_output_tensor_values;
+  };
 
   // Data members
   const GrapplerItem& item_;
@@ -211,6 +250,9 @@ class GraphProperties {
   // Nodes with output shape incompatible between shape inference and
   // annotation.
   std::unordered_set<string> incompatible_shape_nodes_;
+
+  absl::optional<StaticInferenceOptions> static_inference_options_;
+  thread::ThreadPool* thread_pool_ = nullptr;
 };
 
 // Helper function for GraphProperties.
@@ -29,11 +29,14 @@ limitations under the License.
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/inputs/trivial_test_graph_input_yielder.h"
 #include "tensorflow/core/grappler/inputs/utils.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
 #ifdef INTEL_MKL
 #include "tensorflow/core/graph/mkl_graph_util.h"
 #endif
@@ -2144,6 +2147,103 @@ TEST_F(GraphPropertiesTest, Performance) {
   TF_ASSERT_OK(properties.InferStatically(false));
 }
 
+TEST_F(GraphPropertiesTest, ParallelInference) {
+  thread::ThreadPool thread_pool(Env::Default(), "shape_inference", 4);
+  for (const string& graph_name :
+       {"merge_without_loops.pbtxt", "while_loop.pbtxt", "nested_loop.pbtxt",
+        "loops_and_queues.pbtxt", "queues_and_loops.pbtxt",
+        "large_function_graph.pbtxt"}) {
+    GrapplerItem item;
+    string filename = io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataPath,
+                                   graph_name);
+    TF_ASSERT_OK(ReadGraphDefFromFile(filename, &item.graph));
+
+    GraphProperties serial_properties(item);
+    TF_ASSERT_OK(serial_properties.InferStatically(false));
+    GraphProperties parallel_properties(item);
+    parallel_properties.set_thread_pool(&thread_pool);
+    TF_ASSERT_OK(parallel_properties.InferStatically(false));
+
+    for (const NodeDef& node : item.graph.node()) {
+      const auto& serial_inputs =
+          serial_properties.GetInputProperties(node.name());
+      const auto& parallel_inputs =
+          parallel_properties.GetInputProperties(node.name());
+      ASSERT_EQ(serial_inputs.size(), parallel_inputs.size())
+          << graph_name << ": " << node.name();
+      for (int i = 0; i < serial_inputs.size(); ++i) {
+        EXPECT_EQ(PropToString(serial_inputs[i]),
+                  PropToString(parallel_inputs[i]))
+            << graph_name << ": " << node.name();
+      }
+      const auto& serial_outputs =
+          serial_properties.GetOutputProperties(node.name());
+      const auto& parallel_outputs =
+          parallel_properties.GetOutputProperties(node.name());
+      ASSERT_EQ(serial_outputs.size(), parallel_outputs.size())
+          << graph_name << ": " << node.name();
+      for (int i = 0; i < serial_outputs.size(); ++i) {
+        EXPECT_EQ(PropToString(serial_outputs[i]),
+                  PropToString(parallel_outputs[i]))
+            << graph_name << ": " << node.name();
+      }
+    }
+  }
+}
+
+TEST_F(GraphPropertiesTest, UpdateStatically) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  Output x = ops::Placeholder(s.WithOpName("x"), DT_FLOAT,
+                              ops::Placeholder::Shape({5, 7}));
+  Output y = ops::Identity(s.WithOpName("y"), x);
+  Output shape = ops::Const(s.WithOpName("shape"), {-1}, {1});
+  Output z = ops::Reshape(s.WithOpName("z"), y, shape);
+  Output w = ops::Placeholder(s.WithOpName("w"), DT_FLOAT,
+                              ops::Placeholder::Shape({3}));
+  Output u = ops::Square(s.WithOpName("u"), w);
+  Output v = ops::Square(s.WithOpName("v"), u);
+  GrapplerItem item;
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  GraphProperties properties(item);
+  MutableGraphView graph_view(&item.graph);
+  EXPECT_TRUE(errors::IsFailedPrecondition(
+      properties.UpdateStatically(graph_view, {"y"})));
+  TF_ASSERT_OK(properties.InferStatically(false));
+  EXPECT_EQ("float: [35]",
+            PropToString(properties.GetOutputProperties("z").at(0)));
+
+  // Feed y from a new placeholder, and delete v.
+  NodeDef new_x;
+  new_x.set_name("new_x");
+  new_x.set_op("Placeholder");
+  (*new_x.mutable_attr())["dtype"].set_type(DT_FLOAT);
+  TensorShapeProto* new_shape =
+      (*new_x.mutable_attr())["shape"].mutable_shape();
+  new_shape->add_dim()->set_size(2);
+  new_shape->add_dim()->set_size(3);
+  graph_view.AddNode(std::move(new_x));
+  TF_ASSERT_OK(graph_view.UpdateRegularFaninByPort("y", 0, {"new_x", 0}));
+  TF_ASSERT_OK(graph_view.DeleteNodes({"v"}));
+  TF_ASSERT_OK(properties.UpdateStatically(graph_view, {"y", "v"}));
+
+  EXPECT_EQ("float: [2,3]",
+            PropToString(properties.GetOutputProperties("new_x").at(0)));
+  EXPECT_EQ("float: [2,3]",
+            PropToString(properties.GetInputProperties("y").at(0)));
+  EXPECT_EQ("float: [2,3]",
+            PropToString(properties.GetOutputProperties("y").at(0)));
+  EXPECT_EQ("float: [6]",
+            PropToString(properties.GetOutputProperties("z").at(0)));
+  ExpectTensorValues({-1}, properties.GetInputProperties("z").at(1).value());
+  // The other nodes are unchanged.
+  EXPECT_EQ("float: [5,7]",
+            PropToString(properties.GetOutputProperties("x").at(0)));
+  EXPECT_EQ("float: [3]",
+            PropToString(properties.GetOutputProperties("u").at(0)));
+  EXPECT_FALSE(properties.HasOutputProperties("v"));
+}
+
 TEST_F(GraphPropertiesTest, StridedSlicesOfShapes) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output a =
@@ -0,0 +1,204 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/measured_cost_database.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/grappler/costs/robust_stats.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kFileExtension[] = ".measured_costs";
+
+std::string DeviceType(const OpInfo& op_info) {
+  return op_info.device().type().empty() ? "UNKNOWN"
+                                         : op_info.device().type();
+}
+
+}  // namespace
+
+MeasuredCostDatabase::MeasuredCostDatabase(int max_measurements_per_op,
+                                           Env* env)
+    : max_measurements_per_op_(max_measurements_per_op), env_(env) {}
+
+const MeasuredCostDatabase* MeasuredCostDatabase::Global() {
+  static const MeasuredCostDatabase* database = []() {
+    const char* directory = getenv(kMeasuredCostsDirEnvVariableName);
+    if (directory == nullptr || directory[0] == '\0') {
+      return static_cast<MeasuredCostDatabase*>(nullptr);
+    }
+    auto* loaded = new MeasuredCostDatabase();
+    Status status = loaded->Load(directory);
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to load the measured cost database from "
+                   << directory << ": " << status;
+      delete loaded;
+      return static_cast<MeasuredCostDatabase*>(nullptr);
+    }
+    VLOG(1) << "Loaded the measured costs of " << loaded->num_ops()
+            << " ops from " << directory;
+    return loaded;
+  }();
+  return database;
+}
+
+OpInfo MeasuredCostDatabase::Normalize(const OpInfo& op_info) {
+  OpInfo normalized;
+  normalized.set_op(op_info.op());
+  // Attributes starting with '_' are added by the runtime (e.g. _class) and
+  // don't change what the op computes.
+  for (const auto& attr : op_info.attr()) {
+    if (!absl::StartsWith(attr.first, "_")) {
+      (*normalized.mutable_attr())[attr.first] = attr.second;
+    }
+  }
+  // Input values are only known for constants, so keying on them would split
+  // the measurements of the same op.
+  for (const auto& input : op_info.inputs()) {
+    OpInfo::TensorProperties* normalized_input = normalized.add_inputs();
+    normalized_input->set_dtype(input.dtype());
+    *normalized_input->mutable_shape() = input.shape();
+  }
+  normalized.mutable_device()->set_type(op_info.device().type());
+  return normalized;
+}
+
+uint64 MeasuredCostDatabase::Fingerprint(const OpInfo& normalized_op_info) {
+  std::string serialized;
+  SerializeToStringDeterministic(normalized_op_info, &serialized);
+  return Fingerprint64(serialized);
+}
+
+void MeasuredCostDatabase::AddMeasurement(const OpInfo& op_info,
+                                          double measurement) {
+  OpInfo normalized = Normalize(op_info);
+  const uint64 fingerprint = Fingerprint(normalized);
+  mutex_lock l(mu_);
+  Entry& entry = entries_[DeviceType(op_info)][fingerprint];
+  if (entry.measurements.empty()) {
+    entry.op_info = std::move(normalized);
+  }
+  entry.measurements.push_back(measurement);
+  while (entry.measurements.size() >
+         static_cast<size_t>(max_measurements_per_op_)) {
+    entry.measurements.pop_front();
+  }
+  RobustStats stats(std::vector<double>(entry.measurements.begin(),
+                                        entry.measurements.end()));
+  entry.execution_time = stats.mean();
+}
+
+void MeasuredCostDatabase::AddMeasurements(
+    const OpPerformanceList& op_performance) {
+  for (const OpPerformance& perf : op_performance.op_performance()) {
+    if (perf.compute_cost() < 0) {
+      continue;
+    }
+    AddMeasurement(perf.op(), perf.compute_cost());
+  }
+}
+
+void MeasuredCostDatabase::AddCostGraph(const CostGraphDef& cost_graph,
+                                        const GraphDef& graph) {
+  AddMeasurements(CostGraphToOpPerformanceData(cost_graph, graph));
+}
+
+bool MeasuredCostDatabase::Lookup(const OpInfo& op_info,
+                                  Costs::NanoSeconds* execution_time) const {
+  const uint64 fingerprint = Fingerprint(Normalize(op_info));
+  mutex_lock l(mu_);
+  auto device_entries = entries_.find(DeviceType(op_info));
+  if (device_entries == entries_.end()) {
+    return false;
+  }
+  auto entry = device_entries->second.find(fingerprint);
+  if (entry == device_entries->second.end()) {
+    return false;
+  }
+  *execution_time = Costs::NanoSeconds(entry->second.execution_time);
+  return true;
+}
+
+Status MeasuredCostDatabase::Load(const std::string& directory) {
+  if (errors::IsNotFound(env_->FileExists(directory))) {
+    return OkStatus();
+  }
+  std::vector<std::string> files;
+  TF_RETURN_IF_ERROR(env_->GetMatchingPaths(
+      io::JoinPath(directory, absl::StrCat("*", kFileExtension)), &files));
+  for (const std::string& file : files) {
+    OpPerformanceList op_performance;
+    TF_RETURN_IF_ERROR(ReadBinaryProto(env_, file, &op_performance));
+    AddMeasurements(op_performance);
+  }
+  return OkStatus();
+}
+
+Status MeasuredCostDatabase::Save(const std::string& directory) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory));
+  std::map<std::string, OpPerformanceList> files;
+  {
+    mutex_lock l(mu_);
+    for (const auto& device_entries : entries_) {
+      OpPerformanceList& op_performance = files[device_entries.first];
+      for (const auto& entry : device_entries.second) {
+        for (double measurement : entry.second.measurements) {
+          OpPerformance* perf = op_performance.add_op_performance();
+          *perf->mutable_op() = entry.second.op_info;
+          perf->set_compute_cost(measurement);
+        }
+      }
+    }
+  }
+  for (const auto& file : files) {
+    // Write to a temporary file and rename it, so that the processes reading
+    // the directory never see a partially written file.
+    const std::string file_name =
+        io::JoinPath(directory, absl::StrCat(file.first, kFileExtension));
+    std::string temp_file_name = file_name;
+    if (!env_->CreateUniqueFileName(&temp_file_name, ".tmp")) {
+      return errors::Unavailable("Could not create a unique file name for ",
+                                 file_name);
+    }
+    TF_RETURN_IF_ERROR(WriteBinaryProto(env_, temp_file_name, file.second));
+    TF_RETURN_IF_ERROR(env_->RenameFile(temp_file_name, file_name));
+  }
+  return OkStatus();
+}
+
+int64_t MeasuredCostDatabase::num_ops() const {
+  mutex_lock l(mu_);
+  int64_t num_ops = 0;
+  for (const auto& device_entries : entries_) {
+    num_ops += device_entries.second.size();
+  }
+  return num_ops;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,112 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_COST_DATABASE_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_COST_DATABASE_H_
+
+#include <deque>
+#include <map>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/cost_graph.pb.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The name of the environment variable that sets the directory of the measured
+// cost database consulted by default by the OpLevelCostEstimator.
+static const char kMeasuredCostsDirEnvVariableName[] =
+    "TF_GRAPPLER_MEASURED_COSTS_DIR";
+
+// A database of the measured execution times of ops, e.g. of the CostGraphDef
+// that StepStatsCollector builds for the RunMetadata of a step. Cost
+// estimators consult it before falling back to their analytical models, which
+// can be far off for custom or data dependent ops.
+//
+// The measurements are keyed by the op, its attributes, the types and shapes
+// of its inputs, and the type of its device (e.g. "GPU"). The most recent
+// measurements of each op are kept, and their robust mean is used as the
+// execution time of the op. The database is stored in a directory, with one
+// file of OpPerformance records per device type.
+//
+// This class is thread-safe.
+class MeasuredCostDatabase {
+ public:
+  explicit MeasuredCostDatabase(int max_measurements_per_op = 16,
+                                Env* env = Env::Default());
+
+  // Returns the database loaded from the directory set by the
+  // `TF_GRAPPLER_MEASURED_COSTS_DIR` environment variable, or nullptr if it is
+  // not set or cannot be loaded.
+  static const MeasuredCostDatabase* Global();
+
+  // Records the measured `compute_cost` of each op of `op_performance`.
+  void AddMeasurements(const OpPerformanceList& op_performance);
+
+  // Records the measured execution times of the nodes of `cost_graph`, which
+  // was collected by running `graph`.
+  void AddCostGraph(const CostGraphDef& cost_graph, const GraphDef& graph);
+
+  // Returns true and sets `execution_time` if the op described by `op_info`
+  // has been measured.
+  bool Lookup(const OpInfo& op_info, Costs::NanoSeconds* execution_time) const;
+
+  // Adds the measurements stored in `directory`. A missing directory is
+  // treated as an empty database.
+  Status Load(const std::string& directory);
+
+  // Stores the measurements in `directory`, in one file per device type.
+  Status Save(const std::string& directory) const;
+
+  // Returns the number of distinct ops measured.
+  int64_t num_ops() const;
+
+ private:
+  struct Entry {
+    // The normalized description of the op.
+    OpInfo op_info;
+    // The most recent measurements, in nanoseconds.
+    std::deque<double> measurements;
+    // The robust mean of `measurements`.
+    double execution_time = 0;
+  };
+
+  // Returns the OpInfo with only the fields that are part of the key.
+  static OpInfo Normalize(const OpInfo& op_info);
+  static uint64 Fingerprint(const OpInfo& normalized_op_info);
+
+  void AddMeasurement(const OpInfo& op_info, double measurement);
+
+  const int max_measurements_per_op_;
+  Env* const env_;
+
+  mutable mutex mu_;
+  // The entries of each device type, by the fingerprint of their op.
+  std::map<std::string, absl::flat_hash_map<uint64, Entry>> entries_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_MEASURED_COST_DATABASE_H_
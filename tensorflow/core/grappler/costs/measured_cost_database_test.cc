@@ -0,0 +1,164 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/measured_cost_database.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpInfo DescribeOp(const string& op, int size, const string& device_type) {
+  OpInfo op_info;
+  op_info.set_op(op);
+  (*op_info.mutable_attr())["T"].set_type(DT_FLOAT);
+  OpInfo::TensorProperties* input = op_info.add_inputs();
+  input->set_dtype(DT_FLOAT);
+  input->mutable_shape()->add_dim()->set_size(size);
+  op_info.mutable_device()->set_type(device_type);
+  return op_info;
+}
+
+OpPerformanceList Measure(const OpInfo& op_info,
+                          const std::vector<int64_t>& compute_costs) {
+  OpPerformanceList op_performance;
+  for (int64_t compute_cost : compute_costs) {
+    OpPerformance* perf = op_performance.add_op_performance();
+    *perf->mutable_op() = op_info;
+    perf->set_compute_cost(compute_cost);
+  }
+  return op_performance;
+}
+
+TEST(MeasuredCostDatabaseTest, Lookup) {
+  MeasuredCostDatabase database;
+  const OpInfo op_info = DescribeOp("CustomOp", 10, "GPU");
+  database.AddMeasurements(Measure(op_info, {1000}));
+  EXPECT_EQ(database.num_ops(), 1);
+
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(database.Lookup(op_info, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(1000));
+
+  EXPECT_FALSE(database.Lookup(DescribeOp("OtherOp", 10, "GPU"),
+                               &execution_time));
+  EXPECT_FALSE(database.Lookup(DescribeOp("CustomOp", 20, "GPU"),
+                               &execution_time));
+  EXPECT_FALSE(database.Lookup(DescribeOp("CustomOp", 10, "CPU"),
+                               &execution_time));
+  OpInfo other_attr = op_info;
+  (*other_attr.mutable_attr())["T"].set_type(DT_DOUBLE);
+  EXPECT_FALSE(database.Lookup(other_attr, &execution_time));
+}
+
+TEST(MeasuredCostDatabaseTest, IgnoresFieldsOutsideTheKey) {
+  MeasuredCostDatabase database;
+  const OpInfo op_info = DescribeOp("CustomOp", 10, "GPU");
+  database.AddMeasurements(Measure(op_info, {1000}));
+
+  OpInfo same_op = op_info;
+  (*same_op.mutable_attr())["_class"].set_s("loc:@x");
+  same_op.mutable_inputs(0)->mutable_value()->set_dtype(DT_FLOAT);
+  same_op.add_outputs()->set_dtype(DT_FLOAT);
+  same_op.mutable_device()->set_num_cores(10);
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(database.Lookup(same_op, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(1000));
+}
+
+TEST(MeasuredCostDatabaseTest, RobustMean) {
+  MeasuredCostDatabase database;
+  const OpInfo op_info = DescribeOp("CustomOp", 10, "GPU");
+  // A single slow step, e.g. a warmup, doesn't skew the execution time.
+  database.AddMeasurements(Measure(op_info, {100, 100, 100, 100, 10000}));
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(database.Lookup(op_info, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(100));
+}
+
+TEST(MeasuredCostDatabaseTest, KeepsRecentMeasurements) {
+  MeasuredCostDatabase database(/*max_measurements_per_op=*/2);
+  const OpInfo op_info = DescribeOp("CustomOp", 10, "GPU");
+  database.AddMeasurements(Measure(op_info, {100, 200, 300}));
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(database.Lookup(op_info, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(250));
+}
+
+TEST(MeasuredCostDatabaseTest, SaveAndLoad) {
+  const string directory =
+      io::JoinPath(testing::TmpDir(), "measured_cost_database");
+  MeasuredCostDatabase database;
+  const OpInfo gpu_op = DescribeOp("CustomOp", 10, "GPU");
+  const OpInfo cpu_op = DescribeOp("CustomOp", 10, "CPU");
+  database.AddMeasurements(Measure(gpu_op, {1000}));
+  database.AddMeasurements(Measure(cpu_op, {5000}));
+  TF_ASSERT_OK(database.Save(directory));
+
+  std::vector<string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &files));
+  EXPECT_EQ(files.size(), 2);
+
+  MeasuredCostDatabase loaded;
+  TF_ASSERT_OK(loaded.Load(directory));
+  EXPECT_EQ(loaded.num_ops(), 2);
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(loaded.Lookup(gpu_op, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(1000));
+  ASSERT_TRUE(loaded.Lookup(cpu_op, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(5000));
+}
+
+TEST(MeasuredCostDatabaseTest, LoadMissingDirectory) {
+  MeasuredCostDatabase database;
+  TF_EXPECT_OK(database.Load(
+      io::JoinPath(testing::TmpDir(), "missing_measured_cost_database")));
+  EXPECT_EQ(database.num_ops(), 0);
+}
+
+TEST(MeasuredCostDatabaseTest, AddCostGraph) {
+  GraphDef graph;
+  NodeDef* node = graph.add_node();
+  node->set_name("x");
+  node->set_op("CustomOp");
+  node->set_device("/job:localhost/replica:0/task:0/device:CPU:0");
+
+  CostGraphDef cost_graph;
+  CostGraphDef::Node* cost_node = cost_graph.add_node();
+  cost_node->set_name("x");
+  cost_node->set_device(node->device());
+  // Microseconds.
+  cost_node->set_compute_cost(3);
+
+  MeasuredCostDatabase database;
+  database.AddCostGraph(cost_graph, graph);
+  OpInfo op_info;
+  op_info.set_op("CustomOp");
+  op_info.mutable_device()->set_type("CPU");
+  Costs::NanoSeconds execution_time;
+  ASSERT_TRUE(database.Lookup(op_info, &execution_time));
+  EXPECT_EQ(execution_time, Costs::Duration(3000));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -339,6 +339,28 @@ bool IsEinsumCorrectlyFormed(const OpContext& einsum_context) {
   return true;
 }
 
+// Replaces the predicted execution time of an op with its measured one, and
+// scales the predicted breakdown of the time to match.
+void ApplyMeasuredExecutionTime(Costs::NanoSeconds measured_time,
+                                Costs* costs) {
+  if (costs->execution_time.count() > 0) {
+    const double scale = static_cast<double>(measured_time.count()) /
+                         costs->execution_time.count();
+    for (Costs::Duration* time :
+         {&costs->compute_time, &costs->memory_time,
+          &costs->intermediate_memory_time,
+          &costs->intermediate_memory_read_time,
+          &costs->intermediate_memory_write_time}) {
+      *time = Costs::NanoSeconds(time->count() * scale);
+    }
+  } else {
+    costs->compute_time = measured_time;
+    costs->memory_time = Costs::Duration::zero();
+  }
+  costs->execution_time = measured_time;
+  costs->inaccurate = false;
+}
+
 }  // namespace
 
 // Return a minimum shape if the shape is unknown. If known, return the original
@@ -655,9 +677,24 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  measured_costs_ = MeasuredCostDatabase::Global();
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
+  Costs costs = PredictAnalyticalCosts(op_context);
+  Costs::NanoSeconds measured_time;
+  if (measured_costs_ != nullptr &&
+      measured_costs_->Lookup(op_context.op_info, &measured_time)) {
+    VLOG(1) << "Operation " << op_context.op_info.op()
+            << " was measured to take " << measured_time.count() << " ns.";
+    ApplyMeasuredExecutionTime(measured_time, &costs);
+  }
+  return costs;
+}
+
+Costs OpLevelCostEstimator::PredictAnalyticalCosts(
+    const OpContext& op_context) const {
   Costs costs;
   NodeCosts node_costs;
   if (PredictNodeCosts(op_context, &node_costs).ok()) {
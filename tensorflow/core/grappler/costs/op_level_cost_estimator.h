@@ -26,6 +26,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/measured_cost_database.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/platform/types.h"
@@ -101,12 +102,24 @@ class OpLevelCostEstimator {
   OpLevelCostEstimator();
   virtual ~OpLevelCostEstimator() {}
 
+  // Predicts the costs of an op, using its measured execution time if it is in
+  // the measured cost database.
   virtual Costs PredictCosts(const OpContext& op_context) const;
 
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Sets the database of measured op costs consulted before the analytical
+  // models, or nullptr to only use the analytical models. Defaults to
+  // MeasuredCostDatabase::Global(). Not owned.
+  void set_measured_costs(const MeasuredCostDatabase* measured_costs) {
+    measured_costs_ = measured_costs;
+  }
+
  protected:
+  // Predicts the costs of an op from its analytical model only.
+  Costs PredictAnalyticalCosts(const OpContext& op_context) const;
+
   // TODO(dyoon): Consider to remove PredictOpCountBasedCosts() with OpInfo.
   // Naive cost estimate based on the given operations count and total
   // input/output tensor sizes of the given op_info combined.
@@ -335,6 +348,7 @@ class OpLevelCostEstimator {
   // compute_time and memory_time, instead of sum of those two.
   bool compute_memory_overlap_;
   std::set<string> persistent_ops_;
+  const MeasuredCostDatabase* measured_costs_;
 
  private:
   friend class OpLevelCostEstimatorTest;
@@ -924,6 +924,41 @@ TEST_F(OpLevelCostEstimatorTest, ExecutionTimeSumOrMax) {
   SetComputeMemoryOverlap(false);  // Set it back to default.
 }
 
+TEST_F(OpLevelCostEstimatorTest, MeasuredExecutionTime) {
+  MeasuredCostDatabase measured_costs;
+  OpPerformanceList op_performance;
+  OpContext bias_add = DescribeBiasAdd(1000, 10);
+  OpPerformance* perf = op_performance.add_op_performance();
+  *perf->mutable_op() = bias_add.op_info;
+  perf->set_compute_cost(18800);
+  OpContext dummy = DescribeBinaryOp("Dummy", 1000, 1);
+  perf = op_performance.add_op_performance();
+  *perf->mutable_op() = dummy.op_info;
+  perf->set_compute_cost(5000);
+  measured_costs.AddMeasurements(op_performance);
+  estimator_.set_measured_costs(&measured_costs);
+
+  // The analytical breakdown of the time is scaled to the measured time.
+  auto cost = PredictCosts(bias_add);
+  EXPECT_EQ(Costs::Duration(16800), cost.memory_time);
+  EXPECT_EQ(Costs::Duration(2000), cost.compute_time);
+  EXPECT_EQ(Costs::Duration(18800), cost.execution_time);
+  EXPECT_FALSE(cost.inaccurate);
+
+  // Ops without an analytical model are accurate once measured.
+  cost = PredictCosts(dummy);
+  EXPECT_EQ(Costs::Duration(5000), cost.memory_time);
+  EXPECT_EQ(Costs::Duration(0), cost.compute_time);
+  EXPECT_EQ(Costs::Duration(5000), cost.execution_time);
+  EXPECT_FALSE(cost.inaccurate);
+
+  // Ops that were not measured use the analytical model.
+  cost = PredictCosts(DescribeBiasAdd(1000, 20));
+  EXPECT_FALSE(cost.inaccurate);
+  EXPECT_NE(Costs::Duration(18800), cost.execution_time);
+  estimator_.set_measured_costs(nullptr);
+}
+
 TEST_F(OpLevelCostEstimatorTest,
        FusedConv2DBiasActivationNCHW_HWIO_NoSideInput) {
   auto cost = PredictCosts(DescribeFusedConv2DBiasActivation(
@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/grappler/clusters/cluster.h"
@@ -33,35 +35,50 @@ namespace grappler {
 
 namespace {
 
-StatusOr<std::string> GetCompressionFunctionName(const GraphDef& graph) {
-  for (const auto& function : graph.library().function()) {
-    for (const auto& node : function.node_def()) {
-      if (node.op() == "CompressElement") {
-        return function.signature().name();
-      }
+// Returns the CompressElement node of `function`, or nullptr if it has none.
+const NodeDef* FindCompressElementNode(const FunctionDef& function) {
+  for (const auto& node : function.node_def()) {
+    if (node.op() == "CompressElement") {
+      return &node;
     }
   }
-  return errors::Internal("Compression function not found.");
+  return nullptr;
 }
 
-StatusOr<NodeDef> GetCompressionMapNode(const GraphDef& graph) {
-  TF_ASSIGN_OR_RETURN(std::string compression_function_name,
-                      GetCompressionFunctionName(graph));
+}  // namespace
+
+StatusOr<NodeDef> GetCompressionMapNode(const GraphDef& graph,
+                                        NodeDef* compress_node) {
+  absl::flat_hash_map<std::string, const NodeDef*> compress_nodes;
+  for (const auto& function : graph.library().function()) {
+    if (const NodeDef* node = FindCompressElementNode(function)) {
+      compress_nodes[function.signature().name()] = node;
+    }
+  }
+  if (compress_nodes.empty()) {
+    return errors::Internal("Compression function not found.");
+  }
+  // Only a top-level map whose function compresses is the compression map;
+  // CompressElement ops in other functions belong to the user's pipeline.
   for (const auto& node : graph.node()) {
     if (node.op() != "ParallelMapDatasetV2") {
       continue;
     }
-    if (auto it = node.attr().find("f");
-        it != node.attr().end() && it->second.has_func() &&
-        it->second.func().name() == compression_function_name) {
+    auto it = node.attr().find("f");
+    if (it == node.attr().end() || !it->second.has_func()) {
+      continue;
+    }
+    auto compress_it = compress_nodes.find(it->second.func().name());
+    if (compress_it != compress_nodes.end()) {
+      if (compress_node != nullptr) {
+        *compress_node = *compress_it->second;
+      }
       return node;
     }
   }
   return errors::Internal("Compression map node not found.");
 }
 
-}  // namespace
-
 Status RemoveCompressionMap::OptimizeAndCollectStats(Cluster* cluster,
                                                      const GrapplerItem& item,
                                                      GraphDef* output,
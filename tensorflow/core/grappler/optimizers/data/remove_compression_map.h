@@ -16,11 +16,20 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_REMOVE_COMPRESSION_MAP_H_
 #define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_REMOVE_COMPRESSION_MAP_H_
 
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+#include "tensorflow/core/platform/statusor.h"
 
 namespace tensorflow {
 namespace grappler {
 
+// Returns the map node that the tf.data service added to `graph` to compress
+// its elements. If `compress_node` is not null, it is set to the
+// CompressElement node called by the map's function.
+StatusOr<NodeDef> GetCompressionMapNode(const GraphDef& graph,
+                                        NodeDef* compress_node = nullptr);
+
 class RemoveCompressionMap : public TFDataOptimizerBase {
  public:
   RemoveCompressionMap() = default;
@@ -112,6 +112,40 @@ TEST(RemoveCompressionMap, Success) {
   EXPECT_EQ(output.node(index).input(0), "RangeDataset/_3");
 }
 
+TEST(RemoveCompressionMap, GetCompressionMapNodeIgnoresOtherFunctions) {
+  using test::function::NDef;
+  auto compress_function = [](const std::string& name) {
+    return FunctionDefHelper::Create(
+        name, {"args_0: int64"}, {"identity: variant"}, {},
+        {{{"CompressElement"},
+          "CompressElement",
+          {"args_0"},
+          {{"input_types", DT_INT64}}},
+         {{"Identity"},
+          "Identity",
+          {"CompressElement:compressed:0"},
+          {{"T", DT_VARIANT}}}},
+        {});
+  };
+  // The user's pipeline compresses in a function that no top-level map calls,
+  // and which comes first in the library.
+  GraphDef graph = test::function::GDef(
+      {graph_tests_utils::MakeParallelMapV2Node(
+          /*name=*/"ParallelMapDatasetV2/_5",
+          /*input_node_name=*/"RangeDataset/_3",
+          /*num_parallel_calls_node_name=*/"Const/_4",
+          /*function_name=*/"__inference_Dataset_map_lambda_10",
+          /*deterministic=*/"default")},
+      {compress_function("__inference_user_function_3"),
+       compress_function("__inference_Dataset_map_lambda_10")});
+
+  NodeDef compress_node;
+  TF_ASSERT_OK_AND_ASSIGN(NodeDef map_node,
+                          GetCompressionMapNode(graph, &compress_node));
+  EXPECT_EQ(map_node.name(), "ParallelMapDatasetV2/_5");
+  EXPECT_EQ(compress_node.op(), "CompressElement");
+}
+
 TEST(RemoveCompressionMap, FailureNoMap) {
   using test::function::NDef;
   GrapplerItem item;
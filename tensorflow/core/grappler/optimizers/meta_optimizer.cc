@@ -49,6 +49,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/optimizers/implementation_selector.h"
 #include "tensorflow/core/grappler/optimizers/loop_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/memory_optimizer.h"
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
 #include "tensorflow/core/grappler/optimizers/model_pruner.h"
 #include "tensorflow/core/grappler/optimizers/pin_to_host_optimizer.h"
 #include "tensorflow/core/grappler/optimizers/remapper.h"
@@ -186,6 +187,27 @@ Status GetGraphDevice(const GraphDef& g_def, std::set<std::string>* devices) {
   return OkStatus();
 }
 
+// Returns true if optimizing `graph` with `cfg` runs registered custom
+// optimizers or plugin optimizers. The cache key cannot identify their code,
+// so their results are not persisted across processes.
+bool RunsCustomOrPluginOptimizers(const RewriterConfig& cfg,
+                                  const GraphDef& graph) {
+  if (!cfg.custom_optimizers().empty()) {
+    const std::vector<string> registered =
+        CustomGraphOptimizerRegistry::GetRegisteredOptimizers();
+    for (const auto& optimizer : cfg.custom_optimizers()) {
+      if (std::find(registered.begin(), registered.end(), optimizer.name()) !=
+          registered.end()) {
+        return true;
+      }
+    }
+  }
+  if (cfg.use_plugin_optimizers() == RewriterConfig::OFF) return false;
+  std::set<string> device_types;
+  if (!GetGraphDevice(graph, &device_types).ok()) return true;
+  return !PluginGraphOptimizerRegistry::CreateOptimizers(device_types).empty();
+}
+
 }  // namespace
 
 #define MK_OPT(NAME, CONFIG, VALUE)                                    \
@@ -1074,6 +1096,22 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       "Deleted $0 unreachable functions from the graph (library size = $1)",
       old_library_size - new_library_size, new_library_size);
 
+  // Restore the optimized graph from the cache, if enabled and populated.
+  MetaOptimizerCache* cache = MetaOptimizerCache::Global();
+  string cache_key;
+  bool persist_in_cache = false;
+  if (cache != nullptr) {
+    cache_key = MetaOptimizerCache::Key(item, config_proto_, cluster,
+                                        xla_auto_clustering_on_);
+    persist_in_cache = !RunsCustomOrPluginOptimizers(cfg_, item.graph);
+    if (cache->Lookup(cache_key, persist_in_cache, optimized_graph)) {
+      VLOG(1) << "Restored the optimized graph of grappler item " << item.id
+              << " from the cache.";
+      return OkStatus();
+    }
+  }
+  const uint64 optimization_start_usecs = Env::Default()->NowMicros();
+
   // Save a few small fields from item before we move it.
   bool optimize_function_library =
       item.optimization_options().optimize_function_library;
@@ -1301,6 +1339,21 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   }
 #endif
 
+  // Only cache the graphs that all the optimizers optimized successfully, as
+  // failures such as deadlines may be transient.
+  if (cache != nullptr) {
+    bool all_succeeded = true;
+    for (const GraphOptimizationResult& graph_result : optimization_results_) {
+      for (const OptimizerResult& result : graph_result.results) {
+        all_succeeded &= result.status.ok();
+      }
+    }
+    if (all_succeeded) {
+      cache->Insert(cache_key, persist_in_cache, *optimized_graph,
+                    Env::Default()->NowMicros() - optimization_start_usecs);
+    }
+  }
+
   VLOG(1) << "Optimized " << optimized_funcs.size()
           << " functions: " << absl::StrJoin(optimized_funcs, ", ");
   VLOG(3) << "Optimized graph =\n" << optimized_graph->DebugString();
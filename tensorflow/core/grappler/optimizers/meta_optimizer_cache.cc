@@ -0,0 +1,409 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/util.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// The first line of the header record of the cache files, which changes with
+// their format.
+constexpr char kFileMagic[] = "grappler_cache_v1";
+constexpr char kFileSuffix[] = ".grappler";
+
+// Appends `field` to `data`, prefixed by its length so that the concatenation
+// of the fields is unambiguous.
+void AppendField(absl::string_view field, std::string* data) {
+  absl::StrAppend(data, field.size(), ":", field);
+}
+
+void AppendProto(const protobuf::MessageLite& proto, std::string* data) {
+  std::string serialized;
+  SerializeToStringDeterministic(proto, &serialized);
+  AppendField(serialized, data);
+}
+
+void AppendFields(std::vector<std::string> fields, bool sort,
+                  std::string* data) {
+  if (sort) {
+    std::sort(fields.begin(), fields.end());
+  }
+  absl::StrAppend(data, fields.size(), "[");
+  for (const std::string& field : fields) {
+    AppendField(field, data);
+  }
+  absl::StrAppend(data, "]");
+}
+
+// Returns the environment variables that change what the optimizers do. The
+// TF_XLA_FLAGS auto-clustering setting is covered by the
+// `xla_auto_clustering_on` argument of the key.
+const std::vector<std::string>& OptimizerEnvVariables() {
+  static const std::vector<std::string>* variables = [] {
+    auto* variables = new std::vector<std::string>{
+        "TF_ENABLE_ONEDNN_OPTS",
+        "TF_USE_CUBLASLT",
+        "TF_USE_CUDNN_BATCHNORM_SPATIAL_PERSISTENT",
+        "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_LEVEL",
+        "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_SIMULATE_GPU",
+        "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_IGNORE_PERFORMANCE",
+        "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_EMULATE_FP16"};
+    // The additions to and removals from the auto mixed precision op lists.
+    for (const char* list : {"ALLOWLIST", "INFERLIST", "DENYLIST", "CLEARLIST",
+                             "WHITELIST", "GRAYLIST", "BLACKLIST"}) {
+      for (const char* change : {"ADD", "REMOVE"}) {
+        variables->push_back(absl::StrCat(
+            "TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_", list, "_", change));
+      }
+    }
+    return variables;
+  }();
+  return *variables;
+}
+
+// Appends the state of the process that the optimizers depend on, besides
+// their configuration.
+void AppendProcessState(bool xla_auto_clustering_on, std::string* data) {
+  absl::StrAppend(data, static_cast<int>(xla_auto_clustering_on),
+                  static_cast<int>(IsMKLEnabled()), ";");
+  std::vector<std::string> variables;
+  for (const std::string& name : OptimizerEnvVariables()) {
+    const char* value = getenv(name.c_str());
+    if (value != nullptr) {
+      variables.push_back(absl::StrCat(name, "=", value));
+    }
+  }
+  AppendFields(std::move(variables), /*sort=*/false, data);
+}
+
+}  // namespace
+
+MetaOptimizerCache::MetaOptimizerCache(const Options& options, Env* env)
+    : options_(options), env_(env) {}
+
+MetaOptimizerCache* MetaOptimizerCache::Global() {
+  static MetaOptimizerCache* cache = []() -> MetaOptimizerCache* {
+    bool enabled;
+    TF_CHECK_OK(ReadBoolFromEnvVar(kMetaOptimizerCacheEnvVariableName,
+                                   /*default_val=*/false, &enabled));
+    Options options;
+    TF_CHECK_OK(ReadStringFromEnvVar(kMetaOptimizerCacheDirEnvVariableName,
+                                     /*default_val=*/"", &options.directory));
+    if (!enabled && options.directory.empty()) {
+      return nullptr;
+    }
+    int64_t max_memory_mb;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_GRAPPLER_CACHE_MAX_MEMORY_MB",
+                                    options.max_memory_bytes >> 20,
+                                    &max_memory_mb));
+    options.max_memory_bytes = max_memory_mb << 20;
+    int64_t max_disk_mb;
+    TF_CHECK_OK(ReadInt64FromEnvVar("TF_GRAPPLER_CACHE_MAX_DISK_MB",
+                                    options.max_disk_bytes >> 20,
+                                    &max_disk_mb));
+    options.max_disk_bytes = max_disk_mb << 20;
+    LOG(INFO) << "Caching the graphs optimized by Grappler in memory"
+              << (options.directory.empty()
+                      ? ""
+                      : absl::StrCat(" and in ", options.directory));
+    return new MetaOptimizerCache(options);
+  }();
+  return cache;
+}
+
+std::string MetaOptimizerCache::Key(const GrapplerItem& item,
+                                    const ConfigProto& config,
+                                    const Cluster* cluster,
+                                    bool xla_auto_clustering_on) {
+  std::string data;
+  AppendField(TF_VERSION_STRING, &data);
+  absl::StrAppend(&data, TF_GRAPH_DEF_VERSION, ";");
+  AppendProcessState(xla_auto_clustering_on, &data);
+
+  // The graph and its function library.
+  AppendProto(item.graph, &data);
+  // The values of the feeds don't change the optimized graph, but their types
+  // and shapes may.
+  std::vector<std::string> feeds;
+  for (const auto& feed : item.feed) {
+    feeds.push_back(absl::StrCat(feed.first, ":",
+                                 DataTypeString(feed.second.dtype()),
+                                 feed.second.shape().DebugString()));
+  }
+  AppendFields(std::move(feeds), /*sort=*/false, &data);
+  AppendFields(item.fetch, /*sort=*/false, &data);
+  AppendFields(item.init_ops, /*sort=*/false, &data);
+  AppendFields(item.keep_ops, /*sort=*/false, &data);
+  AppendFields({item.save_op, item.restore_op, item.save_restore_loc_tensor},
+               /*sort=*/false, &data);
+  for (const QueueRunnerDef& queue_runner : item.queue_runners) {
+    AppendProto(queue_runner, &data);
+  }
+  AppendFields(
+      std::vector<std::string>(item.devices().begin(), item.devices().end()),
+      /*sort=*/true, &data);
+  const GrapplerItem::OptimizationOptions& opts = item.optimization_options();
+  absl::StrAppend(&data,
+                  static_cast<int>(opts.allow_non_differentiable_rewrites),
+                  static_cast<int>(opts.allow_pruning_stateful_and_dataset_ops),
+                  static_cast<int>(opts.optimize_function_library),
+                  static_cast<int>(opts.is_eager_mode), ",",
+                  opts.intra_op_parallelism_threads, ";");
+
+  AppendProto(config.graph_options().rewrite_options(), &data);
+  // The fields of the ConfigProto that the MetaOptimizer reads besides the
+  // RewriterConfig: the executor decides whether control flow is lowered, and
+  // the JIT level whether the memory optimizer runs.
+  AppendField(config.experimental().executor_type(), &data);
+  absl::StrAppend(
+      &data, static_cast<int>(config.experimental().use_tfrt()), ",",
+      static_cast<int>(
+          config.graph_options().optimizer_options().global_jit_level()),
+      ";");
+
+  if (cluster != nullptr) {
+    std::vector<std::string> devices;
+    for (const auto& device : cluster->GetDevices()) {
+      std::string properties;
+      SerializeToStringDeterministic(device.second, &properties);
+      devices.push_back(absl::StrCat(device.first, ":", properties));
+    }
+    AppendFields(std::move(devices), /*sort=*/true, &data);
+  }
+
+  const Fprint128 fingerprint = Fingerprint128(data);
+  return absl::StrCat(absl::Hex(fingerprint.high64, absl::kZeroPad16),
+                      absl::Hex(fingerprint.low64, absl::kZeroPad16));
+}
+
+bool MetaOptimizerCache::Lookup(const std::string& key, bool persistent,
+                                GraphDef* optimized_graph) {
+  std::shared_ptr<const GraphDef> graph;
+  uint64 optimization_usecs = 0;
+  {
+    mutex_lock l(mu_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      graph = it->second.graph;
+      optimization_usecs = it->second.optimization_usecs;
+    }
+  }
+  if (graph != nullptr) {
+    metrics::RecordGrapplerCacheLookup("memory_hit");
+    metrics::UpdateGrapplerCacheSavingTime(optimization_usecs);
+    *optimized_graph = *graph;
+    return true;
+  }
+  if (options_.directory.empty() || !persistent) {
+    metrics::RecordGrapplerCacheLookup("miss");
+    return false;
+  }
+
+  auto read_graph = std::make_shared<GraphDef>();
+  Status s = ReadFile(key, read_graph.get(), &optimization_usecs);
+  if (s.ok()) {
+    VLOG(2) << "Read the optimized graph from " << FileName(key);
+    metrics::RecordGrapplerCacheLookup("disk_hit");
+    metrics::UpdateGrapplerCacheSavingTime(optimization_usecs);
+    *optimized_graph = *read_graph;
+    InsertInMemory(key, std::move(read_graph), optimization_usecs);
+    return true;
+  }
+  if (errors::IsNotFound(s)) {
+    metrics::RecordGrapplerCacheLookup("miss");
+  } else {
+    LOG(WARNING) << "Deleting the invalid Grappler cache file "
+                 << FileName(key) << ": " << s;
+    metrics::RecordGrapplerCacheLookup("invalid");
+    env_->DeleteFile(FileName(key)).IgnoreError();
+  }
+  return false;
+}
+
+void MetaOptimizerCache::Insert(const std::string& key, bool persistent,
+                                const GraphDef& optimized_graph,
+                                uint64 optimization_usecs) {
+  auto graph = std::make_shared<const GraphDef>(optimized_graph);
+  InsertInMemory(key, graph, optimization_usecs);
+  if (options_.directory.empty() || !persistent) {
+    return;
+  }
+  Status s = WriteFile(key, *graph, optimization_usecs);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to write the Grappler cache file " << FileName(key)
+                 << ": " << s;
+    return;
+  }
+  EvictFiles();
+}
+
+std::string MetaOptimizerCache::FileName(const std::string& key) const {
+  return io::JoinPath(options_.directory, absl::StrCat(key, kFileSuffix));
+}
+
+// A cache file has two records: a header with the magic string, the key and the
+// optimization time, and the serialized graph. The records are checksummed.
+Status MetaOptimizerCache::ReadFile(const std::string& key, GraphDef* graph,
+                                    uint64* optimization_usecs) const {
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(FileName(key), &file));
+  io::RecordReader reader(file.get());
+  uint64 offset = 0;
+  tstring header;
+  TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &header));
+  std::vector<absl::string_view> fields =
+      absl::StrSplit(absl::string_view(header), '\n');
+  if (fields.size() != 3 || fields[0] != kFileMagic || fields[1] != key ||
+      !absl::SimpleAtoi(fields[2], optimization_usecs)) {
+    return errors::DataLoss("Invalid header: ", absl::string_view(header));
+  }
+  tstring serialized_graph;
+  TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &serialized_graph));
+  if (!graph->ParseFromArray(serialized_graph.data(),
+                             serialized_graph.size())) {
+    return errors::DataLoss("Failed to parse the optimized graph.");
+  }
+  return OkStatus();
+}
+
+Status MetaOptimizerCache::WriteFile(const std::string& key,
+                                     const GraphDef& graph,
+                                     uint64 optimization_usecs) const {
+  std::string serialized_graph;
+  if (!graph.SerializeToString(&serialized_graph)) {
+    return errors::InvalidArgument("Failed to serialize the optimized graph.");
+  }
+  if (!env_->FileExists(options_.directory).ok()) {
+    TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(options_.directory));
+  }
+  // Write to a temporary file and rename it, so that other processes sharing
+  // the directory never read a partial file.
+  std::string temp_file_name = FileName(key);
+  if (!env_->CreateUniqueFileName(&temp_file_name, ".tmp")) {
+    return errors::Unavailable("Could not create a unique file inside ",
+                               options_.directory);
+  }
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(temp_file_name, &file));
+    io::RecordWriter writer(file.get());
+    TF_RETURN_IF_ERROR(writer.WriteRecord(
+        absl::StrCat(kFileMagic, "\n", key, "\n", optimization_usecs)));
+    TF_RETURN_IF_ERROR(writer.WriteRecord(serialized_graph));
+    TF_RETURN_IF_ERROR(writer.Close());
+    TF_RETURN_IF_ERROR(file->Close());
+  }
+  return env_->RenameFile(temp_file_name, FileName(key));
+}
+
+void MetaOptimizerCache::EvictFiles() const {
+  std::vector<std::string> file_names;
+  Status s = env_->GetMatchingPaths(
+      io::JoinPath(options_.directory, absl::StrCat("*", kFileSuffix)),
+      &file_names);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to list the Grappler cache files in "
+                 << options_.directory << ": " << s;
+    return;
+  }
+  struct CacheFile {
+    std::string name;
+    int64_t bytes;
+    int64_t mtime_nsec;
+  };
+  std::vector<CacheFile> files;
+  int64_t total_bytes = 0;
+  for (std::string& file_name : file_names) {
+    FileStatistics stat;
+    if (env_->Stat(file_name, &stat).ok()) {
+      files.push_back({std::move(file_name), stat.length, stat.mtime_nsec});
+      total_bytes += stat.length;
+    }
+  }
+  if (total_bytes <= options_.max_disk_bytes) {
+    return;
+  }
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile& a, const CacheFile& b) {
+              return a.mtime_nsec < b.mtime_nsec;
+            });
+  int num_evicted = 0;
+  for (const CacheFile& file : files) {
+    if (total_bytes <= options_.max_disk_bytes) break;
+    // Another process sharing the directory may have deleted the file.
+    if (env_->DeleteFile(file.name).ok()) {
+      ++num_evicted;
+    }
+    total_bytes -= file.bytes;
+  }
+  metrics::IncrementGrapplerCacheEvictionCount(num_evicted, "disk");
+}
+
+void MetaOptimizerCache::InsertInMemory(const std::string& key,
+                                        std::shared_ptr<const GraphDef> graph,
+                                        uint64 optimization_usecs) {
+  const int64_t bytes = graph->ByteSizeLong();
+  if (bytes > options_.max_memory_bytes) {
+    return;
+  }
+  mutex_lock l(mu_);
+  if (entries_.contains(key)) {
+    return;
+  }
+  lru_.push_front(key);
+  entries_[key] = Entry{std::move(graph), bytes, optimization_usecs,
+                        lru_.begin()};
+  bytes_ += bytes;
+  int num_evicted = 0;
+  while (bytes_ > options_.max_memory_bytes) {
+    auto it = entries_.find(lru_.back());
+    bytes_ -= it->second.bytes;
+    entries_.erase(it);
+    lru_.pop_back();
+    ++num_evicted;
+  }
+  if (num_evicted > 0) {
+    metrics::IncrementGrapplerCacheEvictionCount(num_evicted, "memory");
+  }
+}
+
+}  // namespace grappler
+}  // namespace tensorflow
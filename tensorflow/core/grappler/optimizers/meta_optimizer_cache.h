@@ -0,0 +1,139 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The name of the environment variable that enables the in-memory cache of the
+// graphs optimized by the MetaOptimizer.
+static const char kMetaOptimizerCacheEnvVariableName[] = "TF_GRAPPLER_CACHE";
+// The name of the environment variable that sets the directory of the on-disk
+// cache of the graphs optimized by the MetaOptimizer, which also enables the
+// in-memory cache.
+static const char kMetaOptimizerCacheDirEnvVariableName[] =
+    "TF_GRAPPLER_CACHE_DIR";
+
+// A cache of the graphs optimized by the MetaOptimizer, including their
+// function libraries, so that optimizing the same graph again with the same
+// configuration (e.g. in each replica of a model, or after a restart) does not
+// run the optimizers again.
+//
+// The entries are keyed by a fingerprint of everything the optimizers depend
+// on: the input graph and the rest of the GrapplerItem, the RewriterConfig and
+// the other fields of the ConfigProto that the MetaOptimizer reads, the
+// devices, the TensorFlow version, and the flags and environment variables
+// that change what the built-in optimizers do. They are kept in memory, and
+// optionally in a directory, which can be shared by the processes of a job.
+// Both tiers are bounded in bytes, and evict their least recently used (in
+// memory) or least recently written (on disk) entries.
+//
+// The key cannot identify the code of custom and plugin optimizers, which may
+// change between processes, so the graphs they optimize should only be cached
+// in memory (see `persistent` below).
+//
+// The files of the on-disk cache are checksummed, and a file that cannot be
+// read or validated is deleted and counted as a miss.
+//
+// This class is thread-safe.
+class MetaOptimizerCache {
+ public:
+  struct Options {
+    // The directory of the on-disk cache, or empty to only cache in memory.
+    std::string directory;
+    // The maximum total size of the optimized graphs cached in memory, and in
+    // the directory, in bytes.
+    int64_t max_memory_bytes = 512LL << 20;
+    int64_t max_disk_bytes = 4LL << 30;
+  };
+
+  explicit MetaOptimizerCache(const Options& options,
+                              Env* env = Env::Default());
+
+  // Returns the process-wide cache configured by the `TF_GRAPPLER_CACHE*`
+  // environment variables, or nullptr if the cache is disabled, which is the
+  // default.
+  static MetaOptimizerCache* Global();
+
+  // Returns the cache key of optimizing `item` with `config` on `cluster`,
+  // which may be null, when XLA auto-clustering is on or off as given, e.g. by
+  // TF_XLA_FLAGS or the session's global JIT level.
+  static std::string Key(const GrapplerItem& item, const ConfigProto& config,
+                         const Cluster* cluster, bool xla_auto_clustering_on);
+
+  // Looks up the optimized graph for `key`, first in memory and then, if
+  // `persistent`, on disk. Returns true and sets `optimized_graph` on a hit.
+  bool Lookup(const std::string& key, bool persistent,
+              GraphDef* optimized_graph);
+
+  // Caches the graph optimized for `key`, whose optimization took
+  // `optimization_usecs`, in memory and, if `persistent`, on disk.
+  void Insert(const std::string& key, bool persistent,
+              const GraphDef& optimized_graph, uint64 optimization_usecs);
+
+ private:
+  struct Entry {
+    std::shared_ptr<const GraphDef> graph;
+    int64_t bytes = 0;
+    uint64 optimization_usecs = 0;
+    // The position of the key in `lru_`.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  std::string FileName(const std::string& key) const;
+
+  // Reads and validates the cache file for `key`.
+  Status ReadFile(const std::string& key, GraphDef* graph,
+                  uint64* optimization_usecs) const;
+  Status WriteFile(const std::string& key, const GraphDef& graph,
+                   uint64 optimization_usecs) const;
+  // Deletes the least recently written files until the directory fits in
+  // `max_disk_bytes`.
+  void EvictFiles() const;
+
+  void InsertInMemory(const std::string& key,
+                      std::shared_ptr<const GraphDef> graph,
+                      uint64 optimization_usecs);
+
+  const Options options_;
+  Env* const env_;
+
+  mutex mu_;
+  absl::flat_hash_map<std::string, Entry> entries_ TF_GUARDED_BY(mu_);
+  // The keys of `entries_`, from the most to the least recently used.
+  std::list<std::string> lru_ TF_GUARDED_BY(mu_);
+  int64_t bytes_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_META_OPTIMIZER_CACHE_H_
@@ -0,0 +1,283 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/meta_optimizer_cache.h"
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using test::function::NDef;
+
+constexpr char kDevice[] = "/job:localhost/replica:0/task:0/device:CPU:0";
+
+GrapplerItem MakeItem(int num_nodes) {
+  GrapplerItem item;
+  std::vector<NodeDef> nodes = {
+      NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  for (int i = 0; i < num_nodes; ++i) {
+    nodes.push_back(NDef(absl::StrCat("y", i), "Identity", {"x"},
+                         {{"T", DT_FLOAT}}, kDevice));
+  }
+  item.graph = test::function::GDef(nodes);
+  item.fetch = {"y0"};
+  return item;
+}
+
+std::string TempDir() {
+  std::string dir = io::JoinPath(testing::TmpDir(), "meta_optimizer_cache");
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  return dir;
+}
+
+std::string Key(const GrapplerItem& item, const ConfigProto& config) {
+  return MetaOptimizerCache::Key(item, config, /*cluster=*/nullptr,
+                                 /*xla_auto_clustering_on=*/false);
+}
+
+std::string Key(const GrapplerItem& item, const RewriterConfig& cfg) {
+  ConfigProto config;
+  *config.mutable_graph_options()->mutable_rewrite_options() = cfg;
+  return Key(item, config);
+}
+
+TEST(MetaOptimizerCacheTest, Key) {
+  RewriterConfig cfg;
+  const GrapplerItem item = MakeItem(2);
+  const std::string key = Key(item, cfg);
+  EXPECT_EQ(key.size(), 32);
+  EXPECT_EQ(Key(MakeItem(2), cfg), key);
+
+  EXPECT_NE(Key(MakeItem(3), cfg), key);
+
+  GrapplerItem other_fetch = MakeItem(2);
+  other_fetch.fetch = {"y1"};
+  EXPECT_NE(Key(other_fetch, cfg), key);
+
+  GrapplerItem with_device = MakeItem(2);
+  TF_ASSERT_OK(with_device.AddDevice(kDevice));
+  EXPECT_NE(Key(with_device, cfg), key);
+
+  GrapplerItem function_item = MakeItem(2);
+  function_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
+      false;
+  EXPECT_NE(Key(function_item, cfg), key);
+
+  RewriterConfig other_cfg;
+  other_cfg.set_constant_folding(RewriterConfig::OFF);
+  EXPECT_NE(Key(item, other_cfg), key);
+
+  EXPECT_NE(MetaOptimizerCache::Key(item, ConfigProto(), /*cluster=*/nullptr,
+                                    /*xla_auto_clustering_on=*/true),
+            key);
+}
+
+TEST(MetaOptimizerCacheTest, KeyDependsOnConfigProto) {
+  const GrapplerItem item = MakeItem(2);
+  ConfigProto config;
+  const std::string key = Key(item, config);
+  EXPECT_EQ(Key(item, RewriterConfig()), key);
+
+  // The single threaded executor doesn't lower control flow, so a graph
+  // optimized for it must not be served to the default executor.
+  ConfigProto single_threaded = config;
+  single_threaded.mutable_experimental()->set_executor_type(
+      "SINGLE_THREADED_EXECUTOR");
+  const std::string single_threaded_key = Key(item, single_threaded);
+  EXPECT_NE(single_threaded_key, key);
+  MetaOptimizerCache cache(MetaOptimizerCache::Options{});
+  GraphDef graph;
+  cache.Insert(single_threaded_key, /*persistent=*/true, MakeItem(1).graph,
+               /*optimization_usecs=*/10);
+  EXPECT_TRUE(cache.Lookup(single_threaded_key, /*persistent=*/true, &graph));
+  EXPECT_FALSE(cache.Lookup(key, /*persistent=*/true, &graph));
+
+  ConfigProto tfrt = config;
+  tfrt.mutable_experimental()->set_use_tfrt(true);
+  EXPECT_NE(Key(item, tfrt), key);
+
+  ConfigProto jit = config;
+  jit.mutable_graph_options()
+      ->mutable_optimizer_options()
+      ->set_global_jit_level(OptimizerOptions::ON_1);
+  EXPECT_NE(Key(item, jit), key);
+
+  // Fields that the MetaOptimizer doesn't read don't change the key.
+  ConfigProto threads = config;
+  threads.set_inter_op_parallelism_threads(4);
+  EXPECT_EQ(Key(item, threads), key);
+}
+
+TEST(MetaOptimizerCacheTest, KeyDependsOnEnvironment) {
+  RewriterConfig cfg;
+  const GrapplerItem item = MakeItem(2);
+  const std::string key = Key(item, cfg);
+  setenv("TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_ALLOWLIST_ADD", "Identity",
+         /*overwrite=*/1);
+  const std::string mixed_precision_key = Key(item, cfg);
+  unsetenv("TF_AUTO_MIXED_PRECISION_GRAPH_REWRITE_ALLOWLIST_ADD");
+  EXPECT_NE(mixed_precision_key, key);
+  // Other environment variables don't change the optimized graph.
+  setenv("TF_CPP_VMODULE", "meta_optimizer=1", /*overwrite=*/1);
+  const std::string logging_key = Key(item, cfg);
+  unsetenv("TF_CPP_VMODULE");
+  EXPECT_EQ(logging_key, key);
+  EXPECT_EQ(Key(item, cfg), key);
+}
+
+TEST(MetaOptimizerCacheTest, InMemory) {
+  MetaOptimizerCache cache(MetaOptimizerCache::Options{});
+  const GraphDef optimized_graph = MakeItem(1).graph;
+  GraphDef graph;
+
+  const int64_t misses = metrics::GetGrapplerCacheLookupCount("miss");
+  const int64_t hits = metrics::GetGrapplerCacheLookupCount("memory_hit");
+  EXPECT_FALSE(cache.Lookup("key", /*persistent=*/true, &graph));
+  EXPECT_EQ(metrics::GetGrapplerCacheLookupCount("miss"), misses + 1);
+
+  cache.Insert("key", /*persistent=*/true, optimized_graph,
+               /*optimization_usecs=*/10);
+  ASSERT_TRUE(cache.Lookup("key", /*persistent=*/true, &graph));
+  EXPECT_EQ(graph.SerializeAsString(), optimized_graph.SerializeAsString());
+  EXPECT_EQ(metrics::GetGrapplerCacheLookupCount("memory_hit"), hits + 1);
+  EXPECT_FALSE(cache.Lookup("other_key", /*persistent=*/true, &graph));
+}
+
+TEST(MetaOptimizerCacheTest, InMemoryEviction) {
+  const GraphDef optimized_graph = MakeItem(1).graph;
+  MetaOptimizerCache::Options options;
+  // Room for two graphs.
+  options.max_memory_bytes = 2 * optimized_graph.ByteSizeLong();
+  MetaOptimizerCache cache(options);
+  GraphDef graph;
+
+  const int64_t evictions = metrics::GetGrapplerCacheEvictionCount("memory");
+  cache.Insert("a", /*persistent=*/true, optimized_graph,
+               /*optimization_usecs=*/10);
+  cache.Insert("b", /*persistent=*/true, optimized_graph,
+               /*optimization_usecs=*/10);
+  // Uses "a", so that "b" is the least recently used.
+  EXPECT_TRUE(cache.Lookup("a", /*persistent=*/true, &graph));
+  cache.Insert("c", /*persistent=*/true, optimized_graph,
+               /*optimization_usecs=*/10);
+  EXPECT_EQ(metrics::GetGrapplerCacheEvictionCount("memory"), evictions + 1);
+  EXPECT_TRUE(cache.Lookup("a", /*persistent=*/true, &graph));
+  EXPECT_FALSE(cache.Lookup("b", /*persistent=*/true, &graph));
+  EXPECT_TRUE(cache.Lookup("c", /*persistent=*/true, &graph));
+}
+
+TEST(MetaOptimizerCacheTest, OnDisk) {
+  MetaOptimizerCache::Options options;
+  options.directory = TempDir();
+  const GraphDef optimized_graph = MakeItem(1).graph;
+  {
+    MetaOptimizerCache cache(options);
+    cache.Insert("key", /*persistent=*/true, optimized_graph,
+                 /*optimization_usecs=*/10);
+  }
+
+  // A new cache, e.g. in another process, reads the graph from the directory.
+  MetaOptimizerCache cache(options);
+  GraphDef graph;
+  const int64_t hits = metrics::GetGrapplerCacheLookupCount("disk_hit");
+  const uint64 saving_time = metrics::GetGrapplerCacheSavingTimeUsecs();
+  ASSERT_TRUE(cache.Lookup("key", /*persistent=*/true, &graph));
+  EXPECT_EQ(graph.SerializeAsString(), optimized_graph.SerializeAsString());
+  EXPECT_EQ(metrics::GetGrapplerCacheLookupCount("disk_hit"), hits + 1);
+  EXPECT_EQ(metrics::GetGrapplerCacheSavingTimeUsecs(), saving_time + 10);
+  EXPECT_FALSE(cache.Lookup("other_key", /*persistent=*/true, &graph));
+}
+
+TEST(MetaOptimizerCacheTest, InvalidFile) {
+  MetaOptimizerCache::Options options;
+  options.directory = TempDir();
+  Env* env = Env::Default();
+  {
+    MetaOptimizerCache cache(options);
+    cache.Insert("key", /*persistent=*/true, MakeItem(1).graph,
+                 /*optimization_usecs=*/10);
+  }
+  const std::string file_name =
+      io::JoinPath(options.directory, "key.grappler");
+  std::string contents;
+  TF_ASSERT_OK(ReadFileToString(env, file_name, &contents));
+  contents[contents.size() / 2] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(env, file_name, contents));
+
+  MetaOptimizerCache cache(options);
+  GraphDef graph;
+  const int64_t invalid = metrics::GetGrapplerCacheLookupCount("invalid");
+  EXPECT_FALSE(cache.Lookup("key", /*persistent=*/true, &graph));
+  EXPECT_EQ(metrics::GetGrapplerCacheLookupCount("invalid"), invalid + 1);
+  EXPECT_TRUE(errors::IsNotFound(env->FileExists(file_name)));
+}
+
+TEST(MetaOptimizerCacheTest, OnDiskEviction) {
+  MetaOptimizerCache::Options options;
+  options.directory = TempDir();
+  // No file fits in the directory, so each write evicts all the files.
+  options.max_disk_bytes = 1;
+  MetaOptimizerCache cache(options);
+  const int64_t evictions = metrics::GetGrapplerCacheEvictionCount("disk");
+  cache.Insert("a", /*persistent=*/true, MakeItem(1).graph,
+               /*optimization_usecs=*/10);
+  cache.Insert("b", /*persistent=*/true, MakeItem(1).graph,
+               /*optimization_usecs=*/10);
+  EXPECT_EQ(metrics::GetGrapplerCacheEvictionCount("disk"), evictions + 2);
+  std::vector<std::string> files;
+  TF_ASSERT_OK(Env::Default()->GetMatchingPaths(
+      io::JoinPath(options.directory, "*.grappler"), &files));
+  EXPECT_TRUE(files.empty());
+  // The graphs are still cached in memory.
+  GraphDef graph;
+  EXPECT_TRUE(cache.Lookup("a", /*persistent=*/true, &graph));
+}
+
+TEST(MetaOptimizerCacheTest, NotPersistent) {
+  MetaOptimizerCache::Options options;
+  options.directory = TempDir();
+  const GraphDef optimized_graph = MakeItem(1).graph;
+  {
+    MetaOptimizerCache cache(options);
+    cache.Insert("key", /*persistent=*/false, optimized_graph,
+                 /*optimization_usecs=*/10);
+    GraphDef graph;
+    EXPECT_TRUE(cache.Lookup("key", /*persistent=*/false, &graph));
+  }
+  std::vector<std::string> files;
+  TF_ASSERT_OK(Env::Default()->GetMatchingPaths(
+      io::JoinPath(options.directory, "*.grappler"), &files));
+  EXPECT_TRUE(files.empty());
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -74,6 +74,10 @@ namespace grappler {
 //
 // Sigmoid + Mul -> _MklSwish  // This fusion only works on Intel CPU.
 //
+// Gather + <Mul> + SparseSegment{Sum,Mean,SqrtN} ->
+//     _FusedGatherSparseSegmentReduction  // CPU only.
+//   Embedding lookups that read the same table are merged into one node.
+//
 //
 // In all cases, the supported activation functions are Relu, Relu6, and Elu.
 //
@@ -92,6 +96,8 @@ constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
 constexpr char kFusedBatchNormGradEx[] = "_FusedBatchNormGradEx";
 constexpr char kTensorToHashBucket[] = "_TensorToHashBucketFast";
+constexpr char kFusedGatherSparseSegmentReduction[] =
+    "_FusedGatherSparseSegmentReduction";
 constexpr char kLeakyRelu[] = "LeakyRelu";
 constexpr char kMklFusedMish[] = "_MklFusedMish";
 constexpr char kRelu[] = "Relu";
@@ -167,6 +173,17 @@ struct TensorToHashBucket {
   int string_to_hash_bucket = kMissingIndex;
 };
 
+// Embedding lookup: Gather of the rows of a rank 2 table, optionally scaled by
+// per-id weights, reduced with SparseSegment{Sum,Mean,SqrtN}.
+struct GatherSparseSegmentReduction {
+  GatherSparseSegmentReduction() = default;
+
+  int gather = kMissingIndex;
+  int mul = kMissingIndex;  // kMissingIndex if the lookup is not weighted.
+  int weights_port = kMissingIndex;
+  int segment_reduction = kMissingIndex;
+};
+
 // Pad followed by Conv3D/FusedConv3D
 struct PadWithConv3D {
   PadWithConv3D() = default;
@@ -2671,6 +2688,134 @@ bool FindTensorToHashBucket(const RemapperContext& ctx, int node_index,
   return true;
 }
 
+// Returns the combiner of _FusedGatherSparseSegmentReduction for the sparse
+// segment reductions that can be fused, or an empty string.
+string SparseSegmentReductionCombiner(const NodeDef& node) {
+  if (node.op() == "SparseSegmentSum") return "sum";
+  if (node.op() == "SparseSegmentMean") return "mean";
+  if (node.op() == "SparseSegmentSqrtN") return "sqrtn";
+  return "";
+}
+
+bool IsEmbeddingLookupCandidate(const utils::MutableNodeView& node_view) {
+  const auto* node_def = node_view.node();
+  if (SparseSegmentReductionCombiner(*node_def).empty()) return false;
+  if (node_view.NumRegularFanins() < 1) return false;
+  const auto* fanin_0 = node_view.GetRegularFanin(0).node_view()->node();
+  return fanin_0->op() == "Gather" || fanin_0->op() == "GatherV2" ||
+         IsMul(*fanin_0);
+}
+
+bool FindGatherSparseSegmentReduction(const RemapperContext& ctx,
+                                      int node_index,
+                                      GatherSparseSegmentReduction* matched) {
+  // Root of the pattern must be a SparseSegment{Sum,Mean,SqrtN} on CPU.
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  const auto* node_def = node_view->node();
+  if (!IsEmbeddingLookupCandidate(*node_view) || !NodeIsOnCpu(node_def) ||
+      HasControlFaninOrFanout(*node_view) || node_view->NumRegularFanins() < 3)
+    return false;
+
+  const DataType dtype = GetDataTypeFromAttr(*node_def, "T");
+  if (dtype != DT_FLOAT && dtype != DT_BFLOAT16) return false;
+
+  // The Gather and Mul nodes must only feed the next node of the pattern.
+  const auto is_fusable_interior_node =
+      [&](const utils::MutableNodeView& interior) {
+        return !HasControlFaninOrFanout(interior) &&
+               HasAtMostOneFanoutAtPort0(interior) &&
+               GetDataTypeFromAttr(*interior.node(), "T") == dtype &&
+               !IsInPreserveSet(ctx, interior.node());
+      };
+
+  GatherSparseSegmentReduction pattern;
+  pattern.segment_reduction = node_index;
+
+  // Optional per-id weights: Mul(Gather, weights) or Mul(weights, Gather).
+  const auto* gather_node_view = node_view->GetRegularFanin(0).node_view();
+  if (IsMul(*gather_node_view->node())) {
+    const auto* mul_node_view = gather_node_view;
+    if (!is_fusable_interior_node(*mul_node_view) ||
+        mul_node_view->NumRegularFanins() != 2)
+      return false;
+    for (int port = 0; port < 2; ++port) {
+      const auto* fanin = mul_node_view->GetRegularFanin(port).node_view();
+      if (IsGather(*fanin->node())) {
+        pattern.mul = mul_node_view->node_index();
+        pattern.weights_port = 1 - port;
+        gather_node_view = fanin;
+        break;
+      }
+    }
+    if (pattern.mul == kMissingIndex ||
+        mul_node_view->GetRegularFanin(pattern.weights_port).node_view() ==
+            gather_node_view)
+      return false;
+  }
+
+  // The Gather must read whole rows of the table. Gather has no "T" attribute,
+  // so it is checked separately from the Mul.
+  const auto* gather_node_def = gather_node_view->node();
+  if (gather_node_def->op() != "Gather" && gather_node_def->op() != "GatherV2")
+    return false;
+  if (HasControlFaninOrFanout(*gather_node_view) ||
+      !HasAtMostOneFanoutAtPort0(*gather_node_view) ||
+      IsInPreserveSet(ctx, gather_node_def) ||
+      GetDataTypeFromAttr(*gather_node_def, "Tparams") != dtype)
+    return false;
+  if (gather_node_def->op() == "GatherV2") {
+    int batch_dims = 0;
+    if (TryGetNodeAttr(*gather_node_def, "batch_dims", &batch_dims) &&
+        batch_dims != 0)
+      return false;
+    if (gather_node_view->NumRegularFanins() < 3) return false;
+    const auto* axis_node_def =
+        gather_node_view->GetRegularFanin(2).node_view()->node();
+    if (!IsConstant(*axis_node_def)) return false;
+    Tensor axis;
+    if (!axis.FromProto(axis_node_def->attr().at("value").tensor()) ||
+        axis.NumElements() != 1)
+      return false;
+    const int64_t axis_value = axis.dtype() == DT_INT32
+                                   ? axis.flat<int32>()(0)
+                                   : axis.flat<int64_t>()(0);
+    if (axis_value != 0) return false;
+  }
+
+  // The table must be a matrix and the ids a vector, so that the gathered
+  // rows are the rows the segment reduction reads.
+  if (!ctx.inferred_graph_properties) return false;
+  const auto& gather_props =
+      ctx.graph_properties.GetInputProperties(gather_node_def->name());
+  if (gather_props.size() < 2) return false;
+  const TensorShapeProto& params_shape = gather_props[0].shape();
+  const TensorShapeProto& ids_shape = gather_props[1].shape();
+  if (params_shape.unknown_rank() || params_shape.dim_size() != 2 ||
+      ids_shape.unknown_rank() || ids_shape.dim_size() != 1)
+    return false;
+
+  // The weights must scale whole rows: either one weight per id ([n, 1]) or a
+  // single weight.
+  if (pattern.mul != kMissingIndex) {
+    const auto& mul_props = ctx.graph_properties.GetInputProperties(
+        ctx.graph_view.GetNode(pattern.mul)->GetName());
+    if (mul_props.size() != 2) return false;
+    const TensorShapeProto& weights_shape =
+        mul_props[pattern.weights_port].shape();
+    if (weights_shape.unknown_rank()) return false;
+    const bool per_id = weights_shape.dim_size() == 2 &&
+                        weights_shape.dim(1).size() == 1;
+    const bool single = weights_shape.dim_size() == 0 ||
+                        (weights_shape.dim_size() == 1 &&
+                         weights_shape.dim(0).size() == 1);
+    if (!per_id && !single) return false;
+  }
+
+  pattern.gather = gather_node_view->node_index();
+  *matched = pattern;
+  return true;
+}
+
 // clang-format off
 // HardSwish pattern
 //                        input     Const (value: 3)
@@ -4285,6 +4430,159 @@ Status AddTensorToHashBucketNode(RemapperContext* ctx,
   return OkStatus();
 }
 
+// Returns true if one of the lookups in `group` (transitively) reads the output
+// of another one, in which case merging them into one node creates a cycle.
+bool LookupsDependOnEachOther(
+    const RemapperContext& ctx,
+    const std::vector<GatherSparseSegmentReduction>& group) {
+  absl::flat_hash_set<int> pattern_nodes;
+  for (const auto& lookup : group) {
+    pattern_nodes.insert({lookup.gather, lookup.segment_reduction});
+    if (lookup.mul != kMissingIndex) pattern_nodes.insert(lookup.mul);
+  }
+
+  // A lookup can not reach its own nodes from its inputs, so reaching any
+  // pattern node from outside the patterns means two lookups are dependent.
+  std::vector<int> stack;
+  absl::flat_hash_set<int> visited;
+  const auto push_fanins = [&](int node_index, bool skip_pattern_nodes) {
+    const auto* node_view = ctx.graph_view.GetNode(node_index);
+    for (const auto& fanin : node_view->GetRegularFanins()) {
+      if (skip_pattern_nodes && pattern_nodes.contains(fanin.node_index()))
+        continue;
+      stack.push_back(fanin.node_index());
+    }
+    for (const auto& fanin : node_view->GetControllingFanins()) {
+      stack.push_back(fanin.node_index());
+    }
+  };
+  for (int node_index : pattern_nodes) {
+    push_fanins(node_index, /*skip_pattern_nodes=*/true);
+  }
+  while (!stack.empty()) {
+    const int node_index = stack.back();
+    stack.pop_back();
+    if (pattern_nodes.contains(node_index)) return true;
+    if (!visited.insert(node_index).second) continue;
+    push_fanins(node_index, /*skip_pattern_nodes=*/false);
+  }
+  return false;
+}
+
+// Replaces the lookups in `group`, which all read the same table, by one
+// _FusedGatherSparseSegmentReduction node. A single lookup is replaced in
+// place; for several lookups each SparseSegment node is replaced by an Identity
+// of the matching output of the fused node.
+Status AddFusedGatherSparseSegmentReductionNode(
+    RemapperContext* ctx,
+    const std::vector<GatherSparseSegmentReduction>& group) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& first_gather = graph->node(group.front().gather);
+  const NodeDef& first_segment = graph->node(group.front().segment_reduction);
+  const bool weighted = group.front().mul != kMissingIndex;
+  const int num_lookups = group.size();
+
+  NodeDef fused_op;
+  fused_op.set_name(num_lookups == 1 ? first_segment.name()
+                                     : absl::StrCat(first_segment.name(),
+                                                    "/FusedEmbeddingLookups"));
+  fused_op.set_op(kFusedGatherSparseSegmentReduction);
+  fused_op.set_device(first_segment.device());
+  fused_op.add_input(first_gather.input(0));  // 0: params
+  for (const auto& lookup : group) {
+    fused_op.add_input(graph->node(lookup.gather).input(1));  // ids
+  }
+  for (const auto& lookup : group) {
+    fused_op.add_input(graph->node(lookup.segment_reduction).input(1));
+  }
+  for (const auto& lookup : group) {
+    fused_op.add_input(graph->node(lookup.segment_reduction).input(2));
+  }
+  if (weighted) {
+    for (const auto& lookup : group) {
+      fused_op.add_input(
+          graph->node(lookup.mul).input(lookup.weights_port));  // weights
+    }
+  }
+
+  const DataType segment_ids_type =
+      GetDataTypeFromAttr(first_segment, "Tsegmentids");
+  auto* attr = fused_op.mutable_attr();
+  (*attr)["T"] = first_segment.attr().at("T");
+  SetAttrValue(GetDataTypeFromAttr(first_gather, "Tindices"), &(*attr)["Tids"]);
+  SetAttrValue(GetDataTypeFromAttr(first_segment, "Tidx"), &(*attr)["Tidx"]);
+  SetAttrValue(segment_ids_type == DT_INVALID ? DT_INT32 : segment_ids_type,
+               &(*attr)["Tsegmentids"]);
+  SetAttrValue(num_lookups, &(*attr)["N"]);
+  SetAttrValue(weighted ? num_lookups : 0, &(*attr)["num_weights"]);
+  SetAttrValue(SparseSegmentReductionCombiner(first_segment),
+               &(*attr)["combiner"]);
+
+  std::vector<NodeDef> identities;
+  if (num_lookups > 1) {
+    for (int i = 0; i < num_lookups; ++i) {
+      const NodeDef& segment = graph->node(group[i].segment_reduction);
+      NodeDef identity;
+      identity.set_name(segment.name());
+      identity.set_op("Identity");
+      identity.set_device(segment.device());
+      identity.add_input(i == 0 ? fused_op.name()
+                                : absl::StrCat(fused_op.name(), ":", i));
+      (*identity.mutable_attr())["T"] = segment.attr().at("T");
+      identities.push_back(std::move(identity));
+    }
+  }
+  VLOG(2) << "Fuse " << num_lookups
+          << " Gather + SparseSegmentReduction lookups into "
+          << fused_op.name() << " on device=" << fused_op.device();
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  for (NodeDef& identity : identities) {
+    mutation->AddNode(std::move(identity), &status);
+    TF_RETURN_IF_ERROR(status);
+  }
+  return mutation->Apply();
+}
+
+// Fuses the embedding lookups matched by FindGatherSparseSegmentReduction.
+// Lookups into the same table with the same combiner, index types and device
+// share one fused node, so the table is walked by a single kernel.
+Status AddFusedGatherSparseSegmentReductionNodes(
+    RemapperContext* ctx,
+    const std::vector<GatherSparseSegmentReduction>& matched) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  std::vector<std::vector<GatherSparseSegmentReduction>> groups;
+  std::map<string, int> group_index;
+  for (const auto& lookup : matched) {
+    const NodeDef& gather = graph->node(lookup.gather);
+    const NodeDef& segment = graph->node(lookup.segment_reduction);
+    const string key = absl::StrCat(
+        gather.input(0), "|", segment.device(), "|", segment.op(), "|",
+        lookup.mul != kMissingIndex, "|",
+        GetDataTypeFromAttr(gather, "Tindices"), "|",
+        GetDataTypeFromAttr(segment, "Tidx"), "|",
+        GetDataTypeFromAttr(segment, "Tsegmentids"));
+    auto it = group_index.emplace(key, groups.size());
+    if (it.second) groups.emplace_back();
+    groups[it.first->second].push_back(lookup);
+  }
+
+  for (const auto& group : groups) {
+    if (group.size() > 1 && LookupsDependOnEachOther(*ctx, group)) {
+      for (const auto& lookup : group) {
+        TF_RETURN_IF_ERROR(
+            AddFusedGatherSparseSegmentReductionNode(ctx, {lookup}));
+      }
+    } else {
+      TF_RETURN_IF_ERROR(AddFusedGatherSparseSegmentReductionNode(ctx, group));
+    }
+  }
+  return OkStatus();
+}
+
 Status AddFusedBatchMatMul(RemapperContext* ctx,
                            const std::map<string, int>& matched_nodes_map,
                            const std::set<int>& remove_node_indices,
@@ -4755,17 +5053,21 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index,
     return true;
   };
 
+  const auto is_embedding_lookup_candidate = [&]() -> bool {
+    return IsEmbeddingLookupCandidate(*node_view) && NodeIsOnCpu(node_def);
+  };
+
   if (IsMKLEnabled())
     return is_batch_norm_candidate() || is_batch_norm_fusion_candidate() ||
            IsContractionWithAdd(ctx, node_index) ||
            is_act_biasadd_conv_candidate() || IsBiasAdd(*node_def) ||
-           IsTranspose(*node_def);
+           IsTranspose(*node_def) || is_embedding_lookup_candidate();
 
   return is_act_biasadd_conv_candidate() || is_batch_norm_candidate() ||
          is_batch_norm_fusion_candidate() ||
          is_batch_norm_grad_fusion_candidate() ||
          is_matmul_gelu_exact_fusion_candidate() ||
-         is_act_biasadd_matmul_candidate();
+         is_act_biasadd_matmul_candidate() || is_embedding_lookup_candidate();
 }
 }  // namespace
 
@@ -4791,6 +5093,9 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
   // not perform rewrite if the graph will be differentiated later.
   bool allow_non_differentiable_rewrites =
       item.optimization_options().allow_non_differentiable_rewrites;
+  // Embedding lookups are fused after the loop, once all lookups into the same
+  // table are known.
+  std::vector<GatherSparseSegmentReduction> gather_segment_reductions;
 
   for (int i = num_nodes - 1; i >= 0; --i) {
     // Check if node was invalidated by one of the previous remaps.
@@ -5108,6 +5413,18 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    GatherSparseSegmentReduction gather_segment_reduction;
+    if (allow_non_differentiable_rewrites &&
+        FindGatherSparseSegmentReduction(ctx, i, &gather_segment_reduction)) {
+      gather_segment_reductions.push_back(gather_segment_reduction);
+      invalidated_nodes[i] = true;
+      nodes_to_delete[gather_segment_reduction.gather] = true;
+      if (gather_segment_reduction.mul != kMissingIndex) {
+        nodes_to_delete[gather_segment_reduction.mul] = true;
+      }
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
@@ -5117,6 +5434,9 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
     }
   }
 
+  TF_RETURN_IF_ERROR(AddFusedGatherSparseSegmentReductionNodes(
+      &ctx, gather_segment_reductions));
+
   // Remove invalidated nodes.
   utils::Mutation* mutation = ctx.graph_view.GetMutationBuilder();
   for (int i = 0; i < num_nodes; ++i) {
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include <set>
+
+#include "absl/strings/match.h"
 #include "tensorflow/cc/ops/nn_ops_internal.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
@@ -1764,6 +1767,117 @@ TEST_F(RemapperTensorToHashBucketTest, I32) { RunTest<DT_INT32>(); }
 
 TEST_F(RemapperTensorToHashBucketTest, I64) { RunTest<DT_INT64>(); }
 
+TEST_F(RemapperTest, FuseGatherSparseSegmentReduction) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto params = Placeholder(s.WithOpName("params"), DT_FLOAT,
+                            ops::Placeholder::Shape({10, 4}));
+  auto axis = ops::Const(s.WithOpName("axis"), 0);
+
+  // Two unweighted sum lookups into the same table are merged.
+  auto ids_a = Placeholder(s.WithOpName("ids_a"), DT_INT32,
+                           ops::Placeholder::Shape({6}));
+  auto gather_a = ops::GatherV2(s.WithOpName("gather_a"), params, ids_a, axis);
+  auto sum_a = ops::SparseSegmentSum(
+      s.WithOpName("sum_a"), gather_a,
+      ops::Const(s.WithOpName("indices_a"), {0, 1, 2, 3, 4, 5}),
+      ops::Const(s.WithOpName("segments_a"), {0, 0, 1, 1, 1, 3}));
+  auto ids_c = Placeholder(s.WithOpName("ids_c"), DT_INT32,
+                           ops::Placeholder::Shape({2}));
+  auto gather_c = ops::GatherV2(s.WithOpName("gather_c"), params, ids_c, axis);
+  auto sum_c = ops::SparseSegmentSum(
+      s.WithOpName("sum_c"), gather_c,
+      ops::Const(s.WithOpName("indices_c"), {1, 0}),
+      ops::Const(s.WithOpName("segments_c"), {0, 1}));
+
+  // A weighted mean lookup is fused on its own.
+  auto ids_b = Placeholder(s.WithOpName("ids_b"), DT_INT32,
+                           ops::Placeholder::Shape({3}));
+  auto weights_b = Placeholder(s.WithOpName("weights_b"), DT_FLOAT,
+                               ops::Placeholder::Shape({3, 1}));
+  auto gather_b = ops::GatherV2(s.WithOpName("gather_b"), params, ids_b, axis);
+  auto mul_b = ops::Mul(s.WithOpName("mul_b"), gather_b, weights_b);
+  auto mean_b = ops::SparseSegmentMean(
+      s.WithOpName("mean_b"), mul_b,
+      ops::Const(s.WithOpName("indices_b"), {0, 1, 2}),
+      ops::Const(s.WithOpName("segments_b"), {0, 1, 1}));
+
+  auto fetch_a = ops::Identity(s.WithOpName("fetch_a"), sum_a);
+  auto fetch_b = ops::Identity(s.WithOpName("fetch_b"), mean_b);
+  auto fetch_c = ops::Identity(s.WithOpName("fetch_c"), sum_c);
+
+  Tensor ids_a_t(DT_INT32, TensorShape({6}));
+  test::FillValues<int32>(&ids_a_t, {9, 0, 3, 3, 7, 1});
+  Tensor ids_b_t(DT_INT32, TensorShape({3}));
+  test::FillValues<int32>(&ids_b_t, {2, 5, 8});
+  Tensor ids_c_t(DT_INT32, TensorShape({2}));
+  test::FillValues<int32>(&ids_c_t, {4, 6});
+
+  GrapplerItem item;
+  item.fetch = {"fetch_a", "fetch_b", "fetch_c"};
+  item.feed = {{"params", GenerateRandomTensor<DT_FLOAT>({10, 4})},
+               {"ids_a", ids_a_t},
+               {"ids_b", ids_b_t},
+               {"ids_c", ids_c_t},
+               {"weights_b", GenerateRandomTensor<DT_FLOAT>({3, 1})}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // The fused kernel only exists on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  string merged;
+  int found = 0;
+  for (const NodeDef& node : output.node()) {
+    EXPECT_FALSE(absl::StartsWith(node.name(), "gather_")) << node.name();
+    EXPECT_NE(node.name(), "mul_b");
+    if (node.op() != "_FusedGatherSparseSegmentReduction") continue;
+    if (node.name() == "mean_b") {
+      EXPECT_EQ(node.attr().at("N").i(), 1);
+      EXPECT_EQ(node.attr().at("num_weights").i(), 1);
+      EXPECT_EQ(node.attr().at("combiner").s(), "mean");
+      ASSERT_EQ(node.input_size(), 5);
+      EXPECT_EQ(node.input(0), "params");
+      EXPECT_EQ(node.input(1), "ids_b");
+      EXPECT_EQ(node.input(4), "weights_b");
+    } else {
+      merged = node.name();
+      EXPECT_EQ(node.attr().at("N").i(), 2);
+      EXPECT_EQ(node.attr().at("num_weights").i(), 0);
+      EXPECT_EQ(node.attr().at("combiner").s(), "sum");
+      EXPECT_EQ(node.input_size(), 7);
+    }
+    found++;
+  }
+  EXPECT_EQ(found, 2);
+  ASSERT_FALSE(merged.empty());
+
+  std::set<string> merged_outputs;
+  for (const NodeDef& node : output.node()) {
+    if (node.name() == "sum_a" || node.name() == "sum_c") {
+      EXPECT_EQ(node.op(), "Identity");
+      ASSERT_EQ(node.input_size(), 1);
+      merged_outputs.insert(node.input(0));
+    }
+  }
+  EXPECT_EQ(merged_outputs, (std::set<string>{merged, merged + ":1"}));
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 3);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorNear<float>(tensors[i], tensors_expected[i], 1e-6);
+  }
+}
+
 class RemapperFuseMatMulWithBiasTest : public RemapperTest {
  public:
   template <DataType DTYPE>
@@ -0,0 +1,557 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_BATCH_SCHEDULER_H_
+#define TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_BATCH_SCHEDULER_H_
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+namespace internal {
+template <typename TaskType>
+class DBSQueue;
+}  // namespace internal
+
+// EXPERIMENTAL: API MAY BE SUBJECTED TO SUDDEN CHANGES.
+//
+// Shared batch scheduler which forms batches from per-task deadlines and
+// priorities rather than from a fixed batch timeout.
+//
+// Every task carries a deadline (an absolute time, in Env::NowMicros() terms)
+// and is either high or low priority. A queue holds on to the tasks of each
+// priority until a batch of 'max_batch_size' is available, or until their
+// earliest deadline is less than 'batch_processing_micros' away. Among the
+// queues that are due, batch threads serve high priority work before low
+// priority work, and earliest deadline first within each. Enqueuing a task
+// wakes up an idle batch thread.
+//
+// A batch is filled with the queue's high priority tasks in deadline order.
+// If 'allowed_batch_sizes' is set, the batch would be padded up to the next
+// allowed size anyway, so low priority tasks take those padding slots for
+// free. Low priority tasks left over are batched on their own once they come
+// due and no high priority batch is.
+//
+// This lets latency critical traffic and bulk traffic share a model without
+// bulk traffic delaying the critical batches.
+template <typename TaskType>
+class DeadlineBatchScheduler
+    : public std::enable_shared_from_this<DeadlineBatchScheduler<TaskType>> {
+ public:
+  ~DeadlineBatchScheduler();
+
+  struct Options {
+    // The name to use for the pool of batch threads.
+    string thread_pool_name = {"batch_threads"};
+    // Number of batch processing threads.
+    int64_t num_batch_threads = port::NumSchedulableCPUs();
+    // Longest time an idle batch thread waits for new tasks before looking for
+    // due batches again.
+    int64_t max_idle_sleep_micros = 1000;
+    // The environment to use (typically only overridden by test code).
+    Env* env = Env::Default();
+  };
+
+  // Ownership is shared between the caller of Create() and any queues created
+  // via AddQueue().
+  static Status Create(
+      const Options& options,
+      std::shared_ptr<DeadlineBatchScheduler<TaskType>>* scheduler);
+
+  struct QueueOptions {
+    // Maximum size of each batch.
+    int max_batch_size = 1000;
+    // If non-empty, batches are padded up to the smallest of these sizes that
+    // holds them, and low priority tasks are used as padding. Must be
+    // increasing, with the last entry equal to 'max_batch_size'.
+    std::vector<int32> allowed_batch_sizes;
+    // Maximum number of enqueued tasks of each priority, in units of
+    // 'max_batch_size'.
+    int max_enqueued_batches = 10;
+    // Expected time to process a batch. A batch is dispatched once the
+    // earliest deadline in it is this close.
+    int64_t batch_processing_micros = 0;
+    // Returns the deadline of a task. If unset, or if it returns a value
+    // <= 0, the deadline is the enqueue time plus the timeout below for the
+    // task's priority.
+    std::function<int64_t(const TaskType&)> get_deadline_micros;
+    // Returns true for low priority tasks. If unset, all tasks are high
+    // priority.
+    std::function<bool(const TaskType&)> is_low_priority;
+    // Default deadline of high and low priority tasks, relative to the time
+    // they are enqueued.
+    int64_t batch_timeout_micros = 0;
+    int64_t low_priority_batch_timeout_micros = 0;
+  };
+
+  using BatchProcessor = std::function<void(std::unique_ptr<Batch<TaskType>>)>;
+
+  // Adds queue (and its callback) to be managed by this scheduler.
+  Status AddQueue(const QueueOptions& options,
+                  BatchProcessor process_batch_callback,
+                  std::unique_ptr<BatchScheduler<TaskType>>* queue);
+
+ private:
+  // access to RemoveQueue(), env().
+  friend class internal::DBSQueue<TaskType>;
+
+  explicit DeadlineBatchScheduler(const Options& options);
+
+  // Continuously retrieves and processes batches.
+  void ProcessBatches();
+
+  // Removes queue from scheduler.
+  void RemoveQueue(const internal::DBSQueue<TaskType>* queue);
+
+  // Wakes up an idle batch thread after a task was enqueued.
+  void NotifyTaskScheduled();
+
+  Env* env() const { return options_.env; }
+
+  const Options options_;
+
+  // Unowned queues and callbacks added by AddQueue.
+  std::unordered_map<internal::DBSQueue<TaskType>*, BatchProcessor>
+      queues_and_callbacks_ TF_GUARDED_BY(mu_);
+
+  // Responsible for running the batch processing callbacks.
+  std::unique_ptr<thread::ThreadPool> batch_thread_pool_;
+
+  // Set when the scheduler is being destroyed.
+  bool shutting_down_ TF_GUARDED_BY(mu_) = false;
+
+  mutex mu_;
+
+  // Notified when a task is enqueued or the scheduler is being destroyed.
+  condition_variable schedulable_batch_cv_;
+
+  DeadlineBatchScheduler(const DeadlineBatchScheduler&) = delete;
+  void operator=(const DeadlineBatchScheduler&) = delete;
+};
+
+//////////////////////////////////////////////////////////
+// Implementation details follow. API users need not read.
+
+namespace internal {
+// Holds the tasks of one queue ordered by deadline, and forms its batches on
+// behalf of the DeadlineBatchScheduler.
+template <typename TaskType>
+class DBSQueue : public BatchScheduler<TaskType> {
+ public:
+  using QueueOptions = typename DeadlineBatchScheduler<TaskType>::QueueOptions;
+
+  // When the queue next needs a batch thread, as seen by the scheduler.
+  struct Urgency {
+    // Whether the batch would lead with high priority tasks. Otherwise it only
+    // holds low priority tasks.
+    bool high_priority = false;
+    // Earliest deadline of the tasks that would lead the batch.
+    int64_t earliest_deadline = std::numeric_limits<int64_t>::max();
+    // Time at which a batch must be dispatched; the minimum for a full batch.
+    int64_t due_time = std::numeric_limits<int64_t>::max();
+  };
+
+  DBSQueue(std::shared_ptr<DeadlineBatchScheduler<TaskType>> scheduler,
+           const QueueOptions& options);
+
+  ~DBSQueue() override;
+
+  // Enqueues task. Fails if the task size is larger than the batch size or if
+  // the queue for the task's priority is full.
+  Status Schedule(std::unique_ptr<TaskType>* task) override;
+
+  // Number of tasks waiting to be scheduled.
+  size_t NumEnqueuedTasks() const override;
+
+  // Number of size 1 high priority tasks which could currently be scheduled
+  // without failing.
+  size_t SchedulingCapacity() const override;
+
+  size_t max_task_size() const override { return options_.max_batch_size; }
+
+  // Returns the urgency of the next batch at time 'now'. The high priority
+  // tasks lead the batch unless only the low priority tasks are due.
+  Urgency GetUrgency(int64_t now) const;
+
+  // Forms and closes the next batch, of the priority of the last urgency
+  // returned. Returns nullptr if there are no such tasks.
+  std::unique_ptr<Batch<TaskType>> FormBatch(bool high_priority);
+
+ private:
+  struct PendingTask {
+    int64_t deadline_micros;
+    // Breaks ties between equal deadlines in favor of earlier tasks.
+    uint64 sequence_number;
+    std::unique_ptr<TaskType> task;
+  };
+
+  // Orders a heap by earliest deadline.
+  static bool LaterDeadline(const PendingTask& a, const PendingTask& b) {
+    if (a.deadline_micros != b.deadline_micros) {
+      return a.deadline_micros > b.deadline_micros;
+    }
+    return a.sequence_number > b.sequence_number;
+  }
+
+  // Moves tasks from 'tasks' into 'batch' in deadline order, for as long as
+  // they fit within 'size_limit'.
+  static void TakeTasks(std::vector<PendingTask>* tasks, size_t* tasks_size,
+                        size_t size_limit, Batch<TaskType>* batch);
+
+  // Returns the size 'batch_size' gets padded to.
+  size_t PaddedBatchSize(size_t batch_size) const;
+
+  // Returns the time at which a batch of 'tasks' must be dispatched.
+  int64_t DueTime(const std::vector<PendingTask>& tasks,
+                  size_t tasks_size) const;
+
+  std::shared_ptr<DeadlineBatchScheduler<TaskType>> scheduler_;
+  const QueueOptions options_;
+
+  // Min-heaps of pending tasks by deadline, and the sum of their sizes.
+  std::vector<PendingTask> high_priority_tasks_ TF_GUARDED_BY(mu_);
+  std::vector<PendingTask> low_priority_tasks_ TF_GUARDED_BY(mu_);
+  size_t high_priority_size_ TF_GUARDED_BY(mu_) = 0;
+  size_t low_priority_size_ TF_GUARDED_BY(mu_) = 0;
+  uint64 next_sequence_number_ TF_GUARDED_BY(mu_) = 0;
+
+  mutable mutex mu_;
+  DBSQueue(const DBSQueue&) = delete;
+  void operator=(const DBSQueue&) = delete;
+};
+}  // namespace internal
+
+// ---------------- DeadlineBatchScheduler ----------------
+
+template <typename TaskType>
+Status DeadlineBatchScheduler<TaskType>::Create(
+    const Options& options,
+    std::shared_ptr<DeadlineBatchScheduler<TaskType>>* scheduler) {
+  if (options.num_batch_threads < 1) {
+    return errors::InvalidArgument("num_batch_threads must be positive; was ",
+                                   options.num_batch_threads);
+  }
+  if (options.max_idle_sleep_micros < 1) {
+    return errors::InvalidArgument(
+        "max_idle_sleep_micros must be positive; was ",
+        options.max_idle_sleep_micros);
+  }
+  scheduler->reset(new DeadlineBatchScheduler<TaskType>(options));
+  return OkStatus();
+}
+
+template <typename TaskType>
+DeadlineBatchScheduler<TaskType>::DeadlineBatchScheduler(
+    const Options& options)
+    : options_(options) {
+  batch_thread_pool_.reset(new thread::ThreadPool(
+      env(), options.thread_pool_name, options.num_batch_threads));
+  for (int i = 0; i < options.num_batch_threads; i++) {
+    batch_thread_pool_->Schedule(
+        std::bind(&DeadlineBatchScheduler<TaskType>::ProcessBatches, this));
+  }
+}
+
+template <typename TaskType>
+DeadlineBatchScheduler<TaskType>::~DeadlineBatchScheduler() {
+  // Signal processing threads to exit.
+  {
+    mutex_lock l(mu_);
+    shutting_down_ = true;
+    schedulable_batch_cv_.notify_all();
+  }
+  // Hangs until all threads finish.
+  batch_thread_pool_.reset();
+}
+
+template <typename TaskType>
+Status DeadlineBatchScheduler<TaskType>::AddQueue(
+    const QueueOptions& options, BatchProcessor process_batch_callback,
+    std::unique_ptr<BatchScheduler<TaskType>>* queue) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be positive; was ",
+                                   options.max_batch_size);
+  }
+  if (options.max_enqueued_batches <= 0) {
+    return errors::InvalidArgument(
+        "max_enqueued_batches must be positive; was ",
+        options.max_enqueued_batches);
+  }
+  if (options.batch_processing_micros < 0) {
+    return errors::InvalidArgument(
+        "batch_processing_micros can't be negative; was ",
+        options.batch_processing_micros);
+  }
+  if (options.batch_timeout_micros < 0 ||
+      options.low_priority_batch_timeout_micros < 0) {
+    return errors::InvalidArgument("Batch timeouts can't be negative");
+  }
+  if (!options.allowed_batch_sizes.empty()) {
+    int32 last_size = 0;
+    for (const int32 size : options.allowed_batch_sizes) {
+      if (size <= last_size) {
+        return errors::InvalidArgument(
+            "allowed_batch_sizes entries must be positive and monotonically "
+            "increasing");
+      }
+      last_size = size;
+    }
+    if (last_size != options.max_batch_size) {
+      return errors::InvalidArgument(
+          "Final entry in allowed_batch_sizes must equal max_batch_size");
+    }
+  }
+  internal::DBSQueue<TaskType>* DBS_queue_raw;
+  queue->reset(DBS_queue_raw = new internal::DBSQueue<TaskType>(
+                   this->shared_from_this(), options));
+  mutex_lock l(mu_);
+  queues_and_callbacks_[DBS_queue_raw] = process_batch_callback;
+  return OkStatus();
+}
+
+template <typename TaskType>
+void DeadlineBatchScheduler<TaskType>::RemoveQueue(
+    const internal::DBSQueue<TaskType>* queue) {
+  mutex_lock l(mu_);
+  queues_and_callbacks_.erase(const_cast<internal::DBSQueue<TaskType>*>(queue));
+}
+
+template <typename TaskType>
+void DeadlineBatchScheduler<TaskType>::NotifyTaskScheduled() {
+  // Taking the lock makes sure that a batch thread either sees the task or is
+  // already waiting for the notification.
+  mutex_lock l(mu_);
+  schedulable_batch_cv_.notify_one();
+}
+
+template <typename TaskType>
+void DeadlineBatchScheduler<TaskType>::ProcessBatches() {
+  for (;;) {
+    std::unique_ptr<Batch<TaskType>> batch;
+    BatchProcessor callback;
+    {
+      mutex_lock l(mu_);
+      if (shutting_down_) break;
+      const int64_t now = env()->NowMicros();
+      // Picks the due queue with high priority work first, then the one with
+      // the earliest deadline.
+      internal::DBSQueue<TaskType>* best_queue = nullptr;
+      typename internal::DBSQueue<TaskType>::Urgency best_urgency;
+      int64_t next_due_time = std::numeric_limits<int64_t>::max();
+      for (const auto& queue_and_callback : queues_and_callbacks_) {
+        const auto urgency = queue_and_callback.first->GetUrgency(now);
+        if (urgency.due_time > now) {
+          next_due_time = std::min(next_due_time, urgency.due_time);
+          continue;
+        }
+        if (best_queue == nullptr ||
+            urgency.high_priority > best_urgency.high_priority ||
+            (urgency.high_priority == best_urgency.high_priority &&
+             urgency.earliest_deadline < best_urgency.earliest_deadline)) {
+          best_queue = queue_and_callback.first;
+          best_urgency = urgency;
+        }
+      }
+      if (best_queue == nullptr) {
+        // Waits for a new task, or until the next batch is due. The wait is
+        // bounded since the deadlines follow env(), which may not be the
+        // clock of the condition variable.
+        const int64_t wait_micros =
+            std::min(next_due_time - now, options_.max_idle_sleep_micros);
+        schedulable_batch_cv_.wait_for(l,
+                                       std::chrono::microseconds(wait_micros));
+        continue;
+      }
+      batch = best_queue->FormBatch(best_urgency.high_priority);
+      callback = queues_and_callbacks_[best_queue];
+    }
+    if (batch != nullptr) {
+      callback(std::move(batch));
+    }
+  }
+}
+
+// ---------------- DBSQueue ----------------
+
+namespace internal {
+template <typename TaskType>
+DBSQueue<TaskType>::DBSQueue(
+    std::shared_ptr<DeadlineBatchScheduler<TaskType>> scheduler,
+    const QueueOptions& options)
+    : scheduler_(scheduler), options_(options) {}
+
+template <typename TaskType>
+DBSQueue<TaskType>::~DBSQueue() {
+  // Wait until the last task has been scheduled.
+  const int kSleepMicros = 1000;
+  for (;;) {
+    {
+      mutex_lock l(mu_);
+      if (high_priority_tasks_.empty() && low_priority_tasks_.empty()) {
+        break;
+      }
+    }
+    scheduler_->env()->SleepForMicroseconds(kSleepMicros);
+  }
+  scheduler_->RemoveQueue(this);
+}
+
+template <typename TaskType>
+Status DBSQueue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
+  const size_t size = (*task)->size();
+  if (size > static_cast<size_t>(options_.max_batch_size)) {
+    return errors::InvalidArgument("Task size ", size,
+                                   " is larger than maximum batch size ",
+                                   options_.max_batch_size);
+  }
+  const bool low_priority =
+      options_.is_low_priority && options_.is_low_priority(**task);
+  int64_t deadline_micros =
+      options_.get_deadline_micros ? options_.get_deadline_micros(**task) : 0;
+  if (deadline_micros <= 0) {
+    deadline_micros = scheduler_->env()->NowMicros() +
+                      (low_priority ? options_.low_priority_batch_timeout_micros
+                                    : options_.batch_timeout_micros);
+  }
+
+  {
+    mutex_lock l(mu_);
+    std::vector<PendingTask>* tasks =
+        low_priority ? &low_priority_tasks_ : &high_priority_tasks_;
+    size_t* tasks_size =
+        low_priority ? &low_priority_size_ : &high_priority_size_;
+    if (*tasks_size + size >
+        static_cast<size_t>(options_.max_enqueued_batches) *
+            options_.max_batch_size) {
+      return errors::Unavailable("The batch scheduling queue is full");
+    }
+    tasks->push_back(
+        {deadline_micros, next_sequence_number_++, std::move(*task)});
+    std::push_heap(tasks->begin(), tasks->end(), &DBSQueue::LaterDeadline);
+    *tasks_size += size;
+  }
+  scheduler_->NotifyTaskScheduled();
+  return OkStatus();
+}
+
+template <typename TaskType>
+int64_t DBSQueue<TaskType>::DueTime(const std::vector<PendingTask>& tasks,
+                                    size_t tasks_size) const {
+  if (tasks.empty()) return std::numeric_limits<int64_t>::max();
+  if (tasks_size >= static_cast<size_t>(options_.max_batch_size)) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  return tasks.front().deadline_micros - options_.batch_processing_micros;
+}
+
+template <typename TaskType>
+typename DBSQueue<TaskType>::Urgency DBSQueue<TaskType>::GetUrgency(
+    int64_t now) const {
+  mutex_lock l(mu_);
+  Urgency urgency;
+  const int64_t high_due_time =
+      DueTime(high_priority_tasks_, high_priority_size_);
+  const int64_t low_due_time = DueTime(low_priority_tasks_, low_priority_size_);
+  if (!high_priority_tasks_.empty() &&
+      (high_due_time <= now || low_due_time > now)) {
+    urgency.high_priority = true;
+    urgency.earliest_deadline = high_priority_tasks_.front().deadline_micros;
+    // Wakes up for whichever batch comes due first.
+    urgency.due_time = std::min(high_due_time, low_due_time);
+  } else if (!low_priority_tasks_.empty()) {
+    urgency.earliest_deadline = low_priority_tasks_.front().deadline_micros;
+    urgency.due_time = low_due_time;
+  }
+  return urgency;
+}
+
+template <typename TaskType>
+void DBSQueue<TaskType>::TakeTasks(std::vector<PendingTask>* tasks,
+                                   size_t* tasks_size, size_t size_limit,
+                                   Batch<TaskType>* batch) {
+  while (!tasks->empty() &&
+         batch->size() + tasks->front().task->size() <= size_limit) {
+    std::pop_heap(tasks->begin(), tasks->end(), &DBSQueue::LaterDeadline);
+    *tasks_size -= tasks->back().task->size();
+    batch->AddTask(std::move(tasks->back().task));
+    tasks->pop_back();
+  }
+}
+
+template <typename TaskType>
+size_t DBSQueue<TaskType>::PaddedBatchSize(size_t batch_size) const {
+  for (const int32 allowed_size : options_.allowed_batch_sizes) {
+    if (static_cast<size_t>(allowed_size) >= batch_size) {
+      return allowed_size;
+    }
+  }
+  return batch_size;
+}
+
+template <typename TaskType>
+std::unique_ptr<Batch<TaskType>> DBSQueue<TaskType>::FormBatch(
+    bool high_priority) {
+  mutex_lock l(mu_);
+  if ((high_priority ? high_priority_tasks_ : low_priority_tasks_).empty()) {
+    return nullptr;
+  }
+  auto batch = std::make_unique<Batch<TaskType>>();
+  if (high_priority) {
+    TakeTasks(&high_priority_tasks_, &high_priority_size_,
+              options_.max_batch_size, batch.get());
+    // Low priority tasks ride along in the padding.
+    TakeTasks(&low_priority_tasks_, &low_priority_size_,
+              PaddedBatchSize(batch->size()), batch.get());
+  } else {
+    TakeTasks(&low_priority_tasks_, &low_priority_size_,
+              options_.max_batch_size, batch.get());
+  }
+  batch->Close();
+  return batch;
+}
+
+template <typename TaskType>
+size_t DBSQueue<TaskType>::NumEnqueuedTasks() const {
+  mutex_lock l(mu_);
+  return high_priority_tasks_.size() + low_priority_tasks_.size();
+}
+
+template <typename TaskType>
+size_t DBSQueue<TaskType>::SchedulingCapacity() const {
+  mutex_lock l(mu_);
+  return static_cast<size_t>(options_.max_enqueued_batches) *
+             options_.max_batch_size -
+         high_priority_size_;
+}
+}  // namespace internal
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_BATCHING_UTIL_DEADLINE_BATCH_SCHEDULER_H_
@@ -0,0 +1,408 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/batching_util/deadline_batch_scheduler.h"
+
+#include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace serving {
+namespace anonymous {
+
+class FakeTask : public BatchTask {
+ public:
+  FakeTask(size_t size, int64_t deadline_micros, bool low_priority)
+      : size_(size),
+        deadline_micros_(deadline_micros),
+        low_priority_(low_priority) {}
+
+  ~FakeTask() override = default;
+
+  size_t size() const override { return size_; }
+  int64_t deadline_micros() const { return deadline_micros_; }
+  bool low_priority() const { return low_priority_; }
+
+ private:
+  const size_t size_;
+  const int64_t deadline_micros_;
+  const bool low_priority_;
+
+  FakeTask(const FakeTask&) = delete;
+  void operator=(const FakeTask&) = delete;
+};
+
+using Scheduler = DeadlineBatchScheduler<FakeTask>;
+
+// Creates a FakeTask and calls 'scheduler->Schedule()' on that task. Returns
+// the resulting status.
+Status ScheduleTask(size_t task_size, int64_t deadline_micros,
+                    bool low_priority, BatchScheduler<FakeTask>* scheduler) {
+  std::unique_ptr<FakeTask> task(
+      new FakeTask(task_size, deadline_micros, low_priority));
+  Status status = scheduler->Schedule(&task);
+  // Schedule() should have consumed 'task' iff it returned Status::OK.
+  CHECK_EQ(status.ok(), task == nullptr);
+  return status;
+}
+
+Scheduler::QueueOptions DefaultQueueOptions() {
+  Scheduler::QueueOptions options;
+  options.get_deadline_micros = [](const FakeTask& task) {
+    return task.deadline_micros();
+  };
+  options.is_low_priority = [](const FakeTask& task) {
+    return task.low_priority();
+  };
+  return options;
+}
+
+// Creates a thread that waits on 'start' and then advances the fake clock in
+// 'env' in a loop until 'stop' is notified. Useful for allowing objects that
+// use the clock to be destroyed.
+std::unique_ptr<Thread> CreateFakeClockAdvancerThread(
+    test_util::FakeClockEnv* env, Notification* start, Notification* stop) {
+  return std::unique_ptr<Thread>(Env::Default()->StartThread(
+      {}, "FakeClockAdvancerThread", [env, start, stop] {
+        start->WaitForNotification();
+        while (!stop->HasBeenNotified()) {
+          env->AdvanceByMicroseconds(10);
+          Env::Default()->SleepForMicroseconds(10);
+        }
+      }));
+}
+
+// Records, for each processed batch, the deadlines of its tasks.
+class BatchRecorder {
+ public:
+  Scheduler::BatchProcessor Callback() {
+    return [this](std::unique_ptr<Batch<FakeTask>> batch) {
+      ASSERT_TRUE(batch->IsClosed());
+      std::vector<int64_t> deadlines;
+      for (int i = 0; i < batch->num_tasks(); ++i) {
+        deadlines.push_back(batch->task(i).deadline_micros());
+      }
+      mutex_lock l(mu_);
+      batches_.push_back(std::move(deadlines));
+    };
+  }
+
+  std::vector<std::vector<int64_t>> batches() {
+    mutex_lock l(mu_);
+    return batches_;
+  }
+
+  // Waits until at least 'num_batches' batches were processed.
+  void WaitForBatches(size_t num_batches) {
+    while (batches().size() < num_batches) {
+      Env::Default()->SleepForMicroseconds(100);
+    }
+  }
+
+ private:
+  mutex mu_;
+  std::vector<std::vector<int64_t>> batches_ TF_GUARDED_BY(mu_);
+};
+
+TEST(DeadlineBatchSchedulerTest, BadOptions) {
+  std::shared_ptr<Scheduler> scheduler;
+  Scheduler::Options options;
+  options.num_batch_threads = 0;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+  options = Scheduler::Options();
+  options.max_idle_sleep_micros = 0;
+  EXPECT_FALSE(Scheduler::Create(options, &scheduler).ok());
+
+  TF_ASSERT_OK(Scheduler::Create(Scheduler::Options(), &scheduler));
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {};
+  std::unique_ptr<BatchScheduler<FakeTask>> queue;
+  Scheduler::QueueOptions queue_options;
+  queue_options.max_batch_size = 0;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options = Scheduler::QueueOptions();
+  queue_options.max_enqueued_batches = 0;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options = Scheduler::QueueOptions();
+  queue_options.batch_processing_micros = -1;
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options = Scheduler::QueueOptions();
+  queue_options.max_batch_size = 8;
+  queue_options.allowed_batch_sizes = {4, 2, 8};
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options.allowed_batch_sizes = {2, 4};
+  EXPECT_FALSE(scheduler->AddQueue(queue_options, callback, &queue).ok());
+  queue_options.allowed_batch_sizes = {2, 4, 8};
+  TF_EXPECT_OK(scheduler->AddQueue(queue_options, callback, &queue));
+}
+
+TEST(DeadlineBatchSchedulerTest, EarliestDeadlineFirst) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    std::unique_ptr<BatchScheduler<FakeTask>> queue1;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue3;
+    TF_ASSERT_OK(scheduler->AddQueue(DefaultQueueOptions(),
+                                     recorder.Callback(), &queue1));
+    TF_ASSERT_OK(scheduler->AddQueue(DefaultQueueOptions(),
+                                     recorder.Callback(), &queue2));
+    TF_ASSERT_OK(scheduler->AddQueue(DefaultQueueOptions(),
+                                     recorder.Callback(), &queue3));
+    TF_ASSERT_OK(ScheduleTask(10, 500, false, queue1.get()));
+    TF_ASSERT_OK(ScheduleTask(10, 200, false, queue2.get()));
+    TF_ASSERT_OK(ScheduleTask(10, 800, false, queue3.get()));
+    TF_ASSERT_OK(ScheduleTask(10, 300, false, queue2.get()));
+    // Release the batch processing thread once all three batches are due.
+    env.AdvanceByMicroseconds(1000);
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(recorder.batches(), (std::vector<std::vector<int64_t>>{
+                                    {200, 300}, {500}, {800}}));
+}
+
+TEST(DeadlineBatchSchedulerTest, HighPriorityFirst) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    std::unique_ptr<BatchScheduler<FakeTask>> bulk_queue;
+    std::unique_ptr<BatchScheduler<FakeTask>> critical_queue;
+    TF_ASSERT_OK(scheduler->AddQueue(DefaultQueueOptions(),
+                                     recorder.Callback(), &bulk_queue));
+    TF_ASSERT_OK(scheduler->AddQueue(DefaultQueueOptions(),
+                                     recorder.Callback(), &critical_queue));
+    TF_ASSERT_OK(ScheduleTask(10, 100, true, bulk_queue.get()));
+    TF_ASSERT_OK(ScheduleTask(10, 900, false, critical_queue.get()));
+    env.AdvanceByMicroseconds(1000);
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(recorder.batches(),
+            (std::vector<std::vector<int64_t>>{{900}, {100}}));
+}
+
+TEST(DeadlineBatchSchedulerTest, LowPriorityFillsPadding) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.max_batch_size = 8;
+    queue_options.allowed_batch_sizes = {2, 4, 8};
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback(), &queue));
+    TF_ASSERT_OK(ScheduleTask(3, 500, false, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, 5000, true, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, 6000, true, queue.get()));
+    EXPECT_EQ(3, queue->NumEnqueuedTasks());
+    // The high priority task is padded to 4, and the most urgent low priority
+    // task takes the padding slot. The other one follows once it is due.
+    env.AdvanceByMicroseconds(1000);
+    recorder.WaitForBatches(1);
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(recorder.batches(),
+            (std::vector<std::vector<int64_t>>{{500, 5000}, {6000}}));
+}
+
+TEST(DeadlineBatchSchedulerTest, DueLowPriorityNotStarved) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.max_batch_size = 8;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback(), &queue));
+    // High priority tasks keep arriving, but none of them is due yet.
+    TF_ASSERT_OK(ScheduleTask(1, 20000, false, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, 100, true, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, 200, true, queue.get()));
+    env.AdvanceByMicroseconds(1000);
+    TF_ASSERT_OK(ScheduleTask(1, 21000, false, queue.get()));
+    // The overdue low priority tasks go out on their own.
+    recorder.WaitForBatches(1);
+    EXPECT_EQ(recorder.batches(),
+              (std::vector<std::vector<int64_t>>{{100, 200}}));
+    EXPECT_EQ(2, queue->NumEnqueuedTasks());
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(recorder.batches(),
+            (std::vector<std::vector<int64_t>>{{100, 200}, {20000, 21000}}));
+}
+
+TEST(DeadlineBatchSchedulerTest, ScheduleWakesBatchThread) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    // Without a wakeup, the full batch would wait for an hour.
+    options.max_idle_sleep_micros = 3600LL * 1000 * 1000;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.max_batch_size = 2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback(), &queue));
+    // Let the batch thread go idle.
+    Env::Default()->SleepForMicroseconds(10000);
+    TF_ASSERT_OK(ScheduleTask(1, 1000000, false, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(1, 1000001, false, queue.get()));
+    recorder.WaitForBatches(1);
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(recorder.batches(),
+            (std::vector<std::vector<int64_t>>{{1000000, 1000001}}));
+}
+
+TEST(DeadlineBatchSchedulerTest, FullBatchBeforeDeadline) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.max_batch_size = 4;
+    // Deadlines are far away, but a full batch goes out right away.
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback(), &queue));
+    for (int i = 0; i < 5; ++i) {
+      TF_ASSERT_OK(ScheduleTask(1, 1000000 + i, false, queue.get()));
+    }
+    recorder.WaitForBatches(1);
+    EXPECT_EQ(recorder.batches(),
+              (std::vector<std::vector<int64_t>>{
+                  {1000000, 1000001, 1000002, 1000003}}));
+    EXPECT_EQ(1, queue->NumEnqueuedTasks());
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+  EXPECT_EQ(2, recorder.batches().size());
+}
+
+TEST(DeadlineBatchSchedulerTest, BatchProcessingMicros) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  BatchRecorder recorder;
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.batch_processing_micros = 500;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(
+        scheduler->AddQueue(queue_options, recorder.Callback(), &queue));
+    // Due at 1000 - 500, so it goes out on the first wakeup.
+    TF_ASSERT_OK(ScheduleTask(1, 1400, false, queue.get()));
+    env.AdvanceByMicroseconds(1000);
+    recorder.WaitForBatches(1);
+    EXPECT_EQ(recorder.batches(), (std::vector<std::vector<int64_t>>{{1400}}));
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST(DeadlineBatchSchedulerTest, QueueCapacity) {
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+  {
+    Scheduler::Options options;
+    options.env = &env;
+    options.num_batch_threads = 1;
+    std::shared_ptr<Scheduler> scheduler;
+    TF_ASSERT_OK(Scheduler::Create(options, &scheduler));
+    Scheduler::QueueOptions queue_options = DefaultQueueOptions();
+    queue_options.max_batch_size = 10;
+    queue_options.max_enqueued_batches = 2;
+    std::unique_ptr<BatchScheduler<FakeTask>> queue;
+    TF_ASSERT_OK(scheduler->AddQueue(
+        queue_options, [](std::unique_ptr<Batch<FakeTask>> batch) {}, &queue));
+    EXPECT_EQ(20, queue->SchedulingCapacity());
+    EXPECT_EQ(error::INVALID_ARGUMENT,
+              ScheduleTask(11, 100, false, queue.get()).code());
+    TF_ASSERT_OK(ScheduleTask(10, 100, false, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(5, 100, false, queue.get()));
+    EXPECT_EQ(5, queue->SchedulingCapacity());
+    EXPECT_EQ(error::UNAVAILABLE,
+              ScheduleTask(6, 100, false, queue.get()).code());
+    // Low priority tasks have a capacity of their own.
+    TF_ASSERT_OK(ScheduleTask(10, 100, true, queue.get()));
+    TF_ASSERT_OK(ScheduleTask(5, 100, false, queue.get()));
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+}  // namespace anonymous
+}  // namespace serving
+}  // namespace tensorflow
@@ -14,14 +14,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -36,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
@@ -65,15 +69,38 @@ constexpr char kCreatedAt[] = "Created at";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
+constexpr char kPartialCache[] = "partial_cache";
 constexpr char kIndex[] = "index";
+constexpr char kInputPosition[] = "input_position";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+constexpr char kSpillMemoryCacheExperiment[] = "spill_memory_cache";
+constexpr char kSpillDirectoryEnvVar[] = "TF_DATA_CACHE_SPILL_DIR";
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
     "contents of the dataset  will be discarded. This can happen if you have "
     "an input pipeline similar to `dataset.cache().take(k).repeat()`. You "
     "should use `dataset.take(k).cache().repeat()` instead.";
+
+// Returns the directory that in-memory caches spill elements to when they
+// exceed the RAM budget: `TF_DATA_CACHE_SPILL_DIR` if set and the first local
+// temporary directory otherwise.
+std::string GetSpillDirectory(Env* env) {
+  std::string spill_directory;
+  Status s = ReadStringFromEnvVar(kSpillDirectoryEnvVar, "", &spill_directory);
+  if (!s.ok()) {
+    LOG(ERROR) << s;
+  }
+  if (spill_directory.empty()) {
+    std::vector<std::string> temp_directories;
+    env->GetLocalTempDirectories(&temp_directories);
+    if (!temp_directories.empty()) {
+      spill_directory = temp_directories.front();
+    }
+  }
+  return spill_directory;
+}
 }  // namespace
 
 class PartialCache {
@@ -767,7 +794,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     return input_->Cardinality(options);
   };
 
-  Status Get(OpKernelContext* ctx, int64 index,
+  Status Get(AnyContext ctx, int64 index,
              std::vector<Tensor>* out_tensors) const override {
     mutex_lock l(mu_);
 
@@ -783,7 +810,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     if (!partial_cache_) {
       partial_cache_ = std::make_unique<PartialCache>(input_);
     }
-    return partial_cache_->Get(ctx, index, out_tensors);
+    if (ctx.op_kernel_context == nullptr) {
+      return errors::Unimplemented(
+          "Random access to a cached dataset is only supported by the "
+          "`GetElementAtIndex` op.");
+    }
+    return partial_cache_->Get(ctx.op_kernel_context, index, out_tensors);
   }
 
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
@@ -803,7 +835,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
     Status Initialize(IteratorContext* ctx) override {
       mutex_lock l(mu_);
-      return InitializeIterator(ctx);
+      return InitializeIterator(ctx, /*restored_reader=*/false);
     }
 
     Status GetNextInternal(IteratorContext* ctx,
@@ -825,8 +857,12 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       if (cache_->IsCompleted()) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCacheCompleted, ""));
+        std::vector<std::vector<Tensor>> elements;
+        TF_RETURN_IF_ERROR(cache_->GetAll(&elements));
         TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+            WriteElementsToCheckpoint(writer, prefix(), elements));
+      } else if (!is_writer_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kPartialCache, ""));
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -840,27 +876,39 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         std::vector<std::vector<Tensor>> temp_cache;
         TF_RETURN_IF_ERROR(
             ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
-        cache_->Complete(std::move(temp_cache));
+        TF_RETURN_IF_ERROR(cache_->Complete(std::move(temp_cache)));
       }
-      TF_RETURN_IF_ERROR(InitializeIterator(ctx));
+      TF_RETURN_IF_ERROR(InitializeIterator(
+          ctx, /*restored_reader=*/reader->Contains(prefix(), kPartialCache)));
       return RestoreInput(ctx, reader, iterator_);
     }
 
    private:
     class MemoryWriterIterator : public DatasetIterator<MemoryDatasetBase> {
      public:
-      explicit MemoryWriterIterator(const Params& params, MemoryCache* cache)
-          : DatasetIterator<MemoryDatasetBase>(params), cache_(cache) {}
+      explicit MemoryWriterIterator(const Params& params, MemoryCache* cache,
+                                    int64_t writer_id)
+          : DatasetIterator<MemoryDatasetBase>(params),
+            cache_(cache),
+            writer_id_(writer_id) {}
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
+        if (num_cached_ > 0 && !cache_->IsCompleted()) {
           LOG(WARNING) << kIncompleteCacheErrorMessage;
-          cache_->Reset();
         }
+        cache_->ReleaseWriter(writer_id_);
       }
 
       Status Initialize(IteratorContext* ctx) override {
+        if (ctx->ram_budget_manager() != nullptr &&
+            GetExperiments().contains(kSpillMemoryCacheExperiment)) {
+          std::string spill_directory = GetSpillDirectory(ctx->env());
+          if (!spill_directory.empty()) {
+            cache_->EnableSpilling(ctx->ram_budget_manager(), ctx->env(),
+                                   spill_directory);
+          }
+        }
         return dataset()->input_->MakeIterator(ctx, this, prefix(),
                                                &input_impl_);
       }
@@ -874,16 +922,21 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         if (*end_of_sequence) {
           if (!cache_->IsCompleted()) {
             VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
+            cache_->Complete(writer_id_);
           }
           return OkStatus();
         }
-        RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        bool in_memory = false;
+        TF_RETURN_IF_ERROR(cache_->Append(writer_id_, *out_tensors,
+                                          &in_memory));
+        if (in_memory) {
+          RecordBufferEnqueue(ctx, *out_tensors);
+        }
+        ++num_cached_;
+        if (num_cached_ == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          cache_->Complete(writer_id_);
         }
         return OkStatus();
       }
@@ -899,8 +952,17 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         if (!cache_->IsCompleted()) {
+          std::vector<std::vector<Tensor>> temp_cache;
+          TF_RETURN_IF_ERROR(cache_->GetAll(&temp_cache));
           TF_RETURN_IF_ERROR(
-              WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+              WriteElementsToCheckpoint(writer, prefix(), temp_cache));
+          // If another iterator populates the cache when this checkpoint is
+          // restored, it is restored into a MemoryReaderIterator, which
+          // resumes from this position of the input.
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(prefix(), kIndex, num_cached_));
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(prefix(), kInputPosition, num_cached_));
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -909,8 +971,14 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
         if (!reader->Contains(prefix(), kCacheCompleted)) {
+          std::vector<std::vector<Tensor>> temp_cache;
           TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache_));
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
+          for (const std::vector<Tensor>& element : temp_cache) {
+            bool in_memory = false;
+            TF_RETURN_IF_ERROR(cache_->Append(writer_id_, element, &in_memory));
+          }
+          num_cached_ = temp_cache.size();
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
@@ -919,15 +987,23 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
-      std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      const int64_t writer_id_;
+      int64_t num_cached_ TF_GUARDED_BY(mu_) = 0;
     };  // MemoryWriterIterator
 
+    // Reads elements from the cache. If the cache is still being populated by
+    // another iterator, reads the cached prefix and then falls back to its own
+    // input iterator once it gets ahead of the writer. This is only correct if
+    // the input produces the same elements in each iteration, so otherwise
+    // (`input_only`) the iterator reads its own input from the start.
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
      public:
-      explicit MemoryReaderIterator(const Params& params, MemoryCache* cache)
+      explicit MemoryReaderIterator(const Params& params, MemoryCache* cache,
+                                    bool input_only)
           : DatasetIterator<MemoryDatasetBase>(params),
             cache_(cache),
-            index_(0) {}
+            index_(0),
+            input_only_(input_only) {}
 
       Status Initialize(IteratorContext* ctx) override {
         // The memory allocated for the cache is owned by the parent
@@ -936,8 +1012,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         // is that this is incorrect if there are concurrent instances of this
         // iterator.
         tf_shared_lock l(mu_);
+        std::vector<Tensor> element;
         for (size_t i = 0; i < cache_->size(); ++i) {
-          RecordBufferEnqueue(ctx, cache_->at(i));
+          if (cache_->GetIfInMemory(i, &element)) {
+            RecordBufferEnqueue(ctx, element);
+          }
         }
         return OkStatus();
       }
@@ -946,17 +1025,30 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
+        *end_of_sequence = false;
+        if (input_only_) {
+          return GetNextFromInput(ctx, out_tensors, end_of_sequence);
+        }
         if (index_ < cache_->size()) {
-          const std::vector<Tensor>& cache_tensors = cache_->at(index_);
-          out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
-                              cache_tensors.end());
-          index_++;
-          *end_of_sequence = false;
-          return OkStatus();
-        } else {
+          std::vector<Tensor> cache_tensors;
+          Status s = cache_->Get(index_, &cache_tensors);
+          if (s.ok()) {
+            out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
+                                cache_tensors.end());
+            index_++;
+            return OkStatus();
+          }
+          // The cache may have been discarded concurrently, in which case we
+          // fall back to reading the input.
+          if (!errors::IsOutOfRange(s)) {
+            return s;
+          }
+        }
+        if (cache_->IsCompleted() && index_ >= cache_->size()) {
           *end_of_sequence = true;
           return OkStatus();
         }
+        return GetNextFromInput(ctx, out_tensors, end_of_sequence);
       }
 
      protected:
@@ -970,6 +1062,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kIndex, index_));
+        if (input_impl_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(prefix(), kInputPosition, input_position_));
+          TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+        }
         return OkStatus();
       }
 
@@ -985,27 +1082,88 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
           }
           index_ = static_cast<size_t>(temp);
         }
+        input_impl_.reset();
+        input_position_ = 0;
+        // An iterator that read its own input continues to do so, unless the
+        // input is deterministic, in which case the cache can serve it.
+        input_only_ = reader->Contains(prefix(), kInputPosition) &&
+                      !IsKnownDeterministic(*dataset()->input_);
+        if (reader->Contains(prefix(), kInputPosition)) {
+          int64_t temp;
+          TF_RETURN_IF_ERROR(
+              reader->ReadScalar(prefix(), kInputPosition, &temp));
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, prefix(), &input_impl_));
+          TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+          input_position_ = static_cast<size_t>(temp);
+        }
         return OkStatus();
       }
 
      private:
+      Status GetNextFromInput(IteratorContext* ctx,
+                              std::vector<Tensor>* out_tensors,
+                              bool* end_of_sequence)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (!input_impl_) {
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, prefix(), &input_impl_));
+          input_position_ = 0;
+        }
+        // Elements read from the cache have not been consumed from the input.
+        while (input_position_ < index_) {
+          int num_skipped;
+          TF_RETURN_IF_ERROR(input_impl_->Skip(
+              ctx,
+              static_cast<int>(std::min<size_t>(
+                  index_ - input_position_, std::numeric_limits<int>::max())),
+              end_of_sequence, &num_skipped));
+          input_position_ += num_skipped;
+          if (*end_of_sequence) {
+            return OkStatus();
+          }
+        }
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (!*end_of_sequence) {
+          index_++;
+          input_position_++;
+        }
+        return OkStatus();
+      }
+
       mutex mu_;
       MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
       size_t index_ TF_GUARDED_BY(mu_);
+      // Only created if the reader gets ahead of the writer of the cache.
+      std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+      // Number of elements consumed from `input_impl_`.
+      size_t input_position_ TF_GUARDED_BY(mu_) = 0;
+      // Whether to ignore the cache, which another iterator populates from a
+      // nondeterministic input.
+      bool input_only_ TF_GUARDED_BY(mu_);
     };  // MemoryReaderIterator
 
-    Status InitializeIterator(IteratorContext* ctx)
+    // Creates a reader if the cache is completed or populated by another
+    // iterator (or if restoring such a reader) and a writer otherwise.
+    Status InitializeIterator(IteratorContext* ctx, bool restored_reader)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-      if (cache_->IsCompleted()) {
-        iterator_ = std::make_unique<MemoryReaderIterator>(
-            MemoryReaderIterator::Params{dataset(),
-                                         strings::StrCat(prefix(), kImpl)},
-            cache_);
-      } else {
+      const bool completed = cache_->IsCompleted();
+      const int64_t writer_id =
+          completed || restored_reader ? 0 : cache_->AcquireWriter();
+      is_writer_ = writer_id != 0;
+      if (is_writer_) {
         iterator_ = std::make_unique<MemoryWriterIterator>(
             MemoryWriterIterator::Params{dataset(),
                                          strings::StrCat(prefix(), kImpl)},
-            cache_);
+            cache_, writer_id);
+      } else {
+        const bool input_only =
+            !completed && !IsKnownDeterministic(*dataset()->input_);
+        iterator_ = std::make_unique<MemoryReaderIterator>(
+            MemoryReaderIterator::Params{dataset(),
+                                         strings::StrCat(prefix(), kImpl)},
+            cache_, input_only);
       }
       TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
       return iterator_->Initialize(ctx);
@@ -1014,6 +1172,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     mutex mu_;
     MemoryCache* cache_ TF_GUARDED_BY(mu_);  // not owned.
     std::unique_ptr<IteratorBase> iterator_ TF_GUARDED_BY(mu_);
+    bool is_writer_ TF_GUARDED_BY(mu_) = false;
   };  // MemoryIterator
 
   mutable mutex mu_;
@@ -11,12 +11,16 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
@@ -370,6 +374,160 @@ INSTANTIATE_TEST_CASE_P(CacheDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(CacheDatasetOpTest, MemoryCacheReadWhileWriting) {
+  auto dataset_params = CacheDatasetParams3();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  EXPECT_TRUE(IsKnownDeterministic(*dataset_));
+  auto expected_outputs = CreateTensors<int64_t>(
+      TensorShape({3, 1}), {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+
+  // `iterator_` populates the cache.
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+
+  // A concurrent iterator reads the cached element and then gets ahead of the
+  // writer.
+  std::unique_ptr<IteratorBase> reader;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &reader));
+  std::vector<Tensor> reader_outputs;
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(reader->GetNext(iterator_ctx_.get(), &reader_outputs,
+                                 &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(reader_outputs, expected_outputs,
+                           /*compare_order=*/true));
+
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
+TEST_F(CacheDatasetOpTest, MemoryCacheNondeterministicInput) {
+  Options options;
+  options.set_deterministic(false);
+  auto dataset_params = CacheDatasetParams(
+      OptionsDatasetParams(
+          TensorSliceDatasetParams(
+              /*components=*/{CreateTensor<int64_t>(
+                  TensorShape{3, 3, 1}, {0, 1, 2, 3, 4, 5, 6, 7, 8})},
+              /*node_name=*/"tensor_slice"),
+          options.SerializeAsString(),
+          /*output_dtypes=*/{DT_INT64},
+          /*output_shapes=*/{PartialTensorShape({3, 1})},
+          /*node_name=*/"options"),
+      /*filename=*/"",
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({3, 1})}, kNodeName);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  EXPECT_FALSE(IsKnownDeterministic(*dataset_));
+  auto expected_outputs = CreateTensors<int64_t>(
+      TensorShape({3, 1}), {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+
+  // `iterator_` populates the cache.
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence));
+  ASSERT_FALSE(end_of_sequence);
+
+  // A concurrent iterator reads its own input rather than the cached prefix,
+  // which may hold other elements than its input produces.
+  std::unique_ptr<IteratorBase> reader;
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &reader));
+  std::vector<Tensor> reader_outputs;
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(reader->GetNext(iterator_ctx_.get(), &reader_outputs,
+                                 &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(reader_outputs, expected_outputs,
+                           /*compare_order=*/true));
+
+  end_of_sequence = false;
+  while (!end_of_sequence) {
+    TF_ASSERT_OK(iterator_->GetNext(iterator_ctx_.get(), &out_tensors,
+                                    &end_of_sequence));
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
+TEST(MemoryCacheTest, SpillsElementsOverRamBudget) {
+  auto ram_budget_manager = std::make_shared<model::RamBudgetManager>(
+      /*budget=*/2 * sizeof(int64_t) + 1);
+  MemoryCache cache;
+  cache.EnableSpilling(ram_budget_manager, Env::Default(), testing::TmpDir());
+
+  const int64_t writer_id = cache.AcquireWriter();
+  ASSERT_GT(writer_id, 0);
+  EXPECT_EQ(cache.AcquireWriter(), 0);
+  for (int64_t i = 0; i < 5; ++i) {
+    bool in_memory = false;
+    TF_ASSERT_OK(cache.Append(
+        writer_id, {CreateTensor<int64_t>(TensorShape({}), {i})}, &in_memory));
+    EXPECT_EQ(in_memory, i < 2);
+  }
+  EXPECT_EQ(cache.size(), 5);
+  EXPECT_EQ(cache.num_spilled(), 3);
+  EXPECT_EQ(ram_budget_manager->AvailableModelRam(), 1);
+
+  // Spilled elements are readable before the cache is completed.
+  for (int64_t i = 0; i < 5; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(cache.Get(i, &element));
+    ASSERT_EQ(element.size(), 1);
+    TF_EXPECT_OK(DatasetOpsTestBase::ExpectEqual(
+        element[0], CreateTensor<int64_t>(TensorShape({}), {i})));
+    EXPECT_EQ(cache.GetIfInMemory(i, &element), i < 2);
+  }
+  cache.Complete(writer_id);
+  EXPECT_TRUE(cache.IsCompleted());
+  std::vector<std::vector<Tensor>> elements;
+  TF_ASSERT_OK(cache.GetAll(&elements));
+  EXPECT_EQ(elements.size(), 5);
+
+  cache.Reset();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(ram_budget_manager->AvailableModelRam(), 2 * sizeof(int64_t) + 1);
+  std::vector<Tensor> element;
+  EXPECT_TRUE(errors::IsOutOfRange(cache.Get(0, &element)));
+}
+
+TEST(MemoryCacheTest, ReleasingIncompleteCacheDiscardsIt) {
+  MemoryCache cache;
+  const int64_t writer_id = cache.AcquireWriter();
+  bool in_memory = false;
+  TF_ASSERT_OK(cache.Append(
+      writer_id, {CreateTensor<int64_t>(TensorShape({}), {0})}, &in_memory));
+  EXPECT_TRUE(in_memory);
+  EXPECT_EQ(cache.size(), 1);
+  cache.ReleaseWriter(writer_id);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_FALSE(cache.IsCompleted());
+
+  // A writer invalidated by `Reset()` can no longer append.
+  const int64_t new_writer_id = cache.AcquireWriter();
+  ASSERT_GT(new_writer_id, 0);
+  cache.Reset();
+  TF_ASSERT_OK(cache.Append(new_writer_id,
+                            {CreateTensor<int64_t>(TensorShape({}), {0})},
+                            &in_memory));
+  EXPECT_FALSE(in_memory);
+  EXPECT_EQ(cache.size(), 0);
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
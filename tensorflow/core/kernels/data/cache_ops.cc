@@ -14,33 +14,184 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kSegmentFilePrefix[] = "tf_data_cache";
+constexpr char kSegmentFileSuffix[] = ".segment";
+
+// Reads the element stored at `spilled_offset` in the segment `file`.
+Status ReadSpilledElement(RandomAccessFile* file, int64_t spilled_offset,
+                          int64_t spilled_length, uint32 spilled_crc,
+                          std::vector<Tensor>* element) {
+  std::string buffer(spilled_length, '\0');
+  StringPiece result;
+  TF_RETURN_IF_ERROR(
+      file->Read(spilled_offset, spilled_length, &result, buffer.data()));
+  if (result.size() != spilled_length) {
+    return errors::DataLoss("Truncated read of a spilled cache element: read ",
+                            result.size(), " of ", spilled_length, " bytes.");
+  }
+  if (crc32c::Value(result.data(), result.size()) != spilled_crc) {
+    return errors::DataLoss("Checksum mismatch for a spilled cache element.");
+  }
+  UncompressedElement proto;
+  if (!proto.ParseFromArray(result.data(), result.size())) {
+    return errors::DataLoss("Could not parse a spilled cache element.");
+  }
+  element->clear();
+  element->reserve(proto.components_size());
+  for (const TensorProto& component : proto.components()) {
+    element->emplace_back();
+    if (!element->back().FromProto(component)) {
+      return errors::DataLoss("Could not parse a spilled cache component.");
+    }
+  }
+  return OkStatus();
+}
 
 }  // namespace
 
 string MemoryCacheManager::DebugString() const { return kMemoryCache; }
 
-void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
+MemoryCache::~MemoryCache() {
+  mutex_lock l(mu_);
+  Clear();
+}
+
+void MemoryCache::EnableSpilling(
+    std::shared_ptr<model::RamBudgetManager> ram_budget_manager, Env* env,
+    const std::string& spill_directory) {
+  mutex_lock l(mu_);
+  if (!cache_.empty()) {
+    return;
+  }
+  ram_budget_manager_ = std::move(ram_budget_manager);
+  env_ = env;
+  spill_directory_ = spill_directory;
+}
+
+int64_t MemoryCache::AcquireWriter() {
   mutex_lock l(mu_);
+  if (completed_ || writer_id_ != 0) {
+    return 0;
+  }
+  writer_id_ = next_writer_id_++;
+  return writer_id_;
+}
+
+void MemoryCache::ReleaseWriter(int64_t writer_id) {
+  mutex_lock l(mu_);
+  if (writer_id != writer_id_) {
+    return;
+  }
+  writer_id_ = 0;
   if (!completed_) {
-    cache_ = std::move(cache);
+    Clear();
+  }
+}
+
+Status MemoryCache::Append(int64_t writer_id,
+                           const std::vector<Tensor>& element,
+                           bool* in_memory) {
+  *in_memory = false;
+  mutex_lock l(mu_);
+  if (writer_id != writer_id_ || completed_) {
+    return OkStatus();
+  }
+  return AppendLocked(element, in_memory);
+}
+
+Status MemoryCache::AppendLocked(const std::vector<Tensor>& element,
+                                 bool* in_memory) {
+  Element cached;
+  if (ram_budget_manager_ == nullptr) {
+    cached.tensors = element;
+  } else {
+    const int64_t bytes = GetTotalBytes(element);
+    if (ram_budget_manager_->RequestCacheBytes(bytes)) {
+      cached.tensors = element;
+      cached.allocated_bytes = bytes;
+    } else {
+      TF_RETURN_IF_ERROR(Spill(element, &cached));
+    }
+  }
+  *in_memory = cached.offset < 0;
+  cache_.push_back(std::move(cached));
+  return OkStatus();
+}
+
+Status MemoryCache::Spill(const std::vector<Tensor>& element,
+                          Element* spilled) {
+  if (segment_writer_ == nullptr) {
+    segment_filename_ = io::JoinPath(spill_directory_, kSegmentFilePrefix);
+    if (!env_->CreateUniqueFileName(&segment_filename_, kSegmentFileSuffix)) {
+      return errors::Unavailable("Could not create a cache segment file in ",
+                                 spill_directory_);
+    }
+    TF_RETURN_IF_ERROR(
+        env_->NewWritableFile(segment_filename_, &segment_writer_));
+    VLOG(2) << "Spilling cache elements to " << segment_filename_;
+  }
+  UncompressedElement proto;
+  for (const Tensor& component : element) {
+    component.AsProtoTensorContent(proto.add_components());
+  }
+  std::string serialized;
+  if (!proto.SerializeToString(&serialized)) {
+    return errors::Internal("Could not serialize a cache element.");
+  }
+  TF_RETURN_IF_ERROR(segment_writer_->Append(serialized));
+  spilled->offset = segment_size_;
+  spilled->length = serialized.size();
+  spilled->crc = crc32c::Value(serialized.data(), serialized.size());
+  segment_size_ += serialized.size();
+  ++num_spilled_;
+  return OkStatus();
+}
+
+void MemoryCache::Complete(int64_t writer_id) {
+  mutex_lock l(mu_);
+  if (writer_id == writer_id_) {
     completed_ = true;
   }
 }
 
+Status MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
+  mutex_lock l(mu_);
+  if (completed_) {
+    return OkStatus();
+  }
+  Clear();
+  for (std::vector<Tensor>& element : cache) {
+    bool in_memory;
+    TF_RETURN_IF_ERROR(AppendLocked(element, &in_memory));
+    element.clear();
+  }
+  completed_ = true;
+  return OkStatus();
+}
+
 bool MemoryCache::IsCompleted() {
   tf_shared_lock l(mu_);
   return completed_;
@@ -48,14 +199,86 @@ bool MemoryCache::IsCompleted() {
 
 void MemoryCache::Reset() {
   mutex_lock l(mu_);
+  writer_id_ = 0;
+  Clear();
+}
+
+void MemoryCache::Clear() {
+  if (ram_budget_manager_ != nullptr) {
+    int64_t allocated_bytes = 0;
+    for (const Element& element : cache_) {
+      allocated_bytes += element.allocated_bytes;
+    }
+    ram_budget_manager_->RequestCacheBytes(-allocated_bytes);
+  }
   completed_ = false;
   cache_.clear();
+  num_spilled_ = 0;
+  if (segment_writer_ != nullptr) {
+    segment_writer_->Close().IgnoreError();
+    segment_writer_.reset();
+    // Concurrent readers keep their own reference to the reader, so the
+    // segment can be deleted while they finish.
+    segment_reader_.reset();
+    env_->DeleteFile(segment_filename_).IgnoreError();
+    segment_filename_.clear();
+  }
+  segment_size_ = 0;
+  segment_flushed_size_ = 0;
+}
+
+Status MemoryCache::Get(int64_t index, std::vector<Tensor>* element) {
+  std::shared_ptr<RandomAccessFile> segment_reader;
+  int64_t offset, length;
+  uint32 crc;
+  {
+    mutex_lock l(mu_);
+    if (index < 0 || index >= cache_.size()) {
+      return errors::OutOfRange("Index ", index, " is not cached. The cache ",
+                                "has ", cache_.size(), " elements.");
+    }
+    const Element& cached = cache_[index];
+    if (cached.offset < 0) {
+      *element = cached.tensors;
+      return OkStatus();
+    }
+    if (segment_flushed_size_ < cached.offset + cached.length) {
+      TF_RETURN_IF_ERROR(segment_writer_->Flush());
+      segment_flushed_size_ = segment_size_;
+    }
+    if (segment_reader_ == nullptr) {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(segment_filename_, &file));
+      segment_reader_ = std::move(file);
+    }
+    segment_reader = segment_reader_;
+    offset = cached.offset;
+    length = cached.length;
+    crc = cached.crc;
+  }
+  // Spilled elements are read without holding the lock so that readers of
+  // in-memory elements and the writer are not blocked on disk I/O.
+  return ReadSpilledElement(segment_reader.get(), offset, length, crc, element);
 }
 
-const std::vector<Tensor>& MemoryCache::at(int64_t index) {
+bool MemoryCache::GetIfInMemory(int64_t index, std::vector<Tensor>* element) {
   tf_shared_lock l(mu_);
-  DCHECK(index < cache_.size());
-  return cache_[index];
+  if (index < 0 || index >= cache_.size() || cache_[index].offset >= 0) {
+    return false;
+  }
+  *element = cache_[index].tensors;
+  return true;
+}
+
+Status MemoryCache::GetAll(std::vector<std::vector<Tensor>>* elements) {
+  const size_t num_elements = size();
+  elements->clear();
+  elements->reserve(num_elements);
+  for (size_t i = 0; i < num_elements; ++i) {
+    elements->emplace_back();
+    TF_RETURN_IF_ERROR(Get(i, &elements->back()));
+  }
+  return OkStatus();
 }
 
 size_t MemoryCache::size() {
@@ -63,9 +286,9 @@ size_t MemoryCache::size() {
   return cache_.size();
 }
 
-const std::vector<std::vector<Tensor>>& MemoryCache::data() {
+size_t MemoryCache::num_spilled() {
   tf_shared_lock l(mu_);
-  return cache_;
+  return num_spilled_;
 }
 
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
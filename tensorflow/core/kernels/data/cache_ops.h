@@ -16,8 +16,18 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
 namespace data {
@@ -25,36 +35,113 @@ namespace data {
 // A thread-safe data structure for caching dataset elements.
 //
 // The expected use is that a single `MemoryWriterIterator` populates the
-// cache with dataset elements. Once all elements are cached, the cache can
-// be used by one or more `MemoryReaderIterator`s.
+// cache with dataset elements. Elements become visible as soon as they are
+// appended, so other iterators can read the partially filled cache while it
+// is being written. Once all elements are cached, the cache can be used by one
+// or more `MemoryReaderIterator`s.
+//
+// If spilling is enabled, each element's memory is requested from a
+// `model::RamBudgetManager`. Elements that do not fit into the budget are
+// appended to a log-structured segment file on disk and read back on demand.
 class MemoryCache {
  public:
   MemoryCache() = default;
+  ~MemoryCache();
+
+  // Keeps elements in memory only while `ram_budget_manager` grants the bytes
+  // for them, spilling the others to a segment file in `spill_directory`. Has
+  // no effect unless the cache is empty.
+  void EnableSpilling(
+      std::shared_ptr<model::RamBudgetManager> ram_budget_manager, Env* env,
+      const std::string& spill_directory);
+
+  // Claims the right to populate the cache. Returns a positive writer id, or 0
+  // if the cache is completed or another writer is active.
+  int64_t AcquireWriter();
+
+  // Gives up the claim of `writer_id`. If the cache has not been completed,
+  // the partially filled cache is discarded.
+  void ReleaseWriter(int64_t writer_id);
 
-  // Marks the cache as completed.
-  void Complete(std::vector<std::vector<Tensor>>&& cache);
+  // Appends an element on behalf of `writer_id`. Sets `*in_memory` to whether
+  // the element is kept in memory. Elements appended by a writer whose claim
+  // was invalidated by `Reset()` are dropped.
+  Status Append(int64_t writer_id, const std::vector<Tensor>& element,
+                bool* in_memory);
+
+  // Marks the cache populated by `writer_id` as completed.
+  void Complete(int64_t writer_id);
+
+  // Replaces the contents of the cache with `cache` and marks it as
+  // completed, unless it is already completed.
+  Status Complete(std::vector<std::vector<Tensor>>&& cache);
 
   // Returns whether the cache is completed.
   bool IsCompleted();
 
-  // Resets the cache.
+  // Resets the cache and invalidates the active writer, if any.
   void Reset();
 
-  // Returns the element at the given index.
-  const std::vector<Tensor>& at(int64_t index);
+  // Copies the element at the given index to `element`, reading it from disk
+  // if it was spilled. Returns an `OutOfRange` error if the index is not
+  // cached (e.g. because the cache was reset concurrently).
+  Status Get(int64_t index, std::vector<Tensor>* element);
+
+  // Like `Get()`, but returns false instead of reading spilled elements.
+  bool GetIfInMemory(int64_t index, std::vector<Tensor>* element);
+
+  // Copies all cached elements to `elements`.
+  Status GetAll(std::vector<std::vector<Tensor>>* elements);
 
   // Returns the size of the cache.
   size_t size();
 
-  // Returns a reference to the cache's data. The returned reference will be
-  // invalidated by any call to Reset().
-  const std::vector<std::vector<Tensor>>& data();
+  // Returns the number of elements that were spilled to disk.
+  size_t num_spilled();
 
  private:
+  struct Element {
+    // Empty if the element was spilled.
+    std::vector<Tensor> tensors;
+    // Bytes granted by `ram_budget_manager_` for `tensors`.
+    int64_t allocated_bytes = 0;
+    // Location of the serialized element in the segment file, if spilled.
+    int64_t offset = -1;
+    int64_t length = 0;
+    uint32 crc = 0;
+  };
+
+  // Appends `element`, spilling it if spilling is enabled and it does not fit
+  // into the RAM budget.
+  Status AppendLocked(const std::vector<Tensor>& element, bool* in_memory)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Appends the serialized `element` to the segment file.
+  Status Spill(const std::vector<Tensor>& element, Element* spilled)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Releases the memory and disk space held by the cache.
+  void Clear() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   mutex mu_;
   // Determines whether all elements of the dataset have been cached.
   bool completed_ TF_GUARDED_BY(mu_) = false;
-  std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  std::vector<Element> cache_ TF_GUARDED_BY(mu_);
+  int64_t writer_id_ TF_GUARDED_BY(mu_) = 0;
+  int64_t next_writer_id_ TF_GUARDED_BY(mu_) = 1;
+  size_t num_spilled_ TF_GUARDED_BY(mu_) = 0;
+
+  std::shared_ptr<model::RamBudgetManager> ram_budget_manager_
+      TF_GUARDED_BY(mu_);
+  Env* env_ TF_GUARDED_BY(mu_) = nullptr;
+  std::string spill_directory_ TF_GUARDED_BY(mu_);
+  // The segment file is created when the first element is spilled and only
+  // ever appended to until the cache is reset.
+  std::string segment_filename_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<WritableFile> segment_writer_ TF_GUARDED_BY(mu_);
+  std::shared_ptr<RandomAccessFile> segment_reader_ TF_GUARDED_BY(mu_);
+  int64_t segment_size_ TF_GUARDED_BY(mu_) = 0;
+  int64_t segment_flushed_size_ TF_GUARDED_BY(mu_) = 0;
 };
 
 // A resource wrapping a shared instance of a memory cache.
@@ -0,0 +1,383 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_record_dataset_op.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/columnar_records.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const ColumnarRecordDatasetOp::kDatasetType;
+/* static */ constexpr const char* const ColumnarRecordDatasetOp::kFileNames;
+/* static */ constexpr const char* const ColumnarRecordDatasetOp::kColumns;
+/* static */ constexpr const char* const ColumnarRecordDatasetOp::kBatchSize;
+/* static */ constexpr const char* const
+    ColumnarRecordDatasetOp::kDropRemainder;
+/* static */ constexpr const char* const ColumnarRecordDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const
+    ColumnarRecordDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kCurrentFileIndex[] = "current_file_index";
+constexpr char kChunkIndex[] = "chunk_index";
+constexpr char kRecordIndex[] = "record_index";
+
+}  // namespace
+
+class ColumnarRecordDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, std::vector<string> filenames,
+          std::vector<string> columns, int64_t batch_size, bool drop_remainder,
+          const DataTypeVector& output_types,
+          const std::vector<PartialTensorShape>& output_shapes)
+      : DatasetBase(DatasetContext(ctx)),
+        filenames_(std::move(filenames)),
+        columns_(std::move(columns)),
+        batch_size_(batch_size),
+        drop_remainder_(drop_remainder),
+        output_types_(output_types),
+        output_shapes_(output_shapes) {}
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return output_types_;
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(batch_size_);
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override { return OkStatus(); }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* filenames = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(filenames_, &filenames));
+    Node* columns = nullptr;
+    TF_RETURN_IF_ERROR(b->AddVector(columns_, &columns));
+    Node* batch_size = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+    Node* drop_remainder = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(drop_remainder_, &drop_remainder));
+    return b->AddDataset(
+        this, {filenames, columns, batch_size, drop_remainder}, output);
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params) {}
+
+    bool SymbolicCheckpointCompatible() const override { return true; }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      mutex_lock l(mu_);
+      const int64_t batch_size = dataset()->batch_size_;
+      std::vector<Tensor> batch;
+      int64_t num_records = 0;
+      while (num_records < batch_size) {
+        if (chunk_values_.empty()) {
+          bool end_of_files = false;
+          TF_RETURN_IF_ERROR(ReadChunkLocked(ctx->env(), &end_of_files));
+          if (end_of_files) break;
+        }
+        const int64_t chunk_records = chunk_values_[0].dim_size(0);
+        const int64_t n =
+            std::min(batch_size - num_records, chunk_records - record_index_);
+        if (n == batch_size && n == chunk_records) {
+          // The batch is the whole chunk: output the decoded columns as is.
+          *out_tensors = std::move(chunk_values_);
+          NextChunkLocked();
+          *end_of_sequence = false;
+          return OkStatus();
+        }
+        if (batch.empty()) {
+          batch.reserve(chunk_values_.size());
+          for (const Tensor& values : chunk_values_) {
+            TensorShape shape = values.shape();
+            shape.set_dim(0, batch_size);
+            batch.emplace_back(ctx->allocator({}), values.dtype(), shape);
+          }
+        }
+        for (int i = 0; i < chunk_values_.size(); ++i) {
+          TF_RETURN_IF_ERROR(batch_util::CopyContiguousSlices(
+              chunk_values_[i], record_index_, num_records, n, &batch[i]));
+        }
+        num_records += n;
+        record_index_ += n;
+        if (record_index_ == chunk_records) {
+          NextChunkLocked();
+        }
+      }
+      if (num_records == 0 ||
+          (num_records < batch_size && dataset()->drop_remainder_)) {
+        *end_of_sequence = true;
+        return OkStatus();
+      }
+      if (num_records < batch_size) {
+        for (Tensor& values : batch) {
+          values = values.Slice(0, num_records);
+        }
+      }
+      *out_tensors = std::move(batch);
+      *end_of_sequence = false;
+      return OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCurrentFileIndex,
+                                             current_file_index_));
+      if (reader_) {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kChunkIndex, chunk_index_));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kRecordIndex, record_index_));
+      }
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      reader_.reset();
+      chunk_values_.clear();
+      int64_t current_file_index;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kCurrentFileIndex, &current_file_index));
+      current_file_index_ = current_file_index;
+      chunk_index_ = 0;
+      record_index_ = 0;
+      if (reader->Contains(prefix(), kChunkIndex)) {
+        TF_RETURN_IF_ERROR(OpenFileLocked(ctx->env()));
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kChunkIndex, &chunk_index_));
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kRecordIndex, &record_index_));
+      }
+      return OkStatus();
+    }
+
+   private:
+    // Opens the file at `current_file_index_` and finds the columns to read.
+    Status OpenFileLocked(Env* env) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (current_file_index_ >= dataset()->filenames_.size()) {
+        return errors::InvalidArgument(
+            "current_file_index_:", current_file_index_,
+            " >= filenames_.size():", dataset()->filenames_.size());
+      }
+      const string& filename = dataset()->filenames_[current_file_index_];
+      TF_RETURN_IF_ERROR(ColumnarRecordsReader::Open(
+          env, TranslateFileName(filename), &reader_));
+      column_indices_.clear();
+      for (int i = 0; i < dataset()->columns_.size(); ++i) {
+        const string& name = dataset()->columns_[i];
+        const int index = reader_->ColumnIndex(name);
+        if (index == -1) {
+          reader_.reset();
+          return errors::InvalidArgument("Column ", name, " is not in ",
+                                         filename);
+        }
+        const ColumnarRecordsColumn& column = reader_->columns()[index];
+        PartialTensorShape batch_shape({-1});
+        batch_shape = batch_shape.Concatenate(column.shape);
+        if (column.dtype != dataset()->output_types_[i] ||
+            !batch_shape.IsCompatibleWith(dataset()->output_shapes_[i])) {
+          reader_.reset();
+          return errors::InvalidArgument(
+              "Expected ", DataTypeString(dataset()->output_types_[i]),
+              " values of shape ", dataset()->output_shapes_[i].DebugString(),
+              " for column ", name, ", but ", filename, " has ",
+              DataTypeString(column.dtype), " values of shape ",
+              batch_shape.DebugString());
+        }
+        column_indices_.push_back(index);
+      }
+      return OkStatus();
+    }
+
+    // Reads the projected columns of the next chunk into `chunk_values_`,
+    // moving on to the next files as needed.
+    Status ReadChunkLocked(Env* env, bool* end_of_files)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (true) {
+        if (!reader_) {
+          // Iteration ends when there are no more files to process.
+          if (current_file_index_ == dataset()->filenames_.size()) {
+            *end_of_files = true;
+            return OkStatus();
+          }
+          Status s = OpenFileLocked(env);
+          if (!s.ok()) {
+            // Move forward the file index so that it works with
+            // ignore_errors. Otherwise the same file will repeat.
+            ++current_file_index_;
+            return s;
+          }
+        }
+        if (chunk_index_ < reader_->chunks().size()) break;
+        reader_.reset();
+        ++current_file_index_;
+        chunk_index_ = 0;
+        record_index_ = 0;
+      }
+
+      static monitoring::CounterCell* bytes_counter =
+          metrics::GetTFDataBytesReadCounter(kDatasetType);
+      const ColumnarRecordsChunk& chunk = reader_->chunks()[chunk_index_];
+      chunk_values_.resize(column_indices_.size());
+      for (int i = 0; i < column_indices_.size(); ++i) {
+        Status s = reader_->ReadColumn(chunk_index_, column_indices_[i],
+                                       &chunk_values_[i]);
+        if (!s.ok()) {
+          chunk_values_.clear();
+          reader_.reset();
+          ++current_file_index_;
+          chunk_index_ = 0;
+          record_index_ = 0;
+          return s;
+        }
+        bytes_counter->IncrementBy(chunk.columns[column_indices_[i]].size);
+      }
+      *end_of_files = false;
+      return OkStatus();
+    }
+
+    void NextChunkLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      chunk_values_.clear();
+      ++chunk_index_;
+      record_index_ = 0;
+    }
+
+    mutex mu_;
+    size_t current_file_index_ TF_GUARDED_BY(mu_) = 0;
+    std::unique_ptr<ColumnarRecordsReader> reader_ TF_GUARDED_BY(mu_);
+    // Indices in the file of the columns to read.
+    std::vector<int> column_indices_ TF_GUARDED_BY(mu_);
+    // Chunk of the current file to read next, and index of the next record in
+    // the chunk.
+    int64_t chunk_index_ TF_GUARDED_BY(mu_) = 0;
+    int64_t record_index_ TF_GUARDED_BY(mu_) = 0;
+    // Values of the projected columns of chunk `chunk_index_`, or empty if
+    // they were not read yet.
+    std::vector<Tensor> chunk_values_ TF_GUARDED_BY(mu_);
+  };
+
+  const std::vector<string> filenames_;
+  const std::vector<string> columns_;
+  const int64_t batch_size_;
+  const bool drop_remainder_;
+  const DataTypeVector output_types_;
+  const std::vector<PartialTensorShape> output_shapes_;
+};
+
+ColumnarRecordDatasetOp::ColumnarRecordDatasetOp(OpKernelConstruction* ctx)
+    : DatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputTypes, &output_types_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kOutputShapes, &output_shapes_));
+}
+
+void ColumnarRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                          DatasetBase** output) {
+  const Tensor* filenames_tensor;
+  OP_REQUIRES_OK(ctx, ctx->input(kFileNames, &filenames_tensor));
+  OP_REQUIRES(
+      ctx, filenames_tensor->dims() <= 1,
+      errors::InvalidArgument("`filenames` must be a scalar or a vector."));
+  std::vector<string> filenames;
+  filenames.reserve(filenames_tensor->NumElements());
+  for (int i = 0; i < filenames_tensor->NumElements(); ++i) {
+    filenames.push_back(filenames_tensor->flat<tstring>()(i));
+    metrics::RecordTFDataFilename(kDatasetType, filenames[i]);
+  }
+
+  std::vector<tstring> column_names;
+  OP_REQUIRES_OK(ctx,
+                 ParseVectorArgument<tstring>(ctx, kColumns, &column_names));
+  OP_REQUIRES(ctx, column_names.size() == output_types_.size(),
+              errors::InvalidArgument(
+                  "`columns` must have an element per output type, got ",
+                  column_names.size(), " columns and ", output_types_.size(),
+                  " output types."));
+  OP_REQUIRES(ctx, output_shapes_.size() == output_types_.size(),
+              errors::InvalidArgument(
+                  "`output_shapes` must have an element per output type."));
+  std::vector<string> columns(column_names.begin(), column_names.end());
+
+  int64_t batch_size = 0;
+  OP_REQUIRES_OK(ctx,
+                 ParseScalarArgument<int64_t>(ctx, kBatchSize, &batch_size));
+  OP_REQUIRES(ctx, batch_size > 0,
+              errors::InvalidArgument("`batch_size` must be greater than 0."));
+  bool drop_remainder = false;
+  OP_REQUIRES_OK(
+      ctx, ParseScalarArgument<bool>(ctx, kDropRemainder, &drop_remainder));
+
+  *output = new Dataset(ctx, std::move(filenames), std::move(columns),
+                        batch_size, drop_remainder, output_types_,
+                        output_shapes_);
+}
+
+namespace {
+
+REGISTER_KERNEL_BUILDER(Name("ColumnarRecordDataset").Device(DEVICE_CPU),
+                        ColumnarRecordDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
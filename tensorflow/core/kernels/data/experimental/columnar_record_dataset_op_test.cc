@@ -0,0 +1,265 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/columnar_record_dataset_op.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/columnar_records.h"
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "columnar_record_dataset";
+
+class ColumnarRecordDatasetParams : public DatasetParams {
+ public:
+  ColumnarRecordDatasetParams(std::vector<tstring> filenames,
+                              std::vector<tstring> columns, int64_t batch_size,
+                              bool drop_remainder, DataTypeVector output_dtypes,
+                              std::vector<PartialTensorShape> output_shapes,
+                              string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        filenames_(std::move(filenames)),
+        columns_(std::move(columns)),
+        batch_size_(batch_size),
+        drop_remainder_(drop_remainder) {}
+
+  std::vector<Tensor> GetInputTensors() const override {
+    int64_t num_files = filenames_.size();
+    int64_t num_columns = columns_.size();
+    return {CreateTensor<tstring>(TensorShape({num_files}), filenames_),
+            CreateTensor<tstring>(TensorShape({num_columns}), columns_),
+            CreateTensor<int64_t>(TensorShape({}), {batch_size_}),
+            CreateTensor<bool>(TensorShape({}), {drop_remainder_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {
+        ColumnarRecordDatasetOp::kFileNames,
+        ColumnarRecordDatasetOp::kColumns,
+        ColumnarRecordDatasetOp::kBatchSize,
+        ColumnarRecordDatasetOp::kDropRemainder,
+    };
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{ColumnarRecordDatasetOp::kOutputTypes, output_dtypes_},
+                    {ColumnarRecordDatasetOp::kOutputShapes, output_shapes_},
+                    {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return ColumnarRecordDatasetOp::kDatasetType;
+  }
+
+ private:
+  std::vector<tstring> filenames_;
+  std::vector<tstring> columns_;
+  int64_t batch_size_;
+  bool drop_remainder_;
+};
+
+class ColumnarRecordDatasetOpTest : public DatasetOpsTestBase {};
+
+// Writes two files, of 5 and 3 records, in chunks of 2 records. Record `i` has
+// an "id" `i`, a "feature" `[i, -i]` and a "name" "r<i>".
+std::vector<tstring> CreateTestFiles() {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/columnar_records_1"),
+      absl::StrCat(testing::TmpDir(), "/columnar_records_2")};
+  const std::vector<ColumnarRecordsColumn> columns = {
+      {"id", DT_INT64, TensorShape({})},
+      {"feature", DT_FLOAT, TensorShape({2})},
+      {"name", DT_STRING, TensorShape({})}};
+  ColumnarRecordsWriterOptions options;
+  options.records_per_chunk = 2;
+  int64_t record = 0;
+  for (int i = 0; i < filenames.size(); ++i) {
+    const int64_t num_records = i == 0 ? 5 : 3;
+    Tensor ids(DT_INT64, TensorShape({num_records}));
+    Tensor features(DT_FLOAT, TensorShape({num_records, 2}));
+    Tensor names(DT_STRING, TensorShape({num_records}));
+    for (int64_t j = 0; j < num_records; ++j, ++record) {
+      ids.vec<int64_t>()(j) = record;
+      features.matrix<float>()(j, 0) = record;
+      features.matrix<float>()(j, 1) = -record;
+      names.vec<tstring>()(j) = absl::StrCat("r", record);
+    }
+    std::unique_ptr<ColumnarRecordsWriter> writer;
+    TF_CHECK_OK(ColumnarRecordsWriter::Create(Env::Default(), filenames[i],
+                                              columns, options, &writer));
+    TF_CHECK_OK(writer->Write({ids, features, names}));
+    TF_CHECK_OK(writer->Close());
+  }
+  return filenames;
+}
+
+// Returns the "name" and "id" batches of records [begin, end).
+std::vector<Tensor> NameAndIdBatches(int64_t begin, int64_t end,
+                                     int64_t batch_size) {
+  std::vector<Tensor> batches;
+  for (int64_t start = begin; start < end; start += batch_size) {
+    const int64_t size = std::min(batch_size, end - start);
+    std::vector<tstring> names;
+    std::vector<int64_t> ids;
+    for (int64_t i = start; i < start + size; ++i) {
+      names.push_back(absl::StrCat("r", i));
+      ids.push_back(i);
+    }
+    batches.push_back(CreateTensor<tstring>(TensorShape({size}), names));
+    batches.push_back(CreateTensor<int64_t>(TensorShape({size}), ids));
+  }
+  return batches;
+}
+
+// Projects two of the three columns, in another order than in the files.
+ColumnarRecordDatasetParams ProjectionParams(int64_t batch_size,
+                                             bool drop_remainder) {
+  const int64_t batch_dim = drop_remainder ? batch_size : -1;
+  return ColumnarRecordDatasetParams(
+      CreateTestFiles(), /*columns=*/{"name", "id"}, batch_size,
+      drop_remainder,
+      /*output_dtypes=*/{DT_STRING, DT_INT64},
+      /*output_shapes=*/
+      {PartialTensorShape({batch_dim}), PartialTensorShape({batch_dim})},
+      kNodeName);
+}
+
+// Batches of a chunk, batches spanning chunks and files, and a last partial
+// batch.
+ColumnarRecordDatasetParams ColumnarRecordDatasetParams1() {
+  return ProjectionParams(/*batch_size=*/2, /*drop_remainder=*/false);
+}
+
+ColumnarRecordDatasetParams ColumnarRecordDatasetParams2() {
+  return ProjectionParams(/*batch_size=*/3, /*drop_remainder=*/false);
+}
+
+ColumnarRecordDatasetParams ColumnarRecordDatasetParams3() {
+  return ProjectionParams(/*batch_size=*/3, /*drop_remainder=*/true);
+}
+
+ColumnarRecordDatasetParams FeatureParams() {
+  return ColumnarRecordDatasetParams(
+      CreateTestFiles(), /*columns=*/{"feature"}, /*batch_size=*/4,
+      /*drop_remainder=*/false, /*output_dtypes=*/{DT_FLOAT},
+      /*output_shapes=*/{PartialTensorShape({-1, 2})}, kNodeName);
+}
+
+ColumnarRecordDatasetParams MissingColumnParams() {
+  return ColumnarRecordDatasetParams(
+      CreateTestFiles(), /*columns=*/{"label"}, /*batch_size=*/2,
+      /*drop_remainder=*/false, /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1})}, kNodeName);
+}
+
+ColumnarRecordDatasetParams WrongTypeParams() {
+  return ColumnarRecordDatasetParams(
+      CreateTestFiles(), /*columns=*/{"id"}, /*batch_size=*/2,
+      /*drop_remainder=*/false, /*output_dtypes=*/{DT_INT32},
+      /*output_shapes=*/{PartialTensorShape({-1})}, kNodeName);
+}
+
+std::vector<GetNextTestCase<ColumnarRecordDatasetParams>> GetNextTestCases() {
+  return {{/*dataset_params=*/ColumnarRecordDatasetParams1(),
+           /*expected_outputs=*/NameAndIdBatches(0, 8, /*batch_size=*/2)},
+          {/*dataset_params=*/ColumnarRecordDatasetParams2(),
+           /*expected_outputs=*/NameAndIdBatches(0, 8, /*batch_size=*/3)},
+          {/*dataset_params=*/ColumnarRecordDatasetParams3(),
+           /*expected_outputs=*/NameAndIdBatches(0, 6, /*batch_size=*/3)},
+          {/*dataset_params=*/FeatureParams(),
+           /*expected_outputs=*/
+           {CreateTensor<float>(TensorShape({4, 2}),
+                                {0, 0, 1, -1, 2, -2, 3, -3}),
+            CreateTensor<float>(TensorShape({4, 2}),
+                                {4, -4, 5, -5, 6, -6, 7, -7})}}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(ColumnarRecordDatasetOpTest,
+                         ColumnarRecordDatasetParams, GetNextTestCases())
+
+TEST_F(ColumnarRecordDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = ColumnarRecordDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(ColumnarRecordDatasetOp::kDatasetType)));
+}
+
+TEST_F(ColumnarRecordDatasetOpTest, DatasetOutputDtypes) {
+  auto dataset_params = ColumnarRecordDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputDtypes({DT_STRING, DT_INT64}));
+}
+
+TEST_F(ColumnarRecordDatasetOpTest, IteratorOutputShapes) {
+  auto dataset_params = ColumnarRecordDatasetParams3();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorOutputShapes(
+      {PartialTensorShape({3}), PartialTensorShape({3})}));
+}
+
+TEST_F(ColumnarRecordDatasetOpTest, MissingColumn) {
+  auto dataset_params = MissingColumnParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(ColumnarRecordDatasetOpTest, WrongColumnType) {
+  auto dataset_params = WrongTypeParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(
+      iterator_->GetNext(iterator_ctx_.get(), &out_tensors, &end_of_sequence)
+          .code(),
+      absl::StatusCode::kInvalidArgument);
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<ColumnarRecordDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {{/*dataset_params=*/ColumnarRecordDatasetParams1(),
+           /*breakpoints=*/{0, 1, 3, 5},
+           /*expected_outputs=*/NameAndIdBatches(0, 8, /*batch_size=*/2)},
+          {/*dataset_params=*/ColumnarRecordDatasetParams2(),
+           /*breakpoints=*/{0, 1, 2, 4},
+           /*expected_outputs=*/NameAndIdBatches(0, 8, /*batch_size=*/3)}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(ColumnarRecordDatasetOpTest,
+                                 ColumnarRecordDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
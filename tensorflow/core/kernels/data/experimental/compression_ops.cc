@@ -25,7 +25,24 @@ namespace data {
 namespace experimental {
 
 CompressElementOp::CompressElementOp(OpKernelConstruction* ctx)
-    : OpKernel(ctx) {}
+    : OpKernel(ctx) {
+  std::string codec;
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kCodec, &codec));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kLevel, &options_.level));
+  if (codec == "auto") {
+    float network_bytes_per_second;
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kNetworkBytesPerSecond, &network_bytes_per_second));
+    OP_REQUIRES(ctx, network_bytes_per_second > 0,
+                errors::InvalidArgument(
+                    "`network_bytes_per_second` must be positive, got ",
+                    network_bytes_per_second));
+    adaptive_compressor_ = std::make_unique<AdaptiveElementCompressor>(
+        network_bytes_per_second, options_.level);
+    return;
+  }
+  OP_REQUIRES_OK(ctx, ParseCompressionCodec(codec, &options_.codec));
+}
 
 void CompressElementOp::Compute(OpKernelContext* ctx) {
   std::vector<Tensor> components;
@@ -33,7 +50,12 @@ void CompressElementOp::Compute(OpKernelContext* ctx) {
     components.push_back(ctx->input(i));
   }
   CompressedElement compressed;
-  OP_REQUIRES_OK(ctx, CompressElement(components, &compressed));
+  if (adaptive_compressor_) {
+    OP_REQUIRES_OK(ctx,
+                   adaptive_compressor_->Compress(components, &compressed));
+  } else {
+    OP_REQUIRES_OK(ctx, CompressElement(components, options_, &compressed));
+  }
 
   Tensor* output;
   OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
@@ -59,15 +81,18 @@ void UncompressElementOp::Compute(OpKernelContext* ctx) {
                               "variant, but encountered an input with dtype ",
                               DataTypeString(tensor.dtype())));
   const Variant& variant = tensor.scalar<Variant>()();
-  const CompressedElement* compressed = variant.get<CompressedElement>();
   OP_REQUIRES(
-      ctx, compressed != nullptr,
+      ctx,
+      variant.get<CompressedElement>() != nullptr ||
+          variant.get<LocalElement>() != nullptr,
       errors::InvalidArgument(
           "Input does not contain a compressed element. Instead got tensor ",
           tensor.DebugString()));
 
+  // Elements from in-process tf.data service workers may be `LocalElement`s,
+  // whose components are forwarded without a copy.
   std::vector<Tensor> components;
-  OP_REQUIRES_OK(ctx, UncompressElement(*compressed, &components));
+  OP_REQUIRES_OK(ctx, UncompressElement(variant, &components));
   OP_REQUIRES(ctx, components.size() == output_types_.size(),
               errors::FailedPrecondition("Expected ", output_types_.size(),
                                          " outputs from uncompress, but got ",
@@ -0,0 +1,271 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/random_seed_ops.h"
+#include "tensorflow/core/kernels/random_index_shuffle.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kDatasetType;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kInputDataset;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kSeed2;
+/* static */ constexpr const char* const
+    GlobalShuffleDatasetOp::kReshuffleEachIteration;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const GlobalShuffleDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kElementIndex[] = "element_index";
+constexpr char kIteratorSeed[] = "iterator_seed";
+constexpr char kIteratorSeed2[] = "iterator_seed2";
+constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+
+// The number of rounds of the Feistel network that permutes the indices.
+constexpr int kPermutationRounds = 8;
+
+// Returns the index of the element at `position` in the permutation of
+// [0, cardinality) selected by `seed` and `seed2`.
+int64_t PermutedIndex(int64_t position, int64_t cardinality, int64_t seed,
+                      int64_t seed2) {
+  const std::array<uint32_t, 3> key = {
+      static_cast<uint32_t>(seed), static_cast<uint32_t>(seed2),
+      static_cast<uint32_t>(static_cast<uint64_t>(seed ^ seed2) >> 32)};
+  return random::index_shuffle(position, key, cardinality - 1,
+                               kPermutationRounds);
+}
+
+// Returns the cardinality of `dataset`, computing it from the indices of file
+// sources if needed, as random access does.
+int64_t RandomAccessCardinality(const DatasetBase* dataset) {
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  return dataset->Cardinality(options);
+}
+
+}  // namespace
+
+class GlobalShuffleDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input, RandomSeeds&& seeds,
+          bool reshuffle_each_iteration)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        seeds_(std::move(seeds)) {
+    if (reshuffle_each_iteration) {
+      seed_generator_ = std::make_shared<RandomSeedGenerator>(seeds_);
+    } else {
+      seed_generator_ = std::make_shared<FixedSeedGenerator>(seeds_);
+    }
+    input_->Ref();
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(
+        Iterator::Params{this,
+                         name_utils::IteratorPrefix(kDatasetType, prefix)},
+        seed_generator_.get());
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return input_->output_shapes();
+  }
+
+  string DebugString() const override {
+    name_utils::DatasetDebugStringParams params;
+    params.set_args(seeds_.seed(), seeds_.seed2());
+    return name_utils::DatasetDebugString(kDatasetType, params);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    return input_->Cardinality(options);
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+  Status Get(AnyContext ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    return input_->Get(ctx,
+                       PermutedIndex(index, RandomAccessCardinality(input_),
+                                     seeds_.seed(), seeds_.seed2()),
+                       out_tensors);
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* seed_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed(), &seed_node));
+    Node* seed2_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(seeds_.input_seed2(), &seed2_node));
+    AttrValue reshuffle_each_iteration;
+    b->BuildAttrValue(seed_generator_->reshuffle_each_iteration(),
+                      &reshuffle_each_iteration);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {input_graph_node, seed_node, seed2_node},
+        {std::make_pair(kReshuffleEachIteration, reshuffle_each_iteration)},
+        output));
+    return OkStatus();
+  }
+
+ private:
+  // Produces the elements at the positions [0, cardinality) of a permutation,
+  // so its state is the next position and the seeds of the permutation.
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    Iterator(const Params& params, SeedGenerator* seed_generator)
+        : DatasetIterator<Dataset>(params), seed_generator_(seed_generator) {}
+
+    bool SymbolicCheckpointCompatible() const override { return true; }
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      cardinality_ = RandomAccessCardinality(dataset()->input_);
+      if (cardinality_ == kInfiniteCardinality ||
+          cardinality_ == kUnknownCardinality) {
+        return errors::FailedPrecondition(
+            "Global shuffling requires an input dataset with a known, finite "
+            "cardinality, which supports random access; got ",
+            dataset()->input_->DebugString(), " with ",
+            cardinality_ == kInfiniteCardinality ? "infinite" : "unknown",
+            " cardinality.");
+      }
+      seed_generator_->GenerateSeeds(&seed_, &seed2_);
+      return OkStatus();
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      int64_t index;
+      {
+        mutex_lock l(mu_);
+        if (element_index_ >= cardinality_) {
+          *end_of_sequence = true;
+          return OkStatus();
+        }
+        index = PermutedIndex(element_index_++, cardinality_, seed_, seed2_);
+      }
+      *end_of_sequence = false;
+      return dataset()->input_->Get(ctx, index, out_tensors);
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeSourceNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kElementIndex, element_index_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kIteratorSeed, seed_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kIteratorSeed2, seed2_));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kEpochNumRandomSamples,
+                              seed_generator_->num_random_samples()));
+      return OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kElementIndex, &element_index_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kIteratorSeed, &seed_));
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kIteratorSeed2, &seed2_));
+      int64_t num_random_samples;
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kEpochNumRandomSamples,
+                                            &num_random_samples));
+      seed_generator_->set_num_random_samples(num_random_samples);
+      seed_generator_->Reset();
+      return OkStatus();
+    }
+
+   private:
+    SeedGenerator* const seed_generator_;  // Not owned.
+
+    mutex mu_;
+    int64_t cardinality_ TF_GUARDED_BY(mu_) = 0;
+    int64_t element_index_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed_ TF_GUARDED_BY(mu_) = 0;
+    int64_t seed2_ TF_GUARDED_BY(mu_) = 0;
+  };
+
+  const DatasetBase* const input_;
+  const RandomSeeds seeds_;
+  std::shared_ptr<SeedGenerator> seed_generator_;
+};
+
+GlobalShuffleDatasetOp::GlobalShuffleDatasetOp(OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kReshuffleEachIteration,
+                                   &reshuffle_each_iteration_));
+}
+
+void GlobalShuffleDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                         DatasetBase* input,
+                                         DatasetBase** output) {
+  int64_t seed;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed, &seed));
+  int64_t seed2;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed2, &seed2));
+  *output = new Dataset(ctx, input, RandomSeeds(seed, seed2),
+                        reshuffle_each_iteration_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(Name("GlobalShuffleDataset").Device(DEVICE_CPU),
+                        GlobalShuffleDatasetOp);
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
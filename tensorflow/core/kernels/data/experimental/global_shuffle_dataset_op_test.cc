@@ -0,0 +1,234 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/global_shuffle_dataset_op.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/serialization_utils.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+constexpr char kNodeName[] = "global_shuffle_dataset";
+
+class GlobalShuffleDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  GlobalShuffleDatasetParams(T input_dataset_params, int64_t seed,
+                             int64_t seed2, bool reshuffle_each_iteration,
+                             DataTypeVector output_dtypes,
+                             std::vector<PartialTensorShape> output_shapes,
+                             string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        seed_(seed),
+        seed2_(seed2),
+        reshuffle_each_iteration_(reshuffle_each_iteration) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    return {CreateTensor<int64_t>(TensorShape({}), {seed_}),
+            CreateTensor<int64_t>(TensorShape({}), {seed2_})};
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {GlobalShuffleDatasetOp::kInputDataset,
+                    GlobalShuffleDatasetOp::kSeed,
+                    GlobalShuffleDatasetOp::kSeed2};
+    return OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {
+        {GlobalShuffleDatasetOp::kReshuffleEachIteration,
+         reshuffle_each_iteration_},
+        {GlobalShuffleDatasetOp::kOutputTypes, output_dtypes_},
+        {GlobalShuffleDatasetOp::kOutputShapes, output_shapes_},
+        {"metadata", ""}};
+    return OkStatus();
+  }
+
+  string dataset_type() const override {
+    return GlobalShuffleDatasetOp::kDatasetType;
+  }
+
+ private:
+  int64_t seed_;
+  int64_t seed2_;
+  bool reshuffle_each_iteration_;
+};
+
+class GlobalShuffleDatasetOpTest : public DatasetOpsTestBase {
+ protected:
+  // Returns all the elements of the current iterator.
+  Status GetAllElements(std::vector<Tensor>* out_tensors) {
+    bool end_of_sequence = false;
+    while (!end_of_sequence) {
+      std::vector<Tensor> next;
+      TF_RETURN_IF_ERROR(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors->insert(out_tensors->end(), next.begin(), next.end());
+    }
+    return OkStatus();
+  }
+};
+
+GlobalShuffleDatasetParams ShuffleRangeParams(int64_t stop,
+                                              bool reshuffle_each_iteration) {
+  return GlobalShuffleDatasetParams(
+      RangeDatasetParams(0, stop, 1),
+      /*seed=*/1,
+      /*seed2=*/2,
+      /*reshuffle_each_iteration=*/reshuffle_each_iteration,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})},
+      /*node_name=*/kNodeName);
+}
+
+std::vector<Tensor> Range(int64_t stop) {
+  std::vector<Tensor> tensors;
+  for (int64_t i = 0; i < stop; ++i) {
+    tensors.push_back(CreateTensor<int64_t>(TensorShape({}), {i}));
+  }
+  return tensors;
+}
+
+class ParameterizedPermutationTest
+    : public GlobalShuffleDatasetOpTest,
+      public ::testing::WithParamInterface<int64_t> {};
+
+TEST_P(ParameterizedPermutationTest, ProducesPermutation) {
+  const int64_t stop = GetParam();
+  auto dataset_params = ShuffleRangeParams(stop,
+                                           /*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetAllElements(&out_tensors));
+  TF_EXPECT_OK(ExpectEqual(out_tensors, Range(stop),
+                           /*compare_order=*/false));
+}
+
+INSTANTIATE_TEST_SUITE_P(GlobalShuffleDatasetOpTest,
+                         ParameterizedPermutationTest,
+                         ::testing::Values(0, 1, 2, 10, 100, 1024));
+
+TEST_F(GlobalShuffleDatasetOpTest, Shuffles) {
+  auto dataset_params = ShuffleRangeParams(100,
+                                           /*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  TF_ASSERT_OK(GetAllElements(&out_tensors));
+  EXPECT_FALSE(ExpectEqual(out_tensors, Range(100),
+                           /*compare_order=*/true)
+                   .ok());
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, FixedSeeds) {
+  auto dataset_params = ShuffleRangeParams(100,
+                                           /*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> shuffled;
+  TF_ASSERT_OK(GetAllElements(&shuffled));
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> reshuffled;
+  TF_ASSERT_OK(GetAllElements(&reshuffled));
+  TF_EXPECT_OK(ExpectEqual(shuffled, reshuffled, /*compare_order=*/true));
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, ReshuffleEachIteration) {
+  auto dataset_params = ShuffleRangeParams(100,
+                                           /*reshuffle_each_iteration=*/true);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> shuffled;
+  TF_ASSERT_OK(GetAllElements(&shuffled));
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+  std::vector<Tensor> reshuffled;
+  TF_ASSERT_OK(GetAllElements(&reshuffled));
+  TF_EXPECT_OK(ExpectEqual(shuffled, reshuffled, /*compare_order=*/false));
+  EXPECT_FALSE(ExpectEqual(shuffled, reshuffled, /*compare_order=*/true).ok());
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, RandomAccess) {
+  auto dataset_params = ShuffleRangeParams(100,
+                                           /*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> shuffled;
+  TF_ASSERT_OK(GetAllElements(&shuffled));
+  std::vector<Tensor> elements;
+  for (int64_t i = 0; i < 100; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(dataset_->Get(iterator_ctx_.get(), i, &element));
+    elements.insert(elements.end(), element.begin(), element.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(elements, shuffled, /*compare_order=*/true));
+  std::vector<Tensor> element;
+  EXPECT_EQ(dataset_->Get(iterator_ctx_.get(), 100, &element).code(),
+            absl::StatusCode::kOutOfRange);
+}
+
+TEST_F(GlobalShuffleDatasetOpTest, SaveAndRestore) {
+  auto dataset_params = ShuffleRangeParams(10,
+                                           /*reshuffle_each_iteration=*/false);
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> expected_outputs;
+  TF_ASSERT_OK(GetAllElements(&expected_outputs));
+  TF_ASSERT_OK(dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                      dataset_params.iterator_prefix(),
+                                      &iterator_));
+
+  std::unique_ptr<SerializationContext> serialization_ctx;
+  TF_ASSERT_OK(CreateSerializationContext(&serialization_ctx));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  int cur_iteration = 0;
+  for (int breakpoint : {0, 4, 11}) {
+    VariantTensorDataWriter writer;
+    TF_EXPECT_OK(iterator_->Save(serialization_ctx.get(), &writer));
+    std::vector<const VariantTensorData*> data;
+    writer.GetData(&data);
+    VariantTensorDataReader reader(data);
+    TF_EXPECT_OK(RestoreIterator(iterator_ctx_.get(), &reader,
+                                 dataset_params.iterator_prefix(), *dataset_,
+                                 &iterator_));
+    while (cur_iteration <= breakpoint) {
+      std::vector<Tensor> next;
+      TF_EXPECT_OK(
+          iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+      out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+      cur_iteration++;
+    }
+  }
+  TF_EXPECT_OK(ExpectEqual(out_tensors, expected_outputs,
+                           /*compare_order=*/true));
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,93 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/data/columnar_records.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// Writes a tensor per column, whose first dimension is the record index, to a
+// columnar records file.
+class WriteColumnarRecordsOp : public OpKernel {
+ public:
+  explicit WriteColumnarRecordsOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("records_per_chunk",
+                                     &options_.records_per_chunk));
+    std::string codec;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("codec", &codec));
+    OP_REQUIRES_OK(ctx,
+                   ParseCompressionCodec(codec, &options_.compression.codec));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor* filename;
+    OP_REQUIRES_OK(ctx, ctx->input("filename", &filename));
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(filename->shape()),
+                errors::InvalidArgument("`filename` must be a scalar."));
+    const Tensor* names;
+    OP_REQUIRES_OK(ctx, ctx->input("columns", &names));
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(names->shape()),
+                errors::InvalidArgument("`columns` must be a vector."));
+    OpInputList values;
+    OP_REQUIRES_OK(ctx, ctx->input_list("values", &values));
+    OP_REQUIRES(ctx, names->NumElements() == values.size(),
+                errors::InvalidArgument(
+                    "`columns` must have an element per value, got ",
+                    names->NumElements(), " columns and ", values.size(),
+                    " values."));
+
+    std::vector<ColumnarRecordsColumn> columns(values.size());
+    std::vector<Tensor> column_values(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+      OP_REQUIRES(ctx, values[i].dims() >= 1,
+                  errors::InvalidArgument(
+                      "The values of the columns must have a dimension for "
+                      "the records, got a scalar for column ",
+                      names->vec<tstring>()(i)));
+      columns[i].name = names->vec<tstring>()(i);
+      columns[i].dtype = values[i].dtype();
+      columns[i].shape = values[i].shape();
+      columns[i].shape.RemoveDim(0);
+      column_values[i] = values[i];
+    }
+
+    std::unique_ptr<ColumnarRecordsWriter> writer;
+    OP_REQUIRES_OK(ctx, ColumnarRecordsWriter::Create(
+                            ctx->env(), filename->scalar<tstring>()(),
+                            std::move(columns), options_, &writer));
+    OP_REQUIRES_OK(ctx, writer->Write(column_values));
+    OP_REQUIRES_OK(ctx, writer->Close());
+  }
+
+ private:
+  ColumnarRecordsWriterOptions options_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("WriteColumnarRecords").Device(DEVICE_CPU),
+                        WriteColumnarRecordsOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
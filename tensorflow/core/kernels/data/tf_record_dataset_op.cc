@@ -14,6 +14,12 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -25,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
@@ -45,6 +52,29 @@ constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+// The number of files that random access keeps open.
+constexpr size_t kMaxOpenFiles = 16;
+// Bound on TF_RECORD_DATASET_READAHEAD_BUFFERS.
+constexpr int64_t kMaxReadaheadBuffers = 16;
+
+// Returns the number of buffers whose reads are kept in flight by the readers
+// of buffered datasets, for files that support asynchronous reads. Each reader
+// then holds that many more buffers of `buffer_size` bytes, which adds up with
+// interleaved files, so readahead is off unless the
+// TF_RECORD_DATASET_READAHEAD_BUFFERS environment variable is set.
+int64_t ReadaheadBuffers() {
+  static const int64_t readahead_buffers = [] {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar("TF_RECORD_DATASET_READAHEAD_BUFFERS",
+                                   /*default_val=*/0, &value);
+    if (!s.ok()) {
+      LOG(WARNING) << s;
+      return int64_t{0};
+    }
+    return std::clamp<int64_t>(value, 0, kMaxReadaheadBuffers);
+  }();
+  return readahead_buffers;
+}
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -68,6 +98,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
         op_version_(op_version) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
+      options_.readahead_buffers = ReadaheadBuffers();
     }
   }
 
@@ -96,12 +127,70 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     return name_utils::DatasetDebugString(kDatasetType, params);
   }
 
+  // The cardinality is only computed for random access, as it requires
+  // indexing the records of all the files.
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    if (options.compute_level() <
+            CardinalityOptions::CARDINALITY_COMPUTE_MODERATE ||
+        options_.compression_type != io::RecordReaderOptions::NONE) {
+      return kUnknownCardinality;
+    }
+    mutex_lock l(index_mu_);
+    Status s = BuildRecordIndexLocked();
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to index the records of " << DebugString()
+                   << ": " << s;
+      return kUnknownCardinality;
+    }
+    return file_first_record_.back();
+  }
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
     return OkStatus();
   }
 
   Status CheckExternalState() const override { return OkStatus(); }
 
+  Status Get(AnyContext ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    size_t file_index;
+    uint64 offset;
+    std::shared_ptr<RandomAccessFile> file;
+    {
+      mutex_lock l(index_mu_);
+      TF_RETURN_IF_ERROR(BuildRecordIndexLocked());
+      file_index = std::upper_bound(file_first_record_.begin(),
+                                    file_first_record_.end(), index) -
+                   file_first_record_.begin() - 1;
+      offset = record_offsets_[file_index]
+                               [index - file_first_record_[file_index]];
+      file = FindOpenFileLocked(file_index);
+    }
+    if (file == nullptr) {
+      // Opened without the lock, as it may be a round trip to a remote file
+      // system.
+      std::unique_ptr<RandomAccessFile> new_file;
+      TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(
+          TranslateFileName(filenames_[file_index]), &new_file));
+      mutex_lock l(index_mu_);
+      file = FindOpenFileLocked(file_index);
+      if (file == nullptr) {
+        file = std::move(new_file);
+        open_files_.emplace_front(file_index, file);
+        if (open_files_.size() > kMaxOpenFiles) open_files_.pop_back();
+      }
+    }
+    // Reading a record at an offset of an uncompressed file does not depend on
+    // earlier reads, so the reader is only a cheap wrapper of the shared file.
+    io::RecordReader reader(file.get());
+    Tensor record(ctx.allocator, DT_STRING, TensorShape({}));
+    TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &record.scalar<tstring>()()));
+    out_tensors->clear();
+    out_tensors->push_back(std::move(record));
+    return OkStatus();
+  }
+
  protected:
   Status AsGraphDefInternal(SerializationContext* ctx,
                             DatasetGraphDefBuilder* b,
@@ -287,11 +376,68 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
   };
 
+  // Reads the offsets of the records of all the files, unless already done,
+  // by skipping from record header to record header.
+  Status BuildRecordIndexLocked() const TF_EXCLUSIVE_LOCKS_REQUIRED(index_mu_) {
+    if (!file_first_record_.empty()) {
+      return OkStatus();
+    }
+    std::vector<std::vector<uint64>> record_offsets(filenames_.size());
+    std::vector<int64_t> file_first_record = {0};
+    for (size_t i = 0; i < filenames_.size(); ++i) {
+      std::unique_ptr<RandomAccessFile> file;
+      TF_RETURN_IF_ERROR(Env::Default()->NewRandomAccessFile(
+          TranslateFileName(filenames_[i]), &file));
+      io::RecordReader reader(file.get());
+      uint64 offset = byte_offsets_.empty() ? 0 : byte_offsets_[i];
+      while (true) {
+        const uint64 record_offset = offset;
+        int num_skipped;
+        Status s = reader.SkipRecords(&offset, 1, &num_skipped);
+        if (errors::IsOutOfRange(s)) {
+          break;
+        }
+        TF_RETURN_IF_ERROR(s);
+        record_offsets[i].push_back(record_offset);
+      }
+      file_first_record.push_back(file_first_record.back() +
+                                  record_offsets[i].size());
+    }
+    record_offsets_ = std::move(record_offsets);
+    file_first_record_ = std::move(file_first_record);
+    return OkStatus();
+  }
+
+  // Returns the file of `filenames_[file_index]` if it is one of the
+  // `open_files_`, and marks it as the most recently used one.
+  std::shared_ptr<RandomAccessFile> FindOpenFileLocked(size_t file_index) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(index_mu_) {
+    for (auto it = open_files_.begin(); it != open_files_.end(); ++it) {
+      if (it->first == file_index) {
+        open_files_.splice(open_files_.begin(), open_files_, it);
+        return it->second;
+      }
+    }
+    return nullptr;
+  }
+
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
   const std::vector<int64_t> byte_offsets_;
   const int op_version_;
+
+  // The index of the records, for random access: the offsets of the records of
+  // each file, and the index of the first record of each file, followed by the
+  // number of records. The index takes 8 bytes per record.
+  mutable mutex index_mu_;
+  mutable std::vector<std::vector<uint64>> record_offsets_
+      TF_GUARDED_BY(index_mu_);
+  mutable std::vector<int64_t> file_first_record_ TF_GUARDED_BY(index_mu_);
+  // The files most recently read by `Get`, by index in `filenames_`, from the
+  // most recently used one.
+  mutable std::list<std::pair<size_t, std::shared_ptr<RandomAccessFile>>>
+      open_files_ TF_GUARDED_BY(index_mu_);
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
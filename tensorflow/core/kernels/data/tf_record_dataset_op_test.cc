@@ -13,6 +13,7 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/lib/io/record_reader.h"
@@ -300,6 +301,54 @@ TEST_F(TFRecordDatasetOpTest, Cardinality) {
   TF_ASSERT_OK(CheckDatasetCardinality(kUnknownCardinality));
 }
 
+class TFRecordDatasetRandomAccessTest
+    : public TFRecordDatasetOpTest,
+      public ::testing::WithParamInterface<
+          GetNextTestCase<TFRecordDatasetParams>> {};
+
+TEST_P(TFRecordDatasetRandomAccessTest, Get) {
+  auto test_case = GetParam();
+  TF_ASSERT_OK(Initialize(test_case.dataset_params));
+  const int64_t num_records = test_case.expected_outputs.size();
+  CardinalityOptions options;
+  options.set_compute_level(CardinalityOptions::CARDINALITY_COMPUTE_MODERATE);
+  EXPECT_EQ(dataset_->Cardinality(options), num_records);
+  // Reads the records out of order, and then again from the open files.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int64_t i = num_records - 1; i >= 0; --i) {
+      std::vector<Tensor> out_tensors;
+      TF_ASSERT_OK(dataset_->Get(dataset_ctx_.get(), i, &out_tensors));
+      TF_EXPECT_OK(ExpectEqual(out_tensors, {test_case.expected_outputs[i]},
+                               /*compare_order=*/true));
+    }
+  }
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(dataset_->Get(dataset_ctx_.get(), num_records, &out_tensors).code(),
+            absl::StatusCode::kOutOfRange);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    TFRecordDatasetOpTest, TFRecordDatasetRandomAccessTest,
+    ::testing::ValuesIn(std::vector<GetNextTestCase<TFRecordDatasetParams>>{
+        {/*dataset_params=*/TFRecordDatasetParams3(),
+         /*expected_outputs=*/
+         CreateTensors<tstring>(
+             TensorShape({}),
+             {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+        {/*dataset_params=*/TFRecordDatasetParams4(),
+         /*expected_outputs=*/
+         CreateTensors<tstring>(
+             TensorShape({}),
+             {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})}}));
+
+TEST_F(TFRecordDatasetOpTest, RandomAccessCompressed) {
+  auto dataset_params = TFRecordDatasetParams1();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  std::vector<Tensor> out_tensors;
+  EXPECT_EQ(dataset_->Get(dataset_ctx_.get(), 0, &out_tensors).code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
 TEST_F(TFRecordDatasetOpTest, IteratorOutputDtypes) {
   auto dataset_params = TFRecordDatasetParams1();
   TF_ASSERT_OK(Initialize(dataset_params));
@@ -0,0 +1,311 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements _FusedGatherSparseSegmentReduction, the composition of
+//   SparseSegment{Sum,Mean,SqrtN}(Mul(GatherV2(params, ids), weights),
+//                                 indices, segment_ids)
+// that reads each embedding row straight from `params` into a per-segment
+// accumulator instead of materializing the gathered [nnz, dim] tensor.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+namespace {
+
+enum class Combiner { kSum, kMean, kSqrtN };
+
+// How many indices ahead of the current one to prefetch the embedding row.
+constexpr int64_t kPrefetchDistance = 4;
+
+// A run of consecutive `indices` that share one segment id.
+struct Segment {
+  int64_t segment_id;
+  int64_t begin;
+  int64_t end;
+};
+
+// The validated inputs and the output of one lookup.
+template <typename T, typename Tids, typename Tidx>
+struct Lookup {
+  const Tids* ids = nullptr;
+  const Tidx* indices = nullptr;
+  // Null if the lookup is not weighted. `num_weights` is 1 if one weight is
+  // broadcast to all rows.
+  const T* weights = nullptr;
+  int64_t num_weights = 0;
+  std::vector<Segment> segments;
+  T* output = nullptr;
+};
+
+}  // namespace
+
+template <typename T, typename Tids, typename Tidx, typename Tsegmentids>
+class FusedGatherSparseSegmentReductionOp : public OpKernel {
+ public:
+  explicit FusedGatherSparseSegmentReductionOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("N", &num_lookups_));
+    int num_weights;
+    OP_REQUIRES_OK(context, context->GetAttr("num_weights", &num_weights));
+    OP_REQUIRES(context, num_weights == 0 || num_weights == num_lookups_,
+                errors::InvalidArgument(
+                    "num_weights must be 0 or equal to N, got num_weights=",
+                    num_weights, " and N=", num_lookups_));
+    has_weights_ = num_weights > 0;
+    std::string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    if (combiner == "sum") {
+      combiner_ = Combiner::kSum;
+    } else if (combiner == "mean") {
+      combiner_ = Combiner::kMean;
+    } else if (combiner == "sqrtn") {
+      combiner_ = Combiner::kSqrtN;
+    } else {
+      context->CtxFailure(
+          errors::InvalidArgument("Unsupported combiner: ", combiner));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& params = context->input(0);
+    OP_REQUIRES(context, TensorShapeUtils::IsMatrix(params.shape()),
+                errors::InvalidArgument("params must be a matrix, got shape ",
+                                        params.shape().DebugString()));
+    const int64_t num_rows = params.dim_size(0);
+    const int64_t dim = params.dim_size(1);
+
+    OpInputList ids_list, indices_list, segment_ids_list, weights_list;
+    OP_REQUIRES_OK(context, context->input_list("ids", &ids_list));
+    OP_REQUIRES_OK(context, context->input_list("indices", &indices_list));
+    OP_REQUIRES_OK(context,
+                   context->input_list("segment_ids", &segment_ids_list));
+    OP_REQUIRES_OK(context, context->input_list("weights", &weights_list));
+    OpOutputList outputs;
+    OP_REQUIRES_OK(context, context->output_list("output", &outputs));
+
+    std::vector<Lookup<T, Tids, Tidx>> lookups(num_lookups_);
+    // (lookup, segment) pairs, the unit of parallel work.
+    std::vector<std::pair<int, int64_t>> work;
+    int64_t total_indices = 0;
+    for (int i = 0; i < num_lookups_; ++i) {
+      OP_REQUIRES_OK(context,
+                     PrepareLookup(i, num_rows, dim, ids_list[i],
+                                   indices_list[i], segment_ids_list[i],
+                                   has_weights_ ? &weights_list[i] : nullptr,
+                                   &outputs, &lookups[i]));
+      for (int64_t s = 0; s < static_cast<int64_t>(lookups[i].segments.size());
+           ++s) {
+        work.emplace_back(i, s);
+      }
+      total_indices += indices_list[i].NumElements();
+    }
+    if (work.empty()) return;
+
+    const T* params_data = params.flat<T>().data();
+    auto compute = [&](int64_t start, int64_t limit) {
+      std::vector<float> buffer;
+      if (!std::is_same<T, float>::value) buffer.resize(dim);
+      for (int64_t w = start; w < limit; ++w) {
+        const Lookup<T, Tids, Tidx>& lookup = lookups[work[w].first];
+        ReduceSegment(params_data, dim, lookup,
+                      lookup.segments[work[w].second], buffer.data());
+      }
+    };
+    const int64_t num_work_units = work.size();
+    const int64_t cost_per_unit =
+        std::max<int64_t>(1, total_indices / num_work_units) * dim * 2;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers, num_work_units,
+          cost_per_unit, compute);
+  }
+
+ private:
+  // Validates the inputs of lookup `i`, allocates its output, zero-fills the
+  // output rows of empty segments and splits `indices` into segments.
+  Status PrepareLookup(int i, int64_t num_rows, int64_t dim, const Tensor& ids,
+                       const Tensor& indices, const Tensor& segment_ids,
+                       const Tensor* weights, OpOutputList* outputs,
+                       Lookup<T, Tids, Tidx>* lookup) {
+    if (!TensorShapeUtils::IsVector(ids.shape())) {
+      return errors::InvalidArgument("ids must be a vector, got shape ",
+                                     ids.shape().DebugString());
+    }
+    if (!TensorShapeUtils::IsVector(indices.shape())) {
+      return errors::InvalidArgument("indices should be a vector.");
+    }
+    if (!TensorShapeUtils::IsVector(segment_ids.shape())) {
+      return errors::InvalidArgument("segment_ids should be a vector.");
+    }
+    const int64_t num_ids = ids.NumElements();
+    const int64_t num_indices = indices.NumElements();
+    if (num_indices != segment_ids.NumElements()) {
+      return errors::InvalidArgument(
+          "segment_ids and indices should have same size.");
+    }
+    if (weights != nullptr) {
+      if (weights->NumElements() != num_ids && weights->NumElements() != 1) {
+        return errors::InvalidArgument(
+            "weights must have one element per id or a single element, got "
+            "shape ",
+            weights->shape().DebugString(), " for ", num_ids, " ids");
+      }
+      lookup->weights = weights->flat<T>().data();
+      lookup->num_weights = weights->NumElements();
+    }
+
+    const auto ids_vec = ids.vec<Tids>();
+    const auto indices_vec = indices.vec<Tidx>();
+    const auto segment_vec = segment_ids.vec<Tsegmentids>();
+    for (int64_t k = 0; k < num_indices; ++k) {
+      const Tidx index = internal::SubtleMustCopy(indices_vec(k));
+      if (!FastBoundsCheck(index, num_ids)) {
+        return errors::InvalidArgument("indices[", k, "] = ", index,
+                                       " is out of range [0, ", num_ids, ")");
+      }
+      const Tids id = internal::SubtleMustCopy(ids_vec(index));
+      if (!FastBoundsCheck(id, num_rows)) {
+        return errors::InvalidArgument("ids[", index, "] = ", id,
+                                       " is not in [0, ", num_rows, ")");
+      }
+      const int64_t segment_id = internal::SubtleMustCopy(segment_vec(k));
+      if (lookup->segments.empty() ||
+          lookup->segments.back().segment_id != segment_id) {
+        if (segment_id < 0) {
+          return errors::InvalidArgument("segment ids must be >= 0");
+        }
+        if (!lookup->segments.empty() &&
+            lookup->segments.back().segment_id > segment_id) {
+          return errors::InvalidArgument("segment ids are not increasing");
+        }
+        lookup->segments.push_back({segment_id, k, k + 1});
+      } else {
+        lookup->segments.back().end = k + 1;
+      }
+    }
+
+    const int64_t output_rows =
+        lookup->segments.empty() ? 0 : lookup->segments.back().segment_id + 1;
+    Tensor* output = nullptr;
+    TF_RETURN_IF_ERROR(
+        outputs->allocate(i, TensorShape({output_rows, dim}), &output));
+    lookup->ids = ids_vec.data();
+    lookup->indices = indices_vec.data();
+    lookup->output = output->flat<T>().data();
+
+    // Segments without indices are not visited by `ReduceSegment()`.
+    int64_t next_row = 0;
+    for (const Segment& segment : lookup->segments) {
+      std::fill(lookup->output + next_row * dim,
+                lookup->output + segment.segment_id * dim, T(0));
+      next_row = segment.segment_id + 1;
+    }
+    return OkStatus();
+  }
+
+  // Accumulates the (weighted) embedding rows of `segment` in float and writes
+  // the combined row to the output. `buffer` holds `dim` floats unless T is
+  // float, in which case the output row is the accumulator.
+  void ReduceSegment(const T* params, int64_t dim,
+                     const Lookup<T, Tids, Tidx>& lookup,
+                     const Segment& segment, float* buffer) const {
+    typedef Eigen::Array<float, Eigen::Dynamic, 1> FloatArray;
+    typedef Eigen::Array<T, Eigen::Dynamic, 1> Array;
+    T* output_row = lookup.output + segment.segment_id * dim;
+    float* acc_data = std::is_same<T, float>::value
+                          ? reinterpret_cast<float*>(output_row)
+                          : buffer;
+    Eigen::Map<FloatArray> acc(acc_data, dim);
+    acc.setZero();
+
+    auto row = [&](int64_t k) {
+      return params + static_cast<int64_t>(lookup.ids[lookup.indices[k]]) * dim;
+    };
+    for (int64_t k = segment.begin; k < segment.end; ++k) {
+      if (k + kPrefetchDistance < segment.end) {
+        port::prefetch<port::PREFETCH_HINT_T0>(row(k + kPrefetchDistance));
+      }
+      Eigen::Map<const Array> values(row(k), dim);
+      if (lookup.weights == nullptr) {
+        acc += values.template cast<float>();
+      } else {
+        const int64_t w = lookup.num_weights == 1 ? 0 : lookup.indices[k];
+        acc += values.template cast<float>() *
+               static_cast<float>(lookup.weights[w]);
+      }
+    }
+
+    const int64_t count = segment.end - segment.begin;
+    if (combiner_ == Combiner::kMean) {
+      acc /= static_cast<float>(count);
+    } else if (combiner_ == Combiner::kSqrtN) {
+      acc /= std::sqrt(static_cast<float>(count));
+    }
+    if (!std::is_same<T, float>::value) {
+      Eigen::Map<Array>(output_row, dim) = acc.template cast<T>();
+    }
+  }
+
+  int num_lookups_;
+  bool has_weights_;
+  Combiner combiner_ = Combiner::kSum;
+};
+
+#define REGISTER_KERNEL(T, Tids, Tidx, Tsegmentids)                      \
+  REGISTER_KERNEL_BUILDER(                                               \
+      Name("_FusedGatherSparseSegmentReduction")                         \
+          .Device(DEVICE_CPU)                                            \
+          .TypeConstraint<T>("T")                                        \
+          .TypeConstraint<Tids>("Tids")                                  \
+          .TypeConstraint<Tidx>("Tidx")                                  \
+          .TypeConstraint<Tsegmentids>("Tsegmentids"),                   \
+      FusedGatherSparseSegmentReductionOp<T, Tids, Tidx, Tsegmentids>);
+
+#define REGISTER_KERNELS_FOR_SEGMENT_IDS(T, Tids, Tidx) \
+  REGISTER_KERNEL(T, Tids, Tidx, int32);                \
+  REGISTER_KERNEL(T, Tids, Tidx, int64_t);
+
+#define REGISTER_KERNELS_FOR_INDICES(T, Tids)         \
+  REGISTER_KERNELS_FOR_SEGMENT_IDS(T, Tids, int32);   \
+  REGISTER_KERNELS_FOR_SEGMENT_IDS(T, Tids, int64_t);
+
+#define REGISTER_CPU_KERNELS(T)                \
+  REGISTER_KERNELS_FOR_INDICES(T, int32);      \
+  REGISTER_KERNELS_FOR_INDICES(T, int64_t);
+
+TF_CALL_float(REGISTER_CPU_KERNELS);
+TF_CALL_bfloat16(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+#undef REGISTER_KERNELS_FOR_INDICES
+#undef REGISTER_KERNELS_FOR_SEGMENT_IDS
+#undef REGISTER_KERNEL
+
+}  // namespace tensorflow
@@ -0,0 +1,123 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedGatherSparseSegmentReductionOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(int num_lookups, bool weighted, const string& combiner) {
+    TF_ASSERT_OK(NodeDefBuilder("fused", "_FusedGatherSparseSegmentReduction")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(num_lookups, DT_INT32))
+                     .Input(FakeInput(num_lookups, DT_INT32))
+                     .Input(FakeInput(num_lookups, DT_INT32))
+                     .Input(FakeInput(weighted ? num_lookups : 0, DT_FLOAT))
+                     .Attr("combiner", combiner)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // params = [[1, 2], [3, 4], [5, 6], [7, 8]]
+  void AddParams() {
+    AddInputFromArray<float>(TensorShape({4, 2}), {1, 2, 3, 4, 5, 6, 7, 8});
+  }
+};
+
+// The gathered rows are [[7, 8], [1, 2], [5, 6]], segment 1 is empty.
+TEST_F(FusedGatherSparseSegmentReductionOpTest, Sum) {
+  MakeOp(/*num_lookups=*/1, /*weighted=*/false, "sum");
+  AddParams();
+  AddInputFromArray<int32>(TensorShape({3}), {3, 0, 2});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 1});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {8, 10, 0, 0, 6, 8});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedGatherSparseSegmentReductionOpTest, WeightedMean) {
+  MakeOp(/*num_lookups=*/1, /*weighted=*/true, "mean");
+  AddParams();
+  AddInputFromArray<int32>(TensorShape({3}), {3, 0, 2});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 1});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  AddInputFromArray<float>(TensorShape({3, 1}), {0.5, 2, 1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {2.75, 4, 0, 0, 3.5, 5});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedGatherSparseSegmentReductionOpTest, SqrtNWithTwoLookups) {
+  MakeOp(/*num_lookups=*/2, /*weighted=*/false, "sqrtn");
+  AddParams();
+  AddInputFromArray<int32>(TensorShape({3}), {3, 0, 2});
+  AddInputFromArray<int32>(TensorShape({1}), {1});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 1});
+  AddInputFromArray<int32>(TensorShape({1}), {0});
+  AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  AddInputFromArray<int32>(TensorShape({1}), {1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const float sqrt2 = std::sqrt(2.0f);
+  Tensor expected0(DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(
+      &expected0, {8 / sqrt2, 10 / sqrt2, 0, 0, 6 / sqrt2, 8 / sqrt2});
+  test::ExpectTensorNear<float>(expected0, *GetOutput(0), 1e-6);
+  Tensor expected1(DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&expected1, {0, 0, 3, 4});
+  test::ExpectTensorNear<float>(expected1, *GetOutput(1), 1e-6);
+}
+
+TEST_F(FusedGatherSparseSegmentReductionOpTest, IdOutOfRange) {
+  MakeOp(/*num_lookups=*/1, /*weighted=*/false, "sum");
+  AddParams();
+  AddInputFromArray<int32>(TensorShape({2}), {0, 4});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.message(), "ids[1] = 4 is not in [0, 4)"))
+      << s;
+}
+
+TEST_F(FusedGatherSparseSegmentReductionOpTest, SegmentIdsNotIncreasing) {
+  MakeOp(/*num_lookups=*/1, /*weighted=*/false, "sum");
+  AddParams();
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {1, 0});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(errors::IsInvalidArgument(s));
+  EXPECT_TRUE(absl::StrContains(s.message(), "not increasing")) << s;
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,16 +15,22 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +106,175 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+class ShardedMutableHashTableTest : public OpsTestBase,
+                                    public ::testing::WithParamInterface<int> {
+ protected:
+  // Runs AnonymousMutableHashTable with `num_shards` set to the test parameter
+  // and returns the created table.
+  lookup::LookupInterface* MakeTable() {
+    TF_CHECK_OK(NodeDefBuilder("table", "AnonymousMutableHashTable")
+                    .Attr("key_dtype", DT_INT64)
+                    .Attr("value_dtype", DT_INT64)
+                    .Attr("num_shards", GetParam())
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    TF_CHECK_OK(RunOpKernel());
+    auto table_or = GetOutput(0)
+                        ->scalar<ResourceHandle>()()
+                        .GetResource<lookup::LookupInterface>();
+    TF_CHECK_OK(table_or.status());
+    return table_or.value();
+  }
+};
+
+TEST_P(ShardedMutableHashTableTest, InsertFindRemove) {
+  lookup::LookupInterface* table = MakeTable();
+  EXPECT_EQ(table->size(), 0);
+
+  const int64_t kNumKeys = 1000;
+  Tensor keys(DT_INT64, TensorShape({kNumKeys}));
+  Tensor values(DT_INT64, TensorShape({kNumKeys}));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    keys.flat<int64_t>()(i) = i * 64;
+    values.flat<int64_t>()(i) = i;
+  }
+  TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+  EXPECT_EQ(table->size(), kNumKeys);
+
+  // Overwrite the first key and look up a key that is not in the table.
+  TF_ASSERT_OK(table->Insert(context_.get(),
+                             test::AsTensor<int64_t>({0}, TensorShape({1})),
+                             test::AsTensor<int64_t>({-5}, TensorShape({1}))));
+  EXPECT_EQ(table->size(), kNumKeys);
+
+  Tensor lookup_keys = test::AsTensor<int64_t>({0, 64, 65, 128});
+  Tensor result(DT_INT64, TensorShape({4}));
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &result,
+                           test::AsScalar<int64_t>(-1)));
+  test::ExpectTensorEqual<int64_t>(result,
+                                   test::AsTensor<int64_t>({-5, 1, -1, 2}));
+
+  TF_ASSERT_OK(
+      table->Remove(context_.get(), test::AsTensor<int64_t>({64, 65})));
+  EXPECT_EQ(table->size(), kNumKeys - 1);
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &result,
+                           test::AsScalar<int64_t>(-1)));
+  test::ExpectTensorEqual<int64_t>(result,
+                                   test::AsTensor<int64_t>({-5, -1, -1, 2}));
+
+  // Importing replaces the contents of every shard.
+  TF_ASSERT_OK(table->ImportValues(context_.get(),
+                                   test::AsTensor<int64_t>({65, 128}),
+                                   test::AsTensor<int64_t>({7, 8})));
+  EXPECT_EQ(table->size(), 2);
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &result,
+                           test::AsScalar<int64_t>(-1)));
+  test::ExpectTensorEqual<int64_t>(result,
+                                   test::AsTensor<int64_t>({-1, -1, 7, 8}));
+}
+
+TEST_P(ShardedMutableHashTableTest, LargeBatchFind) {
+  lookup::LookupInterface* table = MakeTable();
+
+  // Large enough to take the parallel lookup path of sharded tables.
+  const int64_t kNumKeys = 100000;
+  Tensor keys(DT_INT64, TensorShape({kNumKeys}));
+  Tensor values(DT_INT64, TensorShape({kNumKeys}));
+  Tensor defaults(DT_INT64, TensorShape({kNumKeys}));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    keys.flat<int64_t>()(i) = i;
+    values.flat<int64_t>()(i) = 2 * i;
+    defaults.flat<int64_t>()(i) = -i;
+  }
+  TF_ASSERT_OK(table->Insert(context_.get(), keys, values));
+
+  // Every odd key is missing and falls back to its own default.
+  Tensor lookup_keys(DT_INT64, TensorShape({kNumKeys}));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    lookup_keys.flat<int64_t>()(i) = i % 2 == 0 ? i : kNumKeys + i;
+  }
+  Tensor result(DT_INT64, TensorShape({kNumKeys}));
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &result, defaults));
+  for (int64_t i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(result.flat<int64_t>()(i), i % 2 == 0 ? 2 * i : -i);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(NumShards, ShardedMutableHashTableTest,
+                         ::testing::Values(0, 1, 16));
+
+// Builds a graph with `num_readers` LookupTableFindV2 and `num_writers`
+// LookupTableInsertV2 nodes that all operate on the same MutableHashTableV2
+// concurrently.
+static Graph* MutableHashTableContention(int num_shards, int num_readers,
+                                         int num_writers, int batch_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableHashTableV2")
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_FLOAT)
+                  .Attr("shared_name", "contention_table")
+                  .Attr("num_shards", num_shards)
+                  .Finalize(g, &table));
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  const int64_t kVocabSize = 1 << 20;
+  auto random_keys = [&]() {
+    Tensor keys(DT_INT64, TensorShape({batch_size}));
+    for (int i = 0; i < batch_size; ++i) {
+      keys.flat<int64_t>()(i) = rnd.Uniform64(kVocabSize);
+    }
+    return keys;
+  };
+  Tensor values(DT_FLOAT, TensorShape({batch_size}));
+  values.flat<float>().setRandom();
+  Node* default_value = test::graph::Constant(g, test::AsScalar<float>(0.f));
+
+  for (int i = 0; i < num_writers; ++i) {
+    Node* insert;
+    TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                    .Input(table)
+                    .Input(test::graph::Constant(g, random_keys()))
+                    .Input(test::graph::Constant(g, values))
+                    .Finalize(g, &insert));
+  }
+  for (int i = 0; i < num_readers; ++i) {
+    Node* find;
+    TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                    .Input(table)
+                    .Input(test::graph::Constant(g, random_keys()))
+                    .Input(default_value)
+                    .Finalize(g, &find));
+  }
+  return g;
+}
+
+// Mixed readers and writers on one table. Args are the number of shards and
+// the number of concurrent writers; every run also has 8 readers.
+static void BM_MutableHashTableContention(::testing::benchmark::State& state) {
+  const int num_shards = state.range(0);
+  const int num_writers = state.range(1);
+  const int kNumReaders = 8;
+  const int kBatchSize = 4096;
+
+  test::Benchmark("cpu",
+                  MutableHashTableContention(num_shards, kNumReaders,
+                                             num_writers, kBatchSize),
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          (kNumReaders + num_writers) * kBatchSize);
+}
+
+BENCHMARK(BM_MutableHashTableContention)
+    ->UseRealTime()
+    ->ArgPair(0, 1)
+    ->ArgPair(0, 4)
+    ->ArgPair(16, 1)
+    ->ArgPair(16, 4)
+    ->ArgPair(64, 1)
+    ->ArgPair(64, 4);
+
 }  // namespace
 }  // namespace tensorflow
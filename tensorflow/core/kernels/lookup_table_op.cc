@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -212,6 +213,338 @@ class MutableHashTableOfScalars final : public LookupInterface {
   std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
 };
 
+// Lookup table with the same semantics as MutableHashTableOfScalars, but the
+// keys are partitioned by hash into `num_shards` independently locked
+// unordered_maps. Writers only block readers of the shards they touch, and
+// each call takes every shard lock at most once: the keys of a batch are first
+// grouped by shard and then processed shard by shard. Large Find batches are
+// additionally spread over the intra-op thread pool, one range of shards per
+// worker.
+//
+// The table is created by MutableHashTableV2 and AnonymousMutableHashTable
+// when their `num_shards` attr is greater than 1.
+template <class K, class V>
+class ShardedMutableHashTableOfScalars final : public LookupInterface {
+ public:
+  ShardedMutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel,
+                                   int64_t num_shards)
+      : num_shards_(num_shards), shards_(num_shards) {}
+
+  size_t size() const override {
+    size_t ret = 0;
+    for (const TableShard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      ret += shard.table.size();
+    }
+    return ret;
+  }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+
+    int64_t total = value_values.size();
+    int64_t default_total = default_flat.size();
+    bool is_full_size_default = (total == default_total);
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionKeys(key_values, &order, &offsets);
+
+    auto find_in_shards = [&](int64_t begin, int64_t end) {
+      for (int64_t s = begin; s < end; ++s) {
+        const TableShard& shard = shards_[s];
+        tf_shared_lock l(shard.mu);
+        for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+          const int64_t i = order[j];
+          value_values(i) = gtl::FindWithDefault(
+              shard.table, SubtleMustCopyIfIntegral(key_values(i)),
+              is_full_size_default ? default_flat(i) : default_flat(0));
+        }
+      }
+    };
+
+    if (ctx != nullptr && key_values.size() >= kMinParallelFindSize) {
+      const auto* worker_threads =
+          ctx->device()->tensorflow_cpu_worker_threads();
+      const int64_t cost_per_shard =
+          kFindCostPerKey * key_values.size() / num_shards_;
+      Shard(worker_threads->num_threads, worker_threads->workers, num_shards_,
+            cost_per_shard, find_in_shards);
+    } else {
+      find_in_shards(0, num_shards_);
+    }
+    return OkStatus();
+  }
+
+  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionKeys(key_values, &order, &offsets);
+
+    if (clear) {
+      // Importing replaces the whole table, so all shards are held for the
+      // duration of the import to keep it atomic for concurrent readers.
+      std::vector<mutex_lock> all_locks = LockAll();
+      for (int64_t s = 0; s < num_shards_; ++s) {
+        InsertIntoShardLocked(s, /*clear=*/true, key_values, value_values,
+                              order, offsets);
+      }
+      return OkStatus();
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      mutex_lock l(shards_[s].mu);
+      InsertIntoShardLocked(s, /*clear=*/false, key_values, value_values,
+                            order, offsets);
+    }
+    return OkStatus();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    return DoInsert(false, keys, values);
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    const auto key_values = keys.flat<K>();
+
+    std::vector<int64_t> order;
+    std::vector<int64_t> offsets;
+    PartitionKeys(key_values, &order, &offsets);
+
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (offsets[s] == offsets[s + 1]) continue;
+      TableShard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+        shard.table.erase(SubtleMustCopyIfIntegral(key_values(order[j])));
+      }
+    }
+    return OkStatus();
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    return DoInsert(true, keys, values);
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    std::vector<tf_shared_lock> all_locks = LockAllShared();
+    int64_t size = SizeLocked();
+
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+    ExportKeysAndValues(keys, values);
+    return OkStatus();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64_t MemoryUsed() const override {
+    int64_t ret = 0;
+    for (const TableShard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      for (unsigned i = 0; i < shard.table.bucket_count(); ++i) {
+        size_t bucket_size = shard.table.bucket_size(i);
+        if (bucket_size == 0) {
+          ret++;
+        } else {
+          ret += bucket_size;
+        }
+      }
+    }
+    return sizeof(ShardedMutableHashTableOfScalars) +
+           num_shards_ * sizeof(TableShard) + ret;
+  }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    std::vector<tf_shared_lock> all_locks = LockAllShared();
+    int64_t size = SizeLocked();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size}));
+    ExportKeysAndValues(&keys, &values);
+
+    // See MutableHashTableOfScalars::AsGraphDef for why the node name is
+    // shared.
+    Node* table = ops::SourceOp(
+        "MutableHashTableV2",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("num_shards", num_shards_));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return OkStatus();
+  }
+
+ private:
+  // Batches with fewer keys than this are looked up on the calling thread.
+  static constexpr int64_t kMinParallelFindSize = 8192;
+  // Rough cost, in cycles, of hashing and probing a single key.
+  static constexpr int64_t kFindCostPerKey = 100;
+
+  // Each shard sits on its own cache line so that readers of neighbouring
+  // shards do not contend on the lock words.
+  struct alignas(64) TableShard {
+    mutable mutex mu;
+    std::unordered_map<K, V> table TF_GUARDED_BY(mu);
+  };
+
+  // Integral keys are mixed before picking a shard so that strided ids, which
+  // are common for embedding vocabularies, still spread over all shards.
+  template <typename T>
+  static uint64 ShardHash(const T& key) {
+    return static_cast<uint64>(key) * 0x9E3779B97F4A7C15ULL;
+  }
+  static uint64 ShardHash(const tstring& key) { return Hash64(key); }
+
+  int64_t ShardIndex(const K& key) const {
+    return static_cast<int64_t>((ShardHash(key) >> 32) % num_shards_);
+  }
+
+  // Groups the positions of `keys` by the shard that owns them. On return the
+  // keys of shard `s` are at positions `order[offsets[s]]` up to (excluding)
+  // `order[offsets[s + 1]]`, in their original relative order.
+  void PartitionKeys(typename TTypes<K>::ConstFlat keys,
+                     std::vector<int64_t>* order,
+                     std::vector<int64_t>* offsets) const {
+    const int64_t n = keys.size();
+    std::vector<int32> shard_ids(n);
+    offsets->assign(num_shards_ + 1, 0);
+    for (int64_t i = 0; i < n; ++i) {
+      const int64_t s = ShardIndex(SubtleMustCopyIfIntegral(keys(i)));
+      shard_ids[i] = s;
+      ++(*offsets)[s + 1];
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      (*offsets)[s + 1] += (*offsets)[s];
+    }
+    std::vector<int64_t> cursor(offsets->begin(), offsets->end() - 1);
+    order->resize(n);
+    for (int64_t i = 0; i < n; ++i) {
+      (*order)[cursor[shard_ids[i]]++] = i;
+    }
+  }
+
+  // Inserts the keys of shard `s`, as grouped by PartitionKeys, after
+  // optionally clearing the shard.
+  // REQUIRES: shards_[s].mu is held exclusively.
+  void InsertIntoShardLocked(int64_t s, bool clear,
+                             typename TTypes<K>::ConstFlat keys,
+                             typename TTypes<V>::ConstFlat values,
+                             const std::vector<int64_t>& order,
+                             const std::vector<int64_t>& offsets)
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    TableShard& shard = shards_[s];
+    if (clear) {
+      shard.table.clear();
+    }
+    for (int64_t j = offsets[s]; j < offsets[s + 1]; ++j) {
+      const int64_t i = order[j];
+      gtl::InsertOrUpdate(&shard.table, SubtleMustCopyIfIntegral(keys(i)),
+                          SubtleMustCopyIfIntegral(values(i)));
+    }
+  }
+
+  // Acquires an exclusive lock on every shard. Locks are always acquired in
+  // shard order.
+  std::vector<mutex_lock> LockAll() TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<mutex_lock> locks;
+    locks.reserve(num_shards_);
+    for (TableShard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+    }
+    return locks;
+  }
+
+  // Acquires a shared lock on every shard, in shard order, to get a consistent
+  // view of the whole table.
+  std::vector<tf_shared_lock> LockAllShared() const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    std::vector<tf_shared_lock> locks;
+    locks.reserve(num_shards_);
+    for (const TableShard& shard : shards_) {
+      locks.emplace_back(shard.mu);
+    }
+    return locks;
+  }
+
+  // REQUIRES: all shards are locked.
+  int64_t SizeLocked() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    int64_t size = 0;
+    for (const TableShard& shard : shards_) {
+      size += shard.table.size();
+    }
+    return size;
+  }
+
+  // Writes all keys and values into `keys` and `values`, which must be of size
+  // `SizeLocked()`.
+  // REQUIRES: all shards are locked.
+  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64_t i = 0;
+    for (const TableShard& shard : shards_) {
+      for (auto it = shard.table.begin(); it != shard.table.end(); ++it, ++i) {
+        keys_data(i) = it->first;
+        values_data(i) = it->second;
+      }
+    }
+  }
+
+  const int64_t num_shards_;
+  std::vector<TableShard> shards_;
+};
+
+// MutableHashTableV2 and AnonymousMutableHashTable create a
+// ShardedMutableHashTableOfScalars instead of a MutableHashTableOfScalars when
+// `num_shards` is greater than 1. The attr is absent on the legacy
+// MutableHashTable op, which always gets a single-lock table.
+template <class K, class V>
+struct LookupTableFactory<MutableHashTableOfScalars<K, V>> {
+  static LookupInterface* Create(OpKernelContext* ctx, OpKernel* kernel) {
+    int64_t num_shards = 0;
+    if (TryGetNodeAttr(kernel->def(), "num_shards", &num_shards) &&
+        num_shards > 1) {
+      return new ShardedMutableHashTableOfScalars<K, V>(ctx, kernel,
+                                                        num_shards);
+    }
+    return new MutableHashTableOfScalars<K, V>(ctx, kernel);
+  }
+};
+
 // Lookup table that wraps an unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
@@ -34,6 +34,21 @@ limitations under the License.
 
 namespace tensorflow {
 
+namespace lookup {
+
+// Creates the table resource for the lookup table ops below. By default this
+// constructs a 'Container' directly. Containers whose implementation depends on
+// node attrs (e.g. the number of shards) can specialize this to return a
+// different LookupInterface implementation.
+template <class Container>
+struct LookupTableFactory {
+  static LookupInterface* Create(OpKernelContext* ctx, OpKernel* kernel) {
+    return new Container(ctx, kernel);
+  }
+};
+
+}  // namespace lookup
+
 // Lookup table op that supports different table implementations specified by
 // the 'Container' template. Container must be derived from LookupInterface. The
 // key and value are of the templated type "key_dtype" and "value_dtype"
@@ -69,7 +84,8 @@ class LookupTableOp : public OpKernel {
     auto creator =
         [ctx, this](lookup::LookupInterface** ret)
             TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-              lookup::LookupInterface* container = new Container(ctx, this);
+              lookup::LookupInterface* container =
+                  lookup::LookupTableFactory<Container>::Create(ctx, this);
               if (!ctx->status().ok()) {
                 container->Unref();
                 return ctx->status();
@@ -145,7 +161,8 @@ class AnonymousLookupTableOp : public OpKernel {
   explicit AnonymousLookupTableOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
 
   void Compute(OpKernelContext* ctx) override {
-    lookup::LookupInterface* table = new Container(ctx, this);
+    lookup::LookupInterface* table =
+        lookup::LookupTableFactory<Container>::Create(ctx, this);
     if (!ctx->status().ok()) {
       table->Unref();
       return;
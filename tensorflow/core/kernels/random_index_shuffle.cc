@@ -122,7 +122,12 @@ uint64_t index_shuffle(const uint64_t index, const std::array<uint32_t, 3>& key,
   // Block size must be large enough to represent max_index and even (since
   // word size is half of it). We force at least 16 bits as minimum block size
   // since we observed pattern in the permutations below.
-  int block_size = static_cast<int>(std::ceil(std::log2(max_index)));
+  // The bits of max_index are counted, as std::log2 would be one bit short for
+  // powers of two.
+  int block_size = 0;
+  while (block_size < 64 && (max_index >> block_size) != 0) {
+    ++block_size;
+  }
   block_size = std::max(block_size + block_size % 2, kMinBlockSize);
   assert(block_size > 0 && block_size % 2 == 0 && block_size <= 64);
   // At least 4 rounds and number of rounds must be even.
@@ -46,7 +46,8 @@ TEST_P(RandomIndexShuffleTest, Bijection) {
 }
 
 INSTANTIATE_TEST_SUITE_P(MaxValueTests, RandomIndexShuffleTest,
-                         ::testing::Values(285, 17, 23495, 499'000));
+                         ::testing::Values(285, 17, 23495, 499'000,
+                                           1 << 16, 1 << 18));
 
 }  // namespace
 }  // namespace random
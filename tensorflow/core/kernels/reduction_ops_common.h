@@ -221,9 +221,9 @@ class ReductionOp : public OpKernel {
         OP_REQUIRES(ctx, data_reshaped.CopyFrom(data, helper.data_reshape()),
                     errors::Internal("Error during reduction copy."));
         Tensor shuffled;
-        OP_REQUIRES_OK(ctx, ctx->allocate_temp(DataTypeToEnum<T>::value,
-                                               helper.shuffled_shape(),
-                                               &shuffled, alloc_attr));
+        OP_REQUIRES_OK(ctx, ctx->allocate_step_temp(DataTypeToEnum<T>::value,
+                                                    helper.shuffled_shape(),
+                                                    &shuffled, alloc_attr));
         OP_REQUIRES_OK(ctx, DoTranspose(d, data_reshaped, helper.permutation(),
                                         &shuffled));
         const int64_t unreduced = tmp_out.NumElements();
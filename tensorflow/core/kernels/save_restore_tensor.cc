@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -250,6 +251,47 @@ namespace {
 // Tensors larger than this threshold will be restored from a thread-pool.
 const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
 
+// Smaller tensors are restored in contiguous runs of the sorted restore
+// operations, one thread and reader per run, so that separate regions and
+// data shards of the checkpoint are read concurrently. Each run covers at
+// least this many bytes, so that opening another reader pays off.
+const int64_t kMinRestoreGroupBytes = 16 << 20;  // 16MB
+
+// Size of the restore thread pool, overridable with TF_RESTORE_NUM_THREADS.
+const int64_t kDefaultRestoreThreads = 8;
+
+int RestoreNumThreads() {
+  static const int num_threads = [] {
+    int64_t value;
+    Status s = ReadInt64FromEnvVar("TF_RESTORE_NUM_THREADS",
+                                   kDefaultRestoreThreads, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return static_cast<int>(kDefaultRestoreThreads);
+    }
+    return static_cast<int>(std::max<int64_t>(value, 1));
+  }();
+  return num_threads;
+}
+
+// Reader options for RestoreV2. Setting TF_RESTORE_USE_MMAP=true memory-maps
+// the checkpoint data files, so that aligned tensors are restored without a
+// copy (see BundleReader::Options::use_mmap).
+BundleReader::Options RestoreReaderOptions() {
+  static const bool use_mmap = [] {
+    bool value;
+    Status s = ReadBoolFromEnvVar("TF_RESTORE_USE_MMAP", false, &value);
+    if (!s.ok()) {
+      LOG(ERROR) << s;
+      return false;
+    }
+    return value;
+  }();
+  BundleReader::Options options;
+  options.use_mmap = use_mmap;
+  return options;
+}
+
 // A restore operation for a single tensor.  Small tensors may be restored
 // directly from the op thread to improve read locality.  Large tensors can be
 // restored from a thread pool: this requires creating a separate BundleReader
@@ -282,9 +324,19 @@ struct RestoreOp {
     return restored_full_shape.num_elements() > kLargeShapeThreshold;
   }
 
+  // Approximate number of bytes this operation reads, for load balancing.
+  int64_t estimated_bytes(BundleReader* reader) const {
+    TensorShape restored_full_shape;
+    if (!reader->LookupTensorShape(tensor_name, &restored_full_shape).ok()) {
+      return 0;
+    }
+    return restored_full_shape.num_elements() *
+           std::max(DataTypeSize(dtype), 1);
+  }
+
   // Run this restore operation using a new BundleReader.
-  void run_with_new_reader() {
-    BundleReader reader(Env::Default(), reader_prefix);
+  void run_with_new_reader(const BundleReader::Options& options) {
+    BundleReader reader(Env::Default(), reader_prefix, options);
     if (!reader.status().ok()) {
       status = reader.status();
       return;
@@ -303,9 +355,18 @@ struct RestoreOp {
     Tensor* restored_tensor;
     if (shape_and_slice.empty()) {
       // Lookup the full tensor.
-      TF_RETURN_IF_ERROR(
-          context->allocate_output(idx, restored_full_shape, &restored_tensor));
-      TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, restored_tensor));
+      if (reader->options().use_mmap) {
+        // The reader may return a tensor aliasing the mapped data file, so
+        // let it choose the buffer.
+        Tensor restored;
+        TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, &restored));
+        context->set_output(idx, restored);
+        restored_tensor = context->mutable_output(idx);
+      } else {
+        TF_RETURN_IF_ERROR(context->allocate_output(idx, restored_full_shape,
+                                                    &restored_tensor));
+        TF_RETURN_IF_ERROR(reader->Lookup(tensor_name, restored_tensor));
+      }
     } else {
       // Lookup the slice.
       TensorShape parsed_full_shape;
@@ -359,6 +420,19 @@ struct RestoreOp {
   ::tensorflow::Status status;
 };
 
+// Runs "restore_ops", which are sorted for sequential access, using a new
+// BundleReader.
+Status RunWithNewReader(const string& prefix,
+                        const BundleReader::Options& options,
+                        const std::vector<RestoreOp*>& restore_ops) {
+  BundleReader reader(Env::Default(), prefix, options);
+  TF_RETURN_IF_ERROR(reader.status());
+  for (auto* op : restore_ops) {
+    TF_RETURN_IF_ERROR(op->run(&reader));
+  }
+  return OkStatus();
+}
+
 }  // namespace
 
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
@@ -377,7 +451,8 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                            shape_and_slices_flat(i), prefix_string, dtypes[i]});
   }
 
-  BundleReader default_reader(Env::Default(), prefix_string);
+  const BundleReader::Options reader_options = RestoreReaderOptions();
+  BundleReader default_reader(Env::Default(), prefix_string, reader_options);
   TF_RETURN_IF_ERROR(default_reader.status());
 
   TF_RETURN_IF_ERROR(default_reader.SortForSequentialAccess<RestoreOp>(
@@ -404,28 +479,63 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
 
   std::vector<RestoreOp*> pool_restore_ops;
   std::vector<RestoreOp*> direct_restore_ops;
+  std::vector<int64_t> direct_restore_bytes;
+  int64_t total_direct_bytes = 0;
   for (RestoreOp& restore_op : restore_ops) {
     if (restore_op.should_run_in_pool(&default_reader)) {
       pool_restore_ops.push_back(&restore_op);
     } else {
       direct_restore_ops.push_back(&restore_op);
+      direct_restore_bytes.push_back(
+          restore_op.estimated_bytes(&default_reader));
+      total_direct_bytes += direct_restore_bytes.back();
     }
   }
 
+  // Splits the direct operations into runs of roughly equal size. They keep
+  // the sequential access order, so each run reads one region of the files.
+  const int num_threads = RestoreNumThreads();
+  const int64_t num_groups = std::max<int64_t>(
+      1, std::min<int64_t>(num_threads,
+                           total_direct_bytes / kMinRestoreGroupBytes));
+  std::vector<std::vector<RestoreOp*>> direct_groups(num_groups);
+  int64_t bytes_so_far = 0;
+  for (int i = 0; i < direct_restore_ops.size(); ++i) {
+    const int64_t group =
+        num_groups == 1
+            ? 0
+            : std::min<int64_t>(num_groups - 1,
+                                bytes_so_far * num_groups / total_direct_bytes);
+    direct_groups[group].push_back(direct_restore_ops[i]);
+    bytes_so_far += direct_restore_bytes[i];
+  }
+
+  std::vector<Status> group_statuses(direct_groups.size());
   {
     // Schedule any threaded operations first, skipping thread pool creation if
     // we don't have any expensive operations.
     std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
+    if (!pool_restore_ops.empty() || direct_groups.size() > 1) {
+      reader_pool.reset(new thread::ThreadPool(Env::Default(),
+                                               "restore_tensors", num_threads));
+      // Large tensors are also split into chunks read on the same pool.
+      BundleReader::Options pool_reader_options = reader_options;
+      pool_reader_options.read_pool = reader_pool.get();
       for (auto* op : pool_restore_ops) {
-        reader_pool->Schedule([op]() { op->run_with_new_reader(); });
+        reader_pool->Schedule([op, pool_reader_options]() {
+          op->run_with_new_reader(pool_reader_options);
+        });
+      }
+      for (int i = 1; i < direct_groups.size(); ++i) {
+        reader_pool->Schedule([&, i]() {
+          group_statuses[i] = RunWithNewReader(prefix_string, reader_options,
+                                               direct_groups[i]);
+        });
       }
     }
 
-    // Read small tensors from the op thread
-    for (auto* op : direct_restore_ops) {
+    // Read the first run of small tensors from the op thread
+    for (auto* op : direct_groups[0]) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
     }
   }
@@ -434,6 +544,9 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   for (auto* op : pool_restore_ops) {
     TF_RETURN_IF_ERROR(op->status);
   }
+  for (const Status& status : group_statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
 
   for (const RestoreOp& restore_op : restore_ops) {
     if (restore_op.dtype != context->mutable_output(restore_op.idx)->dtype()) {
@@ -87,8 +87,9 @@ class SparseSoftmaxXentWithLogitsOp : public OpKernel {
     }
 
     Tensor scratch;
-    OP_REQUIRES_OK(context, context->allocate_temp(DataTypeToEnum<T>::value,
-                                                   labels.shape(), &scratch));
+    OP_REQUIRES_OK(context,
+                   context->allocate_step_temp(DataTypeToEnum<T>::value,
+                                               labels.shape(), &scratch));
 
     Tensor* loss_out = nullptr;
     OP_REQUIRES_OK(context, context->forward_input_or_allocate_output(
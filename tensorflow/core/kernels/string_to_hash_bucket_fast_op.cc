@@ -15,11 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/string_to_hash_bucket_fast_op.h"
 
-#include "tensorflow/core/platform/fingerprint.h"
-
 namespace tensorflow {
 
 REGISTER_KERNEL_BUILDER(Name("StringToHashBucketFast").Device(DEVICE_CPU),
-                        StringToHashBucketOp<Fingerprint64>);
+                        StringToHashBucketFastOp);
 
 }  // namespace tensorflow
@@ -20,9 +20,11 @@ limitations under the License.
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/string_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 
@@ -62,6 +64,45 @@ class StringToHashBucketOp : public OpKernel {
   void operator=(const StringToHashBucketOp&) = delete;
 };
 
+// Hashes strings with Fingerprint64, in batches sharded over the CPU worker
+// threads.
+class StringToHashBucketFastOp : public OpKernel {
+ public:
+  explicit StringToHashBucketFastOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("num_buckets", &num_buckets_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor* input_tensor;
+    OP_REQUIRES_OK(context, context->input("input", &input_tensor));
+    const tstring* input = input_tensor->flat<tstring>().data();
+
+    Tensor* output_tensor = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output("output", input_tensor->shape(),
+                                            &output_tensor));
+    int64_t* output = output_tensor->flat<int64_t>().data();
+
+    // Approximate cost of hashing a short string, in cycles.
+    constexpr int64_t kCostPerString = 50;
+    const DeviceBase::CpuWorkerThreads& worker_threads =
+        *context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads.num_threads, worker_threads.workers,
+          input_tensor->NumElements(), kCostPerString,
+          [&](int64_t start, int64_t limit) {
+            StringsToHashBuckets(input + start, limit - start, num_buckets_,
+                                 output + start);
+          });
+  }
+
+ private:
+  int64_t num_buckets_;
+
+  StringToHashBucketFastOp(const StringToHashBucketFastOp&) = delete;
+  void operator=(const StringToHashBucketFastOp&) = delete;
+};
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_STRING_TO_HASH_BUCKET_FAST_OP_H_
@@ -14,7 +14,15 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/string_util.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
+#include "tensorflow/core/platform/fingerprint.h"
 
 namespace tensorflow {
 
@@ -61,4 +69,177 @@ int32 UTF8StrLen(const string& str) {
   return result;
 }
 
+namespace {
+
+// Number of strings hashed together.
+constexpr int64_t kHashBlockSize = 64;
+
+// Constants and helpers of farmhashna::Hash64, which implements
+// Fingerprint64.
+constexpr uint64 kMul0 = 0xc3a5c85c97cb3127ULL;
+constexpr uint64 kMul2 = 0x9ae16a3b2f90404fULL;
+
+inline uint64 Rotate64(uint64 value, int shift) {
+  return (value >> shift) | (value << (64 - shift));
+}
+
+inline uint64 ShiftMix(uint64 value) { return value ^ (value >> 47); }
+
+inline uint64 HashLen16(uint64 u, uint64 v, uint64 mul) {
+  uint64 a = (u ^ v) * mul;
+  a ^= a >> 47;
+  uint64 b = (v ^ a) * mul;
+  b ^= b >> 47;
+  return b * mul;
+}
+
+// Fingerprint64 of strings of 1 to 3, 4 to 7 and 8 to 16 bytes.
+inline uint64 Fingerprint64Len1To3(const char* s, size_t len) {
+  const uint8 a = s[0];
+  const uint8 b = s[len >> 1];
+  const uint8 c = s[len - 1];
+  const uint32 y = static_cast<uint32>(a) + (static_cast<uint32>(b) << 8);
+  const uint32 z = len + (static_cast<uint32>(c) << 2);
+  return ShiftMix(y * kMul2 ^ z * kMul0) * kMul2;
+}
+
+inline uint64 Fingerprint64Len4To7(const char* s, size_t len) {
+  const uint64 mul = kMul2 + len * 2;
+  const uint64 a = core::DecodeFixed32(s);
+  return HashLen16(len + (a << 3), core::DecodeFixed32(s + len - 4), mul);
+}
+
+inline uint64 Fingerprint64Len8To16(const char* s, size_t len) {
+  const uint64 mul = kMul2 + len * 2;
+  const uint64 a = core::DecodeFixed64(s) + kMul2;
+  const uint64 b = core::DecodeFixed64(s + len - 8);
+  const uint64 c = Rotate64(b, 37) * mul + a;
+  const uint64 d = (Rotate64(a, 25) + b) * mul;
+  return HashLen16(c, d, mul);
+}
+
+// Calls `fn(i, Fingerprint64(input[i]))` for the `n` strings of `input`.
+//
+// The sizes of the strings of a block are read first, and the strings are
+// grouped by the size range that Fingerprint64 hashes with the same code.
+// Each group is then hashed without branching on the size of each string,
+// which is mispredicted half of the time when the sizes vary, and the hashes
+// of the strings of a group overlap in the pipeline.
+template <typename T, typename Fn>
+void ForEachFingerprint64(const T* input, int64_t n, Fn fn) {
+  const char* data[kHashBlockSize];
+  size_t sizes[kHashBlockSize];
+  uint64 fingerprints[kHashBlockSize];
+  // Indices in the block of the strings of 1 to 3, 4 to 7 and 8 to 16 bytes,
+  // and of the other strings.
+  int16 groups[4][kHashBlockSize];
+  for (int64_t start = 0; start < n; start += kHashBlockSize) {
+    const int block_size = std::min(kHashBlockSize, n - start);
+    int group_sizes[4] = {0, 0, 0, 0};
+    for (int i = 0; i < block_size; ++i) {
+      const size_t size = input[start + i].size();
+      data[i] = input[start + i].data();
+      sizes[i] = size;
+      groups[0][group_sizes[0]] = i;
+      group_sizes[0] += size - 1 < 3;
+      groups[1][group_sizes[1]] = i;
+      group_sizes[1] += size - 4 < 4;
+      groups[2][group_sizes[2]] = i;
+      group_sizes[2] += size - 8 < 9;
+      groups[3][group_sizes[3]] = i;
+      group_sizes[3] += size - 1 >= 16;
+    }
+    for (int j = 0; j < group_sizes[0]; ++j) {
+      const int i = groups[0][j];
+      fingerprints[i] = Fingerprint64Len1To3(data[i], sizes[i]);
+    }
+    for (int j = 0; j < group_sizes[1]; ++j) {
+      const int i = groups[1][j];
+      fingerprints[i] = Fingerprint64Len4To7(data[i], sizes[i]);
+    }
+    for (int j = 0; j < group_sizes[2]; ++j) {
+      const int i = groups[2][j];
+      fingerprints[i] = Fingerprint64Len8To16(data[i], sizes[i]);
+    }
+    for (int j = 0; j < group_sizes[3]; ++j) {
+      const int i = groups[3][j];
+      fingerprints[i] = Fingerprint64(StringPiece(data[i], sizes[i]));
+    }
+    for (int i = 0; i < block_size; ++i) {
+      fn(start + i, fingerprints[i]);
+    }
+  }
+}
+
+template <typename T>
+void StringsToHashBucketsImpl(const T* input, int64_t n, int64_t num_buckets,
+                              int64_t* output,
+                              const HashedVocabulary* vocabulary) {
+  const FastModulo modulo(num_buckets);
+  if (vocabulary == nullptr) {
+    ForEachFingerprint64(input, n, [&](int64_t i, uint64 fingerprint) {
+      // The number of buckets is always in the positive range of int64 so is
+      // the resulting bucket id.
+      output[i] = static_cast<int64_t>(modulo(fingerprint));
+    });
+    return;
+  }
+  const int64_t vocabulary_size = vocabulary->size();
+  ForEachFingerprint64(input, n, [&](int64_t i, uint64 fingerprint) {
+    const int64_t id = vocabulary->Find(input[i], fingerprint);
+    output[i] = id >= 0 ? id
+                        : vocabulary_size +
+                              static_cast<int64_t>(modulo(fingerprint));
+  });
+}
+
+}  // namespace
+
+void StringsToFingerprint64(const tstring* input, int64_t n,
+                            uint64* fingerprints) {
+  ForEachFingerprint64(input, n, [fingerprints](int64_t i, uint64 fingerprint) {
+    fingerprints[i] = fingerprint;
+  });
+}
+
+void StringsToFingerprint64(const StringPiece* input, int64_t n,
+                            uint64* fingerprints) {
+  ForEachFingerprint64(input, n, [fingerprints](int64_t i, uint64 fingerprint) {
+    fingerprints[i] = fingerprint;
+  });
+}
+
+HashedVocabulary::HashedVocabulary(std::vector<string> vocabulary)
+    : vocabulary_(std::move(vocabulary)) {
+  ids_.reserve(vocabulary_.size());
+  for (int64_t id = 0; id < vocabulary_.size(); ++id) {
+    const string& key = vocabulary_[id];
+    const auto inserted = ids_.emplace(Fingerprint64(key), id);
+    if (!inserted.second && vocabulary_[inserted.first->second] != key) {
+      colliding_ids_.emplace(key, id);
+    }
+  }
+}
+
+int64_t HashedVocabulary::Find(StringPiece key, uint64 fingerprint) const {
+  const auto it = ids_.find(fingerprint);
+  if (it == ids_.end()) return -1;
+  if (vocabulary_[it->second] == key) return it->second;
+  if (colliding_ids_.empty()) return -1;
+  const auto colliding = colliding_ids_.find(string(key));
+  return colliding != colliding_ids_.end() ? colliding->second : -1;
+}
+
+void StringsToHashBuckets(const tstring* input, int64_t n, int64_t num_buckets,
+                          int64_t* output,
+                          const HashedVocabulary* vocabulary) {
+  StringsToHashBucketsImpl(input, n, num_buckets, output, vocabulary);
+}
+
+void StringsToHashBuckets(const StringPiece* input, int64_t n,
+                          int64_t num_buckets, int64_t* output,
+                          const HashedVocabulary* vocabulary) {
+  StringsToHashBucketsImpl(input, n, num_buckets, output, vocabulary);
+}
+
 }  // namespace tensorflow
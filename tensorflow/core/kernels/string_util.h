@@ -15,8 +15,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
 #define TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/numeric/int128.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/tstring.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 
@@ -83,6 +91,77 @@ bool BackNUTF8CharPositions(const StringPiece in,
   return utf8_chars_counted == num_utf8_chars_to_shift;
 }
 
+// Computes `x % divisor` with multiplications instead of a division (Lemire et
+// al., "Faster Remainder by Direct Computation"), which is several times faster
+// when many values are reduced modulo the same divisor.
+class FastModulo {
+ public:
+  // `divisor` must be positive.
+  explicit FastModulo(uint64 divisor)
+      : divisor_(divisor), multiplier_(absl::Uint128Max() / divisor + 1) {}
+
+  uint64 operator()(uint64 x) const {
+    const absl::uint128 low_bits = multiplier_ * x;
+    // The high 64 bits of the 192-bit product `low_bits * divisor_`.
+    const absl::uint128 bottom =
+        absl::uint128(absl::Uint128Low64(low_bits)) * divisor_;
+    const absl::uint128 top =
+        absl::uint128(absl::Uint128High64(low_bits)) * divisor_;
+    return absl::Uint128High64(top + absl::Uint128High64(bottom));
+  }
+
+ private:
+  uint64 divisor_;
+  absl::uint128 multiplier_;
+};
+
+// Sets `fingerprints[i]` to `Fingerprint64(input[i])` for the `n` strings of
+// `input`. The strings are located a block at a time before being hashed, so
+// that the hashes of a block do not wait for each other's data, and strings of
+// at most 16 bytes, which is most of the strings of feature columns, are
+// hashed inline.
+void StringsToFingerprint64(const tstring* input, int64_t n,
+                            uint64* fingerprints);
+void StringsToFingerprint64(const StringPiece* input, int64_t n,
+                            uint64* fingerprints);
+
+// A vocabulary indexed by the fingerprints of its strings, for the lookups of
+// StringsToHashBuckets.
+class HashedVocabulary {
+ public:
+  // Strings appearing several times in `vocabulary` map to their first index.
+  explicit HashedVocabulary(std::vector<string> vocabulary);
+
+  // Returns the index of `key`, whose fingerprint is `fingerprint`, in the
+  // vocabulary, or -1 if it is not in the vocabulary.
+  int64_t Find(StringPiece key, uint64 fingerprint) const;
+
+  int64_t size() const { return vocabulary_.size(); }
+
+ private:
+  std::vector<string> vocabulary_;
+  // Index in `vocabulary_` of the strings by fingerprint, and of the strings
+  // whose fingerprint is the one of an earlier string, by value.
+  absl::flat_hash_map<uint64, int64_t> ids_;
+  absl::flat_hash_map<string, int64_t> colliding_ids_;
+};
+
+// Sets `output[i]` to `Fingerprint64(input[i]) % num_buckets`, as the
+// StringToHashBucketFast op does. `num_buckets` must be positive.
+//
+// If `vocabulary` is not null, the strings of the vocabulary are mapped to
+// their index in it instead, and the other strings to `vocabulary->size() +
+// Fingerprint64(input[i]) % num_buckets`, as `tf.lookup.StaticVocabularyTable`
+// does with `num_buckets` out-of-vocabulary buckets and the default hash
+// function. The fingerprint of each string serves both the lookup and the
+// bucket.
+void StringsToHashBuckets(const tstring* input, int64_t n, int64_t num_buckets,
+                          int64_t* output,
+                          const HashedVocabulary* vocabulary = nullptr);
+void StringsToHashBuckets(const StringPiece* input, int64_t n,
+                          int64_t num_buckets, int64_t* output,
+                          const HashedVocabulary* vocabulary = nullptr);
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_STRING_UTIL_H_
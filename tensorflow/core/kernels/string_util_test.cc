@@ -0,0 +1,195 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/string_util.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns `n` random strings whose sizes are uniformly distributed in
+// [min_size, max_size].
+std::vector<tstring> RandomStrings(int n, int min_size, int max_size) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<tstring> strings(n);
+  for (tstring& s : strings) {
+    s.resize_uninitialized(min_size + rnd.Uniform(max_size - min_size + 1));
+    char* data = s.mdata();
+    for (int i = 0; i < s.size(); ++i) data[i] = rnd.Uniform(256);
+  }
+  return strings;
+}
+
+TEST(StringsToFingerprint64Test, KnownFingerprints) {
+  const std::vector<tstring> input = {"a", "b", "c", "d", "Hello", "World"};
+  std::vector<uint64> fingerprints(input.size());
+  StringsToFingerprint64(input.data(), input.size(), fingerprints.data());
+  EXPECT_EQ(fingerprints[0], 12917804110809363939ULL);
+  EXPECT_EQ(fingerprints[1], 11795596070477164822ULL);
+  EXPECT_EQ(fingerprints[2], 11430444447143000872ULL);
+  EXPECT_EQ(fingerprints[3], 4470636696479570465ULL);
+  EXPECT_EQ(fingerprints[4], 15404698994557526151ULL);
+  EXPECT_EQ(fingerprints[5], 18308117990299812472ULL);
+}
+
+TEST(StringsToFingerprint64Test, MatchesFingerprint64) {
+  // Several blocks of small and large strings of all the sizes handled
+  // differently.
+  const std::vector<tstring> input = RandomStrings(1000, 0, 70);
+  std::vector<uint64> fingerprints(input.size());
+  StringsToFingerprint64(input.data(), input.size(), fingerprints.data());
+  std::vector<StringPiece> views(input.begin(), input.end());
+  std::vector<uint64> view_fingerprints(views.size());
+  StringsToFingerprint64(views.data(), views.size(), view_fingerprints.data());
+  for (int i = 0; i < input.size(); ++i) {
+    EXPECT_EQ(fingerprints[i], Fingerprint64(input[i])) << i;
+    EXPECT_EQ(view_fingerprints[i], fingerprints[i]) << i;
+  }
+}
+
+TEST(StringsToHashBucketsTest, MatchesFingerprint64Modulo) {
+  const std::vector<tstring> input = RandomStrings(300, 0, 24);
+  for (const int64_t num_buckets :
+       {int64_t{1}, int64_t{10}, int64_t{1} << 40,
+        std::numeric_limits<int64_t>::max()}) {
+    std::vector<int64_t> buckets(input.size());
+    StringsToHashBuckets(input.data(), input.size(), num_buckets,
+                         buckets.data());
+    for (int i = 0; i < input.size(); ++i) {
+      EXPECT_EQ(buckets[i], Fingerprint64(input[i]) % num_buckets)
+          << num_buckets << " " << i;
+    }
+  }
+}
+
+TEST(FastModuloTest, MatchesModulo) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (const uint64 divisor :
+       {uint64{1}, uint64{2}, uint64{3}, uint64{10}, uint64{1} << 32,
+        (uint64{1} << 63) - 1, std::numeric_limits<uint64>::max()}) {
+    const FastModulo modulo(divisor);
+    for (const uint64 x : {uint64{0}, divisor - 1, divisor,
+                           std::numeric_limits<uint64>::max()}) {
+      EXPECT_EQ(modulo(x), x % divisor) << divisor << " " << x;
+    }
+    for (int i = 0; i < 1000; ++i) {
+      const uint64 x = rnd.Rand64();
+      EXPECT_EQ(modulo(x), x % divisor) << divisor << " " << x;
+    }
+  }
+}
+
+TEST(StringsToHashBucketsTest, VocabularyLookup) {
+  const HashedVocabulary vocabulary({"a", "long vocabulary string", "c", "a"});
+  EXPECT_EQ(vocabulary.size(), 4);
+  const std::vector<tstring> input = {"c", "a", "long vocabulary string", "d",
+                                      "", "another long string"};
+  std::vector<int64_t> ids(input.size());
+  StringsToHashBuckets(input.data(), input.size(), /*num_buckets=*/3,
+                       ids.data(), &vocabulary);
+  EXPECT_EQ(ids[0], 2);
+  EXPECT_EQ(ids[1], 0);
+  EXPECT_EQ(ids[2], 1);
+  for (int i = 3; i < input.size(); ++i) {
+    EXPECT_EQ(ids[i], 4 + Fingerprint64(input[i]) % 3) << i;
+  }
+}
+
+// BENCHMARKS
+//==============================================================================
+
+constexpr int kNumStrings = 1 << 16;
+
+// Hashes strings with sizes uniformly distributed in [min_size, max_size] one
+// at a time, as the kernels used to.
+void BM_Fingerprint64Modulo(::testing::benchmark::State& state, int min_size,
+                            int max_size) {
+  const std::vector<tstring> input =
+      RandomStrings(kNumStrings, min_size, max_size);
+  const int64_t num_buckets = state.range(0);
+  std::vector<int64_t> buckets(input.size());
+  for (auto s : state) {
+    for (int i = 0; i < input.size(); ++i) {
+      buckets[i] = Fingerprint64(input[i]) % num_buckets;
+    }
+    ::benchmark::DoNotOptimize(buckets.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void BM_StringsToHashBuckets(::testing::benchmark::State& state, int min_size,
+                             int max_size) {
+  const std::vector<tstring> input =
+      RandomStrings(kNumStrings, min_size, max_size);
+  const int64_t num_buckets = state.range(0);
+  std::vector<int64_t> buckets(input.size());
+  for (auto s : state) {
+    StringsToHashBuckets(input.data(), input.size(), num_buckets,
+                         buckets.data());
+    ::benchmark::DoNotOptimize(buckets.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void BM_StringsToHashBucketsWithVocabulary(::testing::benchmark::State& state) {
+  const std::vector<tstring> input = RandomStrings(kNumStrings, 4, 12);
+  // Half of the strings are in the vocabulary.
+  std::vector<string> keys;
+  for (int i = 0; i < input.size(); i += 2) keys.emplace_back(input[i]);
+  const HashedVocabulary vocabulary(std::move(keys));
+  const int64_t num_oov_buckets = state.range(0);
+  std::vector<int64_t> ids(input.size());
+  for (auto s : state) {
+    StringsToHashBuckets(input.data(), input.size(), num_oov_buckets,
+                         ids.data(), &vocabulary);
+    ::benchmark::DoNotOptimize(ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+#define BM_STRING_HASH(size_name, min_size, max_size)                          \
+  BENCHMARK_CAPTURE(BM_Fingerprint64Modulo, size_name, min_size, max_size)     \
+      ->Arg(1000)                                                              \
+      ->Arg(1 << 20);                                                          \
+  BENCHMARK_CAPTURE(BM_StringsToHashBuckets, size_name, min_size, max_size)    \
+      ->Arg(1000)                                                              \
+      ->Arg(1 << 20);
+
+// Short ids, e.g. of categories or countries.
+BM_STRING_HASH(Sizes1To8, 1, 8);
+// Words and small strings stored in the tstring itself.
+BM_STRING_HASH(Sizes4To16, 4, 16);
+// Strings of all sizes, most of them allocated separately.
+BM_STRING_HASH(Sizes1To64, 1, 64);
+// URLs and queries.
+BM_STRING_HASH(Sizes32To128, 32, 128);
+
+BENCHMARK(BM_StringsToHashBucketsWithVocabulary)->Arg(1)->Arg(1000);
+
+}  // namespace
+}  // namespace tensorflow
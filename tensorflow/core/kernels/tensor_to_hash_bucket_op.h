@@ -16,15 +16,16 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_TENSOR_TO_HASH_BUCKET_OP_H_
 #define TENSORFLOW_CORE_KERNELS_TENSOR_TO_HASH_BUCKET_OP_H_
 
+#include <algorithm>
 #include <string>
 
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/string_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
-#include "tensorflow/core/lib/strings/stringprintf.h"
-#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/lib/strings/numbers.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -36,15 +37,11 @@ template <typename Device, typename T>
 struct LaunchTensorToHashBucket {
   void operator()(OpKernelContext* c, const int64_t num_buckets, const T* input,
                   const int num_elems, int64_t* output) {
-    string format = "%";
     switch (DataTypeToEnum<T>::value) {
       case DT_INT8:
       case DT_INT16:
       case DT_INT32:
-        strings::Appendf(&format, "d");
-        break;
       case DT_INT64:
-        strings::Appendf(&format, "lld");
         break;
       default:
         bool type_not_supported = true;
@@ -54,14 +51,19 @@ struct LaunchTensorToHashBucket {
                                     DataTypeString(DataTypeToEnum<T>::value)));
     }
 
-    for (int i = 0; i < num_elems; ++i) {
-      string input_str = strings::Printf(format.c_str(), input[i]);
-      const uint64 input_hash = Fingerprint64(input_str);
-      const uint64 bucket_id = input_hash % num_buckets;
-      // The number of buckets is always in the positive range of int64 so is
-      // the resulting bucket_id. Casting the bucket_id from uint64 to int64 is
-      // safe.
-      output[i] = static_cast<int64_t>(bucket_id);
+    // The decimal representations of a block of elements, which are hashed
+    // together.
+    constexpr int kBlockSize = 64;
+    char buffer[kBlockSize][strings::kFastToBufferSize];
+    StringPiece block[kBlockSize];
+    for (int start = 0; start < num_elems; start += kBlockSize) {
+      const int block_size = std::min(kBlockSize, num_elems - start);
+      for (int i = 0; i < block_size; ++i) {
+        const size_t size = strings::FastInt64ToBufferLeft(
+            static_cast<int64_t>(input[start + i]), buffer[i]);
+        block[i] = StringPiece(buffer[i], size);
+      }
+      StringsToHashBuckets(block, block_size, num_buckets, output + start);
     }
   }
 };
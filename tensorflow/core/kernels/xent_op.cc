@@ -75,9 +75,9 @@ class SoftmaxXentWithLogitsOp : public OpKernel {
 
     Tensor scratch;
     OP_REQUIRES_OK(
-        context, context->allocate_temp(DataTypeToEnum<T>::value,
-                                        TensorShape({shape_in.dim_size(0), 1}),
-                                        &scratch));
+        context, context->allocate_step_temp(
+                     DataTypeToEnum<T>::value,
+                     TensorShape({shape_in.dim_size(0), 1}), &scratch));
 
     Tensor* loss_out = nullptr;
     OP_REQUIRES_OK(context,
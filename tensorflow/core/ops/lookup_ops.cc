@@ -401,6 +401,7 @@ REGISTER_OP("MutableHashTableV2")
     .Attr("use_node_name_sharing: bool = false")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 0 = 0")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
@@ -408,6 +409,7 @@ REGISTER_OP("AnonymousMutableHashTable")
     .Output("table_handle: resource")
     .Attr("key_dtype: type")
     .Attr("value_dtype: type")
+    .Attr("num_shards: int >= 0 = 0")
     .SetIsStateful()
     .SetShapeFn(MutableHashTableShapeFn);
 
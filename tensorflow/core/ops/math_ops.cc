@@ -1566,6 +1566,49 @@ REGISTER_OP("SparseSegmentSqrtNGradV2")
     .Attr("Tsegmentids: {int32, int64} = DT_INT32")
     .SetShapeFn(SparseSegmentReductionGradV2ShapeFn);
 
+REGISTER_OP("_FusedGatherSparseSegmentReduction")
+    .Input("params: T")
+    .Input("ids: N * Tids")
+    .Input("indices: N * Tidx")
+    .Input("segment_ids: N * Tsegmentids")
+    .Input("weights: num_weights * T")
+    .Output("output: N * T")
+    .Attr("T: {bfloat16, float}")
+    .Attr("Tids: {int32, int64} = DT_INT32")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .Attr("N: int >= 1")
+    .Attr("num_weights: int >= 0 = 0")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'}")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 2, &params_shape));
+      int num_features;
+      TF_RETURN_IF_ERROR(c->GetAttr("N", &num_features));
+      ShapeHandle unused;
+      for (int i = 0; i < num_features; ++i) {
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(1 + i), 1, &unused));
+        ShapeHandle indices_shape;
+        TF_RETURN_IF_ERROR(
+            c->WithRank(c->input(1 + num_features + i), 1, &indices_shape));
+        TF_RETURN_IF_ERROR(c->Merge(
+            indices_shape, c->input(1 + 2 * num_features + i), &unused));
+        c->set_output(i, c->Matrix(InferenceContext::kUnknownDim,
+                                   c->Dim(params_shape, 1)));
+      }
+      return OkStatus();
+    })
+    .Doc(R"doc(
+Internal operation which is a composition of gathering the rows `ids` of
+`params` (GatherV2 with axis 0), optionally scaling them by `weights` (Mul), and
+reducing the gathered rows with SparseSegmentSum, SparseSegmentMean or
+SparseSegmentSqrtN. `N` lookups into the same `params` can be computed by one
+operation: reserved for internal use.
+
+Do not invoke this operator directly in Python. A fusion optimization is
+expected to create these operators.
+)doc");
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
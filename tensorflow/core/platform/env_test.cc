@@ -16,11 +16,17 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 
 #include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 #include <memory>
+#include <vector>
 
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/null_file_system.h"
 #include "tensorflow/core/platform/path.h"
@@ -92,6 +98,84 @@ TEST_F(DefaultEnvTest, IncompleteReadOutOfRange) {
   EXPECT_EQ(input, result);
 }
 
+TEST_F(DefaultEnvTest, ReadAsync) {
+  const string filename = io::JoinPath(BaseDir(), "read_async");
+  const string input = CreateTestFile(env_, filename, 1 << 20);
+  std::unique_ptr<RandomAccessFile> f;
+  TF_EXPECT_OK(env_->NewRandomAccessFile(filename, &f));
+
+  // Many more reads than an io_uring queue holds, then a read past EOF, a read
+  // across EOF and an empty read.
+  const int kNumReads = 1000;
+  const size_t kReadSize = 1000;
+  std::vector<RandomAccessFile::AsyncReadRequest> requests(kNumReads + 3);
+  std::vector<string> scratch(requests.size(), string(kReadSize, 0));
+  std::vector<Status> statuses(requests.size());
+  std::vector<string> results(requests.size());
+  for (int i = 0; i < requests.size(); ++i) {
+    requests[i].offset = i < kNumReads ? i * kReadSize : input.size() - 100;
+    requests[i].n = kReadSize;
+    requests[i].scratch = &scratch[i][0];
+  }
+  requests[kNumReads].offset = input.size() + 100;
+  requests[kNumReads + 2].n = 0;
+  BlockingCounter counter(requests.size());
+  for (int i = 0; i < requests.size(); ++i) {
+    requests[i].done = [&, i](const Status& status, StringPiece result) {
+      statuses[i] = status;
+      results[i] = string(result);
+      counter.DecrementCount();
+    };
+  }
+  f->ReadAsync(std::move(requests));
+  counter.Wait();
+
+  for (int i = 0; i < kNumReads; ++i) {
+    TF_EXPECT_OK(statuses[i]);
+    EXPECT_EQ(input.substr(i * kReadSize, kReadSize), results[i]);
+  }
+  EXPECT_EQ(error::OUT_OF_RANGE, statuses[kNumReads].code());
+  EXPECT_EQ("", results[kNumReads]);
+  EXPECT_EQ(error::OUT_OF_RANGE, statuses[kNumReads + 1].code());
+  EXPECT_EQ(input.substr(input.size() - 100), results[kNumReads + 1]);
+  TF_EXPECT_OK(statuses[kNumReads + 2]);
+  EXPECT_EQ("", results[kNumReads + 2]);
+}
+
+#if defined(__linux__)
+TEST_F(DefaultEnvTest, ReadAsyncInForkedChild) {
+  const string filename = io::JoinPath(BaseDir(), "read_async_forked");
+  const string input = CreateTestFile(env_, filename, 1000);
+  std::unique_ptr<RandomAccessFile> f;
+  TF_EXPECT_OK(env_->NewRandomAccessFile(filename, &f));
+  // Sets up the asynchronous reads of the parent, if any, before forking.
+  f->SupportsAsyncReads();
+
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // The child does not have the completion thread of its parent, so its
+    // reads must not be asynchronous.
+    if (f->SupportsAsyncReads()) _exit(1);
+    string scratch(input.size(), 0);
+    bool read = false;
+    std::vector<RandomAccessFile::AsyncReadRequest> requests(1);
+    requests[0].offset = 0;
+    requests[0].n = input.size();
+    requests[0].scratch = &scratch[0];
+    requests[0].done = [&](const Status& status, StringPiece result) {
+      read = status.ok() && result == input;
+    };
+    f->ReadAsync(std::move(requests));
+    _exit(read ? 0 : 2);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(0, WEXITSTATUS(status));
+}
+#endif  // defined(__linux__)
+
 TEST_F(DefaultEnvTest, ReadFileToString) {
   for (const int length : {0, 1, 1212, 2553, 4928, 8196, 9000, (1 << 20) - 1,
                            1 << 20, (1 << 20) + 1, (256 << 20) + 100}) {
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <utility>
@@ -22,6 +23,7 @@ limitations under the License.
 
 #include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -35,11 +37,16 @@ limitations under the License.
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/presized_cuckoo_map.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
 namespace tensorflow {
 namespace example {
 
@@ -117,6 +124,228 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+// Packed varint decoding.
+//
+// Packed Int64Lists (ids, hashed features, ...) make up the bulk of the bytes
+// of most Examples. Rather than decoding them one byte at a time through
+// CodedInputStream and growing the output one push_back at a time, the packed
+// payload is decoded straight from the serialized buffer: the number of values
+// is the number of bytes without a continuation bit, so the output is sized
+// once, and runs of single-byte varints (the common case for small ids and
+// labels) are widened a whole block at a time. On x86 the block scans use
+// AVX2 or AVX-512 when the CPU supports them, selected at runtime.
+
+using internal::PackedInt64Decoder;
+
+constexpr uint64 kContinuationBits = 0x8080808080808080ULL;
+
+// Decodes one varint starting at `*p` and advances `*p` past it. Returns false
+// if the varint is truncated or longer than the 10 bytes of a 64-bit value.
+inline bool DecodeVarint64(const uint8** p, const uint8* end, uint64* value) {
+  uint64 result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*p == end) return false;
+    const uint8 byte = *(*p)++;
+    result |= static_cast<uint64>(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the number of varints in [p, end).
+int64_t CountVarintsPortable(const uint8* p, const uint8* end) {
+  int64_t count = 0;
+  for (; end - p >= 8; p += 8) {
+    uint64 word;
+    std::memcpy(&word, p, sizeof(word));
+    count += 8 - absl::popcount(word & kContinuationBits);
+  }
+  for (; p < end; ++p) {
+    count += *p < 0x80;
+  }
+  return count;
+}
+
+// Decodes the varints in [p, end) into `out`, which has room for `capacity`
+// values. Values past `capacity` are validated but dropped, matching the
+// semantics of LimitedArraySlice.
+bool DecodeVarintsPortable(const uint8* p, const uint8* end, int64_t* out,
+                           int64_t capacity) {
+  int64_t n = 0;
+  while (p < end) {
+    if (port::kLittleEndian && end - p >= 8 && capacity - n >= 8) {
+      uint64 word;
+      std::memcpy(&word, p, sizeof(word));
+      const uint64 continuation = word & kContinuationBits;
+      // Number of single-byte varints at the start of the block.
+      const int run =
+          continuation == 0 ? 8 : absl::countr_zero(continuation) / 8;
+      for (int i = 0; i < run; ++i) {
+        out[n + i] = p[i];
+      }
+      n += run;
+      p += run;
+      if (run == 8) continue;
+    }
+    uint64 value;
+    if (!DecodeVarint64(&p, end, &value)) return false;
+    if (n < capacity) out[n] = static_cast<int64_t>(value);
+    ++n;
+  }
+  return true;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TF_EXAMPLE_PARSING_X86_SIMD 1
+
+__attribute__((target("avx2"))) int64_t CountVarintsAvx2(const uint8* p,
+                                                         const uint8* end) {
+  int64_t count = 0;
+  for (; end - p >= 32; p += 32) {
+    const __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    count += 32 - absl::popcount(
+                      static_cast<uint32>(_mm256_movemask_epi8(bytes)));
+  }
+  return count + CountVarintsPortable(p, end);
+}
+
+__attribute__((target("avx2"))) bool DecodeVarintsAvx2(const uint8* p,
+                                                       const uint8* end,
+                                                       int64_t* out,
+                                                       int64_t capacity) {
+  int64_t n = 0;
+  while (p < end) {
+    if (end - p >= 32 && capacity - n >= 32) {
+      const __m256i bytes =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      const uint32 continuation =
+          static_cast<uint32>(_mm256_movemask_epi8(bytes));
+      const int run = continuation == 0 ? 32 : absl::countr_zero(continuation);
+      // Widens four bytes per store. This may write up to three values past
+      // `run`, which is fine: there are at least 32 slots left and they are
+      // overwritten by the values decoded next.
+      for (int i = 0; i < run; i += 4) {
+        int32 four_bytes;
+        std::memcpy(&four_bytes, p + i, sizeof(four_bytes));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out + n + i),
+            _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(four_bytes)));
+      }
+      n += run;
+      p += run;
+      if (run == 32) continue;
+    }
+    uint64 value;
+    if (!DecodeVarint64(&p, end, &value)) return false;
+    if (n < capacity) out[n] = static_cast<int64_t>(value);
+    ++n;
+  }
+  return true;
+}
+
+__attribute__((target("avx512f,avx512bw"))) int64_t CountVarintsAvx512(
+    const uint8* p, const uint8* end) {
+  int64_t count = 0;
+  for (; end - p >= 64; p += 64) {
+    const __m512i bytes = _mm512_loadu_si512(p);
+    count += 64 - absl::popcount(
+                      static_cast<uint64>(_mm512_movepi8_mask(bytes)));
+  }
+  return count + CountVarintsAvx2(p, end);
+}
+
+__attribute__((target("avx512f,avx512bw"))) bool DecodeVarintsAvx512(
+    const uint8* p, const uint8* end, int64_t* out, int64_t capacity) {
+  int64_t n = 0;
+  while (p < end) {
+    if (end - p >= 64 && capacity - n >= 64) {
+      const __m512i bytes = _mm512_loadu_si512(p);
+      const uint64 continuation =
+          static_cast<uint64>(_mm512_movepi8_mask(bytes));
+      const int run = continuation == 0 ? 64 : absl::countr_zero(continuation);
+      // As in DecodeVarintsAvx2, the last store may run up to seven values
+      // past `run`.
+      for (int i = 0; i < run; i += 8) {
+        _mm512_storeu_si512(
+            out + n + i,
+            _mm512_cvtepu8_epi64(_mm_loadl_epi64(
+                reinterpret_cast<const __m128i*>(p + i))));
+      }
+      n += run;
+      p += run;
+      if (run == 64) continue;
+    }
+    uint64 value;
+    if (!DecodeVarint64(&p, end, &value)) return false;
+    if (n < capacity) out[n] = static_cast<int64_t>(value);
+    ++n;
+  }
+  return true;
+}
+
+#endif  // x86 SIMD
+
+// Returns the fastest decoder supported by this CPU.
+PackedInt64Decoder BestPackedInt64Decoder() {
+  static const PackedInt64Decoder decoder = [] {
+    for (PackedInt64Decoder d :
+         {PackedInt64Decoder::kAvx512, PackedInt64Decoder::kAvx2}) {
+      if (internal::PackedInt64DecoderSupported(d)) return d;
+    }
+    return PackedInt64Decoder::kPortable;
+  }();
+  return decoder;
+}
+
+// The decoder used before the block decoders above, kept as the baseline for
+// tests and benchmarks.
+template <typename Result>
+bool DecodePackedVarintsCodedStream(const uint8* begin, const uint8* end,
+                                    Result* values) {
+  protobuf::io::CodedInputStream stream(begin, end - begin);
+  while (!stream.ExpectAtEnd()) {
+    protobuf_uint64 n;  // There is no API for int64
+    if (!stream.ReadVarint64(&n)) return false;
+    values->push_back(static_cast<int64_t>(n));
+  }
+  return true;
+}
+
+// Appends the varints in [begin, end) to `values` using `decoder`.
+template <typename Result>
+bool DecodePackedVarints(PackedInt64Decoder decoder, const uint8* begin,
+                         const uint8* end, Result* values) {
+  if (decoder == PackedInt64Decoder::kDefault) {
+    decoder = BestPackedInt64Decoder();
+  }
+  if (decoder == PackedInt64Decoder::kCodedStream) {
+    return DecodePackedVarintsCodedStream(begin, end, values);
+  }
+
+  int64_t (*count_fn)(const uint8*, const uint8*) = CountVarintsPortable;
+  bool (*decode_fn)(const uint8*, const uint8*, int64_t*, int64_t) =
+      DecodeVarintsPortable;
+#ifdef TF_EXAMPLE_PARSING_X86_SIMD
+  if (decoder == PackedInt64Decoder::kAvx512) {
+    count_fn = CountVarintsAvx512;
+    decode_fn = DecodeVarintsAvx512;
+  } else if (decoder == PackedInt64Decoder::kAvx2) {
+    count_fn = CountVarintsAvx2;
+    decode_fn = DecodeVarintsAvx2;
+  }
+#endif  // TF_EXAMPLE_PARSING_X86_SIMD
+
+  const size_t initial_size = values->size();
+  values->resize(initial_size + count_fn(begin, end));
+  // The size can be smaller than requested in case of a LimitedArraySlice.
+  const int64_t capacity = values->size() - initial_size;
+  return decode_fn(begin, end, values->data() + initial_size, capacity);
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -303,15 +532,21 @@ class Feature {
         if (!stream.ExpectTag(kDelimitedTag(1))) return false;  // packed tag
         uint32 packed_length;
         if (!stream.ReadVarint32(&packed_length)) return false;
-        auto packed_limit = stream.PushLimit(packed_length);
-
-        while (!stream.ExpectAtEnd()) {
-          protobuf_uint64 n;  // There is no API for int64
-          if (!stream.ReadVarint64(&n)) return false;
-          int64_list->push_back(static_cast<int64_t>(n));
+        if (packed_length > 0) {
+          // Decode straight from the serialized buffer.
+          const void* packed_data;
+          int available;
+          if (!stream.GetDirectBufferPointer(&packed_data, &available) ||
+              static_cast<uint32>(available) < packed_length) {
+            return false;
+          }
+          const uint8* packed_begin = static_cast<const uint8*>(packed_data);
+          if (!DecodePackedVarints(PackedInt64Decoder::kDefault, packed_begin,
+                                   packed_begin + packed_length, int64_list)) {
+            return false;
+          }
+          if (!stream.Skip(packed_length)) return false;
         }
-
-        stream.PopLimit(packed_limit);
       } else {  // non-packed
         while (!stream.ExpectAtEnd()) {
           if (!stream.ExpectTag(kVarintTag(1))) return false;
@@ -459,6 +694,35 @@ bool ParseExample(StringPiece serialized, parsed::Example* example) {
 
 }  // namespace
 
+namespace internal {
+
+bool PackedInt64DecoderSupported(PackedInt64Decoder decoder) {
+  switch (decoder) {
+    case PackedInt64Decoder::kDefault:
+    case PackedInt64Decoder::kCodedStream:
+    case PackedInt64Decoder::kPortable:
+      return true;
+#ifdef TF_EXAMPLE_PARSING_X86_SIMD
+    case PackedInt64Decoder::kAvx2:
+      return port::TestCPUFeature(port::CPUFeature::AVX2);
+    case PackedInt64Decoder::kAvx512:
+      return port::TestCPUFeature(port::CPUFeature::AVX512F) &&
+             port::TestCPUFeature(port::CPUFeature::AVX512BW);
+#endif  // TF_EXAMPLE_PARSING_X86_SIMD
+    default:
+      return false;
+  }
+}
+
+bool DecodePackedInt64s(PackedInt64Decoder decoder, StringPiece packed,
+                        std::vector<int64_t>* values) {
+  DCHECK(PackedInt64DecoderSupported(decoder));
+  const uint8* begin = reinterpret_cast<const uint8*>(packed.data());
+  return DecodePackedVarints(decoder, begin, begin + packed.size(), values);
+}
+
+}  // namespace internal
+
 bool TestFastParse(const string& serialized, Example* example) {
   DCHECK(example != nullptr);
   parsed::Example parsed_example;
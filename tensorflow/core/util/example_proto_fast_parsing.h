@@ -164,6 +164,30 @@ Status FastParseSequenceExample(
 // It is exported here as a convenient API to test parser part separately.
 bool TestFastParse(const string& serialized, Example* example);
 
+namespace internal {
+
+// Implementations of the decoder for packed Int64List values. kDefault picks
+// the fastest one supported by the CPU, kCodedStream is the byte-at-a-time
+// protobuf decoder. Exposed to test and benchmark them against each other.
+enum class PackedInt64Decoder {
+  kDefault,
+  kCodedStream,
+  kPortable,
+  kAvx2,
+  kAvx512,
+};
+
+// Returns true if `decoder` can run on this CPU.
+bool PackedInt64DecoderSupported(PackedInt64Decoder decoder);
+
+// Decodes `packed`, the payload of a packed Int64List, and appends the values
+// to `values`. Returns false if the payload is malformed.
+// REQUIRES: PackedInt64DecoderSupported(decoder).
+bool DecodePackedInt64s(PackedInt64Decoder decoder, StringPiece packed,
+                        std::vector<int64_t>* values);
+
+}  // namespace internal
+
 }  // namespace example
 }  // namespace tensorflow
 
@@ -429,6 +429,129 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(FastParse, LongPackedInt64List) {
+  Example example;
+  Int64List* int64_list =
+      (*example.mutable_features()->mutable_feature())["ids"]
+          .mutable_int64_list();
+  // Long runs of single-byte values interrupted by multi-byte and negative
+  // values, so that both the block and the single-value paths are taken.
+  for (int i = 0; i < 1000; ++i) {
+    int64_list->add_value(i % 97 == 0 ? -i : i % 300);
+  }
+  TestCorrectness(Serialize(example));
+}
+
+using internal::DecodePackedInt64s;
+using internal::PackedInt64Decoder;
+using internal::PackedInt64DecoderSupported;
+
+constexpr PackedInt64Decoder kAllPackedInt64Decoders[] = {
+    PackedInt64Decoder::kDefault, PackedInt64Decoder::kCodedStream,
+    PackedInt64Decoder::kPortable, PackedInt64Decoder::kAvx2,
+    PackedInt64Decoder::kAvx512};
+
+// Serializes `values` the way a packed Int64List stores them.
+string PackInt64s(const std::vector<int64_t>& values) {
+  string packed;
+  protobuf::io::StringOutputStream string_stream(&packed);
+  protobuf::io::CodedOutputStream stream(&string_stream);
+  for (int64_t value : values) {
+    stream.WriteVarint64(static_cast<uint64>(value));
+  }
+  stream.Trim();
+  return packed;
+}
+
+// Returns `n` values of which `large_fraction` are drawn from the whole int64
+// range and the rest are in [0, 128), i.e. encoded as single bytes.
+std::vector<int64_t> RandomInt64s(random::SimplePhilox* rng, int n,
+                                  float large_fraction) {
+  std::vector<int64_t> values(n);
+  for (int64_t& value : values) {
+    value = rng->RandFloat() < large_fraction
+                ? static_cast<int64_t>(rng->Rand64())
+                : rng->Uniform(128);
+  }
+  return values;
+}
+
+TEST(PackedInt64Decoder, MatchesCodedInputStream) {
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  for (PackedInt64Decoder decoder : kAllPackedInt64Decoders) {
+    if (!PackedInt64DecoderSupported(decoder)) continue;
+    for (float large_fraction : {0.0f, 0.01f, 0.3f, 1.0f}) {
+      for (int n : {0, 1, 7, 8, 31, 33, 64, 100, 1000}) {
+        const std::vector<int64_t> expected =
+            RandomInt64s(&rng, n, large_fraction);
+        // Decoded values are appended to what is already in the output.
+        std::vector<int64_t> values = {-1};
+        ASSERT_TRUE(DecodePackedInt64s(decoder, PackInt64s(expected), &values));
+        ASSERT_EQ(values.size(), n + 1);
+        EXPECT_EQ(values[0], -1);
+        for (int i = 0; i < n; ++i) {
+          ASSERT_EQ(values[i + 1], expected[i])
+              << "decoder " << static_cast<int>(decoder) << ", index " << i;
+        }
+      }
+    }
+  }
+}
+
+TEST(PackedInt64Decoder, RejectsMalformedInput) {
+  std::vector<int64_t> ones(40, 1);
+  // The last varint is missing its final byte.
+  string truncated = PackInt64s(ones) + "\x80";
+  // Eleven bytes is longer than any 64-bit varint.
+  string overlong = PackInt64s(ones) + string(10, '\x80') + "\x01";
+  for (PackedInt64Decoder decoder : kAllPackedInt64Decoders) {
+    if (!PackedInt64DecoderSupported(decoder)) continue;
+    std::vector<int64_t> values;
+    EXPECT_FALSE(DecodePackedInt64s(decoder, truncated, &values));
+    EXPECT_FALSE(DecodePackedInt64s(decoder, overlong, &values));
+  }
+}
+
+// Benchmarks decoding of a packed Int64List of 512 values. The first argument
+// selects the decoder, the second the fraction (in percent) of values that
+// need more than one byte: 0 for token or bucketized features, 5 for typical
+// vocabulary ids and 100 for hashed feature crosses.
+void BM_DecodePackedInt64s(::testing::benchmark::State& state) {
+  const auto decoder = static_cast<PackedInt64Decoder>(state.range(0));
+  if (!PackedInt64DecoderSupported(decoder)) {
+    state.SkipWithError("Decoder not supported on this CPU");
+    return;
+  }
+  random::PhiloxRandom philox(1337);
+  random::SimplePhilox rng(&philox);
+  const int kNumValues = 512;
+  const string packed =
+      PackInt64s(RandomInt64s(&rng, kNumValues, state.range(1) / 100.0f));
+  std::vector<int64_t> values;
+  values.reserve(kNumValues);
+  for (auto s : state) {
+    values.clear();
+    CHECK(DecodePackedInt64s(decoder, packed, &values));
+  }
+  state.SetItemsProcessed(state.iterations() * kNumValues);
+  state.SetBytesProcessed(state.iterations() * packed.size());
+}
+
+BENCHMARK(BM_DecodePackedInt64s)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kCodedStream), 0)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kCodedStream), 5)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kCodedStream), 100)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kPortable), 0)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kPortable), 5)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kPortable), 100)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx2), 0)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx2), 5)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx2), 100)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx512), 0)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx512), 5)
+    ->ArgPair(static_cast<int>(PackedInt64Decoder::kAvx512), 100);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -41,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
@@ -79,6 +81,9 @@ const int64_t kLargeTensorThreshold = static_cast<int64_t>(1) << 32;
 const int kMaxFileReadThreads = 8;
 // Minimum size of a file section handled by each thread.
 const int64_t kMinSectionSize = static_cast<int64_t>(1) << 31;
+// Size of the chunks read in parallel on BundleReader::Options::read_pool.
+// Entries are only split if they span at least two chunks.
+const int64_t kReadPoolChunkSize = 8 << 20;  // 8MB
 
 namespace {
 
@@ -422,6 +427,183 @@ Status PadAlignment(tsl::BufferedWritableFile* out, int alignment,
   return status;
 }
 
+// Reads file[offset, offset + size) into "destination" in chunks of
+// "chunk_size" bytes, run on the calling thread and on up to
+// "max_helper_threads" threads of "pool", and stores the crc32c of the bytes
+// into "actual_crc32c". Each chunk is checksummed right after it is read,
+// while it is still in cache.
+//
+// The calling thread claims chunks like any helper and only waits for chunks
+// that are already being read, so this is safe to call from a thread of
+// "pool" even when all of its threads are busy.
+Status ReadChunksInParallel(RandomAccessFile* file, int64_t offset,
+                            int64_t size, int64_t chunk_size,
+                            char* destination, thread::ThreadPool* pool,
+                            int max_helper_threads, uint32* actual_crc32c) {
+  const int64_t num_chunks = (size + chunk_size - 1) / chunk_size;
+  // Helpers that start after all chunks are claimed still touch this state,
+  // so it is shared with them rather than living on the stack.
+  struct State {
+    explicit State(int64_t num_chunks)
+        : statuses(num_chunks), crcs(num_chunks) {}
+    mutex mu;
+    condition_variable all_done;
+    int64_t next_chunk TF_GUARDED_BY(mu) = 0;
+    int64_t chunks_done TF_GUARDED_BY(mu) = 0;
+    std::vector<Status> statuses;
+    std::vector<uint32> crcs;
+  };
+  auto state = std::make_shared<State>(num_chunks);
+
+  auto read_chunks = [state, file, offset, size, chunk_size, destination,
+                      num_chunks]() {
+    while (true) {
+      int64_t i;
+      {
+        mutex_lock l(state->mu);
+        if (state->next_chunk == num_chunks) return;
+        i = state->next_chunk++;
+      }
+      const int64_t chunk_offset = i * chunk_size;
+      const size_t n = std::min(chunk_size, size - chunk_offset);
+      char* chunk = destination + chunk_offset;
+      StringPiece sp;
+      Status status = file->Read(offset + chunk_offset, n, &sp, chunk);
+      if (status.ok()) {
+        if (sp.data() != chunk) {
+          memmove(chunk, sp.data(), n);
+        }
+        state->crcs[i] = crc32c::Value(chunk, n);
+      }
+      mutex_lock l(state->mu);
+      state->statuses[i] = std::move(status);
+      if (++state->chunks_done == num_chunks) {
+        state->all_done.notify_all();
+      }
+    }
+  };
+
+  const int64_t num_helpers =
+      std::min<int64_t>({num_chunks - 1, pool->NumThreads(),
+                         max_helper_threads});
+  for (int64_t i = 0; i < num_helpers; ++i) {
+    pool->Schedule(read_chunks);
+  }
+  read_chunks();
+  {
+    mutex_lock l(state->mu);
+    while (state->chunks_done < num_chunks) {
+      state->all_done.wait(l);
+    }
+  }
+
+  uint32 crc = 0;
+  for (int64_t i = 0; i < num_chunks; ++i) {
+    TF_RETURN_IF_ERROR(state->statuses[i]);
+    crc = crc32c::Combine(crc, state->crcs[i],
+                          std::min(chunk_size, size - i * chunk_size));
+  }
+  *actual_crc32c = crc;
+  return OkStatus();
+}
+
+// Reads file[offset, offset + size) into "destination" in chunks of
+// "chunk_size" bytes, whose reads are all started at once with
+// RandomAccessFile::ReadAsync, and stores the crc32c of the bytes into
+// "actual_crc32c". The calling thread checksums the chunks in order, each as
+// soon as it is read, while the reads of the next chunks are in flight.
+Status ReadChunksAsync(RandomAccessFile* file, int64_t offset, int64_t size,
+                       int64_t chunk_size, char* destination,
+                       uint32* actual_crc32c) {
+  const int64_t num_chunks = (size + chunk_size - 1) / chunk_size;
+  // The last callback may still hold the mutex when the calling thread
+  // returns, so the state is shared with the callbacks.
+  struct State {
+    explicit State(int64_t num_chunks)
+        : statuses(num_chunks), done(num_chunks, false) {}
+    mutex mu;
+    condition_variable chunk_done;
+    std::vector<Status> statuses;
+    std::vector<bool> done TF_GUARDED_BY(mu);
+  };
+  auto state = std::make_shared<State>(num_chunks);
+
+  std::vector<RandomAccessFile::AsyncReadRequest> requests(num_chunks);
+  for (int64_t i = 0; i < num_chunks; ++i) {
+    const int64_t chunk_offset = i * chunk_size;
+    char* chunk = destination + chunk_offset;
+    RandomAccessFile::AsyncReadRequest& request = requests[i];
+    request.offset = offset + chunk_offset;
+    request.n = std::min(chunk_size, size - chunk_offset);
+    request.scratch = chunk;
+    request.done = [state, i, chunk](const Status& status, StringPiece sp) {
+      if (status.ok() && sp.data() != chunk) {
+        memmove(chunk, sp.data(), sp.size());
+      }
+      mutex_lock l(state->mu);
+      state->statuses[i] = status;
+      state->done[i] = true;
+      state->chunk_done.notify_all();
+    };
+  }
+  file->ReadAsync(std::move(requests));
+
+  // Waits for all the reads, even after an error, as they write to
+  // "destination".
+  Status status;
+  uint32 crc = 0;
+  for (int64_t i = 0; i < num_chunks; ++i) {
+    {
+      mutex_lock l(state->mu);
+      while (!state->done[i]) {
+        state->chunk_done.wait(l);
+      }
+    }
+    status.Update(state->statuses[i]);
+    if (status.ok()) {
+      const int64_t chunk_offset = i * chunk_size;
+      crc = crc32c::Extend(crc, destination + chunk_offset,
+                           std::min(chunk_size, size - chunk_offset));
+    }
+  }
+  TF_RETURN_IF_ERROR(status);
+  *actual_crc32c = crc;
+  return OkStatus();
+}
+
+BundleReader::Options MultiThreadingForTestingOptions(bool enabled) {
+  BundleReader::Options options;
+  options.enable_multi_threading_for_testing = enabled;
+  return options;
+}
+
+// A read-only TensorBuffer aliasing part of a memory-mapped data file. Keeps
+// the mapping alive for as long as any tensor refers to it.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("BundleReaderMmap");
+  }
+  bool GetAllocatedBytes(size_t*) const override { return false; }
+
+  // The mapping is read-only, so the buffer must never be forwarded to an
+  // output or updated in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
 }  // namespace
 
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
@@ -770,14 +952,20 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 BundleReader::BundleReader(
     Env* env, StringPiece prefix,
     bool enable_multi_threading_for_testing /* = false */)
+    : BundleReader(env, prefix,
+                   MultiThreadingForTestingOptions(
+                       enable_multi_threading_for_testing)) {}
+
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(prefix),
+      options_(options),
       metadata_(nullptr),
       table_(nullptr),
       index_cache_(nullptr),
       iter_(nullptr),
-      need_to_swap_bytes_(false),
-      enable_multi_threading_for_testing_(enable_multi_threading_for_testing) {
+      need_to_swap_bytes_(false) {
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -869,7 +1057,71 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return OkStatus();
 }
 
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry,
+                                    Tensor* val, bool* mapped) {
+  *mapped = false;
+  if (!DataTypeCanUseMemcpy(entry.dtype()) || need_to_swap_bytes_ ||
+      entry.size() == 0) {
+    return OkStatus();
+  }
+  // Leaves size mismatches to the regular path, which reports them.
+  const TensorShape stored_shape(entry.shape());
+  if (entry.size() !=
+      static_cast<uint64>(stored_shape.num_elements()) *
+          DataTypeSize(entry.dtype())) {
+    return OkStatus();
+  }
+
+  auto it = mapped_data_.find(entry.shard_id());
+  if (it == mapped_data_.end()) {
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status s = env_->NewReadOnlyMemoryRegionFromFile(
+        DataFilename(prefix_, entry.shard_id(), num_shards_), &region);
+    if (!s.ok() && !errors::IsUnimplemented(s)) return s;
+    // A null region marks a file system without mmap support; such files are
+    // read through the regular path from now on.
+    it = mapped_data_.emplace(entry.shard_id(), std::move(region)).first;
+  }
+  const std::shared_ptr<ReadOnlyMemoryRegion>& region = it->second;
+  if (region == nullptr) return OkStatus();
+
+  const uint64 file_size = region->length();
+  if (entry.offset() < 0 || static_cast<uint64>(entry.offset()) > file_size ||
+      entry.size() > file_size - entry.offset()) {
+    return errors::DataLoss("Bundle entry for key ", key(),
+                            " extends past the end of its data file: offset ",
+                            entry.offset(), ", size ", entry.size(),
+                            ", file size ", file_size);
+  }
+  const char* data =
+      static_cast<const char*>(region->data()) + entry.offset();
+  if (reinterpret_cast<uintptr_t>(data) % EIGEN_MAX_ALIGN_BYTES != 0) {
+    return OkStatus();
+  }
+
+  const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+        entry.size(), " bytes): Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+
+  core::RefCountPtr<TensorBuffer> buf(
+      new MappedTensorBuffer(region, data, entry.size()));
+  *val = Tensor(entry.dtype(), stored_shape, std::move(buf));
+  *mapped = true;
+  return OkStatus();
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
+  if (options_.use_mmap) {
+    bool mapped = false;
+    TF_RETURN_IF_ERROR(GetMappedValue(entry, val, &mapped));
+    if (mapped) return OkStatus();
+  }
+
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
   if (val->NumElements() == 0) {
@@ -915,66 +1167,17 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
 
   if (DataTypeCanUseMemcpy(entry.dtype())) {
     char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
-    size_t unused_bytes_read;
     if (entry.size() > kBufferSize) {
-      StringPiece sp;
-      if (!enable_multi_threading_for_testing_ &&
-          entry.size() < kLargeTensorThreshold) {
-        TF_RETURN_IF_ERROR(buffered_file->file()->Read(
-            entry.offset(), entry.size(), &sp, backing_buffer));
-        if (sp.data() != backing_buffer) {
-          memmove(backing_buffer, sp.data(), entry.size());
-        }
-      } else {
-        int64_t section_size = kMinSectionSize;
-        int64_t thread_pool_size =
-            (entry.size() + kMinSectionSize - 1) / kMinSectionSize;
-        if (thread_pool_size > kMaxFileReadThreads ||
-            enable_multi_threading_for_testing_) {
-          thread_pool_size = kMaxFileReadThreads;
-          section_size =
-              (entry.size() + kMaxFileReadThreads - 1) / kMaxFileReadThreads;
-        }
-
-        std::vector<Status> statuses(thread_pool_size);
-        auto reader_pool = std::make_unique<thread::ThreadPool>(
-            Env::Default(), "restore_large_tensor", thread_pool_size);
-
-        for (int i = 0; i < thread_pool_size; ++i) {
-          reader_pool->Schedule([&, i]() {
-            int64_t offset = i * section_size;
-            int64_t size = i == thread_pool_size - 1 ? entry.size() - offset
-                                                     : section_size;
-            std::unique_ptr<RandomAccessFile> section_reader = nullptr;
-            StringPiece sp;
-            if (auto file_status = env_->NewRandomAccessFile(
-                    DataFilename(prefix_, entry.shard_id(), num_shards_),
-                    &section_reader);
-                !file_status.ok()) {
-              statuses[i] = file_status;
-              return;
-            }
-
-            auto backing_buffer_current_pos = backing_buffer + offset;
-            auto status = section_reader->Read(entry.offset() + offset, size,
-                                               &sp, backing_buffer_current_pos);
-            if (sp.data() != backing_buffer_current_pos) {
-              memmove(backing_buffer_current_pos, sp.data(), size);
-            }
-            statuses[i] = std::move(status);
-          });
-        }
-        for (const auto& status : statuses) {
-          TF_RETURN_IF_ERROR(status);
-        }
-      }
+      TF_RETURN_IF_ERROR(ReadLargeEntry(entry, buffered_file->file(),
+                                        backing_buffer, &actual_crc32c));
     } else {
+      size_t unused_bytes_read;
       TF_RETURN_IF_ERROR(buffered_file->ReadNBytes(entry.size(), backing_buffer,
                                                    &unused_bytes_read));
+      actual_crc32c = crc32c::Value(backing_buffer, entry.size());
     }
     // Note that we compute the checksum *before* byte-swapping. The checksum
     // should be on the bytes in the order they appear in the file.
-    actual_crc32c = crc32c::Value(backing_buffer, entry.size());
     if (need_to_swap_bytes_) {
       TF_RETURN_IF_ERROR(ByteSwapTensor(ret));
     }
@@ -1010,6 +1213,54 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   return OkStatus();
 }
 
+Status BundleReader::ReadLargeEntry(const BundleEntryProto& entry,
+                                    RandomAccessFile* file, char* destination,
+                                    uint32* actual_crc32c) {
+  if (options_.read_pool != nullptr &&
+      entry.size() >= 2 * kReadPoolChunkSize) {
+    return ReadChunksInParallel(file, entry.offset(), entry.size(),
+                                kReadPoolChunkSize, destination,
+                                options_.read_pool,
+                                options_.read_pool->NumThreads(),
+                                actual_crc32c);
+  }
+
+  // Without a pool, keeps the reads of all the chunks in flight rather than
+  // reading them with threads, if the file supports it.
+  if (!options_.enable_multi_threading_for_testing &&
+      file->SupportsAsyncReads() && entry.size() >= 2 * kReadPoolChunkSize) {
+    return ReadChunksAsync(file, entry.offset(), entry.size(),
+                           kReadPoolChunkSize, destination, actual_crc32c);
+  }
+
+  if (options_.enable_multi_threading_for_testing ||
+      entry.size() >= kLargeTensorThreshold) {
+    int64_t section_size = kMinSectionSize;
+    int64_t thread_pool_size =
+        (entry.size() + kMinSectionSize - 1) / kMinSectionSize;
+    if (thread_pool_size > kMaxFileReadThreads ||
+        options_.enable_multi_threading_for_testing) {
+      thread_pool_size = kMaxFileReadThreads;
+      section_size =
+          (entry.size() + kMaxFileReadThreads - 1) / kMaxFileReadThreads;
+    }
+    thread::ThreadPool reader_pool(Env::Default(), "restore_large_tensor",
+                                   thread_pool_size);
+    return ReadChunksInParallel(file, entry.offset(), entry.size(),
+                                section_size, destination, &reader_pool,
+                                thread_pool_size - 1, actual_crc32c);
+  }
+
+  StringPiece sp;
+  TF_RETURN_IF_ERROR(
+      file->Read(entry.offset(), entry.size(), &sp, destination));
+  if (sp.data() != destination) {
+    memmove(destination, sp.data(), entry.size());
+  }
+  *actual_crc32c = crc32c::Value(destination, entry.size());
+  return OkStatus();
+}
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1018,6 +1269,10 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   if (entry.slices().empty()) {
     return GetValue(entry, val);
   } else {
+    // Like GetValue(), allocates the result if the caller did not.
+    if (!val->IsInitialized()) {
+      *val = Tensor(entry.dtype(), TensorShape(entry.shape()));
+    }
     return GetSliceValue(
         key, entry,
         /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()), val);
@@ -1036,6 +1291,10 @@ Status BundleReader::ReadCurrent(Tensor* val) {
   if (entry.slices().empty()) {
     return GetValue(entry, val);
   } else {
+    // Like GetValue(), allocates the result if the caller did not.
+    if (!val->IsInitialized()) {
+      *val = Tensor(entry.dtype(), TensorShape(entry.shape()));
+    }
     return GetSliceValue(
         iter_->key(), entry,
         /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()), val);
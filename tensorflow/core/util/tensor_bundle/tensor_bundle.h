@@ -84,6 +84,7 @@ limitations under the License.
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/tstring.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_slice_set.h"
@@ -200,10 +201,36 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    Options() {}
+    // If true, data files are memory-mapped and entries of memcpy-able dtypes
+    // whose data is suitably aligned in the file are returned by "Lookup()" as
+    // tensors that point into the mapping instead of being read into a fresh
+    // buffer. Such tensors keep the mapping alive and are read-only: they
+    // report that they do not own their memory, so ops copy them before
+    // updating them in place. Misaligned or byte-swapped entries, and files
+    // whose file system does not support memory mapping, are read as usual.
+    //
+    // Entries are aligned if the bundle was written with
+    // BundleWriter::Options::data_alignment a multiple of
+    // EIGEN_MAX_ALIGN_BYTES.
+    bool use_mmap{false};
+    // If set, large entries of memcpy-able dtypes are read from the data file
+    // in chunks scheduled on this pool, and each chunk is checksummed by the
+    // thread that read it. The calling thread takes part in the reads, so the
+    // pool may be shared by several readers and "Lookup()" may be called from
+    // one of its threads. Not owned; must outlive the reader.
+    thread::ThreadPool* read_pool{nullptr};
+    bool enable_multi_threading_for_testing{false};
+  };
   BundleReader(Env* const env, absl::string_view prefix,
                bool enable_multi_threading_for_testing = false);
+  BundleReader(Env* const env, absl::string_view prefix,
+               const Options& options);
   ~BundleReader();
 
+  const Options& options() const { return options_; }
+
   // Is ok() iff the reader construction is successful (completed the read of
   // the metadata).
   Status status() const { return status_; }
@@ -243,6 +270,8 @@ class BundleReader {
   // Caller must make sure "val" has the same shape and dtype as the
   // corresponding contents, so that its buffer can be filled without needing
   // extra allocation.  These can be queried via "LookupDtypeAndShape()".
+  // With Options::use_mmap, "val" may instead be replaced by a tensor backed
+  // by the mapped data file, so callers should not preallocate it.
   //
   // On error, "val" may contain nonsense data.  Returns a NotFound error if
   // tensor keyed by "key" does not exist in this bundle.
@@ -309,6 +338,20 @@ class BundleReader {
   Status GetValue(const BundleEntryProto& entry,
                   Tensor* val) TF_MUST_USE_RESULT;
 
+  // If "entry" can be served from a memory-mapped data file, sets "val" to a
+  // tensor aliasing the mapping and "*mapped" to true. Otherwise leaves "val"
+  // untouched and sets "*mapped" to false.
+  // REQUIRES: options_.use_mmap
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* mapped) TF_MUST_USE_RESULT;
+
+  // Reads the "entry.size()" bytes of a memcpy-able "entry" from "file" into
+  // "destination" and computes their checksum, using several threads if the
+  // entry is large.
+  Status ReadLargeEntry(const BundleEntryProto& entry, RandomAccessFile* file,
+                        char* destination,
+                        uint32* actual_crc32c) TF_MUST_USE_RESULT;
+
   // Reads the slice described by "slice_spec".  The corresponding full tensor
   // has key "ful_tensor_key" and metadata proto "full_tensor_entry".
   // REQUIRES: full_tensor_entry.slices_size() > 0
@@ -319,6 +362,7 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const std::string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
@@ -327,6 +371,10 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32_t, io::InputBuffer*> data_;
+  // Memory-mapped data files, if options_.use_mmap. Shared with the tensors
+  // that alias them. Null for files that could not be mapped.
+  std::unordered_map<int32_t, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -342,8 +390,6 @@ class BundleReader {
 
   friend class TensorBundleAlignmentTest;  // For testing data alignment.
 
-  bool enable_multi_threading_for_testing_ = false;
-
   BundleReader(const BundleReader&) = delete;
   void operator=(const BundleReader&) = delete;
 };
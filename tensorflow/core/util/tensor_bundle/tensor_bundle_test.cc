@@ -30,10 +30,12 @@ limitations under the License.
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
@@ -1148,6 +1150,159 @@ TEST(TensorBundleTest, LargeVariableLoadingTest) {
   }
 }
 
+TEST(TensorBundleTest, MmapLookup) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mmap"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<int32>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_100x100<double>(2)));
+    TF_EXPECT_OK(
+        writer.Add("foo_003", test::AsTensor<tstring>({"hello", "world"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  Tensor aliased;
+  {
+    BundleReader reader(Env::Default(), Prefix("mmap"), options);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_100x100<float>(0));
+    Expect<int32>(&reader, "foo_001", Constant_2x3<int32>(1));
+    Expect<double>(&reader, "foo_002", Constant_100x100<double>(2));
+    Expect<tstring>(&reader, "foo_003",
+                    test::AsTensor<tstring>({"hello", "world"}));
+
+    // Aligned entries alias the mapping and may not be updated in place.
+    TF_ASSERT_OK(reader.Lookup("foo_002", &aliased));
+    EXPECT_FALSE(aliased.RefCountIsOne());
+    Tensor copied(DT_STRING, TensorShape({2}));
+    TF_ASSERT_OK(reader.Lookup("foo_003", &copied));
+    EXPECT_TRUE(copied.RefCountIsOne());
+  }
+  // The tensor keeps the mapping alive after the reader is gone.
+  test::ExpectTensorEqual<double>(aliased, Constant_100x100<double>(2));
+}
+
+TEST(TensorBundleTest, MmapLookupMisaligned) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("mmap_misaligned"));
+    TF_EXPECT_OK(writer.Add("foo_000", Constant(0.f, TensorShape({3}))));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_misaligned"), options);
+  TF_ASSERT_OK(reader.status());
+  // "foo_001" starts at byte 12 of the data file and is read into an owned
+  // buffer instead.
+  Tensor val(DT_FLOAT, TensorShape({100, 100}));
+  TF_ASSERT_OK(reader.Lookup("foo_001", &val));
+  EXPECT_TRUE(val.RefCountIsOne());
+  test::ExpectTensorEqual<float>(val, Constant_100x100<float>(1));
+}
+
+TEST(TensorBundleTest, MmapLookupChecksum) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = EIGEN_MAX_ALIGN_BYTES;
+    BundleWriter writer(Env::Default(), Prefix("mmap_checksum"), opts);
+    TF_EXPECT_OK(writer.Add("foo", Constant_100x100<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  const string datafile = DataFilename(Prefix("mmap_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[data.size() / 2] = ~data[data.size() / 2];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), Prefix("mmap_checksum"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val;
+  Status status = reader.Lookup("foo", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"));
+}
+
+TEST(TensorBundleTest, ReadPool) {
+  // Large enough to be read in three chunks.
+  const Tensor expected =
+      test::AsTensor<float>(std::vector<float>(5 << 20, 0.5f));
+  {
+    BundleWriter writer(Env::Default(), Prefix("read_pool"));
+    TF_EXPECT_OK(writer.Add("small", Constant_2x3<float>(1)));
+    TF_EXPECT_OK(writer.Add("large", expected));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  thread::ThreadPool pool(Env::Default(), "read_pool", 2);
+  BundleReader::Options options;
+  options.read_pool = &pool;
+  {
+    BundleReader reader(Env::Default(), Prefix("read_pool"), options);
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "small", Constant_2x3<float>(1));
+    Expect<float>(&reader, "large", expected);
+  }
+  // Lookups from every thread of the pool must not wait on each other.
+  {
+    BlockingCounter counter(pool.NumThreads());
+    for (int i = 0; i < pool.NumThreads(); ++i) {
+      pool.Schedule([&]() {
+        BundleReader reader(Env::Default(), Prefix("read_pool"), options);
+        TF_EXPECT_OK(reader.status());
+        Expect<float>(&reader, "large", expected);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  // Corruption in any chunk is detected.
+  const string datafile = DataFilename(Prefix("read_pool"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[data.size() - 1] = ~data[data.size() - 1];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+  BundleReader reader(Env::Default(), Prefix("read_pool"), options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, expected.shape());
+  Status status = reader.Lookup("large", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"));
+}
+
+TEST(TensorBundleTest, AsyncReads) {
+  // Large enough to be read in three chunks, whose reads are all in flight at
+  // once when the file supports asynchronous reads.
+  const Tensor expected =
+      test::AsTensor<float>(std::vector<float>(5 << 20, 0.25f));
+  {
+    BundleWriter writer(Env::Default(), Prefix("async_reads"));
+    TF_EXPECT_OK(writer.Add("large", expected));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    BundleReader reader(Env::Default(), Prefix("async_reads"));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "large", expected);
+  }
+  // Corruption in the first chunk is detected.
+  const string datafile = DataFilename(Prefix("async_reads"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+  BundleReader reader(Env::Default(), Prefix("async_reads"));
+  TF_ASSERT_OK(reader.status());
+  Tensor val(DT_FLOAT, expected.shape());
+  Status status = reader.Lookup("large", &val);
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"));
+}
+
 class TensorBundleAlignmentTest : public ::testing::Test {
  protected:
   template <typename T>
@@ -1252,4 +1407,82 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+// Restores one 256MB tensor, read in chunks on a pool of "threads" threads.
+static void BM_BundleReaderLargeTensor(::testing::benchmark::State& state) {
+  const int threads = state.range(0);
+  const int64_t bytes = 256 << 20;
+  {
+    BundleWriter writer(Env::Default(), Prefix("restore_large"));
+    TF_CHECK_OK(writer.Add(
+        "big", Constant(static_cast<int8>('a'), TensorShape{bytes})));
+    TF_CHECK_OK(writer.Finish());
+  }
+  std::unique_ptr<thread::ThreadPool> pool;
+  BundleReader::Options options;
+  if (threads > 0) {
+    pool = std::make_unique<thread::ThreadPool>(Env::Default(), "restore",
+                                                threads);
+    options.read_pool = pool.get();
+  }
+  BundleReader reader(Env::Default(), Prefix("restore_large"), options);
+  TF_CHECK_OK(reader.status());
+  Tensor t(DT_INT8, TensorShape{bytes});
+  for (auto s : state) {
+    TF_CHECK_OK(reader.Lookup("big", &t));
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK(BM_BundleReaderLargeTensor)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+// Restores 1024 tensors of 256KB spread over 4 data shards, the way RestoreV2
+// does: the keys are sorted for sequential access and split into one
+// contiguous run per thread, each read with its own BundleReader.
+static void BM_BundleReaderManyTensors(::testing::benchmark::State& state) {
+  const int threads = state.range(0);
+  const int kNumShards = 4;
+  const int kTensorsPerShard = 256;
+  const int64_t kTensorBytes = 256 << 10;
+  const Tensor t = Constant(static_cast<int8>('a'), TensorShape{kTensorBytes});
+  std::vector<tstring> shard_prefixes;
+  std::vector<string> keys;
+  for (int shard = 0; shard < kNumShards; ++shard) {
+    shard_prefixes.push_back(Prefix(strings::StrCat("restore_many_", shard)));
+    BundleWriter writer(Env::Default(), shard_prefixes.back());
+    for (int i = 0; i < kTensorsPerShard; ++i) {
+      keys.push_back(strings::StrCat("t_", shard, "_", i));
+      TF_CHECK_OK(writer.Add(keys.back(), t));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  TF_CHECK_OK(MergeBundles(Env::Default(), shard_prefixes,
+                           Prefix("restore_many")));
+  {
+    BundleReader reader(Env::Default(), Prefix("restore_many"));
+    TF_CHECK_OK(reader.SortForSequentialAccess<string>(
+        keys, [](const string& key) { return key; }));
+  }
+
+  thread::ThreadPool pool(Env::Default(), "restore", threads);
+  for (auto s : state) {
+    BlockingCounter counter(threads);
+    for (int i = 0; i < threads; ++i) {
+      pool.Schedule([&, i]() {
+        BundleReader reader(Env::Default(), Prefix("restore_many"));
+        TF_CHECK_OK(reader.status());
+        Tensor val(DT_INT8, TensorShape{kTensorBytes});
+        for (int k = keys.size() * i / threads;
+             k < keys.size() * (i + 1) / threads; ++k) {
+          TF_CHECK_OK(reader.Lookup(keys[k], &val));
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetBytesProcessed(state.iterations() * keys.size() * kTensorBytes);
+}
+
+BENCHMARK(BM_BundleReaderManyTensors)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
 }  // namespace tensorflow
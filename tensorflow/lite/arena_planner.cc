@@ -18,8 +18,10 @@ limitations under the License.
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -34,6 +36,107 @@ constexpr int32_t kLastActiveNodeUndefined =
 constexpr int32_t kNodeNotAssigned = std::numeric_limits<int32_t>::max();
 constexpr int32_t kScalarTensorBytes = 4;
 
+// Version of the format of SerializePlanCache.
+constexpr int64_t kPlanCacheVersion = 1;
+// Number of entries per tensor in the plan keys, and offset of the tensor
+// entries.
+constexpr size_t kPlanKeyEntriesPerTensor = 5;
+constexpr size_t kPlanKeyTensorsOffset = 2;
+
+namespace {
+
+// Serializes the plan cache as a sequence of 64-bit integers in host order.
+class PlanCacheWriter {
+ public:
+  void Write(int64_t value) {
+    const size_t offset = data_.size();
+    data_.resize(offset + sizeof(value));
+    std::memcpy(&data_[offset], &value, sizeof(value));
+  }
+
+  void Write(const ArenaAllocWithUsageInterval& alloc) {
+    Write(alloc.tensor);
+    Write(alloc.offset);
+    Write(alloc.size);
+    Write(alloc.first_node);
+    Write(alloc.last_node);
+  }
+
+  void Write(const SimpleMemoryArena::Plan& plan) {
+    Write(plan.high_water_mark);
+    Write(plan.active_allocs.size());
+    for (const ArenaAllocWithUsageInterval& alloc : plan.active_allocs) {
+      Write(alloc);
+    }
+  }
+
+  std::string& data() { return data_; }
+
+ private:
+  std::string data_;
+};
+
+class PlanCacheReader {
+ public:
+  PlanCacheReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  bool Read(int64_t* value) {
+    if (size_ - offset_ < sizeof(*value)) return false;
+    std::memcpy(value, data_ + offset_, sizeof(*value));
+    offset_ += sizeof(*value);
+    return true;
+  }
+
+  // Reads a value that fits in `T`.
+  template <typename T>
+  bool Read(T* value) {
+    int64_t v;
+    if (!Read(&v) ||
+        v < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+        (v > 0 && static_cast<uint64_t>(v) > std::numeric_limits<T>::max())) {
+      return false;
+    }
+    *value = static_cast<T>(v);
+    return true;
+  }
+
+  // Reads the number of elements of a sequence of `element_size` bytes each.
+  bool ReadCount(size_t element_size, size_t* count) {
+    return Read(count) && *count <= (size_ - offset_) / element_size;
+  }
+
+  bool Read(ArenaAllocWithUsageInterval* alloc) {
+    return Read(&alloc->tensor) && Read(&alloc->offset) &&
+           Read(&alloc->size) && Read(&alloc->first_node) &&
+           Read(&alloc->last_node);
+  }
+
+  bool Read(SimpleMemoryArena::Plan* plan) {
+    size_t num_allocs;
+    if (!Read(&plan->high_water_mark) ||
+        !ReadCount(5 * sizeof(int64_t), &num_allocs)) {
+      return false;
+    }
+    plan->active_allocs.resize(num_allocs);
+    for (ArenaAllocWithUsageInterval& alloc : plan->active_allocs) {
+      if (!Read(&alloc) || alloc.size > plan->high_water_mark ||
+          alloc.offset > plan->high_water_mark - alloc.size) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool done() const { return offset_ == size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+}  // namespace
+
 ArenaPlanner::ArenaPlanner(TfLiteContext* context,
                            std::unique_ptr<GraphInfo> graph_info,
                            bool preserve_all_tensors, int tensor_alignment,
@@ -329,9 +432,53 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
   }
   // Note that graph outputs will never be scheduled for deallocation. We
   // could do that here for completeness, but it won't have any effect.
+  if (parallel_execution_) {
+    ExtendLifetimesToWaves();
+  } else {
+    execution_waves_.clear();
+    node_waves_.clear();
+  }
   return kTfLiteOk;
 }
 
+void ArenaPlanner::ExtendLifetimesToWaves() {
+  ComputeExecutionWaves(graph_info_.get(), &node_waves_);
+  execution_waves_.clear();
+  for (int i = 0; i < static_cast<int>(node_waves_.size()); ++i) {
+    const int wave = node_waves_[i];
+    if (wave >= static_cast<int>(execution_waves_.size())) {
+      execution_waves_.resize(wave + 1);
+    }
+    execution_waves_[wave].push_back(i);
+  }
+  if (execution_waves_.empty()) return;
+
+  const int last_wave = static_cast<int>(execution_waves_.size()) - 1;
+  for (size_t tensor = 0; tensor < alloc_node_.size(); ++tensor) {
+    if (alloc_node_[tensor] == kNodeNotAssigned) continue;
+    int first_wave = node_waves_[alloc_node_[tensor]];
+    int end_wave = last_wave;
+    if (dealloc_node_[tensor] != kNodeNotAssigned) {
+      end_wave = node_waves_[dealloc_node_[tensor]];
+      first_wave = std::min(first_wave, end_wave);
+    }
+    // Waves are not contiguous in the execution plan: the tensor is allocated
+    // from the first to the last node of all the waves it is used in.
+    int first_node = alloc_node_[tensor];
+    int last_node = dealloc_node_[tensor] != kNodeNotAssigned
+                        ? dealloc_node_[tensor]
+                        : alloc_node_[tensor];
+    for (int wave = first_wave; wave <= end_wave; ++wave) {
+      first_node = std::min(first_node, execution_waves_[wave].front());
+      last_node = std::max(last_node, execution_waves_[wave].back());
+    }
+    alloc_node_[tensor] = first_node;
+    if (dealloc_node_[tensor] != kNodeNotAssigned) {
+      dealloc_node_[tensor] = last_node;
+    }
+  }
+}
+
 TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
   // Grow the size of `allocs_` if necessary. This allows allocating temporary
   // tensors in op's `prepare` function.
@@ -346,12 +493,21 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
        i <= static_cast<size_t>(last_node) && i < num_execution_nodes; ++i) {
     const TfLiteNode& node = graph_info_->node(i);
     TfLiteIntArray* node_temporaries = node.temporaries;
+    // Temporary tensors are used by the node only, during its whole wave if
+    // the nodes of the wave may be executed concurrently.
+    int first_node = i;
+    int last_node = i;
+    if (i < node_waves_.size()) {
+      const std::vector<int>& wave = execution_waves_[node_waves_[i]];
+      first_node = wave.front();
+      last_node = wave.back();
+    }
     for (int j = 0; j < node_temporaries->size; ++j) {
       int tensor_index = node_temporaries->data[j];
-      alloc_node_[tensor_index] = i;
+      alloc_node_[tensor_index] = first_node;
       nodes_to_tensors_[i].insert(tensor_index);
       if (!preserve_all_tensors_) {
-        dealloc_node_[tensor_index] = i;
+        dealloc_node_[tensor_index] = last_node;
       }
     }
   }
@@ -505,6 +661,16 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
     last_active_node_ = last_node;
     return kTfLiteOk;
   }
+  // Only plans computed from empty arenas, after `ResetAllocations`, are
+  // cached.
+  std::vector<int64_t> plan_key;
+  if (plan_cache_capacity_ > 0 && first_node == 0 &&
+      last_active_node_ == kLastActiveNodeUndefined) {
+    plan_key = CreatePlanKey(last_node, *tensors_allocated);
+    if (RestoreCachedPlan(plan_key, last_node, tensors_allocated)) {
+      return kTfLiteOk;
+    }
+  }
   if (first_node < last_active_node_) {
     arena_.ResetAllocs();
     last_active_node_ = first_node;
@@ -556,6 +722,256 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
     }
   }
   last_active_node_ = last_node;
+  if (!plan_key.empty()) {
+    CachePlan(std::move(plan_key), *tensors_allocated);
+  }
+  return kTfLiteOk;
+}
+
+void ArenaPlanner::SetPlanCacheCapacity(size_t capacity) {
+  plan_cache_capacity_ = capacity;
+  while (plan_cache_.size() > plan_cache_capacity_) {
+    plan_cache_.pop_back();
+  }
+}
+
+std::vector<int64_t> ArenaPlanner::CreatePlanKey(
+    int last_node, const std::vector<int32_t>& tensors_allocated) const {
+  std::vector<int32_t> tensor_indices = tensors_allocated;
+  std::sort(tensor_indices.begin(), tensor_indices.end());
+  std::vector<std::pair<int32_t, int32_t>> shared_tensors(
+      actual_tensor_id_.begin(), actual_tensor_id_.end());
+  std::sort(shared_tensors.begin(), shared_tensors.end());
+
+  // The plan depends on the size and lifetime of each tensor it allocates,
+  // and on the tensors sharing their buffer.
+  const TfLiteTensor* tensors = graph_info_->tensors();
+  std::vector<int64_t> key;
+  key.reserve(kPlanKeyTensorsOffset +
+              kPlanKeyEntriesPerTensor * tensor_indices.size() +
+              5 * shared_tensors.size());
+  key.push_back(last_node);
+  key.push_back(tensor_indices.size());
+  for (int32_t i : tensor_indices) {
+    key.push_back(i);
+    key.push_back(tensors[i].allocation_type);
+    key.push_back(tensors[i].bytes);
+    key.push_back(alloc_node_[i]);
+    key.push_back(dealloc_node_[i]);
+  }
+  for (const auto& [tensor, root] : shared_tensors) {
+    key.push_back(tensor);
+    key.push_back(tensors[tensor].bytes);
+    key.push_back(root);
+    key.push_back(tensors[root].allocation_type);
+    key.push_back(tensors[root].bytes);
+  }
+  return key;
+}
+
+bool ArenaPlanner::RestoreCachedPlan(const std::vector<int64_t>& key,
+                                     int last_node,
+                                     std::vector<int32_t>* tensors_allocated) {
+  auto it = std::find_if(
+      plan_cache_.begin(), plan_cache_.end(),
+      [&key](const CachedPlan& plan) { return plan.key == key; });
+  if (it == plan_cache_.end()) {
+    return false;
+  }
+  plan_cache_.splice(plan_cache_.begin(), plan_cache_, it);
+  const CachedPlan& plan = plan_cache_.front();
+  for (size_t i = 0; i < plan.tensors.size(); ++i) {
+    allocs_[plan.tensors[i]] = plan.allocs[i];
+  }
+  actual_tensor_id_.clear();
+  actual_tensor_id_.insert(plan.shared_tensors.begin(),
+                           plan.shared_tensors.end());
+  arena_.RestorePlan(plan.arena_plan);
+  persistent_arena_.RestorePlan(plan.persistent_arena_plan);
+  *tensors_allocated = plan.tensors;
+  last_active_node_ = last_node;
+  ++num_cached_plans_used_;
+  return true;
+}
+
+void ArenaPlanner::CachePlan(std::vector<int64_t> key,
+                             const std::vector<int32_t>& tensors_allocated) {
+  CachedPlan plan;
+  plan.key = std::move(key);
+  plan.tensors = tensors_allocated;
+  std::sort(plan.tensors.begin(), plan.tensors.end());
+  plan.allocs.reserve(plan.tensors.size());
+  for (int32_t tensor_index : plan.tensors) {
+    plan.allocs.push_back(allocs_[tensor_index]);
+  }
+  plan.shared_tensors.assign(actual_tensor_id_.begin(),
+                             actual_tensor_id_.end());
+  std::sort(plan.shared_tensors.begin(), plan.shared_tensors.end());
+  plan.arena_plan = arena_.GetPlan();
+  plan.persistent_arena_plan = persistent_arena_.GetPlan();
+  plan_cache_.push_front(std::move(plan));
+  if (plan_cache_.size() > plan_cache_capacity_) {
+    plan_cache_.pop_back();
+  }
+}
+
+bool ArenaPlanner::IsValidCachedPlan(const CachedPlan& plan) const {
+  // The allocations with a buffer, and the lifetimes of their tensors.
+  struct Extent {
+    bool persistent;
+    size_t offset;
+    size_t end;
+    int64_t first_node;
+    int64_t last_node;
+  };
+  std::vector<Extent> extents;
+  extents.reserve(plan.tensors.size());
+  for (size_t j = 0; j < plan.tensors.size(); ++j) {
+    const ArenaAllocWithUsageInterval& alloc = plan.allocs[j];
+    const int64_t* entry =
+        &plan.key[kPlanKeyTensorsOffset + j * kPlanKeyEntriesPerTensor];
+    const int32_t tensor = plan.tensors[j];
+    const int64_t allocation_type = entry[1];
+    const int64_t bytes = entry[2];
+    if (alloc.size == 0) {
+      // Tensors without a buffer are empty, or share the buffer of another
+      // tensor.
+      const bool shared = std::any_of(
+          plan.shared_tensors.begin(), plan.shared_tensors.end(),
+          [tensor](const auto& shared) { return shared.first == tensor; });
+      if (bytes != 0 && !shared) return false;
+      if (alloc.tensor != tensor && alloc.tensor != -1) return false;
+      continue;
+    }
+    if (alloc.tensor != tensor || bytes < 0 ||
+        alloc.size < static_cast<uint64_t>(bytes) ||
+        alloc.offset % tensor_alignment_ != 0) {
+      return false;
+    }
+    const bool persistent = allocation_type == kTfLiteArenaRwPersistent;
+    if (!persistent && allocation_type != kTfLiteArenaRw) return false;
+    const size_t high_water_mark = persistent
+                                       ? plan.persistent_arena_plan
+                                             .high_water_mark
+                                       : plan.arena_plan.high_water_mark;
+    if (alloc.size > high_water_mark ||
+        alloc.offset > high_water_mark - alloc.size) {
+      return false;
+    }
+    // Persistent tensors live until the end of the subgraph.
+    extents.push_back(
+        {persistent, alloc.offset, alloc.offset + alloc.size, entry[3],
+         persistent ? std::numeric_limits<int64_t>::max() : entry[4]});
+  }
+
+  // Tensors of the same arena that are live at the same time must not
+  // overlap.
+  std::sort(
+      extents.begin(), extents.end(),
+      [](const Extent& a, const Extent& b) { return a.offset < b.offset; });
+  for (size_t i = 0; i < extents.size(); ++i) {
+    for (size_t j = i + 1;
+         j < extents.size() && extents[j].offset < extents[i].end; ++j) {
+      if (extents[i].persistent == extents[j].persistent &&
+          extents[i].first_node <= extents[j].last_node &&
+          extents[j].first_node <= extents[i].last_node) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::string ArenaPlanner::SerializePlanCache() const {
+  PlanCacheWriter writer;
+  writer.Write(kPlanCacheVersion);
+  writer.Write(tensor_alignment_);
+  writer.Write(plan_cache_.size());
+  for (const CachedPlan& plan : plan_cache_) {
+    writer.Write(plan.key.size());
+    for (int64_t value : plan.key) {
+      writer.Write(value);
+    }
+    // The allocated tensors are those of the key.
+    for (const ArenaAllocWithUsageInterval& alloc : plan.allocs) {
+      writer.Write(alloc);
+    }
+    writer.Write(plan.shared_tensors.size());
+    for (const auto& [tensor, root] : plan.shared_tensors) {
+      writer.Write(tensor);
+      writer.Write(root);
+    }
+    writer.Write(plan.arena_plan);
+    writer.Write(plan.persistent_arena_plan);
+  }
+  return std::move(writer.data());
+}
+
+TfLiteStatus ArenaPlanner::LoadPlanCache(const char* data, size_t size) {
+  PlanCacheReader reader(data, size);
+  int64_t version, alignment;
+  size_t num_plans;
+  TF_LITE_ENSURE(context_, reader.Read(&version) &&
+                               version == kPlanCacheVersion &&
+                               reader.Read(&alignment) &&
+                               alignment == tensor_alignment_ &&
+                               reader.Read(&num_plans));
+  std::list<CachedPlan> plans;
+  for (size_t i = 0; i < num_plans; ++i) {
+    CachedPlan plan;
+    size_t key_size;
+    TF_LITE_ENSURE(context_, reader.ReadCount(sizeof(int64_t), &key_size) &&
+                                 key_size >= kPlanKeyTensorsOffset);
+    plan.key.resize(key_size);
+    for (int64_t& value : plan.key) {
+      TF_LITE_ENSURE(context_, reader.Read(&value));
+    }
+    const int64_t num_tensors = plan.key[kPlanKeyTensorsOffset - 1];
+    TF_LITE_ENSURE(context_,
+                   num_tensors >= 0 &&
+                       static_cast<uint64_t>(num_tensors) <=
+                           (key_size - kPlanKeyTensorsOffset) /
+                               kPlanKeyEntriesPerTensor);
+
+    plan.tensors.resize(num_tensors);
+    plan.allocs.resize(num_tensors);
+    for (int64_t j = 0; j < num_tensors; ++j) {
+      const int64_t tensor =
+          plan.key[kPlanKeyTensorsOffset + j * kPlanKeyEntriesPerTensor];
+      TF_LITE_ENSURE(context_,
+                     tensor >= 0 &&
+                         tensor <= std::numeric_limits<int32_t>::max() &&
+                         reader.Read(&plan.allocs[j]));
+      plan.tensors[j] = static_cast<int32_t>(tensor);
+    }
+    size_t num_shared_tensors;
+    TF_LITE_ENSURE(context_, reader.ReadCount(2 * sizeof(int64_t),
+                                              &num_shared_tensors));
+    plan.shared_tensors.resize(num_shared_tensors);
+    for (auto& [tensor, root] : plan.shared_tensors) {
+      TF_LITE_ENSURE(context_, reader.Read(&tensor) && reader.Read(&root));
+    }
+    TF_LITE_ENSURE(context_, reader.Read(&plan.arena_plan) &&
+                                 reader.Read(&plan.persistent_arena_plan));
+
+    // The plan is only restored if its key matches the tensors of the
+    // subgraph, make sure it does not reference other tensors.
+    const size_t shared_tensors_offset =
+        kPlanKeyTensorsOffset + num_tensors * kPlanKeyEntriesPerTensor;
+    for (const auto& [tensor, root] : plan.shared_tensors) {
+      bool found = false;
+      for (size_t j = shared_tensors_offset; j + 4 < key_size; j += 5) {
+        found |= plan.key[j] == tensor && plan.key[j + 2] == root;
+      }
+      TF_LITE_ENSURE(context_, found);
+    }
+    TF_LITE_ENSURE(context_, IsValidCachedPlan(plan));
+    plans.push_back(std::move(plan));
+  }
+  TF_LITE_ENSURE(context_, reader.done());
+
+  plan_cache_.splice(plan_cache_.end(), plans);
+  plan_cache_capacity_ = std::max(plan_cache_capacity_, plan_cache_.size());
   return kTfLiteOk;
 }
 
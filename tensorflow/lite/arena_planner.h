@@ -17,9 +17,12 @@ limitations under the License.
 
 #include <cstddef>
 #include <cstdint>
+#include <list>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/core/c/common.h"
@@ -32,6 +35,11 @@ namespace tflite {
 
 constexpr const int kDefaultArenaAlignment = 64;
 
+// Prefix of the name of the model metadata holding the allocation plans of a
+// subgraph, serialized by ArenaPlanner::SerializePlanCache(). The name ends
+// with the index of the subgraph.
+constexpr char kArenaPlanCacheMetadataPrefix[] = "arena_plan_cache_";
+
 // A memory planner that makes all the allocations using arenas.
 //
 // Before a model is executed by the interpreter, this class determines when
@@ -72,7 +80,73 @@ class ArenaPlanner : public MemoryPlanner {
   // Returns the base arena location for a given allocation type.
   std::intptr_t BasePointer(TfLiteAllocationType type);
 
+  // Keeps the last `capacity` allocation plans computed after
+  // ResetAllocations(), keyed by the sizes and lifetimes of the tensors they
+  // allocate. Allocating tensors again with sizes seen before, e.g. after
+  // resizing the inputs back to previous shapes, then reuses the plan instead
+  // of computing it. Plans are not cached by default.
+  void SetPlanCacheCapacity(size_t capacity);
+
+  // Returns the cached plans, for LoadPlanCache() to load them in another
+  // interpreter for the same subgraph, e.g. from the model metadata.
+  std::string SerializePlanCache() const;
+
+  // Adds plans returned by SerializePlanCache() to the cache, growing its
+  // capacity if needed.
+  TfLiteStatus LoadPlanCache(const char* data, size_t size);
+
+  // Returns the number of plans that were reused instead of computed.
+  int num_cached_plans_used() const { return num_cached_plans_used_; }
+
+  // Plans the allocations so that the nodes of each wave computed by
+  // `ComputeExecutionWaves` can be executed concurrently: the tensors used by
+  // a node of a wave are allocated during the whole wave, so that they never
+  // share memory with the tensors used by the other nodes of the wave. This
+  // uses more memory than sequential execution, which the plans still allow.
+  // Must be called before PlanAllocations().
+  void SetParallelExecution(bool parallel_execution) {
+    parallel_execution_ = parallel_execution;
+  }
+
+  // Returns the waves computed by the last PlanAllocations() if parallel
+  // execution is enabled, each wave holding indices in the execution plan in
+  // increasing order.
+  const std::vector<std::vector<int>>& execution_waves() const {
+    return execution_waves_;
+  }
+
  private:
+  // An allocation plan of `CalculateAllocations`.
+  struct CachedPlan {
+    // The sizes and lifetimes the plan was computed for.
+    std::vector<int64_t> key;
+    // The tensors allocated by the plan, and their allocations.
+    std::vector<int32_t> tensors;
+    std::vector<ArenaAllocWithUsageInterval> allocs;
+    // `actual_tensor_id_` after the plan was computed.
+    std::vector<std::pair<int32_t, int32_t>> shared_tensors;
+    SimpleMemoryArena::Plan arena_plan;
+    SimpleMemoryArena::Plan persistent_arena_plan;
+  };
+
+  // Returns the key of the plan allocating `tensors_allocated` for nodes up to
+  // `last_node`, starting from empty arenas.
+  std::vector<int64_t> CreatePlanKey(
+      int last_node, const std::vector<int32_t>& tensors_allocated) const;
+
+  // Restores the cached plan for `key`. Returns false if there is none.
+  bool RestoreCachedPlan(const std::vector<int64_t>& key, int last_node,
+                         std::vector<int32_t>* tensors_allocated);
+
+  // Returns true if the allocations of `plan`, e.g. loaded from a model, fit
+  // in their arenas and give each tensor of its key a buffer of its size that
+  // no other live tensor uses.
+  bool IsValidCachedPlan(const CachedPlan& plan) const;
+
+  // Caches the plan that was just computed for `key`.
+  void CachePlan(std::vector<int64_t> key,
+                 const std::vector<int32_t>& tensors_allocated);
+
   // Check whether the input tensor's memory may be shared the output tensor.
   // tensor_changed: true if the output tensor modifies the tensor data. For
   // example, `Reshape` doesn't modify data but Add does.
@@ -120,6 +194,10 @@ class ArenaPlanner : public MemoryPlanner {
   // Return the index of the tensor owing `tensor_index's` buffer.
   int FindSharedTensor(int tensor_index);
 
+  // Computes `execution_waves_` and extends the lifetimes of the tensors
+  // planned by PlanAllocations() to the waves they are used in.
+  void ExtendLifetimesToWaves();
+
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
 
@@ -166,6 +244,17 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Store number of references to each tensor.
   std::vector<int> refcounts_;
+
+  // Cached allocation plans, the most recently used first.
+  size_t plan_cache_capacity_ = 0;
+  std::list<CachedPlan> plan_cache_;
+  int num_cached_plans_used_ = 0;
+
+  // Waves of the execution plan, if allocations are planned for parallel
+  // execution, and the wave of each node.
+  bool parallel_execution_ = false;
+  std::vector<std::vector<int>> execution_waves_;
+  std::vector<int> node_waves_;
 };
 
 }  // namespace tflite
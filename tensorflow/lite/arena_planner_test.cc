@@ -19,9 +19,11 @@ limitations under the License.
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <initializer_list>
 #include <memory>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -1074,6 +1076,190 @@ TEST_F(ArenaPlannerTest, DebugTensors) {
   EXPECT_EQ(tensorOffsets.size(), 8);
 }
 
+TEST_F(ArenaPlannerTest, PlanCacheReusesPlanForSameSizes) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},     // First op
+                      {{2, 0}, {4, 5}, {}},  // Second op
+                      {{4, 5}, {3}, {}}      // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  planner_->SetPlanCacheCapacity(2);
+  Execute(0, graph.nodes().size() - 1);
+  std::vector<std::ptrdiff_t> offsets;
+  for (int i = 0; i < 6; ++i) {
+    offsets.push_back(GetOffset(i));
+  }
+  EXPECT_EQ(planner_->num_cached_plans_used(), 0);
+
+  // Same sizes: the plan is reused.
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 1);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+
+  // Larger inputs need a new plan.
+  (*graph.tensors())[0].bytes = 40;
+  (*graph.tensors())[1].bytes = 40;
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 1);
+  EXPECT_EQ(GetOffset(1), 40);
+  EXPECT_EQ(GetOffset(5), GetOffsetAfter(1));
+
+  // Back to the original sizes, the first plan is still cached.
+  (*graph.tensors())[0].bytes = 3;
+  (*graph.tensors())[1].bytes = 6;
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 2);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+}
+
+TEST_F(ArenaPlannerTest, PlanCacheEvictsLeastRecentlyUsedPlan) {
+  TestGraph graph({1}, {{{1}, {2}, {}}}, {2});
+  SetGraph(&graph);
+  planner_->SetPlanCacheCapacity(1);
+  Execute(0, graph.nodes().size() - 1);
+
+  (*graph.tensors())[1].bytes = 12;
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  (*graph.tensors())[1].bytes = 6;
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 0);
+}
+
+TEST_F(ArenaPlannerTest, PlanCacheSerialization) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {5}},  // First op, with temporary
+                      {{2, 0}, {4}, {}},   // Second op
+                      {{4}, {3}, {}}       // Third op
+                  },
+                  {3});
+  (*graph.tensors())[5].allocation_type = kTfLiteArenaRwPersistent;
+  SetGraph(&graph);
+  planner_->SetPlanCacheCapacity(1);
+  Execute(0, graph.nodes().size() - 1);
+  std::vector<std::ptrdiff_t> offsets;
+  for (int i = 0; i < 6; ++i) {
+    offsets.push_back(GetOffset(i));
+  }
+  const std::string plans = planner_->SerializePlanCache();
+
+  // A new planner, e.g. in another interpreter, reuses the loaded plan.
+  SetGraph(&graph);
+  ASSERT_EQ(planner_->LoadPlanCache(plans.data(), plans.size()), kTfLiteOk);
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 1);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+  EXPECT_EQ(planner_->SerializePlanCache(), plans);
+}
+
+TEST_F(ArenaPlannerTest, PlanCacheRejectsInvalidData) {
+  TestGraph graph({1}, {{{1}, {2}, {}}}, {2});
+  SetGraph(&graph);
+  planner_->SetPlanCacheCapacity(1);
+  Execute(0, graph.nodes().size() - 1);
+  const std::string plans = planner_->SerializePlanCache();
+
+  SetGraph(&graph);
+  // Truncated.
+  EXPECT_EQ(planner_->LoadPlanCache(plans.data(), plans.size() - 1),
+            kTfLiteError);
+  // Trailing data.
+  const std::string longer = plans + std::string(sizeof(int64_t), 0);
+  EXPECT_EQ(planner_->LoadPlanCache(longer.data(), longer.size()),
+            kTfLiteError);
+  // Sets `field` of the allocation of the `tensor`-th tensor of the key to
+  // `value` and returns its previous value. The allocations follow the header
+  // (3 values), the key size and the key (2 values and 5 per tensor), and hold
+  // the tensor, the offset, the size and the lifetime of the allocation.
+  auto corrupt = [&plans](int tensor, int field, int64_t value,
+                          std::string* corrupted) {
+    *corrupted = plans;
+    const size_t position = (3 + 1 + 12 + 5 * tensor + field) * sizeof(int64_t);
+    int64_t previous;
+    std::memcpy(&previous, &(*corrupted)[position], sizeof(previous));
+    std::memcpy(&(*corrupted)[position], &value, sizeof(value));
+    return previous;
+  };
+  std::string corrupted;
+  // An allocation past the end of its arena.
+  EXPECT_EQ(corrupt(0, /*field=*/1, 1 << 20, &corrupted), 0);
+  EXPECT_EQ(planner_->LoadPlanCache(corrupted.data(), corrupted.size()),
+            kTfLiteError);
+  // An allocation smaller than its tensor.
+  EXPECT_EQ(corrupt(0, /*field=*/2, 5, &corrupted), 6);
+  EXPECT_EQ(planner_->LoadPlanCache(corrupted.data(), corrupted.size()),
+            kTfLiteError);
+  // Two tensors live at the same time in the same buffer.
+  EXPECT_NE(corrupt(1, /*field=*/1, 0, &corrupted), 0);
+  EXPECT_EQ(planner_->LoadPlanCache(corrupted.data(), corrupted.size()),
+            kTfLiteError);
+  // The allocation of another tensor.
+  EXPECT_EQ(corrupt(0, /*field=*/0, 2, &corrupted), 1);
+  EXPECT_EQ(planner_->LoadPlanCache(corrupted.data(), corrupted.size()),
+            kTfLiteError);
+
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(planner_->num_cached_plans_used(), 0);
+}
+
+// Two towers of two ops each, joined by a fifth op: the first ops of the
+// towers are in the first wave, their second ops in the second wave.
+TEST_F(ArenaPlannerTest, ParallelExecutionSeparatesTensorsOfAWave) {
+  TestGraph graph({0},
+                  {
+                      /* in, out, tmp */
+                      {{0}, {1}, {}},      // First tower
+                      {{1}, {2}, {7}},     // First tower
+                      {{0}, {3}, {}},      // Second tower
+                      {{3}, {4}, {8}},     // Second tower
+                      {{2, 4}, {5}, {6}},  // Join
+                  },
+                  {5});
+  auto overlap = [this](int a, int b) {
+    return GetOffset(a) < GetOffsetAfter(b) && GetOffset(b) < GetOffsetAfter(a);
+  };
+
+  // Sequential execution reuses the memory of the first tower for the
+  // second one.
+  SetGraph(&graph);
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_TRUE(planner_->execution_waves().empty());
+  EXPECT_TRUE(overlap(1, 3) || overlap(2, 4) || overlap(7, 8));
+
+  planner_->SetParallelExecution(true);
+  ResetAllocations();
+  CHECK(planner_->PlanAllocations() == kTfLiteOk);
+  Execute(0, graph.nodes().size() - 1);
+  const std::vector<std::vector<int>> waves = {{0, 2}, {1, 3}, {4}};
+  EXPECT_EQ(planner_->execution_waves(), waves);
+  // Tensors used in the same wave never share memory.
+  for (const std::vector<int>& tensors :
+       std::vector<std::vector<int>>{{0, 1, 3}, {1, 2, 3, 4, 7, 8}}) {
+    for (int a : tensors) {
+      for (int b : tensors) {
+        if (a != b) {
+          EXPECT_FALSE(overlap(a, b)) << a << " " << b;
+        }
+      }
+    }
+  }
+}
+
 TEST_F(ArenaPlannerTest, SimpleProfilerTest) {
   gNumAlloc = 0;
   gNumDealloc = 0;
@@ -40,6 +40,14 @@ static TfLiteDelegate* CreateDelegate(const void* settings) {
       options.flags = xnnpack_settings->flags();
     }
   }
+  // The delegate copies the strings, which only need to outlive its creation.
+  const auto* caching_settings =
+      tflite_settings->compilation_caching_settings();
+  if (caching_settings && caching_settings->cache_dir() &&
+      caching_settings->model_token()) {
+    options.weight_cache_dir = caching_settings->cache_dir()->c_str();
+    options.model_token = caching_settings->model_token()->c_str();
+  }
   return TfLiteXNNPackDelegateCreate(&options);
 }
 
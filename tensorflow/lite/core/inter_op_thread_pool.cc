@@ -0,0 +1,113 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
+
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+
+namespace tflite {
+namespace {
+
+// The pool the calling thread is a worker of, and its index in the pool.
+thread_local const InterOpThreadPool* current_pool = nullptr;
+thread_local int current_thread = 0;
+
+}  // namespace
+
+InterOpThreadPool::InterOpThreadPool(int num_threads) {
+  for (int thread = 1; thread < num_threads; ++thread) {
+    workers_.emplace_back([this, thread] { WorkerLoop(thread); });
+  }
+}
+
+InterOpThreadPool::~InterOpThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+int InterOpThreadPool::CurrentThread() const {
+  return current_pool == this ? current_thread : 0;
+}
+
+void InterOpThreadPool::ParallelFor(int size,
+                                    const std::function<void(int, int)>& fn) {
+  if (size <= 0) return;
+  const int thread = CurrentThread();
+  Batch batch;
+  batch.fn = &fn;
+  batch.size = size;
+  batch.num_running_workers = static_cast<int>(workers_.size());
+  bool run_inline = size == 1 || workers_.empty() || thread != 0;
+  if (!run_inline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (batch_ == nullptr) {
+      batch_ = &batch;
+      ++num_batches_;
+    } else {
+      run_inline = true;
+    }
+  }
+  if (run_inline) {
+    for (int index = 0; index < size; ++index) {
+      fn(index, thread);
+    }
+    return;
+  }
+
+  work_available_.notify_all();
+  RunTasks(&batch, /*thread=*/0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [&batch] { return batch.num_running_workers == 0; });
+  batch_ = nullptr;
+}
+
+void InterOpThreadPool::RunTasks(Batch* batch, int thread) {
+  for (int index = batch->next_index.fetch_add(1); index < batch->size;
+       index = batch->next_index.fetch_add(1)) {
+    (*batch->fn)(index, thread);
+  }
+}
+
+void InterOpThreadPool::WorkerLoop(int thread) {
+  current_pool = this;
+  current_thread = thread;
+  uint64_t num_batches_seen = 0;
+  while (true) {
+    Batch* batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [this, num_batches_seen] {
+        return stopping_ || num_batches_ != num_batches_seen;
+      });
+      if (stopping_) return;
+      num_batches_seen = num_batches_;
+      batch = batch_;
+    }
+    RunTasks(batch, thread);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--batch->num_running_workers == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,83 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
+#define TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+namespace tflite {
+
+// A pool of threads executing the independent nodes of a subgraph
+// concurrently. Unlike the intra-op thread pools of the CPU backends, the
+// tasks are whole nodes, and the thread calling `ParallelFor` executes tasks
+// too.
+//
+// WARNING: This is an experimental API and subject to change.
+class InterOpThreadPool {
+ public:
+  // Starts `num_threads - 1` threads: the thread calling `ParallelFor` is the
+  // other one.
+  explicit InterOpThreadPool(int num_threads);
+  ~InterOpThreadPool();
+  InterOpThreadPool(const InterOpThreadPool&) = delete;
+  InterOpThreadPool& operator=(const InterOpThreadPool&) = delete;
+
+  int num_threads() const { return static_cast<int>(workers_.size()) + 1; }
+
+  // Calls `fn(index, thread)` for each `index` in [0, `size`) and returns once
+  // all the calls returned. `thread` is the index of the thread making the
+  // call, in [0, num_threads()), 0 being the thread calling `ParallelFor`.
+  //
+  // Calls made from `fn`, or while another thread is in `ParallelFor`, run all
+  // the tasks on the calling thread.
+  void ParallelFor(int size, const std::function<void(int, int)>& fn);
+
+ private:
+  struct Batch {
+    const std::function<void(int, int)>* fn;
+    int size;
+    std::atomic<int> next_index{0};
+    // Number of workers which have not finished executing tasks of the batch.
+    int num_running_workers;
+  };
+
+  void WorkerLoop(int thread);
+
+  // Executes tasks of `batch` until there are none left.
+  static void RunTasks(Batch* batch, int thread);
+
+  // Returns the index of the calling thread in this pool, 0 if it is not a
+  // worker.
+  int CurrentThread() const;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // The batch being executed, if any, and the number of batches started.
+  Batch* batch_ = nullptr;
+  uint64_t num_batches_ = 0;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
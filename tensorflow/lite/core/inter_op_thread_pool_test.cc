@@ -0,0 +1,68 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace tflite {
+namespace {
+
+TEST(InterOpThreadPoolTest, RunsEachTaskOnce) {
+  InterOpThreadPool pool(/*num_threads=*/4);
+  EXPECT_EQ(pool.num_threads(), 4);
+  for (int size : {0, 1, 3, 100}) {
+    std::vector<std::atomic<int>> calls(size);
+    std::atomic<bool> valid_threads{true};
+    pool.ParallelFor(size, [&](int index, int thread) {
+      ++calls[index];
+      if (thread < 0 || thread >= pool.num_threads()) valid_threads = false;
+    });
+    for (int index = 0; index < size; ++index) {
+      EXPECT_EQ(calls[index], 1) << index;
+    }
+    EXPECT_TRUE(valid_threads);
+  }
+}
+
+TEST(InterOpThreadPoolTest, SingleThread) {
+  InterOpThreadPool pool(/*num_threads=*/1);
+  EXPECT_EQ(pool.num_threads(), 1);
+  int sum = 0;
+  pool.ParallelFor(10, [&](int index, int thread) {
+    EXPECT_EQ(thread, 0);
+    sum += index;
+  });
+  EXPECT_EQ(sum, 45);
+}
+
+TEST(InterOpThreadPoolTest, NestedCallsRunOnTheCallingThread) {
+  InterOpThreadPool pool(/*num_threads=*/3);
+  std::atomic<int> num_calls{0};
+  std::atomic<bool> same_thread{true};
+  pool.ParallelFor(8, [&](int, int outer_thread) {
+    pool.ParallelFor(4, [&](int, int inner_thread) {
+      ++num_calls;
+      if (inner_thread != outer_thread) same_thread = false;
+    });
+  });
+  EXPECT_EQ(num_calls, 32);
+  EXPECT_TRUE(same_thread);
+}
+
+}  // namespace
+}  // namespace tflite
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
 #include "tensorflow/lite/core/signature_runner.h"
 #include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/interpreter_options.h"
@@ -315,6 +316,11 @@ TfLiteStatus Interpreter::SetNumThreads(int num_threads) {
       c->Refresh(context_);
     }
   }
+  for (auto& c : inter_op_cpu_backend_contexts_) {
+    if (c->internal_backend_context() != nullptr) {
+      c->internal_backend_context()->SetMaxNumThreads(num_threads);
+    }
+  }
   return kTfLiteOk;
 }
 
@@ -500,6 +506,25 @@ TfLiteStatus Interpreter::ApplyOptionsImpl(InterpreterOptions* options) {
           options->GetDynamicAllocationForLargeTensors());
     }
   }
+
+  // Handle `experimental_num_inter_op_threads_`.
+  const int num_inter_op_threads = options->GetNumInterOpThreads();
+  if (num_inter_op_threads > 1) {
+    inter_op_thread_pool_ =
+        std::make_unique<InterOpThreadPool>(num_inter_op_threads);
+    inter_op_cpu_backend_contexts_.clear();
+    std::vector<TfLiteExternalContext*> cpu_backend_contexts;
+    for (int thread = 1; thread < num_inter_op_threads; ++thread) {
+      inter_op_cpu_backend_contexts_.push_back(
+          std::make_unique<ExternalCpuBackendContext>());
+      cpu_backend_contexts.push_back(
+          inter_op_cpu_backend_contexts_.back().get());
+    }
+    for (auto& subgraph : subgraphs_) {
+      subgraph->SetInterOpThreadPool(inter_op_thread_pool_.get(),
+                                     cpu_backend_contexts);
+    }
+  }
   return kTfLiteOk;
 }
 
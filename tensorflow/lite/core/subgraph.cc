@@ -39,6 +39,7 @@ limitations under the License.
 #include "tensorflow/lite/core/api/tensor_utils.h"
 #include "tensorflow/lite/core/c/c_api_types.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/memory_planner.h"
@@ -77,6 +78,10 @@ struct TfLiteSparsityDeleter {
 using ScopedTfLiteSparsity =
     std::unique_ptr<TfLiteSparsity, TfLiteSparsityDeleter>;
 
+// CPU backend context of the inter-op thread executing a node, if it is not
+// the thread calling `Invoke`.
+thread_local TfLiteExternalContext* inter_op_cpu_backend_context = nullptr;
+
 TfLiteStatus ReportOpError(TfLiteContext* context, const TfLiteNode& node,
                            const TfLiteRegistration& registration,
                            int node_index, const char* message) {
@@ -615,6 +620,10 @@ TfLiteStatus Subgraph::ReplaceNodeSubsetsWithDelegateKernels(
 
 TfLiteExternalContext* Subgraph::GetExternalContext(
     TfLiteExternalContextType type) {
+  if (type == kTfLiteCpuBackendContext &&
+      inter_op_cpu_backend_context != nullptr) {
+    return inter_op_cpu_backend_context;
+  }
   if (static_cast<int>(type) >= 0 && type < kTfLiteMaxExternalContexts) {
     return external_contexts_[type];
   }
@@ -1521,9 +1530,23 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
 #ifdef TFLITE_USE_SIMPLE_MEMORY_PLANNER
     memory_planner_.reset(new SimplePlanner(&context_, CreateGraphInfo()));
 #else
-    memory_planner_ = std::make_unique<ArenaPlanner>(
+    auto arena_planner = std::make_unique<ArenaPlanner>(
         &context_, CreateGraphInfo(), ShouldPreserveAllTensors(),
         kDefaultTensorAlignment, subgraph_index_);
+    arena_planner->SetPlanCacheCapacity(MemoryPlanCacheSize());
+    arena_planner->SetParallelExecution(inter_op_thread_pool_ != nullptr);
+    const std::string plans_name =
+        kArenaPlanCacheMetadataPrefix + std::to_string(subgraph_index_);
+    const char* plans = nullptr;
+    size_t plans_size = 0;
+    if (GetModelMetadata(plans_name.c_str(), &plans, &plans_size) ==
+            kTfLiteOk &&
+        arena_planner->LoadPlanCache(plans, plans_size) != kTfLiteOk) {
+      // The plans only save time: plan the memory if they can't be used.
+      TFLITE_LOG(tflite::TFLITE_LOG_WARNING,
+                 "Ignoring invalid memory plans %s.", plans_name.c_str());
+    }
+    memory_planner_ = std::move(arena_planner);
 #endif
     memory_planner_->PlanAllocations();
   }
@@ -1602,6 +1625,14 @@ TfLiteStatus Subgraph::InvokeImpl() {
       tflite::OnTfLiteSubgraphInvoke(name_.c_str(), subgraph_index_);
 #endif  // TF_LITE_TENSORFLOW_PROFILER
 
+  if (const std::vector<std::vector<int>>* waves = GetExecutionWaves()) {
+    status = InvokeInParallel(*waves);
+#ifdef TF_LITE_TENSORFLOW_PROFILER
+    tflite::OnTfLiteSubgraphInvokeEnd(trace_subgraph);
+#endif  // TF_LITE_TENSORFLOW_PROFILER
+    return status;
+  }
+
   // Invocations are always done in node order.
   // Note that calling Invoke repeatedly will cause the original memory plan to
   // be reused, unless either ResizeInputTensor() or AllocateTensors() has been
@@ -1636,37 +1667,7 @@ TfLiteStatus Subgraph::InvokeImpl() {
     TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(
         profile_op ? profiler_.get() : nullptr, op_name, node_index);
 
-    for (int i = 0; i < node.inputs->size; ++i) {
-      int tensor_index = node.inputs->data[i];
-      if (tensor_index == kTfLiteOptionalTensor) {
-        continue;
-      }
-      TfLiteTensor* tensor = &tensors_[tensor_index];
-      if (tensor->delegate && tensor->delegate != node.delegate &&
-          tensor->data_is_stale) {
-        TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
-      }
-      if (tensor->data.raw == nullptr && tensor->bytes > 0) {
-        if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
-            tensor->dims->size != 1) {
-          // In general, having a tensor here with no buffer will be an error.
-          // However, for the reshape operator, the second input tensor is
-          // sometimes only used for the shape, not for the data. Thus, null
-          // buffer is ok in this situation.
-          // The situation where null buffer is not ok for reshape operator is
-          // only when there are 2 inputs given to the node and the one
-          // corresponding to the shape (i == 1) is a vector that contains all
-          // dimensions. See `GetOutputShape()` function in
-          // `tensorflow/lite/kernels/reshape.cc`
-          continue;
-        } else {
-          // In all other cases, we need to return an error as otherwise we will
-          // trigger a null pointer dereference (likely).
-          ReportError("Input tensor %d lacks data", tensor_index);
-          return kTfLiteError;
-        }
-      }
-    }
+    TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(node, registration));
     // Allocate dynamic tensors which memory is required to be allocated
     // before executing the node.
     MayAllocateOpOutput(&node);
@@ -1723,6 +1724,118 @@ TfLiteStatus Subgraph::InvokeImpl() {
   return status;
 }
 
+const std::vector<std::vector<int>>* Subgraph::GetExecutionWaves() {
+#ifdef TFLITE_USE_SIMPLE_MEMORY_PLANNER
+  return nullptr;
+#else
+  // Nodes are only executed concurrently once all of them are prepared and
+  // their tensors allocated, and if they do not need to be profiled or to
+  // allocate or release memory.
+  const size_t num_nodes = execution_plan_.size();
+  if (inter_op_thread_pool_ == nullptr || memory_planner_ == nullptr ||
+      profiler_ != nullptr || has_dynamic_tensors_ ||
+      next_execution_plan_index_to_prepare_ != num_nodes ||
+      next_execution_plan_index_to_plan_allocation_ != num_nodes ||
+      ShouldReleaseDynamicTensors() || ShouldOptimizeMemoryForLargeTensors()) {
+    return nullptr;
+  }
+  // `memory_planner_` is only created as an ArenaPlanner in this case.
+  const std::vector<std::vector<int>>& waves =
+      static_cast<const ArenaPlanner*>(memory_planner_.get())
+          ->execution_waves();
+  // Waves of one node each are executed sequentially anyway.
+  if (waves.empty() || waves.size() == num_nodes) return nullptr;
+  return &waves;
+#endif
+}
+
+TfLiteStatus Subgraph::InvokeInParallel(
+    const std::vector<std::vector<int>>& waves) {
+  // Kernels may add tensors, which must not move the tensors other threads
+  // are using.
+  EnsureTensorsVectorCapacity();
+  for (const std::vector<int>& wave : waves) {
+    for (int execution_plan_index : wave) {
+      const auto& [node, registration] =
+          nodes_and_registration_[execution_plan_[execution_plan_index]];
+      TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(node, registration));
+    }
+
+    if (check_cancelled_func_ != nullptr &&
+        check_cancelled_func_(cancellation_data_)) {
+      ReportError("Client requested cancel during Invoke()");
+      return kTfLiteError;
+    }
+
+    if (continue_invocation_ && !continue_invocation_->test_and_set()) {
+      // `Cancel` is called and cancellation flag is flipped.
+      ReportError("Client requested cancel during Invoke()");
+      return kTfLiteCancelled;
+    }
+
+    wave_statuses_.assign(wave.size(), kTfLiteOk);
+    inter_op_thread_pool_->ParallelFor(
+        wave.size(), [this, &wave](int i, int thread) {
+          auto& [node, registration] =
+              nodes_and_registration_[execution_plan_[wave[i]]];
+          TfLiteExternalContext* previous_context =
+              inter_op_cpu_backend_context;
+          if (thread > 0) {
+            inter_op_cpu_backend_context =
+                inter_op_cpu_backend_contexts_[thread - 1];
+          }
+          wave_statuses_[i] = OpInvoke(registration, &node);
+          inter_op_cpu_backend_context = previous_context;
+        });
+    for (size_t i = 0; i < wave.size(); ++i) {
+      if (wave_statuses_[i] != kTfLiteOk) {
+        const int node_index = execution_plan_[wave[i]];
+        const auto& [node, registration] = nodes_and_registration_[node_index];
+        auto err = ReportOpError(&context_, node, registration, node_index,
+                                 "failed to invoke");
+        return wave_statuses_[i] == kTfLiteCancelled ? wave_statuses_[i] : err;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::EnsureNodeInputsAreReadable(
+    const TfLiteNode& node, const TfLiteRegistration& registration) {
+  for (int i = 0; i < node.inputs->size; ++i) {
+    int tensor_index = node.inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      continue;
+    }
+    TfLiteTensor* tensor = &tensors_[tensor_index];
+    if (tensor->delegate && tensor->delegate != node.delegate &&
+        tensor->data_is_stale) {
+      TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
+    }
+    if (tensor->data.raw == nullptr && tensor->bytes > 0) {
+      if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
+          tensor->dims->size != 1) {
+        // In general, having a tensor here with no buffer will be an error.
+        // However, for the reshape operator, the second input tensor is
+        // sometimes only used for the shape, not for the data. Thus, null
+        // buffer is ok in this situation.
+        // The situation where null buffer is not ok for reshape operator is
+        // only when there are 2 inputs given to the node and the one
+        // corresponding to the shape (i == 1) is a vector that contains all
+        // dimensions. See `GetOutputShape()` function in
+        // `tensorflow/lite/kernels/reshape.cc`
+        continue;
+      } else {
+        // In all other cases, we need to return an error as otherwise we will
+        // trigger a null pointer dereference (likely).
+        ReportError("Input tensor %d lacks data", tensor_index);
+        return kTfLiteError;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus Subgraph::ResizeTensor(TfLiteContext* context,
                                     TfLiteTensor* tensor,
                                     TfLiteIntArray* new_size) {
@@ -2376,6 +2489,22 @@ void Subgraph::DumpMemoryPlannerDebugInfo() const {
   memory_planner_->DumpDebugInfo(execution_plan());
 }
 
+TfLiteStatus Subgraph::SerializeMemoryPlans(std::string* plans) {
+#ifdef TFLITE_USE_SIMPLE_MEMORY_PLANNER
+  ReportError("The simple memory planner does not cache memory plans.");
+  return kTfLiteError;
+#else
+  if (memory_planner_ == nullptr) {
+    ReportError("Tensors must be allocated before serializing memory plans.");
+    return kTfLiteError;
+  }
+  // `memory_planner_` is only created as an ArenaPlanner in this case.
+  *plans = static_cast<const ArenaPlanner*>(memory_planner_.get())
+               ->SerializePlanCache();
+  return kTfLiteOk;
+#endif
+}
+
 void Subgraph::GetMemoryAllocInfo(SubgraphAllocInfo* alloc_info) const {
   memset(alloc_info, 0, sizeof(SubgraphAllocInfo));
   if (memory_planner_ == nullptr) return;
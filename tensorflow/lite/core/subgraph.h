@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
 #include "tensorflow/lite/core/macros.h"
 #include "tensorflow/lite/experimental/resource/initialization_status.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
@@ -461,12 +462,38 @@ class Subgraph {
     return (options_ && (options_->GetDynamicAllocationForLargeTensors() > 0));
   }
 
+  // WARNING: This is an experimental API and subject to change.
+  // Number of memory plans the memory planner should keep.
+  int MemoryPlanCacheSize() const {
+    return options_ ? options_->GetMemoryPlanCacheSize() : 0;
+  }
+
+  // WARNING: This is an experimental API and subject to change.
+  // Serializes the memory plans cached by the memory planner, to be stored in
+  // the model metadata under `kArenaPlanCacheMetadataPrefix` followed by the
+  // subgraph index. Fails if the memory planner does not cache plans.
+  TfLiteStatus SerializeMemoryPlans(std::string* plans);
+
   // WARNING: This is an experimental API and subject to change.
   // Remove unused inputs of the subgraph. It checks usage of inputs and mark it
   // as kTfLiteOptionalTensor if the input is not used in graph execution.
   // Currently, it's used to remove unused inputs of WHILE cond subgraphs.
   TfLiteStatus RemoveUnusedInputs();
 
+  // WARNING: This is an experimental API and subject to change.
+  // Executes the independent nodes of the subgraph concurrently on `pool`, or
+  // sequentially if `pool` is null. `cpu_backend_contexts` has a CPU backend
+  // context for each thread of the pool but the one calling `Invoke`: the
+  // nodes executed by the thread `thread` use `cpu_backend_contexts[thread -
+  // 1]`. Must be called before the tensors are allocated. Ownership is not
+  // taken.
+  void SetInterOpThreadPool(
+      InterOpThreadPool* pool,
+      std::vector<TfLiteExternalContext*> cpu_backend_contexts) {
+    inter_op_thread_pool_ = pool;
+    inter_op_cpu_backend_contexts_ = std::move(cpu_backend_contexts);
+  }
+
   // WARNING: This is an experimental API and subject to change.
   // If true, the graph-reordering optimization that finds a topological
   // reordering that keeps delegated nodes together will be disabled.
@@ -697,6 +724,19 @@ class Subgraph {
   // Does not report invoke status through profiler.
   TfLiteStatus InvokeImpl();
 
+  // Returns the waves of nodes, as indices in the execution plan, that
+  // `InvokeInParallel` can execute, or null if the subgraph must be invoked
+  // sequentially.
+  const std::vector<std::vector<int>>* GetExecutionWaves();
+
+  // Invokes the subgraph wave by wave, executing the nodes of each wave
+  // concurrently on `inter_op_thread_pool_`.
+  TfLiteStatus InvokeInParallel(const std::vector<std::vector<int>>& waves);
+
+  // Makes sure the inputs of `node` can be read by its kernel.
+  TfLiteStatus EnsureNodeInputsAreReadable(
+      const TfLiteNode& node, const TfLiteRegistration& registration);
+
   // Allow a delegate to look at the graph and modify the graph to handle
   // parts of the graph themselves. After this is called, the graph may
   // contain new nodes that replace 1 more nodes.
@@ -1057,6 +1097,13 @@ class Subgraph {
   // Profiler for this interpreter instance.
   std::unique_ptr<SubgraphAwareProfiler> profiler_;
 
+  // Pool executing independent nodes concurrently and the CPU backend
+  // contexts of its threads, not owned, and the statuses of the nodes of the
+  // last wave executed.
+  InterOpThreadPool* inter_op_thread_pool_ = nullptr;
+  std::vector<TfLiteExternalContext*> inter_op_cpu_backend_contexts_;
+  std::vector<TfLiteStatus> wave_statuses_;
+
   // A pointer to vector of subgraphs. The vector is owned by the interpreter.
   std::vector<std::unique_ptr<Subgraph>>* subgraphs_ = nullptr;
 
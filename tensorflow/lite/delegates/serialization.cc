@@ -84,14 +84,23 @@ SerializationEntry::SerializationEntry(const std::string& cache_dir,
       model_token_(model_token),
       fingerprint_(fingerprint) {}
 
+std::string SerializationEntry::GetDataFilePath() const {
+  return GetFilePath(cache_dir_, model_token_, fingerprint_);
+}
+
 TfLiteStatus SerializationEntry::SetData(TfLiteContext* context,
                                          const char* data,
                                          const size_t size) const {
   auto filepath = GetFilePath(cache_dir_, model_token_, fingerprint_);
   // Temporary file to write data to.
-  const std::string temp_filepath =
+  std::string temp_filepath =
       JoinPath(cache_dir_, (model_token_ + std::to_string(fingerprint_) +
                             std::to_string(time(nullptr))));
+#if !defined(_WIN32)
+  // Processes sharing the cache directory may write the same entry at the
+  // same time: each one writes its own temporary file.
+  temp_filepath += "_" + std::to_string(getpid());
+#endif  // !defined(_WIN32)
 
 #if defined(_WIN32)
   std::ofstream out_file(temp_filepath.c_str());
@@ -111,7 +120,7 @@ TfLiteStatus SerializationEntry::SetData(TfLiteContext* context,
 #else   // !defined(_WIN32)
   // This method only works on unix/POSIX systems.
   const int fd = open(temp_filepath.c_str(),
-                      O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+                      O_WRONLY | O_APPEND | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
   if (fd < 0) {
     TF_LITE_KERNEL_LOG(context, "Failed to open for writing: %s",
                        temp_filepath.c_str());
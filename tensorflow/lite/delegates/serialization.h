@@ -119,6 +119,10 @@ class SerializationEntry {
   //   kTfLiteError for unexpected error.
   TfLiteStatus GetData(TfLiteContext* context, std::string* data) const;
 
+  // Returns the path of the file that stores the data of this entry, for
+  // delegates that memory-map the data instead of reading it with GetData.
+  std::string GetDataFilePath() const;
+
   // Non-copyable.
   SerializationEntry(const SerializationEntry&) = delete;
   SerializationEntry& operator=(const SerializationEntry&) = delete;
@@ -0,0 +1,375 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/xnnpack/weight_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef TFLITE_HAVE_CPUINFO
+#include "include/cpuinfo.h"
+#endif
+
+#include "xnnpack.h"  // from @XNNPACK
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/stderr_reporter.h"
+
+namespace tflite {
+namespace xnnpack {
+namespace {
+
+// Alignment of the packed buffers, at least XNN_ALLOCATION_ALIGNMENT on every
+// platform.
+constexpr size_t kAlignment = 64;
+constexpr uint64_t kFileMagic = 0x48434143574e4e58;  // "XNNWCACH"
+
+// The cache file starts with a header, followed by `num_entries` entries and
+// the packed buffers. All integers are in host byte order: cache files are
+// only meant to be read on the machine that wrote them.
+struct FileHeader {
+  uint64_t magic;
+  uint64_t version;
+  char xnnpack_revision[sizeof(kWeightCacheXNNPackRevision)];
+  // NUL-terminated.
+  char hardware_identity[MMapWeightCacheProvider::kMaxHardwareIdentitySize];
+  uint64_t num_entries;
+  uint64_t entries_offset;
+};
+
+struct FileEntry {
+  uint64_t seed;
+  int64_t kernel;
+  int64_t bias;
+  // Offset of the packed buffer in the file.
+  uint64_t offset;
+  uint64_t size;
+};
+
+size_t RoundUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+char* AlignPointer(char* ptr) {
+  return reinterpret_cast<char*>(
+      RoundUp(reinterpret_cast<uintptr_t>(ptr), kAlignment));
+}
+
+std::string ToHex(uint64_t value) {
+  char buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%llx",
+                static_cast<unsigned long long>(value));  // NOLINT
+  return buffer;
+}
+
+std::string ComputeHardwareIdentity() {
+#ifdef TFLITE_HAVE_CPUINFO
+  if (cpuinfo_initialize()) {
+    uint64_t isa = 0;
+    int bit = 0;
+    auto add_feature = [&](bool has_feature) {
+      isa |= static_cast<uint64_t>(has_feature) << bit++;
+    };
+    std::string identity;
+#if CPUINFO_ARCH_X86 || CPUINFO_ARCH_X86_64
+    identity = "x86";
+    add_feature(cpuinfo_has_x86_sse4_1());
+    add_feature(cpuinfo_has_x86_avx());
+    add_feature(cpuinfo_has_x86_fma3());
+    add_feature(cpuinfo_has_x86_f16c());
+    add_feature(cpuinfo_has_x86_avx2());
+    add_feature(cpuinfo_has_x86_avx512f());
+    add_feature(cpuinfo_has_x86_avx512bw());
+    add_feature(cpuinfo_has_x86_avx512dq());
+    add_feature(cpuinfo_has_x86_avx512vl());
+    add_feature(cpuinfo_has_x86_avx512vnni());
+#elif CPUINFO_ARCH_ARM || CPUINFO_ARCH_ARM64
+    identity = "arm";
+    add_feature(cpuinfo_has_arm_neon());
+    add_feature(cpuinfo_has_arm_neon_fma());
+    add_feature(cpuinfo_has_arm_neon_fp16());
+    add_feature(cpuinfo_has_arm_neon_fp16_arith());
+    add_feature(cpuinfo_has_arm_neon_dot());
+    add_feature(cpuinfo_has_arm_neon_bf16());
+    add_feature(cpuinfo_has_arm_i8mm());
+    add_feature(cpuinfo_has_arm_sve());
+    add_feature(cpuinfo_has_arm_sve2());
+#else
+    identity = "other";
+#endif
+    identity += ":" + ToHex(isa);
+    // XNNPACK may pick different microkernels for the cores of a
+    // heterogeneous CPU, so all of them are part of the identity.
+    for (uint32_t i = 0; i < cpuinfo_get_uarchs_count(); ++i) {
+      identity += ":" + ToHex(cpuinfo_get_uarch(i)->uarch);
+    }
+    return identity;
+  }
+#endif  // TFLITE_HAVE_CPUINFO
+  return "unknown";
+}
+
+}  // namespace
+
+std::string GetWeightCacheHardwareIdentity() {
+  static const std::string* const identity =
+      new std::string(ComputeHardwareIdentity());
+  return *identity;
+}
+
+size_t MMapWeightCacheProvider::PackIdentifierHash::operator()(
+    const PackIdentifier& id) const {
+  size_t hash = std::hash<uint64_t>()(id.seed);
+  hash = hash * 31 + std::hash<int64_t>()(id.kernel);
+  return hash * 31 + std::hash<int64_t>()(id.bias);
+}
+
+size_t MMapWeightCacheProvider::TransientKeyHash::operator()(
+    const TransientKey& key) const {
+  size_t hash = std::hash<uint64_t>()(key.seed);
+  hash = hash * 31 + std::hash<const void*>()(key.kernel);
+  return hash * 31 + std::hash<const void*>()(key.bias);
+}
+
+MMapWeightCacheProvider::MMapWeightCacheProvider()
+    : MMapWeightCacheProvider(GetWeightCacheHardwareIdentity()) {}
+
+MMapWeightCacheProvider::MMapWeightCacheProvider(std::string hardware_identity)
+    : hardware_identity_(
+          hardware_identity.substr(0, kMaxHardwareIdentitySize - 1)) {
+  cache_provider_.context = this;
+  cache_provider_.look_up = [](void* context,
+                               const xnn_weights_cache_look_up_key* key) {
+    return static_cast<MMapWeightCacheProvider*>(context)->LookUp(*key);
+  };
+  cache_provider_.reserve_space = [](void* context, size_t n) {
+    return static_cast<MMapWeightCacheProvider*>(context)->ReserveSpace(n);
+  };
+  cache_provider_.look_up_or_insert =
+      [](void* context, const xnn_weights_cache_look_up_key* key, void* ptr,
+         size_t size) {
+        return static_cast<MMapWeightCacheProvider*>(context)->LookUpOrInsert(
+            *key, ptr, size);
+      };
+  cache_provider_.is_finalized = [](void* context) {
+    return static_cast<MMapWeightCacheProvider*>(context)->finalized_;
+  };
+  cache_provider_.offset_to_addr = [](void* context, size_t offset) {
+    return static_cast<MMapWeightCacheProvider*>(context)->OffsetToAddr(
+        offset);
+  };
+  // The cache is owned by the delegate, not by XNNPACK.
+  cache_provider_.delete_cache = [](void* context) {
+    return xnn_status_success;
+  };
+}
+
+bool MMapWeightCacheProvider::Load(const std::string& path) {
+  if (!MMAPAllocation::IsSupported() || !std::ifstream(path).good()) {
+    return false;
+  }
+  auto file =
+      std::make_unique<MMAPAllocation>(path.c_str(), DefaultErrorReporter());
+  if (!file->valid() || file->bytes() < sizeof(FileHeader)) {
+    return false;
+  }
+  const char* data = static_cast<const char*>(file->base());
+  const size_t size = file->bytes();
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic == kFileMagic && header.version == kWeightCacheFileVersion &&
+      std::strncmp(header.hardware_identity, hardware_identity_.c_str(),
+                   sizeof(header.hardware_identity)) != 0) {
+    TFLITE_LOG_PROD(TFLITE_LOG_WARNING,
+                    "Ignoring XNNPACK weight cache file %s, which was written "
+                    "on other hardware.",
+                    path.c_str());
+    return false;
+  }
+  if (header.magic != kFileMagic || header.version != kWeightCacheFileVersion ||
+      std::memcmp(header.xnnpack_revision, kWeightCacheXNNPackRevision,
+                  sizeof(kWeightCacheXNNPackRevision)) != 0 ||
+      header.entries_offset > size ||
+      header.num_entries > (size - header.entries_offset) / sizeof(FileEntry)) {
+    TFLITE_LOG_PROD(TFLITE_LOG_WARNING,
+                    "Ignoring invalid XNNPACK weight cache file %s.",
+                    path.c_str());
+    return false;
+  }
+
+  const char* entries = data + header.entries_offset;
+  for (uint64_t i = 0; i < header.num_entries; ++i) {
+    FileEntry entry;
+    std::memcpy(&entry, entries + i * sizeof(FileEntry), sizeof(entry));
+    if (entry.offset % kAlignment != 0 || entry.offset > size ||
+        entry.size > size - entry.offset) {
+      TFLITE_LOG_PROD(TFLITE_LOG_WARNING,
+                      "Ignoring corrupted XNNPACK weight cache file %s.",
+                      path.c_str());
+      persistent_offsets_.clear();
+      return false;
+    }
+    persistent_offsets_[{entry.seed, entry.kernel, entry.bias}] = {
+        entry.offset, entry.size};
+  }
+  file_ = std::move(file);
+  file_size_ = size;
+  return true;
+}
+
+void MMapWeightCacheProvider::MapTensor(const void* data, int tensor_index) {
+  if (data != nullptr) {
+    tensor_indices_.emplace(data, tensor_index);
+  }
+}
+
+bool MMapWeightCacheProvider::ShouldSave() const {
+  return file_ == nullptr && has_new_persistent_entries_;
+}
+
+std::vector<char> MMapWeightCacheProvider::Serialize() const {
+  std::vector<std::pair<PackIdentifier, BufferLocation>> entries(
+      persistent_offsets_.begin(), persistent_offsets_.end());
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.second.offset < b.second.offset;
+  });
+
+  FileHeader header = {};
+  header.magic = kFileMagic;
+  header.version = kWeightCacheFileVersion;
+  std::memcpy(header.xnnpack_revision, kWeightCacheXNNPackRevision,
+              sizeof(kWeightCacheXNNPackRevision));
+  std::memcpy(header.hardware_identity, hardware_identity_.c_str(),
+              hardware_identity_.size() + 1);
+  header.num_entries = entries.size();
+  header.entries_offset = sizeof(FileHeader);
+
+  size_t data_offset = RoundUp(
+      header.entries_offset + entries.size() * sizeof(FileEntry), kAlignment);
+  std::vector<FileEntry> file_entries;
+  file_entries.reserve(entries.size());
+  for (const auto& [id, location] : entries) {
+    file_entries.push_back(
+        {id.seed, id.kernel, id.bias, data_offset, location.size});
+    data_offset = RoundUp(data_offset + location.size, kAlignment);
+  }
+
+  std::vector<char> file(data_offset, 0);
+  std::memcpy(file.data(), &header, sizeof(header));
+  if (!file_entries.empty()) {
+    std::memcpy(file.data() + header.entries_offset, file_entries.data(),
+                file_entries.size() * sizeof(FileEntry));
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    std::memcpy(file.data() + file_entries[i].offset,
+                OffsetToAddr(entries[i].second.offset),
+                entries[i].second.size);
+  }
+  return file;
+}
+
+bool MMapWeightCacheProvider::GetPackIdentifier(
+    const xnn_weights_cache_look_up_key& key, PackIdentifier* id) const {
+  id->seed = key.seed;
+  id->kernel = kNoTensor;
+  id->bias = kNoTensor;
+  if (key.kernel != nullptr) {
+    const auto it = tensor_indices_.find(key.kernel);
+    if (it == tensor_indices_.end()) return false;
+    id->kernel = it->second;
+  }
+  if (key.bias != nullptr) {
+    const auto it = tensor_indices_.find(key.bias);
+    if (it == tensor_indices_.end()) return false;
+    id->bias = it->second;
+  }
+  return true;
+}
+
+size_t MMapWeightCacheProvider::LookUp(
+    const xnn_weights_cache_look_up_key& key) {
+  PackIdentifier id;
+  if (GetPackIdentifier(key, &id)) {
+    const auto it = persistent_offsets_.find(id);
+    if (it == persistent_offsets_.end()) return kNotFound;
+    if (it->second.offset < file_size_) ++num_loaded_hits_;
+    return it->second.offset;
+  }
+  const auto it =
+      transient_offsets_.find({key.seed, key.kernel, key.bias});
+  return it == transient_offsets_.end() ? kNotFound : it->second;
+}
+
+void* MMapWeightCacheProvider::ReserveSpace(size_t size) {
+  const size_t offset = RoundUp(buffer_size_, kAlignment);
+  const size_t required = offset + size + kAlignment;
+  if (buffer_.size() < required) {
+    std::vector<char> buffer(std::max(required, 2 * buffer_.size()));
+    if (buffer_size_ > 0) {
+      std::memcpy(AlignPointer(buffer.data()), AlignPointer(buffer_.data()),
+                  buffer_size_);
+    }
+    buffer_ = std::move(buffer);
+  }
+  return AlignPointer(buffer_.data()) + offset;
+}
+
+size_t MMapWeightCacheProvider::LookUpOrInsert(
+    const xnn_weights_cache_look_up_key& key, void* ptr, size_t size) {
+  const size_t offset = LookUp(key);
+  if (offset != kNotFound) {
+    return offset;
+  }
+  // `ptr` must point into the space returned by the last `ReserveSpace`.
+  char* const start = AlignPointer(buffer_.data());
+  char* const packed = static_cast<char*>(ptr);
+  if (buffer_.empty() || packed < start + buffer_size_ ||
+      packed + size > buffer_.data() + buffer_.size()) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR,
+                    "XNNPACK packed weights outside of the reserved space.");
+    return kNotFound;
+  }
+  const size_t buffer_offset = packed - start;
+  buffer_size_ = buffer_offset + size;
+
+  PackIdentifier id;
+  if (GetPackIdentifier(key, &id)) {
+    persistent_offsets_[id] = {file_size_ + buffer_offset, size};
+    has_new_persistent_entries_ = true;
+  } else {
+    transient_offsets_[{key.seed, key.kernel, key.bias}] =
+        file_size_ + buffer_offset;
+  }
+  return file_size_ + buffer_offset;
+}
+
+void* MMapWeightCacheProvider::OffsetToAddr(size_t offset) const {
+  if (offset < file_size_) {
+    return const_cast<char*>(static_cast<const char*>(file_->base())) +
+           offset;
+  }
+  return AlignPointer(const_cast<char*>(buffer_.data())) +
+         (offset - file_size_);
+}
+
+}  // namespace xnnpack
+}  // namespace tflite
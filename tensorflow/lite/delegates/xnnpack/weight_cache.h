@@ -0,0 +1,177 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_DELEGATES_XNNPACK_WEIGHT_CACHE_H_
+#define TENSORFLOW_LITE_DELEGATES_XNNPACK_WEIGHT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "xnnpack.h"  // from @XNNPACK
+#include "tensorflow/lite/allocation.h"
+
+namespace tflite {
+namespace xnnpack {
+
+// Identifies the packing format of the weight cache files. Packed weights
+// depend on the XNNPACK revision, so it is part of the cache key.
+// LINT.IfChange(xnnpack_revision)
+inline constexpr char kWeightCacheXNNPackRevision[] =
+    "0cbbe74a16e6ca11acf8484ccac85f620336dea4";
+// LINT.ThenChange(//tensorflow/workspace2.bzl)
+inline constexpr uint64_t kWeightCacheFileVersion = 2;
+
+// Returns a short string identifying the CPU features that XNNPACK selects
+// its microkernels, and thus the layout of packed weights, from: the
+// architecture, the microarchitectures of the cores and the ISA extensions
+// reported by cpuinfo. Weights packed on a CPU with another identity must not
+// be loaded, e.g. from a cache directory shared between machines.
+std::string GetWeightCacheHardwareIdentity();
+
+// An XNNPACK weights cache whose packed weights can be saved to a file and
+// memory-mapped back by later interpreters, possibly in other processes.
+//
+// XNNPACK identifies packed weights by the addresses of the kernel and bias
+// they were packed from, which differ between processes. The delegate thus
+// maps the data of each static tensor to the tensor's index with `MapTensor`,
+// and only weights packed from mapped tensors are persisted. Weights packed
+// from other buffers (e.g. weights XNNPACK converted itself) are still cached,
+// in memory only.
+//
+// A loaded file is mapped read-only, so its pages are shared by all processes
+// using it. The file must have been written for the same model partition,
+// which the delegate guarantees by deriving the file name from the model token
+// and the partition (see `Serialization::GetEntryForKernel`). Files written
+// with another XNNPACK revision or hardware identity are rejected on load.
+//
+// Not thread-safe. Must outlive the XNNPACK runtimes created with it.
+class MMapWeightCacheProvider {
+ public:
+  // Value returned by the XNNPACK callbacks when a look up misses.
+  static constexpr size_t kNotFound = SIZE_MAX;
+  // Size of the hardware identity field of the file header.
+  static constexpr size_t kMaxHardwareIdentitySize = 128;
+
+  // Uses `GetWeightCacheHardwareIdentity()` as the hardware identity.
+  MMapWeightCacheProvider();
+  // Tags saved files with `hardware_identity` and only loads files with the
+  // same identity. Identities are truncated to `kMaxHardwareIdentitySize - 1`
+  // characters.
+  explicit MMapWeightCacheProvider(std::string hardware_identity);
+  MMapWeightCacheProvider(const MMapWeightCacheProvider&) = delete;
+  MMapWeightCacheProvider& operator=(const MMapWeightCacheProvider&) = delete;
+
+  // Memory-maps the cache file at `path`. Returns false, and leaves the cache
+  // empty, if the file does not exist or is not a valid cache file. Must be
+  // called before the cache is used.
+  bool Load(const std::string& path);
+
+  // Records that `data` holds the contents of the tensor at `tensor_index`.
+  void MapTensor(const void* data, int tensor_index);
+
+  // Returns true if weights that can be persisted were packed since the cache
+  // was created and no valid file was loaded.
+  bool ShouldSave() const;
+
+  // Returns the contents of a cache file holding the persistable weights.
+  std::vector<char> Serialize() const;
+
+  // Marks the cache as finalized once the runtimes using it are created, which
+  // XNNPACK requires before running them.
+  void Finalize() { finalized_ = true; }
+
+  // Returns the number of packed buffers served from the loaded file.
+  size_t num_loaded_hits() const { return num_loaded_hits_; }
+
+  xnn_weights_cache_t GetCacheProvider() { return &cache_provider_; }
+
+ private:
+  // A look up key with the kernel and bias pointers replaced by tensor
+  // indices, or `kNoTensor` for a null pointer.
+  struct PackIdentifier {
+    uint64_t seed;
+    int64_t kernel;
+    int64_t bias;
+
+    bool operator==(const PackIdentifier& other) const {
+      return seed == other.seed && kernel == other.kernel &&
+             bias == other.bias;
+    }
+  };
+  struct PackIdentifierHash {
+    size_t operator()(const PackIdentifier& id) const;
+  };
+  // A look up key with pointers that are not mapped to tensors.
+  struct TransientKey {
+    uint64_t seed;
+    const void* kernel;
+    const void* bias;
+
+    bool operator==(const TransientKey& other) const {
+      return seed == other.seed && kernel == other.kernel &&
+             bias == other.bias;
+    }
+  };
+  struct TransientKeyHash {
+    size_t operator()(const TransientKey& key) const;
+  };
+  struct BufferLocation {
+    size_t offset;
+    size_t size;
+  };
+
+  static constexpr int64_t kNoTensor = -1;
+
+  // Converts `key` to a persistent identifier. Returns false if its kernel or
+  // bias is not mapped to a tensor.
+  bool GetPackIdentifier(const xnn_weights_cache_look_up_key& key,
+                         PackIdentifier* id) const;
+
+  size_t LookUp(const xnn_weights_cache_look_up_key& key);
+  void* ReserveSpace(size_t size);
+  size_t LookUpOrInsert(const xnn_weights_cache_look_up_key& key, void* ptr,
+                        size_t size);
+  void* OffsetToAddr(size_t offset) const;
+
+  const std::string hardware_identity_;
+
+  // Offsets below `file_size_` point into the mapped file, others into
+  // `buffer_`, after subtracting `file_size_`.
+  std::unique_ptr<MMAPAllocation> file_;
+  size_t file_size_ = 0;
+  // Packed weights that were not found in the file. The data starts at the
+  // first aligned address of the vector.
+  std::vector<char> buffer_;
+  size_t buffer_size_ = 0;
+
+  std::unordered_map<const void*, int64_t> tensor_indices_;
+  std::unordered_map<PackIdentifier, BufferLocation, PackIdentifierHash>
+      persistent_offsets_;
+  std::unordered_map<TransientKey, size_t, TransientKeyHash>
+      transient_offsets_;
+  size_t num_loaded_hits_ = 0;
+  bool has_new_persistent_entries_ = false;
+  bool finalized_ = false;
+
+  xnn_weights_cache_provider cache_provider_;
+};
+
+}  // namespace xnnpack
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_DELEGATES_XNNPACK_WEIGHT_CACHE_H_
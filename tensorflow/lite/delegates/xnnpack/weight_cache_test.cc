@@ -0,0 +1,175 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/xnnpack/weight_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "xnnpack.h"  // from @XNNPACK
+
+namespace tflite {
+namespace xnnpack {
+namespace {
+
+// Packs `data` in `cache` under `key`, as XNNPACK does.
+size_t Pack(xnn_weights_cache_t cache, const xnn_weights_cache_look_up_key& key,
+            const std::vector<char>& data) {
+  void* ptr = cache->reserve_space(cache->context, data.size());
+  std::memcpy(ptr, data.data(), data.size());
+  return cache->look_up_or_insert(cache->context, &key, ptr, data.size());
+}
+
+std::vector<char> Read(xnn_weights_cache_t cache, size_t offset,
+                       size_t size) {
+  const char* ptr =
+      static_cast<const char*>(cache->offset_to_addr(cache->context, offset));
+  return std::vector<char>(ptr, ptr + size);
+}
+
+void WriteFile(const std::string& path, const std::vector<char>& data) {
+  std::ofstream file(path, std::ios::binary);
+  file.write(data.data(), data.size());
+}
+
+TEST(MMapWeightCacheProviderTest, PackedWeightsAreReloaded) {
+  const std::string path = testing::TempDir() + "/reloaded.xnnpack_cache";
+  std::remove(path.c_str());
+  const std::vector<char> packed_kernel(100, 'k');
+  const std::vector<char> packed_conv(200, 'c');
+
+  {
+    const float kernel[4] = {1, 2, 3, 4};
+    const float bias[2] = {5, 6};
+    MMapWeightCacheProvider cache;
+    EXPECT_FALSE(cache.Load(path));
+    cache.MapTensor(kernel, 3);
+    cache.MapTensor(bias, 4);
+    xnn_weights_cache_t provider = cache.GetCacheProvider();
+
+    const xnn_weights_cache_look_up_key kernel_key = {1, kernel, nullptr};
+    const xnn_weights_cache_look_up_key conv_key = {2, kernel, bias};
+    EXPECT_EQ(MMapWeightCacheProvider::kNotFound,
+              provider->look_up(provider->context, &kernel_key));
+    const size_t kernel_offset = Pack(provider, kernel_key, packed_kernel);
+    const size_t conv_offset = Pack(provider, conv_key, packed_conv);
+    EXPECT_EQ(kernel_offset,
+              provider->look_up(provider->context, &kernel_key));
+    EXPECT_EQ(conv_offset, provider->look_up(provider->context, &conv_key));
+    EXPECT_EQ(packed_kernel, Read(provider, kernel_offset, 100));
+    EXPECT_EQ(packed_conv, Read(provider, conv_offset, 200));
+
+    ASSERT_TRUE(cache.ShouldSave());
+    WriteFile(path, cache.Serialize());
+  }
+
+  // The tensors have other addresses in the next process.
+  const float kernel[4] = {1, 2, 3, 4};
+  const float bias[2] = {5, 6};
+  MMapWeightCacheProvider cache;
+  ASSERT_TRUE(cache.Load(path));
+  cache.MapTensor(kernel, 3);
+  cache.MapTensor(bias, 4);
+  xnn_weights_cache_t provider = cache.GetCacheProvider();
+
+  const xnn_weights_cache_look_up_key conv_key = {2, kernel, bias};
+  const size_t conv_offset = provider->look_up(provider->context, &conv_key);
+  ASSERT_NE(MMapWeightCacheProvider::kNotFound, conv_offset);
+  EXPECT_EQ(packed_conv, Read(provider, conv_offset, 200));
+  EXPECT_EQ(1, cache.num_loaded_hits());
+
+  // New weights are still cached in memory.
+  const xnn_weights_cache_look_up_key bias_key = {3, nullptr, bias};
+  const size_t bias_offset = Pack(provider, bias_key, packed_kernel);
+  EXPECT_EQ(packed_kernel, Read(provider, bias_offset, 100));
+  EXPECT_EQ(packed_conv, Read(provider, conv_offset, 200));
+  EXPECT_FALSE(cache.ShouldSave());
+
+  EXPECT_FALSE(provider->is_finalized(provider->context));
+  cache.Finalize();
+  EXPECT_TRUE(provider->is_finalized(provider->context));
+}
+
+TEST(MMapWeightCacheProviderTest, UnmappedWeightsAreNotSaved) {
+  const float kernel[4] = {1, 2, 3, 4};
+  MMapWeightCacheProvider cache;
+  xnn_weights_cache_t provider = cache.GetCacheProvider();
+
+  const xnn_weights_cache_look_up_key key = {1, kernel, nullptr};
+  const std::vector<char> packed(10, 'p');
+  const size_t offset = Pack(provider, key, packed);
+  EXPECT_EQ(offset, provider->look_up(provider->context, &key));
+  EXPECT_EQ(packed, Read(provider, offset, 10));
+  EXPECT_FALSE(cache.ShouldSave());
+}
+
+TEST(MMapWeightCacheProviderTest, InvalidFilesAreIgnored) {
+  const std::string path = testing::TempDir() + "/invalid.xnnpack_cache";
+  const float kernel[4] = {1, 2, 3, 4};
+  std::vector<char> file;
+  {
+    MMapWeightCacheProvider cache;
+    cache.MapTensor(kernel, 0);
+    xnn_weights_cache_t provider = cache.GetCacheProvider();
+    const xnn_weights_cache_look_up_key key = {1, kernel, nullptr};
+    Pack(provider, key, std::vector<char>(10, 'p'));
+    file = cache.Serialize();
+  }
+
+  WriteFile(path, std::vector<char>(file.begin(), file.begin() + 8));
+  EXPECT_FALSE(MMapWeightCacheProvider().Load(path));
+
+  // Packed with another XNNPACK revision.
+  std::vector<char> other_revision = file;
+  other_revision[16] ^= 1;
+  WriteFile(path, other_revision);
+  EXPECT_FALSE(MMapWeightCacheProvider().Load(path));
+
+  // Truncated packed weights.
+  WriteFile(path, std::vector<char>(file.begin(), file.end() - 64));
+  EXPECT_FALSE(MMapWeightCacheProvider().Load(path));
+
+  WriteFile(path, file);
+  EXPECT_TRUE(MMapWeightCacheProvider().Load(path));
+}
+
+TEST(MMapWeightCacheProviderTest, OtherHardwareIsRejected) {
+  const std::string path = testing::TempDir() + "/hardware.xnnpack_cache";
+  const float kernel[4] = {1, 2, 3, 4};
+  {
+    MMapWeightCacheProvider cache("x86:1f:a");
+    cache.MapTensor(kernel, 0);
+    xnn_weights_cache_t provider = cache.GetCacheProvider();
+    const xnn_weights_cache_look_up_key key = {1, kernel, nullptr};
+    Pack(provider, key, std::vector<char>(10, 'p'));
+    WriteFile(path, cache.Serialize());
+  }
+
+  EXPECT_FALSE(MMapWeightCacheProvider("x86:3f:a").Load(path));
+  EXPECT_FALSE(MMapWeightCacheProvider("x86:1f:a:b").Load(path));
+  EXPECT_TRUE(MMapWeightCacheProvider("x86:1f:a").Load(path));
+}
+
+TEST(MMapWeightCacheProviderTest, HardwareIdentityIsStable) {
+  EXPECT_FALSE(GetWeightCacheHardwareIdentity().empty());
+  EXPECT_EQ(GetWeightCacheHardwareIdentity(), GetWeightCacheHardwareIdentity());
+}
+
+}  // namespace
+}  // namespace xnnpack
+}  // namespace tflite
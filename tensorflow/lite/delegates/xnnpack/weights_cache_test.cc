@@ -13,7 +13,11 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <dirent.h>
+#include <sys/stat.h>
+
 #include <memory>  // For std::unique_ptr.
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
@@ -244,5 +248,55 @@ INSTANTIATE_TEST_SUITE_P(WeightsCacheTest, WeightsCacheTest,
                          testing::Values(2, 4),
                          testing::PrintToStringParamName());
 
+int CountFiles(const std::string& dir) {
+  int count = 0;
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) return -1;
+  while (dirent* entry = readdir(d)) {
+    if (entry->d_name[0] != '.') ++count;
+  }
+  closedir(d);
+  return count;
+}
+
+TEST(XNNPACK_WEIGHTS_CACHE, FileBacked) {
+  std::vector<char> buffer = Conv2DTester().CreateTfLiteModel();
+  const Model* model = GetModel(buffer.data());
+  DummyOpResolver resolver;
+
+  const std::string cache_dir =
+      testing::TempDir() + "/xnnpack_weight_cache_file_backed";
+  ASSERT_EQ(0, mkdir(cache_dir.c_str(), 0700));
+
+  TfLiteXNNPackDelegateOptions delegate_options =
+      TfLiteXNNPackDelegateOptionsDefault();
+  delegate_options.weight_cache_dir = cache_dir.c_str();
+  delegate_options.model_token = "conv_2d";
+
+  // The first interpreter packs the weights and saves them.
+  std::unique_ptr<Interpreter> interpreter1;
+  ASSERT_EQ(kTfLiteOk, InterpreterBuilder(model, resolver)(&interpreter1));
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      delegate1(TfLiteXNNPackDelegateCreate(&delegate_options),
+                TfLiteXNNPackDelegateDelete);
+  ASSERT_EQ(kTfLiteOk, interpreter1->ModifyGraphWithDelegate(delegate1.get()));
+  ASSERT_EQ(kTfLiteOk, interpreter1->AllocateTensors());
+  ASSERT_EQ(kTfLiteOk, interpreter1->Invoke());
+  ASSERT_EQ(1, CountFiles(cache_dir));
+
+  // The second one maps them, and outlives the first one.
+  std::unique_ptr<Interpreter> interpreter2;
+  ASSERT_EQ(kTfLiteOk, InterpreterBuilder(model, resolver)(&interpreter2));
+  std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>
+      delegate2(TfLiteXNNPackDelegateCreate(&delegate_options),
+                TfLiteXNNPackDelegateDelete);
+  ASSERT_EQ(kTfLiteOk, interpreter2->ModifyGraphWithDelegate(delegate2.get()));
+  interpreter1.reset();
+  delegate1.reset();
+  ASSERT_EQ(kTfLiteOk, interpreter2->AllocateTensors());
+  ASSERT_EQ(kTfLiteOk, interpreter2->Invoke());
+  EXPECT_EQ(1, CountFiles(cache_dir));
+}
+
 }  // namespace xnnpack
 }  // namespace tflite
@@ -24,6 +24,7 @@ limitations under the License.
 #include <limits>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,7 +37,9 @@ limitations under the License.
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/builtin_op_data.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/delegates/serialization.h"
 #include "tensorflow/lite/delegates/xnnpack/quantization_util.h"
+#include "tensorflow/lite/delegates/xnnpack/weight_cache.h"
 #include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
@@ -500,6 +503,30 @@ class Delegate {
     options_ =
         options != nullptr ? *options : TfLiteXNNPackDelegateOptionsDefault();
     workspace_.reset(workspace);
+
+    // The options may point to temporary strings: keep copies.
+    if (options_.weights_cache == nullptr &&
+        options_.weight_cache_dir != nullptr &&
+        options_.model_token != nullptr) {
+      weight_cache_dir_ = options_.weight_cache_dir;
+      model_token_ = options_.model_token;
+      delegates::SerializationParams params;
+      params.model_token = model_token_.c_str();
+      params.cache_dir = weight_cache_dir_.c_str();
+      weight_cache_serialization_ =
+          std::make_unique<delegates::Serialization>(params);
+      // Packed weights depend on the XNNPACK revision, on the microkernels
+      // selected for this CPU and on the flags.
+      weight_cache_key_ = std::string("xnnpack_weight_cache_") +
+                          kWeightCacheXNNPackRevision + "_" +
+                          GetWeightCacheHardwareIdentity() + "_" +
+                          std::to_string(options_.flags);
+      options_.weight_cache_dir = weight_cache_dir_.c_str();
+      options_.model_token = model_token_.c_str();
+    } else {
+      options_.weight_cache_dir = nullptr;
+      options_.model_token = nullptr;
+    }
   }
 
   TfLiteIntArray* PrepareOpsToDelegate(TfLiteContext* context);
@@ -582,6 +609,23 @@ class Delegate {
 
   xnn_workspace_t workspace() const { return workspace_.get(); }
 
+  // Creates a file-backed weights cache for the partition described by
+  // `params`, loading its packed weights if they were cached before. Returns
+  // nullptr if packed weights are not cached in files. `entry` is set to the
+  // entry the packed weights should be saved to.
+  std::unique_ptr<MMapWeightCacheProvider> CreateWeightCache(
+      TfLiteContext* context, const TfLiteDelegateParams* params,
+      std::optional<delegates::SerializationEntry>& entry) const {
+    if (weight_cache_serialization_ == nullptr) {
+      return nullptr;
+    }
+    entry.emplace(weight_cache_serialization_->GetEntryForKernel(
+        weight_cache_key_, context, params));
+    auto weight_cache = std::make_unique<MMapWeightCacheProvider>();
+    weight_cache->Load(entry->GetDataFilePath());
+    return weight_cache;
+  }
+
   TfLiteStatus AssociateVariableWithTensor(int local_id,
                                            const TfLiteTensor* tensor,
                                            TfLiteContext* logging_context) {
@@ -663,6 +707,12 @@ class Delegate {
 
   TfLiteXNNPackDelegateOptions options_;
   VariableHolder variable_holder_;
+
+  // Set if packed weights are cached in files.
+  std::unique_ptr<delegates::Serialization> weight_cache_serialization_;
+  std::string weight_cache_key_;
+  std::string weight_cache_dir_;
+  std::string model_token_;
 };
 
 class Subgraph {
@@ -880,6 +930,10 @@ class Subgraph {
       return nullptr;
     }
 
+    std::optional<delegates::SerializationEntry> weight_cache_entry;
+    std::unique_ptr<MMapWeightCacheProvider> weight_cache =
+        delegate.CreateWeightCache(context, params, weight_cache_entry);
+
     std::unordered_map<int, uint32_t> tflite_tensor_to_xnnpack;
     for (int t : tensors) {
       if (context->tensors[t].type == kTfLiteResource) {
@@ -930,6 +984,9 @@ class Subgraph {
           data = delegate.static_unpacked_data_.data() + it->second;
         }
       }
+      if (weight_cache != nullptr) {
+        weight_cache->MapTensor(data, t);
+      }
       if (inputs.count(t) != 0) {
         flags |= XNN_VALUE_FLAG_EXTERNAL_INPUT;
         if (data == nullptr) {
@@ -1053,7 +1110,11 @@ class Subgraph {
     if (context->profiler) {
       flags |= XNN_FLAG_BASIC_PROFILING;
     }
-    status = xnn_create_runtime_v4(subgraph.get(), delegate.weights_cache(),
+    xnn_weights_cache_t weights_cache = delegate.weights_cache();
+    if (weight_cache != nullptr) {
+      weights_cache = weight_cache->GetCacheProvider();
+    }
+    status = xnn_create_runtime_v4(subgraph.get(), weights_cache,
                                    delegate.workspace(), delegate.threadpool(),
                                    flags, &runtime_ptr);
     if (status != xnn_status_success) {
@@ -1061,8 +1122,22 @@ class Subgraph {
       return nullptr;
     }
 
+    if (weight_cache != nullptr) {
+      weight_cache->Finalize();
+      if (weight_cache->ShouldSave()) {
+        // Failing to save the cache only makes later interpreters slower.
+        const std::vector<char> data = weight_cache->Serialize();
+        weight_cache_entry->SetData(context, data.data(), data.size());
+      } else if (weight_cache->num_loaded_hits() > 0) {
+        TFLITE_LOG(tflite::TFLITE_LOG_INFO,
+                   "Loaded %zu packed weights from XNNPACK weight cache %s.",
+                   weight_cache->num_loaded_hits(),
+                   weight_cache_entry->GetDataFilePath().c_str());
+      }
+    }
+
     return new Subgraph(delegate, runtime_ptr, externals,
-                        tflite_tensor_to_xnnpack);
+                        tflite_tensor_to_xnnpack, std::move(weight_cache));
   }
 
   TfLiteStatus Prepare(TfLiteContext* context) { return kTfLiteOk; }
@@ -6359,8 +6434,10 @@ class Subgraph {
  private:
   Subgraph(const Delegate& delegate, xnn_runtime_t runtime,
            const std::unordered_set<int>& externals,
-           std::unordered_map<int, uint32_t>& tflite_tensor_to_xnnpack)
-      : runtime_(runtime, &xnn_delete_runtime) {
+           std::unordered_map<int, uint32_t>& tflite_tensor_to_xnnpack,
+           std::unique_ptr<MMapWeightCacheProvider> weight_cache)
+      : weight_cache_(std::move(weight_cache)),
+        runtime_(runtime, &xnn_delete_runtime) {
     for (int t : externals) {
       externals_[t] = nullptr;
     }
@@ -6368,6 +6445,9 @@ class Subgraph {
     has_variables_ = !delegate.GetAllVariableTensors().empty();
   }
 
+  // File-backed cache of the packed weights used by the runtime, if enabled.
+  // Declared before the runtime so that it is destroyed after it.
+  std::unique_ptr<MMapWeightCacheProvider> weight_cache_;
   // XNNPACK Runtime (subgraph + workspace) with smart-pointer for lifetime
   // management.
   std::unique_ptr<xnn_runtime, decltype(&xnn_delete_runtime)> runtime_{
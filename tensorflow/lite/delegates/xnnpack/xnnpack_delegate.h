@@ -66,6 +66,16 @@ typedef struct {
   bool handle_variable_ops;
   // Enable adaptive optimization for AVX CPUs.
   bool experimental_adaptive_avx_optimization;
+  // Directory in which packed weights are cached across interpreters and
+  // processes. The first interpreter created for a model writes one file per
+  // delegated partition, later ones memory-map the files instead of packing
+  // the weights again. The directory should be private to the application and
+  // to the device. Ignored if `weights_cache` is set or `model_token` is not.
+  const char* weight_cache_dir;
+  // Token unique to the model, e.g. a fingerprint of the model file (see
+  // StrFingerprint() in tensorflow/lite/delegates/serialization.h). Two models
+  // must not share a token in the same `weight_cache_dir`.
+  const char* model_token;
 } TfLiteXNNPackDelegateOptions;
 
 // Returns a structure with the default XNNPack delegate options.
@@ -0,0 +1,307 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/shape_buckets/shape_bucket_interpreter.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/interpreter_builder.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/interpreter_options.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/profiling/time.h"
+#include "tensorflow/lite/util.h"
+
+namespace tflite {
+namespace shape_buckets {
+namespace {
+
+// Sets the first `size` positions of `padded_dim` of `mask` to 1 and the
+// others to 0.
+template <typename T>
+void FillMask(TfLiteTensor* mask, int padded_dim, int size) {
+  int outer = 1;
+  for (int i = 0; i < padded_dim; ++i) outer *= mask->dims->data[i];
+  int inner = 1;
+  for (int i = padded_dim + 1; i < mask->dims->size; ++i) {
+    inner *= mask->dims->data[i];
+  }
+  const int bucket_size = mask->dims->data[padded_dim];
+  T* data = reinterpret_cast<T*>(mask->data.raw);
+  for (int o = 0; o < outer; ++o) {
+    T* row = data + o * bucket_size * inner;
+    std::fill(row, row + size * inner, T(1));
+    std::fill(row + size * inner, row + bucket_size * inner, T(0));
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<ShapeBucketInterpreter> ShapeBucketInterpreter::Create(
+    const FlatBufferModel& model, const OpResolver& op_resolver,
+    const ShapeBucketOptions& options,
+    const InterpreterOptions* interpreter_options) {
+  const std::vector<int>& bucket_sizes = options.bucket_sizes;
+  const bool valid_sizes =
+      bucket_sizes.empty()
+          ? options.max_size > 0
+          : bucket_sizes.front() > 0 &&
+                std::is_sorted(bucket_sizes.begin(), bucket_sizes.end());
+  if (!valid_sizes) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR,
+                    "Bucket sizes must be positive and sorted.");
+    return nullptr;
+  }
+  std::unique_ptr<ShapeBucketInterpreter> bucket_interpreter(
+      new ShapeBucketInterpreter(model, op_resolver, options,
+                                 interpreter_options));
+  std::unique_ptr<Interpreter> interpreter =
+      bucket_interpreter->BuildInterpreter();
+  if (interpreter == nullptr) {
+    return nullptr;
+  }
+  const std::vector<int>& inputs = interpreter->inputs();
+  if (options.padded_dims.size() != inputs.size()) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR,
+                    "Expected a padded dimension for each of the %d inputs.",
+                    static_cast<int>(inputs.size()));
+    return nullptr;
+  }
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const TfLiteTensor* input = interpreter->tensor(inputs[i]);
+    if (options.padded_dims[i] < -1 ||
+        options.padded_dims[i] >= input->dims->size ||
+        input->type == kTfLiteString) {
+      TFLITE_LOG_PROD(TFLITE_LOG_ERROR, "Input %d can't be padded.",
+                      static_cast<int>(i));
+      return nullptr;
+    }
+  }
+  if (options.mask_input != -1) {
+    if (options.mask_input < 0 ||
+        options.mask_input >= static_cast<int>(inputs.size()) ||
+        options.padded_dims[options.mask_input] == -1) {
+      TFLITE_LOG_PROD(TFLITE_LOG_ERROR,
+                      "The mask input must be an input with a padded "
+                      "dimension.");
+      return nullptr;
+    }
+    switch (interpreter->tensor(inputs[options.mask_input])->type) {
+      case kTfLiteFloat32:
+      case kTfLiteInt32:
+      case kTfLiteInt64:
+      case kTfLiteInt8:
+      case kTfLiteUInt8:
+      case kTfLiteBool:
+        break;
+      default:
+        TFLITE_LOG_PROD(TFLITE_LOG_ERROR, "Unsupported mask type.");
+        return nullptr;
+    }
+  }
+  bucket_interpreter->unprepared_ = std::move(interpreter);
+  return bucket_interpreter;
+}
+
+ShapeBucketInterpreter::ShapeBucketInterpreter(
+    const FlatBufferModel& model, const OpResolver& op_resolver,
+    const ShapeBucketOptions& options,
+    const InterpreterOptions* interpreter_options)
+    : model_(model), op_resolver_(op_resolver), options_(options) {
+  if (interpreter_options != nullptr) {
+    interpreter_options_ =
+        std::make_unique<InterpreterOptions>(*interpreter_options);
+  }
+}
+
+std::unique_ptr<Interpreter> ShapeBucketInterpreter::BuildInterpreter() const {
+  std::unique_ptr<Interpreter> interpreter;
+  if (InterpreterBuilder(model_, op_resolver_, interpreter_options_.get())(
+          &interpreter) != kTfLiteOk) {
+    return nullptr;
+  }
+  if (interpreter != nullptr && profiler_ != nullptr) {
+    interpreter->SetProfiler(profiler_);
+  }
+  return interpreter;
+}
+
+int ShapeBucketInterpreter::GetBucketSize(int size) const {
+  if (options_.bucket_sizes.empty()) {
+    if (size > options_.max_size) return -1;
+    int64_t bucket_size = 1;
+    while (bucket_size < size) bucket_size *= 2;
+    return std::min<int64_t>(bucket_size, options_.max_size);
+  }
+  const auto it = std::lower_bound(options_.bucket_sizes.begin(),
+                                   options_.bucket_sizes.end(), size);
+  return it == options_.bucket_sizes.end() ? -1 : *it;
+}
+
+TfLiteStatus ShapeBucketInterpreter::PrepareBucket(int bucket_size,
+                                                   Interpreter* interpreter) {
+  ScopedProfile scoped_profile(profiler_, "ShapeBucketPrepare",
+                               Profiler::EventType::DEFAULT, bucket_size);
+  const std::vector<int>& inputs = interpreter->inputs();
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    const int padded_dim = options_.padded_dims[i];
+    if (padded_dim == -1) continue;
+    const TfLiteIntArray* dims = interpreter->tensor(inputs[i])->dims;
+    std::vector<int> shape(dims->data, dims->data + dims->size);
+    shape[padded_dim] = bucket_size;
+    TF_LITE_ENSURE_STATUS(interpreter->ResizeInputTensor(inputs[i], shape));
+  }
+  return interpreter->AllocateTensors();
+}
+
+TfLiteStatus ShapeBucketInterpreter::SetSize(int size) {
+  invoke_start_us_ = profiling::time::NowMicros();
+  prepared_ = false;
+  const int bucket_size = size > 0 ? GetBucketSize(size) : -1;
+  if (bucket_size < 0) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR, "Size %d does not fit in any bucket.",
+                    size);
+    return kTfLiteError;
+  }
+  std::unique_ptr<Interpreter>& interpreter = buckets_[bucket_size];
+  if (interpreter == nullptr) {
+    std::unique_ptr<Interpreter> new_interpreter =
+        unprepared_ != nullptr ? std::move(unprepared_) : BuildInterpreter();
+    if (new_interpreter == nullptr ||
+        PrepareBucket(bucket_size, new_interpreter.get()) != kTfLiteOk) {
+      buckets_.erase(bucket_size);
+      current_ = nullptr;
+      return kTfLiteError;
+    }
+    interpreter = std::move(new_interpreter);
+    prepared_ = true;
+  }
+  current_ = interpreter.get();
+  size_ = size;
+  bucket_size_ = bucket_size;
+  return SetMask();
+}
+
+TfLiteStatus ShapeBucketInterpreter::SetMask() {
+  if (options_.mask_input == -1) return kTfLiteOk;
+  TfLiteTensor* mask = current_->input_tensor(options_.mask_input);
+  const int padded_dim = options_.padded_dims[options_.mask_input];
+  switch (mask->type) {
+    case kTfLiteFloat32:
+      FillMask<float>(mask, padded_dim, size_);
+      break;
+    case kTfLiteInt32:
+      FillMask<int32_t>(mask, padded_dim, size_);
+      break;
+    case kTfLiteInt64:
+      FillMask<int64_t>(mask, padded_dim, size_);
+      break;
+    case kTfLiteInt8:
+      FillMask<int8_t>(mask, padded_dim, size_);
+      break;
+    case kTfLiteUInt8:
+      FillMask<uint8_t>(mask, padded_dim, size_);
+      break;
+    case kTfLiteBool:
+      FillMask<bool>(mask, padded_dim, size_);
+      break;
+    default:
+      return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus ShapeBucketInterpreter::SetInput(int input_index,
+                                              const void* data, size_t bytes) {
+  if (current_ == nullptr || input_index < 0 ||
+      input_index >= static_cast<int>(current_->inputs().size())) {
+    return kTfLiteError;
+  }
+  TfLiteTensor* input = current_->input_tensor(input_index);
+  size_t element_size;
+  TF_LITE_ENSURE_STATUS(GetSizeOfType(nullptr, input->type, &element_size));
+  const int padded_dim = options_.padded_dims[input_index];
+  if (padded_dim == -1) {
+    if (bytes != input->bytes) return kTfLiteError;
+    std::memcpy(input->data.raw, data, bytes);
+    return kTfLiteOk;
+  }
+
+  size_t outer = 1;
+  for (int i = 0; i < padded_dim; ++i) outer *= input->dims->data[i];
+  size_t inner_bytes = element_size;
+  for (int i = padded_dim + 1; i < input->dims->size; ++i) {
+    inner_bytes *= input->dims->data[i];
+  }
+  const size_t row_bytes = size_ * inner_bytes;
+  const size_t padded_row_bytes = bucket_size_ * inner_bytes;
+  if (bytes != outer * row_bytes) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR,
+                    "Expected %d bytes for input %d of size %d, got %d.",
+                    static_cast<int>(outer * row_bytes), input_index, size_,
+                    static_cast<int>(bytes));
+    return kTfLiteError;
+  }
+  const char* src = static_cast<const char*>(data);
+  char* dst = input->data.raw;
+  for (size_t o = 0; o < outer; ++o) {
+    std::memcpy(dst, src, row_bytes);
+    std::memset(dst + row_bytes, 0, padded_row_bytes - row_bytes);
+    src += row_bytes;
+    dst += padded_row_bytes;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus ShapeBucketInterpreter::Invoke() {
+  if (current_ == nullptr) return kTfLiteError;
+  // Invocations after the first one for a size only measure `Invoke`.
+  const uint64_t start_us = invoke_start_us_ != 0
+                                ? invoke_start_us_
+                                : profiling::time::NowMicros();
+  TfLiteStatus status;
+  {
+    ScopedProfile scoped_profile(profiler_, "ShapeBucketInvoke",
+                                 Profiler::EventType::DEFAULT, bucket_size_);
+    status = current_->Invoke();
+  }
+  stats_.RecordInvoke(bucket_size_, size_, prepared_,
+                      profiling::time::NowMicros() - start_us);
+  invoke_start_us_ = 0;
+  prepared_ = false;
+  return status;
+}
+
+void ShapeBucketInterpreter::SetProfiler(Profiler* profiler) {
+  profiler_ = profiler;
+  for (auto& [bucket_size, interpreter] : buckets_) {
+    interpreter->SetProfiler(profiler);
+  }
+  if (unprepared_ != nullptr) {
+    unprepared_->SetProfiler(profiler);
+  }
+}
+
+}  // namespace shape_buckets
+}  // namespace tflite
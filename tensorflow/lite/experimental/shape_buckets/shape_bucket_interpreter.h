@@ -0,0 +1,146 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_EXPERIMENTAL_SHAPE_BUCKETS_SHAPE_BUCKET_INTERPRETER_H_
+#define TENSORFLOW_LITE_EXPERIMENTAL_SHAPE_BUCKETS_SHAPE_BUCKET_INTERPRETER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/interpreter_options.h"
+#include "tensorflow/lite/profiling/shape_bucket_stats.h"
+
+namespace tflite {
+namespace shape_buckets {
+
+struct ShapeBucketOptions {
+  // Sizes the padded dimension is rounded up to, in increasing order. If
+  // empty, sizes are rounded up to the next power of two, up to `max_size`.
+  std::vector<int> bucket_sizes;
+  int max_size = 0;
+
+  // For each input of the primary subgraph, the dimension that is padded to
+  // the bucket size, or -1 for inputs whose shape does not change.
+  std::vector<int> padded_dims;
+
+  // Index of an input, with a padded dimension, that is set to 1 at the
+  // positions of the padded dimension holding data and to 0 at the padding
+  // positions. -1 if the model has no such mask input. The mask is set by
+  // `SetSize`, not by the caller.
+  int mask_input = -1;
+};
+
+// Runs a model whose inputs have a dimension of varying size (e.g. the
+// sequence length of NLP models) without preparing the model again each time
+// the size changes.
+//
+// Sizes are rounded up to a few bucket sizes, and the inputs are padded to the
+// bucket size with zeros. Each bucket has its own interpreter, prepared the
+// first time the bucket is used, so that switching between buckets does not
+// prepare any op or plan any memory. The interpreters share the model, but
+// each one has its own arenas.
+//
+// The outputs are those of the bucket: the model must make sure that padding
+// does not change the results, e.g. by using the mask input, and the caller
+// must ignore the padding positions of the outputs.
+//
+// Not thread-safe.
+//
+// WARNING: This is an experimental API and subject to change.
+class ShapeBucketInterpreter {
+ public:
+  // Returns nullptr if the options are not valid for `model`. `model` and
+  // `op_resolver` must outlive the returned object.
+  static std::unique_ptr<ShapeBucketInterpreter> Create(
+      const FlatBufferModel& model, const OpResolver& op_resolver,
+      const ShapeBucketOptions& options,
+      const InterpreterOptions* interpreter_options = nullptr);
+
+  // Sets the size of the padded dimension of the inputs of the next
+  // invocations, and selects the smallest bucket that fits it. Prepares the
+  // bucket the first time it is used.
+  TfLiteStatus SetSize(int size);
+
+  // Copies the data of input `input_index` to the input tensor of the bucket,
+  // padding it with zeros. The padded dimension of `data` has `size()`
+  // elements, the other dimensions are those of the model input.
+  TfLiteStatus SetInput(int input_index, const void* data, size_t bytes);
+
+  TfLiteStatus Invoke();
+
+  // Returns the interpreter of the current bucket, e.g. to read its outputs.
+  // Its inputs must not be resized.
+  Interpreter* interpreter() { return current_; }
+
+  int size() const { return size_; }
+  int bucket_size() const { return bucket_size_; }
+
+  // Sets the profiler of the interpreters. Invocations are also reported to
+  // `profiler` as "ShapeBucketInvoke" events, and preparations of buckets as
+  // "ShapeBucketPrepare" events, with the bucket size as event metadata.
+  void SetProfiler(Profiler* profiler);
+
+  const profiling::ShapeBucketStats& stats() const { return stats_; }
+  profiling::ShapeBucketStats* mutable_stats() { return &stats_; }
+
+ private:
+  ShapeBucketInterpreter(const FlatBufferModel& model,
+                         const OpResolver& op_resolver,
+                         const ShapeBucketOptions& options,
+                         const InterpreterOptions* interpreter_options);
+
+  std::unique_ptr<Interpreter> BuildInterpreter() const;
+
+  // Returns the bucket size for `size`, or -1 if it is too large.
+  int GetBucketSize(int size) const;
+
+  // Resizes the padded inputs of `interpreter` to `bucket_size` and allocates
+  // its tensors.
+  TfLiteStatus PrepareBucket(int bucket_size, Interpreter* interpreter);
+
+  TfLiteStatus SetMask();
+
+  const FlatBufferModel& model_;
+  const OpResolver& op_resolver_;
+  const ShapeBucketOptions options_;
+  std::unique_ptr<InterpreterOptions> interpreter_options_;
+
+  std::map<int, std::unique_ptr<Interpreter>> buckets_;
+  // Interpreter built by `Create` to validate the options, used for the first
+  // bucket.
+  std::unique_ptr<Interpreter> unprepared_;
+  Interpreter* current_ = nullptr;
+  int size_ = 0;
+  int bucket_size_ = 0;
+
+  Profiler* profiler_ = nullptr;
+  profiling::ShapeBucketStats stats_;
+  // Start of the next invocation, when `SetSize` was called, and whether
+  // `SetSize` prepared the bucket.
+  uint64_t invoke_start_us_ = 0;
+  bool prepared_ = false;
+};
+
+}  // namespace shape_buckets
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_EXPERIMENTAL_SHAPE_BUCKETS_SHAPE_BUCKET_INTERPRETER_H_
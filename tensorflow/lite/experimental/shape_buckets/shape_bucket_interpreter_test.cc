@@ -0,0 +1,168 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/experimental/shape_buckets/shape_bucket_interpreter.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/kernels/register.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/profiling/buffered_profiler.h"
+
+namespace tflite {
+namespace shape_buckets {
+namespace {
+
+// The model computes `output = input * 3`, with an input of shape [1, 8, 8, 3].
+constexpr char kModelPath[] = "tensorflow/lite/testdata/add.bin";
+constexpr int kRowSize = 8 * 3;
+
+class ShapeBucketInterpreterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    model_ = FlatBufferModel::BuildFromFile(kModelPath);
+    ASSERT_NE(model_, nullptr);
+  }
+
+  std::unique_ptr<ShapeBucketInterpreter> Create(
+      const ShapeBucketOptions& options) {
+    return ShapeBucketInterpreter::Create(*model_, resolver_, options);
+  }
+
+  // Runs the model for `size` rows whose values are their row index plus 1,
+  // and checks the padded output.
+  void RunAndCheck(ShapeBucketInterpreter* interpreter, int size,
+                   int expected_bucket_size) {
+    ASSERT_EQ(interpreter->SetSize(size), kTfLiteOk);
+    EXPECT_EQ(interpreter->bucket_size(), expected_bucket_size);
+    std::vector<float> input(size * kRowSize);
+    for (int i = 0; i < input.size(); ++i) {
+      input[i] = i / kRowSize + 1;
+    }
+    ASSERT_EQ(interpreter->SetInput(0, input.data(),
+                                    input.size() * sizeof(float)),
+              kTfLiteOk);
+    ASSERT_EQ(interpreter->Invoke(), kTfLiteOk);
+
+    const TfLiteTensor* output = interpreter->interpreter()->output_tensor(0);
+    ASSERT_EQ(output->dims->data[1], expected_bucket_size);
+    for (int i = 0; i < expected_bucket_size * kRowSize; ++i) {
+      const int row = i / kRowSize;
+      EXPECT_EQ(output->data.f[i], row < size ? 3 * (row + 1) : 0) << i;
+    }
+  }
+
+  std::unique_ptr<FlatBufferModel> model_;
+  ops::builtin::BuiltinOpResolver resolver_;
+};
+
+TEST_F(ShapeBucketInterpreterTest, PadsToBucketSizes) {
+  ShapeBucketOptions options;
+  options.bucket_sizes = {4, 8, 16};
+  options.padded_dims = {1};
+  auto interpreter = Create(options);
+  ASSERT_NE(interpreter, nullptr);
+
+  RunAndCheck(interpreter.get(), /*size=*/3, /*expected_bucket_size=*/4);
+  RunAndCheck(interpreter.get(), /*size=*/11, /*expected_bucket_size=*/16);
+  RunAndCheck(interpreter.get(), /*size=*/4, /*expected_bucket_size=*/4);
+  RunAndCheck(interpreter.get(), /*size=*/1, /*expected_bucket_size=*/4);
+  EXPECT_EQ(interpreter->SetSize(17), kTfLiteError);
+
+  // Each bucket was only prepared once.
+  const auto& buckets = interpreter->stats().buckets();
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets.at(4).hits, 3);
+  EXPECT_EQ(buckets.at(4).prepares, 1);
+  EXPECT_EQ(buckets.at(4).total_size, 8);
+  EXPECT_EQ(buckets.at(16).hits, 1);
+  EXPECT_EQ(buckets.at(16).prepares, 1);
+}
+
+TEST_F(ShapeBucketInterpreterTest, PowerOfTwoBuckets) {
+  ShapeBucketOptions options;
+  options.max_size = 12;
+  options.padded_dims = {1};
+  auto interpreter = Create(options);
+  ASSERT_NE(interpreter, nullptr);
+
+  RunAndCheck(interpreter.get(), /*size=*/1, /*expected_bucket_size=*/1);
+  RunAndCheck(interpreter.get(), /*size=*/3, /*expected_bucket_size=*/4);
+  RunAndCheck(interpreter.get(), /*size=*/5, /*expected_bucket_size=*/8);
+  RunAndCheck(interpreter.get(), /*size=*/9, /*expected_bucket_size=*/12);
+  EXPECT_EQ(interpreter->SetSize(13), kTfLiteError);
+}
+
+TEST_F(ShapeBucketInterpreterTest, ReportsProfilingEvents) {
+  ShapeBucketOptions options;
+  options.bucket_sizes = {4};
+  options.padded_dims = {1};
+  auto interpreter = Create(options);
+  ASSERT_NE(interpreter, nullptr);
+  profiling::BufferedProfiler profiler(/*max_num_entries=*/1024);
+  interpreter->SetProfiler(&profiler);
+  profiler.StartProfiling();
+  RunAndCheck(interpreter.get(), /*size=*/2, /*expected_bucket_size=*/4);
+  profiler.StopProfiling();
+
+  int num_invokes = 0;
+  int num_prepares = 0;
+  for (const profiling::ProfileEvent* event : profiler.GetProfileEvents()) {
+    if (event->tag == "ShapeBucketInvoke") {
+      ++num_invokes;
+      EXPECT_EQ(event->event_metadata, 4);
+    } else if (event->tag == "ShapeBucketPrepare") {
+      ++num_prepares;
+    }
+  }
+  EXPECT_EQ(num_invokes, 1);
+  EXPECT_EQ(num_prepares, 1);
+}
+
+TEST_F(ShapeBucketInterpreterTest, RejectsInvalidOptions) {
+  ShapeBucketOptions options;
+  options.padded_dims = {1};
+  // No bucket sizes.
+  EXPECT_EQ(Create(options), nullptr);
+  options.bucket_sizes = {8, 4};
+  EXPECT_EQ(Create(options), nullptr);
+  options.bucket_sizes = {4, 8};
+  options.padded_dims = {4};
+  EXPECT_EQ(Create(options), nullptr);
+  options.padded_dims = {1, 1};
+  EXPECT_EQ(Create(options), nullptr);
+  options.padded_dims = {-1};
+  options.mask_input = 0;
+  EXPECT_EQ(Create(options), nullptr);
+}
+
+TEST_F(ShapeBucketInterpreterTest, RejectsInputOfWrongSize) {
+  ShapeBucketOptions options;
+  options.bucket_sizes = {4};
+  options.padded_dims = {1};
+  auto interpreter = Create(options);
+  ASSERT_NE(interpreter, nullptr);
+  ASSERT_EQ(interpreter->SetSize(2), kTfLiteOk);
+  std::vector<float> input(3 * kRowSize);
+  EXPECT_EQ(
+      interpreter->SetInput(0, input.data(), input.size() * sizeof(float)),
+      kTfLiteError);
+}
+
+}  // namespace
+}  // namespace shape_buckets
+}  // namespace tflite
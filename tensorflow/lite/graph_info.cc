@@ -17,6 +17,7 @@ limitations under the License.
 #include <algorithm>
 #include <vector>
 
+#include "tensorflow/lite/builtin_ops.h"
 #include "tensorflow/lite/context_util.h"
 #include "tensorflow/lite/core/c/common.h"
 
@@ -289,4 +290,57 @@ TfLiteStatus PartitionGraphIntoIndependentNodeSubsets(
   return kTfLiteOk;
 }
 
+void ComputeExecutionWaves(const GraphInfo* info,
+                           std::vector<int>* node_waves) {
+  const int num_execution_nodes = info->num_execution_nodes();
+  node_waves->assign(num_execution_nodes, 0);
+  // Last wave writing and reading each tensor, or -1.
+  std::vector<int> writer_wave(info->num_tensors(), -1);
+  std::vector<int> reader_wave(info->num_tensors(), -1);
+  std::vector<bool> is_variable(info->num_tensors(), false);
+  for (int tensor_index : info->variables()) {
+    is_variable[tensor_index] = true;
+  }
+  int last_barrier_wave = -1;
+  int max_wave = -1;
+  for (int i = 0; i < num_execution_nodes; ++i) {
+    const TfLiteNode& node = info->node(i);
+    const TfLiteRegistration& registration = info->registration(i);
+    int wave = last_barrier_wave + 1;
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      wave = std::max(wave, writer_wave[tensor_index] + 1);
+      if (is_variable[tensor_index]) {
+        wave = std::max(wave, reader_wave[tensor_index] + 1);
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      wave = std::max(wave, writer_wave[tensor_index] + 1);
+      wave = std::max(wave, reader_wave[tensor_index] + 1);
+    }
+    const bool is_barrier = node.might_have_side_effect ||
+                            node.delegate != nullptr ||
+                            registration.builtin_code == kTfLiteBuiltinCustom ||
+                            registration.builtin_code == kTfLiteBuiltinDelegate;
+    if (is_barrier) {
+      wave = max_wave + 1;
+      last_barrier_wave = wave;
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      reader_wave[tensor_index] = std::max(reader_wave[tensor_index], wave);
+      if (is_variable[tensor_index]) {
+        writer_wave[tensor_index] = wave;
+      }
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      writer_wave[tensor_index] = wave;
+    }
+    (*node_waves)[i] = wave;
+    max_wave = std::max(max_wave, wave);
+  }
+}
+
 }  // namespace tflite
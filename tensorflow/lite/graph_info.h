@@ -154,6 +154,29 @@ TfLiteStatus PartitionGraphIntoIndependentNodeSubsets(
     std::vector<NodeSubset>* node_subsets, bool greedily,
     const ControlEdges* control_edges = nullptr);
 
+// Groups the nodes of the execution plan of `info` into waves that can be
+// executed one after the other, the nodes of a wave in any order or
+// concurrently. Sets `(*node_waves)[i]` to the wave of the i-th node of the
+// execution plan, waves being numbered from 0 in execution order.
+//
+// A node is in a later wave than the nodes writing its inputs, and than the
+// nodes reading or writing its outputs or the variable tensors it reads (which
+// it may update in place). Nodes which might have side effects, custom ops and
+// delegate kernels are alone in their wave, after all the nodes before them in
+// the execution plan and before all the nodes after them, since their data
+// dependencies do not capture all their interactions with other nodes.
+// Temporary tensors are ignored: they are not shared between nodes.
+//
+// (Example: in the graph
+//
+// 0 --> 1 --> 3
+// |           ^
+// \--> 2 -----/
+//
+// nodes 1 and 2 both only depend on node 0, and the waves are {0}, {1, 2},
+// {3}.)
+void ComputeExecutionWaves(const GraphInfo* info, std::vector<int>* node_waves);
+
 }  // namespace tflite
 
 #endif  // TENSORFLOW_LITE_GRAPH_INFO_H_
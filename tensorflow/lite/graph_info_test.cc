@@ -30,6 +30,7 @@ limitations under the License.
 namespace tflite {
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::ExplainMatchResult;
 using ::testing::Pointwise;
@@ -694,5 +695,67 @@ TEST(PartitionTest, ComplexNonGreedily) {
                                 })));
 }
 
+std::vector<int> ComputeWaves(const SimpleTestGraph& graph) {
+  std::vector<int> node_waves;
+  ComputeExecutionWaves(&graph, &node_waves);
+  return node_waves;
+}
+
+TEST(ExecutionWavesTest, NoNodes) {
+  EXPECT_TRUE(ComputeWaves({/*inputs=*/{0}, /*outputs=*/{0}, /*nodes=*/{}})
+                  .empty());
+}
+
+//         __          __
+//  [0]-->(01)-->[1]-->(12)-->[2]-->(23)-->[4]
+//                 \          __      /
+//                  \------->(13)-->[3]
+//
+TEST(ExecutionWavesTest, IndependentBranches) {
+  EXPECT_THAT(ComputeWaves({
+                  /*inputs=*/{0},
+                  /*outputs=*/{4},
+                  /*nodes=*/
+                  {
+                      {{0}, {1}, false},
+                      {{1}, {2}, false},
+                      {{1}, {3}, false},
+                      {{2, 3}, {4}, false},
+                  },
+              }),
+              ElementsAre(0, 1, 1, 2));
+}
+
+TEST(ExecutionWavesTest, OutputWrittenAfterRead) {
+  // Node 2 overwrites tensor 1, which node 1 reads.
+  EXPECT_THAT(ComputeWaves({
+                  /*inputs=*/{0},
+                  /*outputs=*/{1, 2},
+                  /*nodes=*/
+                  {
+                      {{0}, {1}, false},
+                      {{1}, {2}, false},
+                      {{0}, {1}, false},
+                  },
+              }),
+              ElementsAre(0, 1, 2));
+}
+
+TEST(ExecutionWavesTest, NodesWithSideEffectsAreAlone) {
+  // All the nodes only read the graph input.
+  EXPECT_THAT(ComputeWaves({
+                  /*inputs=*/{0},
+                  /*outputs=*/{1, 2, 3, 4},
+                  /*nodes=*/
+                  {
+                      {{0}, {1}, false},
+                      {{0}, {2}, false},
+                      {{0}, {3}, true},
+                      {{0}, {4}, false},
+                  },
+              }),
+              ElementsAre(0, 0, 1, 2));
+}
+
 }  // namespace
 }  // namespace tflite
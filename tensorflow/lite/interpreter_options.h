@@ -29,7 +29,9 @@ class InterpreterOptions {
       : experimental_preserve_all_tensors_(false),
         experimental_ensure_dynamic_tensors_are_released_(false),
         experimental_optimize_memory_for_large_tensors_(0),
-        experimental_disable_delegate_clustering_(false) {}
+        experimental_disable_delegate_clustering_(false),
+        experimental_memory_plan_cache_size_(0),
+        experimental_num_inter_op_threads_(0) {}
 
   /// Preserving all intermediates tensors for debugging.
   /// WARNING: This is an experimental API and subject to change.
@@ -93,11 +95,46 @@ class InterpreterOptions {
     experimental_disable_delegate_clustering_ = value;
   }
 
+  /// Keeps the memory plans of the last `value` sets of tensor sizes. When
+  /// tensors are allocated again after the inputs are resized back to shapes
+  /// seen before, the cached plan is reused instead of planning the memory
+  /// again. Plans embedded in the model metadata (see
+  /// `kArenaPlanCacheMetadataPrefix`) are used regardless of this option.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetMemoryPlanCacheSize(int value) {
+    experimental_memory_plan_cache_size_ = value > 0 ? value : 0;
+  }
+
+  /// Returns the number of memory plans kept by each subgraph, zero by
+  /// default.
+  /// WARNING: This is an experimental API and subject to change.
+  int GetMemoryPlanCacheSize() { return experimental_memory_plan_cache_size_; }
+
+  /// Executes the independent nodes of the subgraphs concurrently on a pool of
+  /// `value` threads, including the thread calling `Invoke`, when `value` is
+  /// larger than 1. Nodes are grouped in waves of nodes that do not depend on
+  /// each other, and the memory planner keeps the tensors of the nodes of a
+  /// wave apart, which uses more memory. Subgraphs with dynamic tensors, or
+  /// which are profiled, are executed sequentially. Each thread has its own
+  /// CPU backend context, with the number of threads set by `SetNumThreads`:
+  /// use fewer intra-op threads to avoid oversubscribing the cores.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetNumInterOpThreads(int value) {
+    experimental_num_inter_op_threads_ = value > 1 ? value : 0;
+  }
+
+  /// Returns the number of threads executing independent nodes concurrently,
+  /// zero by default for sequential execution.
+  /// WARNING: This is an experimental API and subject to change.
+  int GetNumInterOpThreads() { return experimental_num_inter_op_threads_; }
+
  private:
   bool experimental_preserve_all_tensors_;
   bool experimental_ensure_dynamic_tensors_are_released_;
   int experimental_optimize_memory_for_large_tensors_;
   bool experimental_disable_delegate_clustering_;
+  int experimental_memory_plan_cache_size_;
+  int experimental_num_inter_op_threads_;
 };
 
 }  // namespace tflite
@@ -20,8 +20,12 @@ limitations under the License.
 #include <stdlib.h>
 #include <string.h>
 
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <utility>
@@ -1127,6 +1131,117 @@ TEST(BasicInterpreter, ReleaseDynamicTensors) {
   ASSERT_EQ(interpreter.tensor(3)->bytes, sizeof(float) * 6 * 6);
 }
 
+// State shared by the nodes of `ConcurrentAddOneRegistration`.
+struct ConcurrentNodesState {
+  // Number of nodes of each wave.
+  int wave_size;
+  std::atomic<int> num_started{0};
+  std::mutex mutex;
+  std::set<TfLiteExternalContext*> cpu_backend_contexts;
+};
+
+// Registration of an op summing its inputs and adding 1. If the builtin data
+// of the node points to a `ConcurrentNodesState`, the op fails unless the
+// other nodes of its wave are executed concurrently.
+TfLiteRegistration ConcurrentAddOneRegistration() {
+  TfLiteRegistration reg = {nullptr, nullptr, nullptr, nullptr};
+  reg.prepare = [](TfLiteContext* context, TfLiteNode* node) {
+    const TfLiteTensor* input;
+    TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, 0, &input));
+    TfLiteTensor* output;
+    TF_LITE_ENSURE_OK(context, GetOutputSafe(context, node, 0, &output));
+    return context->ResizeTensor(context, output,
+                                 TfLiteIntArrayCopy(input->dims));
+  };
+  reg.invoke = [](TfLiteContext* context, TfLiteNode* node) {
+    auto* state = static_cast<ConcurrentNodesState*>(
+        node->builtin_data == nullptr
+            ? nullptr
+            : *static_cast<void**>(node->builtin_data));
+    if (state != nullptr) {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->cpu_backend_contexts.insert(
+            context->GetExternalContext(context, kTfLiteCpuBackendContext));
+      }
+      // Waits for all the nodes of the wave to start.
+      const int num_started = ++state->num_started;
+      const int wave_end = (num_started + state->wave_size - 1) /
+                           state->wave_size * state->wave_size;
+      const auto deadline =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (state->num_started < wave_end) {
+        if (std::chrono::steady_clock::now() > deadline) return kTfLiteError;
+        std::this_thread::yield();
+      }
+    }
+    TfLiteTensor* output;
+    TF_LITE_ENSURE_OK(context, GetOutputSafe(context, node, 0, &output));
+    for (int i = 0; i < NumElements(output); ++i) {
+      output->data.f[i] = 1;
+    }
+    for (int j = 0; j < NumInputs(node); ++j) {
+      const TfLiteTensor* input;
+      TF_LITE_ENSURE_OK(context, GetInputSafe(context, node, j, &input));
+      for (int i = 0; i < NumElements(output); ++i) {
+        output->data.f[i] += input->data.f[i];
+      }
+    }
+    return kTfLiteOk;
+  };
+  return reg;
+}
+
+TEST(BasicInterpreter, InterOpThreadsInvokeIndependentNodesConcurrently) {
+  // Two towers of two nodes each read the input, and are joined by a fifth
+  // node.
+  Interpreter interpreter;
+  InterpreterOptions options;
+  options.SetNumInterOpThreads(2);
+  ASSERT_EQ(interpreter.ApplyOptions(&options), kTfLiteOk);
+  ASSERT_EQ(interpreter.AddTensors(6), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetInputs({0}), kTfLiteOk);
+  ASSERT_EQ(interpreter.SetOutputs({5}), kTfLiteOk);
+  TfLiteQuantizationParams quant;
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_EQ(interpreter.SetTensorParametersReadWrite(i, kTfLiteFloat32, "",
+                                                       {16}, quant),
+              kTfLiteOk);
+  }
+  ConcurrentNodesState state;
+  state.wave_size = 2;
+  TfLiteRegistration add_one = ConcurrentAddOneRegistration();
+  auto add_node = [&](std::vector<int> inputs, int output,
+                      ConcurrentNodesState* state) {
+    // The interpreter frees the builtin data.
+    void** builtin_data = static_cast<void**>(malloc(sizeof(void*)));
+    *builtin_data = state;
+    ASSERT_EQ(interpreter.AddNodeWithParameters(inputs, {output}, nullptr, 0,
+                                                builtin_data, &add_one),
+              kTfLiteOk);
+  };
+  add_node({0}, 1, &state);
+  add_node({1}, 2, &state);
+  add_node({0}, 3, &state);
+  add_node({3}, 4, &state);
+  add_node({2, 4}, 5, nullptr);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+
+  for (int i = 0; i < 16; ++i) {
+    interpreter.typed_input_tensor<float>(0)[i] = i;
+  }
+  for (int invoke = 0; invoke < 3; ++invoke) {
+    state.num_started = 0;
+    ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+    EXPECT_EQ(state.num_started, 4);
+    for (int i = 0; i < 16; ++i) {
+      EXPECT_EQ(interpreter.typed_output_tensor<float>(0)[i], 2 * i + 5);
+    }
+  }
+  // Each thread used its own CPU backend context.
+  EXPECT_EQ(state.cpu_backend_contexts.size(), 2);
+}
+
 TEST(InterpreterTensorsCapacityTest, TestWithinHeadroom) {
   Interpreter interpreter;
   ASSERT_EQ(interpreter.AddTensors(Interpreter::kTensorsReservedCapacity),
@@ -0,0 +1,55 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/shape_bucket_stats.h"
+
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace tflite {
+namespace profiling {
+
+void ShapeBucketStats::RecordInvoke(int bucket_size, int size, bool prepared,
+                                    int64_t latency_us) {
+  BucketStats& stats = buckets_[bucket_size];
+  ++stats.hits;
+  if (prepared) ++stats.prepares;
+  stats.total_size += size;
+  stats.latency_us.UpdateStat(latency_us);
+}
+
+std::string ShapeBucketStats::ToString() const {
+  std::stringstream stream;
+  stream << std::setw(12) << "[bucket]" << std::setw(10) << "[hits]"
+         << std::setw(12) << "[prepares]" << std::setw(12) << "[padding %]"
+         << std::setw(14) << "[avg us]" << std::setw(12) << "[max us]"
+         << "\n";
+  for (const auto& [bucket_size, stats] : buckets_) {
+    const double padded_size = static_cast<double>(bucket_size) * stats.hits;
+    const double padding =
+        padded_size > 0 ? 100.0 * (padded_size - stats.total_size) / padded_size
+                        : 0.0;
+    stream << std::setw(12) << bucket_size << std::setw(10) << stats.hits
+           << std::setw(12) << stats.prepares << std::setw(12) << std::fixed
+           << std::setprecision(1) << padding << std::setw(14)
+           << std::setprecision(1) << stats.latency_us.avg() << std::setw(12)
+           << stats.latency_us.max() << "\n";
+  }
+  return stream.str();
+}
+
+}  // namespace profiling
+}  // namespace tflite
@@ -0,0 +1,66 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_SHAPE_BUCKET_STATS_H_
+#define TENSORFLOW_LITE_PROFILING_SHAPE_BUCKET_STATS_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "tensorflow/core/util/stats_calculator.h"
+
+namespace tflite {
+namespace profiling {
+
+// Statistics of the invocations of a model whose inputs are padded to a set of
+// sizes (buckets), e.g. by a `ShapeBucketInterpreter`.
+class ShapeBucketStats {
+ public:
+  struct BucketStats {
+    // Number of invocations that used the bucket.
+    int64_t hits = 0;
+    // Number of times the bucket was prepared. The first use of a bucket
+    // prepares it.
+    int64_t prepares = 0;
+    // Sum of the unpadded sizes of the invocations, to measure the padding
+    // overhead.
+    int64_t total_size = 0;
+    // Duration of the invocations, including the preparation and the copies
+    // of the inputs, in microseconds.
+    tensorflow::Stat<int64_t> latency_us;
+  };
+
+  // Records an invocation of the bucket of size `bucket_size` for inputs of
+  // size `size`, which took `latency_us`. `prepared` is true if the bucket was
+  // prepared for this invocation.
+  void RecordInvoke(int bucket_size, int size, bool prepared,
+                    int64_t latency_us);
+
+  // Returns the statistics of each bucket, keyed by bucket size.
+  const std::map<int, BucketStats>& buckets() const { return buckets_; }
+
+  void Reset() { buckets_.clear(); }
+
+  // Returns a table with a row per bucket.
+  std::string ToString() const;
+
+ private:
+  std::map<int, BucketStats> buckets_;
+};
+
+}  // namespace profiling
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_PROFILING_SHAPE_BUCKET_STATS_H_
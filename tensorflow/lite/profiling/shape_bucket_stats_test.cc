@@ -0,0 +1,63 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/shape_bucket_stats.h"
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace tflite {
+namespace profiling {
+namespace {
+
+using ::testing::HasSubstr;
+
+TEST(ShapeBucketStatsTest, Empty) {
+  ShapeBucketStats stats;
+  EXPECT_TRUE(stats.buckets().empty());
+  EXPECT_THAT(stats.ToString(), HasSubstr("[bucket]"));
+}
+
+TEST(ShapeBucketStatsTest, RecordInvoke) {
+  ShapeBucketStats stats;
+  stats.RecordInvoke(/*bucket_size=*/16, /*size=*/12, /*prepared=*/true,
+                     /*latency_us=*/300);
+  stats.RecordInvoke(/*bucket_size=*/16, /*size=*/16, /*prepared=*/false,
+                     /*latency_us=*/100);
+  stats.RecordInvoke(/*bucket_size=*/32, /*size=*/20, /*prepared=*/true,
+                     /*latency_us=*/500);
+
+  ASSERT_EQ(stats.buckets().size(), 2);
+  const ShapeBucketStats::BucketStats& small = stats.buckets().at(16);
+  EXPECT_EQ(small.hits, 2);
+  EXPECT_EQ(small.prepares, 1);
+  EXPECT_EQ(small.total_size, 28);
+  EXPECT_EQ(small.latency_us.avg(), 200);
+  EXPECT_EQ(small.latency_us.max(), 300);
+  const ShapeBucketStats::BucketStats& large = stats.buckets().at(32);
+  EXPECT_EQ(large.hits, 1);
+  EXPECT_EQ(large.prepares, 1);
+
+  // 4 of the 32 elements of the first bucket are padding.
+  EXPECT_THAT(stats.ToString(), HasSubstr("12.5"));
+
+  stats.Reset();
+  EXPECT_TRUE(stats.buckets().empty());
+}
+
+}  // namespace
+}  // namespace profiling
+}  // namespace tflite
@@ -160,6 +160,23 @@ class SimpleMemoryArena {
 
   size_t GetBufferSize() const { return underlying_buffer_.GetSize(); }
 
+  // The allocations scheduled since the last ClearPlan(). A plan can be saved
+  // and restored instead of scheduling the same allocations again.
+  struct Plan {
+    size_t high_water_mark = 0;
+    std::vector<ArenaAllocWithUsageInterval> active_allocs;
+  };
+
+  Plan GetPlan() const { return {high_water_mark_, active_allocs_}; }
+
+  // Replaces the scheduled allocations with `plan`. The arena must be
+  // committed again before allocations are resolved.
+  void RestorePlan(const Plan& plan) {
+    committed_ = false;
+    high_water_mark_ = plan.high_water_mark;
+    active_allocs_ = plan.active_allocs;
+  }
+
   std::intptr_t BasePointer() const {
     return reinterpret_cast<std::intptr_t>(underlying_buffer_.GetPtr());
   }
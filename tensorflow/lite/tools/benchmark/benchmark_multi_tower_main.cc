@@ -0,0 +1,200 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures the latency of a synthetic multi-tower model, whose towers of fully
+// connected layers only depend on the input, with its ops executed one after
+// the other and with the independent ops executed concurrently
+// (`InterpreterOptions::SetNumInterOpThreads`).
+//
+// Usage:
+//   benchmark_multi_tower --num_towers=4 --num_layers=8 --width=512 \
+//     --num_inter_op_threads=4
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/util/stats_calculator.h"
+#include "tensorflow/lite/core/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/interpreter_options.h"
+#include "tensorflow/lite/profiling/time.h"
+#include "tensorflow/lite/tools/command_line_flags.h"
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+struct MultiTowerModel {
+  int num_towers;
+  int num_layers;
+  int width;
+  // Weights of each layer of each tower, with the same values for all.
+  std::vector<float> weights;
+};
+
+// Builds the model in `interpreter`: the input goes through `num_towers`
+// towers of `num_layers` fully connected layers each, whose outputs are
+// added.
+TfLiteStatus BuildModel(const MultiTowerModel& model,
+                        Interpreter* interpreter) {
+  const int num_tower_tensors = model.num_towers * (model.num_layers + 1);
+  // The input, the weights, the outputs of the layers and of the additions.
+  const int weights = 1;
+  const int first_tower_tensor = 2;
+  const int first_sum = first_tower_tensor + num_tower_tensors;
+  const int num_tensors = first_sum + model.num_towers - 1;
+  TF_LITE_ENSURE_STATUS(interpreter->AddTensors(num_tensors));
+  TF_LITE_ENSURE_STATUS(interpreter->SetInputs({0}));
+  TF_LITE_ENSURE_STATUS(interpreter->SetOutputs({num_tensors - 1}));
+  TfLiteQuantizationParams quant;
+  TF_LITE_ENSURE_STATUS(interpreter->SetTensorParametersReadWrite(
+      0, kTfLiteFloat32, "input", {1, model.width}, quant));
+  TF_LITE_ENSURE_STATUS(interpreter->SetTensorParametersReadOnly(
+      weights, kTfLiteFloat32, "weights", {model.width, model.width}, quant,
+      reinterpret_cast<const char*>(model.weights.data()),
+      model.weights.size() * sizeof(float)));
+  for (int i = first_tower_tensor; i < num_tensors; ++i) {
+    TF_LITE_ENSURE_STATUS(interpreter->SetTensorParametersReadWrite(
+        i, kTfLiteFloat32, "", {1, model.width}, quant));
+  }
+
+  std::vector<int> tower_outputs;
+  for (int tower = 0; tower < model.num_towers; ++tower) {
+    int input = 0;
+    for (int layer = 0; layer < model.num_layers; ++layer) {
+      const int output =
+          first_tower_tensor + tower * (model.num_layers + 1) + layer;
+      // The interpreter frees the parameters.
+      auto* params = static_cast<TfLiteFullyConnectedParams*>(
+          malloc(sizeof(TfLiteFullyConnectedParams)));
+      *params = TfLiteFullyConnectedParams();
+      params->activation = kTfLiteActRelu;
+      TF_LITE_ENSURE_STATUS(interpreter->AddNodeWithParameters(
+          {input, weights, kTfLiteOptionalTensor}, {output}, nullptr, 0,
+          params, ops::builtin::Register_FULLY_CONNECTED()));
+      input = output;
+    }
+    tower_outputs.push_back(input);
+  }
+  int sum = tower_outputs[0];
+  for (int tower = 1; tower < model.num_towers; ++tower) {
+    const int output = first_sum + tower - 1;
+    auto* params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    *params = TfLiteAddParams();
+    TF_LITE_ENSURE_STATUS(interpreter->AddNodeWithParameters(
+        {sum, tower_outputs[tower]}, {output}, nullptr, 0, params,
+        ops::builtin::Register_ADD()));
+    sum = output;
+  }
+  return kTfLiteOk;
+}
+
+// Invokes the model `num_runs` times, after a warm-up run, and records the
+// latencies and the arena size. Returns false on failure.
+bool Run(const MultiTowerModel& model, int num_threads,
+         int num_inter_op_threads, int num_runs,
+         tensorflow::Stat<int64_t>* latency_us, size_t* arena_size) {
+  Interpreter interpreter;
+  InterpreterOptions options;
+  options.SetNumInterOpThreads(num_inter_op_threads);
+  if (interpreter.ApplyOptions(&options) != kTfLiteOk ||
+      BuildModel(model, &interpreter) != kTfLiteOk ||
+      interpreter.SetNumThreads(num_threads) != kTfLiteOk ||
+      interpreter.AllocateTensors() != kTfLiteOk) {
+    return false;
+  }
+  float* input = interpreter.typed_input_tensor<float>(0);
+  for (int i = 0; i < model.width; ++i) {
+    input[i] = static_cast<float>(i % 7) / 7;
+  }
+  if (interpreter.Invoke() != kTfLiteOk) return false;
+  for (int run = 0; run < num_runs; ++run) {
+    const uint64_t start_us = profiling::time::NowMicros();
+    if (interpreter.Invoke() != kTfLiteOk) return false;
+    latency_us->UpdateStat(profiling::time::NowMicros() - start_us);
+  }
+  Subgraph::SubgraphAllocInfo alloc_info;
+  interpreter.primary_subgraph().GetMemoryAllocInfo(&alloc_info);
+  *arena_size = alloc_info.arena_size;
+  return true;
+}
+
+int Main(int argc, char** argv) {
+  MultiTowerModel model;
+  model.num_towers = 4;
+  model.num_layers = 8;
+  model.width = 512;
+  int32_t num_runs = 50;
+  int32_t num_threads = 1;
+  int32_t num_inter_op_threads = 4;
+  std::vector<Flag> flags = {
+      Flag::CreateFlag("num_towers", &model.num_towers,
+                       "Number of independent towers."),
+      Flag::CreateFlag("num_layers", &model.num_layers,
+                       "Number of fully connected layers of each tower."),
+      Flag::CreateFlag("width", &model.width,
+                       "Number of inputs and outputs of the layers."),
+      Flag::CreateFlag("num_runs", &num_runs,
+                       "Number of invocations for each mode."),
+      Flag::CreateFlag("num_threads", &num_threads,
+                       "Number of threads used by each op."),
+      Flag::CreateFlag("num_inter_op_threads", &num_inter_op_threads,
+                       "Number of threads executing independent ops."),
+  };
+  const bool parsed =
+      Flags::Parse(&argc, const_cast<const char**>(argv), flags);
+  if (!parsed || model.num_towers < 1 || model.num_layers < 1 ||
+      model.width < 1 || num_runs < 1 || num_inter_op_threads < 2) {
+    TFLITE_LOG(ERROR) << Flags::Usage(argv[0], flags);
+    return EXIT_FAILURE;
+  }
+  model.weights.assign(model.width * model.width, 1.0f / model.width);
+
+  tensorflow::Stat<int64_t> sequential_us;
+  tensorflow::Stat<int64_t> parallel_us;
+  size_t sequential_arena_size = 0;
+  size_t parallel_arena_size = 0;
+  if (!Run(model, num_threads, /*num_inter_op_threads=*/0, num_runs,
+           &sequential_us, &sequential_arena_size) ||
+      !Run(model, num_threads, num_inter_op_threads, num_runs, &parallel_us,
+           &parallel_arena_size)) {
+    TFLITE_LOG(ERROR) << "Failed to run the model.";
+    return EXIT_FAILURE;
+  }
+
+  TFLITE_LOG(INFO) << "Invoke latency (us):";
+  TFLITE_LOG(INFO) << "  sequential: " << sequential_us;
+  TFLITE_LOG(INFO) << "  " << num_inter_op_threads
+                   << " inter-op threads: " << parallel_us;
+  TFLITE_LOG(INFO) << "Speedup: "
+                   << sequential_us.avg() / parallel_us.avg();
+  TFLITE_LOG(INFO) << "Arena size (bytes): sequential "
+                   << sequential_arena_size << ", parallel "
+                   << parallel_arena_size;
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace tflite
+
+int main(int argc, char** argv) { return tflite::benchmark::Main(argc, argv); }
@@ -0,0 +1,160 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Measures how long it takes to create an interpreter that applies the XNNPACK
+// delegate to a model, without weight cache, with a cold weight cache (the
+// packed weights are written to the cache directory) and with a warm one (the
+// packed weights are memory-mapped from the cache directory).
+//
+// Usage:
+//   benchmark_xnnpack_weight_cache --graph=model.tflite --cache_dir=/tmp/cache
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/util/stats_calculator.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/interpreter_builder.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model_builder.h"
+#include "tensorflow/lite/profiling/time.h"
+#include "tensorflow/lite/tools/command_line_flags.h"
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+using XNNPackDelegatePtr =
+    std::unique_ptr<TfLiteDelegate, decltype(&TfLiteXNNPackDelegateDelete)>;
+
+// An interpreter and the delegate it uses, which must outlive it.
+struct DelegatedInterpreter {
+  XNNPackDelegatePtr delegate{nullptr, TfLiteXNNPackDelegateDelete};
+  std::unique_ptr<Interpreter> interpreter;
+};
+
+// Creates an interpreter for `model` and returns the time it took, or -1 on
+// failure. Weights are cached in `cache_dir` if `model_token` is not empty.
+int64_t CreateInterpreter(const FlatBufferModel& model, int num_threads,
+                          const std::string& cache_dir,
+                          const std::string& model_token,
+                          DelegatedInterpreter* result) {
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates resolver;
+  const uint64_t start_us = profiling::time::NowMicros();
+
+  TfLiteXNNPackDelegateOptions options = TfLiteXNNPackDelegateOptionsDefault();
+  options.num_threads = num_threads;
+  if (!model_token.empty()) {
+    options.weight_cache_dir = cache_dir.c_str();
+    options.model_token = model_token.c_str();
+  }
+  result->delegate.reset(TfLiteXNNPackDelegateCreate(&options));
+  if (InterpreterBuilder(model, resolver)(&result->interpreter) != kTfLiteOk ||
+      result->interpreter == nullptr ||
+      result->interpreter->ModifyGraphWithDelegate(result->delegate.get()) !=
+          kTfLiteOk ||
+      result->interpreter->AllocateTensors() != kTfLiteOk) {
+    return -1;
+  }
+  return profiling::time::NowMicros() - start_us;
+}
+
+// Creates `num_runs` interpreters one after the other. Returns false on
+// failure.
+bool CreateInterpreters(const FlatBufferModel& model, int num_runs,
+                        int num_threads, const std::string& cache_dir,
+                        const std::string& model_token,
+                        tensorflow::Stat<int64_t>* stats) {
+  for (int i = 0; i < num_runs; ++i) {
+    DelegatedInterpreter interpreter;
+    const int64_t time_us = CreateInterpreter(model, num_threads, cache_dir,
+                                              model_token, &interpreter);
+    if (time_us < 0) return false;
+    stats->UpdateStat(time_us);
+  }
+  return true;
+}
+
+int Main(int argc, char** argv) {
+  std::string graph;
+  std::string cache_dir;
+  int32_t num_runs = 10;
+  int32_t num_threads = 1;
+  std::vector<Flag> flags = {
+      Flag::CreateFlag("graph", &graph, "Path to the .tflite model."),
+      Flag::CreateFlag("cache_dir", &cache_dir,
+                       "Existing directory in which the packed weights are "
+                       "cached."),
+      Flag::CreateFlag("num_runs", &num_runs,
+                       "Number of interpreters to create for each mode."),
+      Flag::CreateFlag("num_threads", &num_threads,
+                       "Number of threads used by the XNNPACK delegate."),
+  };
+  const bool parsed =
+      Flags::Parse(&argc, const_cast<const char**>(argv), flags);
+  if (!parsed || graph.empty() || cache_dir.empty() || num_runs < 1) {
+    TFLITE_LOG(ERROR) << Flags::Usage(argv[0], flags);
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<FlatBufferModel> model =
+      FlatBufferModel::BuildFromFile(graph.c_str());
+  if (model == nullptr) {
+    TFLITE_LOG(ERROR) << "Failed to load model " << graph;
+    return EXIT_FAILURE;
+  }
+  // A new token makes sure the first cached run starts from an empty cache.
+  const std::string model_token =
+      "benchmark_" + std::to_string(profiling::time::NowMicros());
+
+  tensorflow::Stat<int64_t> no_cache_us;
+  if (!CreateInterpreters(*model, num_runs, num_threads, cache_dir,
+                          /*model_token=*/"", &no_cache_us)) {
+    TFLITE_LOG(ERROR) << "Failed to create an interpreter for " << graph;
+    return EXIT_FAILURE;
+  }
+  // Keep the cold interpreter alive while the warm ones are created, as an
+  // application serving the model would.
+  DelegatedInterpreter cold_interpreter;
+  const int64_t cold_cache_us = CreateInterpreter(
+      *model, num_threads, cache_dir, model_token, &cold_interpreter);
+  tensorflow::Stat<int64_t> warm_cache_us;
+  if (cold_cache_us < 0 ||
+      !CreateInterpreters(*model, num_runs, num_threads, cache_dir,
+                          model_token, &warm_cache_us)) {
+    TFLITE_LOG(ERROR) << "Failed to create a cached interpreter for " << graph;
+    return EXIT_FAILURE;
+  }
+
+  TFLITE_LOG(INFO) << "Interpreter creation time (us):";
+  TFLITE_LOG(INFO) << "  no weight cache:   " << no_cache_us;
+  TFLITE_LOG(INFO) << "  cold weight cache: " << cold_cache_us;
+  TFLITE_LOG(INFO) << "  warm weight cache: " << warm_cache_us;
+  TFLITE_LOG(INFO) << "Cache files were written to " << cache_dir
+                   << " with model token " << model_token << ".";
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace tflite
+
+int main(int argc, char** argv) { return tflite::benchmark::Main(argc, argv); }
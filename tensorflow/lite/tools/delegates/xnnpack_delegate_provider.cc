@@ -25,6 +25,10 @@ class XnnpackDelegateProvider : public DelegateProvider {
  public:
   XnnpackDelegateProvider() {
     default_params_.AddParam("use_xnnpack", ToolParam::Create<bool>(false));
+    default_params_.AddParam("xnnpack_weight_cache_dir",
+                             ToolParam::Create<std::string>(""));
+    default_params_.AddParam("xnnpack_weight_cache_model_token",
+                             ToolParam::Create<std::string>(""));
   }
 
   std::vector<Flag> CreateFlags(ToolParams* params) const final;
@@ -41,25 +45,41 @@ REGISTER_DELEGATE_PROVIDER(XnnpackDelegateProvider);
 
 std::vector<Flag> XnnpackDelegateProvider::CreateFlags(
     ToolParams* params) const {
-  std::vector<Flag> flags = {CreateFlag<bool>(
-      "use_xnnpack", params,
-      "explicitly apply the XNNPACK delegate. Note the XNNPACK delegate could "
-      "be implicitly applied by the TF Lite runtime regardless the value of "
-      "this parameter. To disable this implicit application, set the value to "
-      "false explicitly.")};
+  std::vector<Flag> flags = {
+      CreateFlag<bool>(
+          "use_xnnpack", params,
+          "explicitly apply the XNNPACK delegate. Note the XNNPACK delegate "
+          "could be implicitly applied by the TF Lite runtime regardless the "
+          "value of this parameter. To disable this implicit application, set "
+          "the value to false explicitly."),
+      CreateFlag<std::string>(
+          "xnnpack_weight_cache_dir", params,
+          "directory in which the XNNPACK delegate caches packed weights, so "
+          "that later runs memory-map them instead of packing them again. "
+          "Requires --xnnpack_weight_cache_model_token."),
+      CreateFlag<std::string>(
+          "xnnpack_weight_cache_model_token", params,
+          "token unique to the model, naming its files in "
+          "--xnnpack_weight_cache_dir.")};
   return flags;
 }
 
 void XnnpackDelegateProvider::LogParams(const ToolParams& params,
                                         bool verbose) const {
   LOG_TOOL_PARAM(params, bool, "use_xnnpack", "Use xnnpack", verbose);
+  LOG_TOOL_PARAM(params, std::string, "xnnpack_weight_cache_dir",
+                 "XNNPACK weight cache dir", verbose);
+  LOG_TOOL_PARAM(params, std::string, "xnnpack_weight_cache_model_token",
+                 "XNNPACK weight cache model token", verbose);
 }
 
 TfLiteDelegatePtr XnnpackDelegateProvider::CreateTfLiteDelegate(
     const ToolParams& params) const {
   if (params.Get<bool>("use_xnnpack")) {
     return evaluation::CreateXNNPACKDelegate(
-        params.Get<int32_t>("num_threads"));
+        params.Get<int32_t>("num_threads"),
+        params.Get<std::string>("xnnpack_weight_cache_dir"),
+        params.Get<std::string>("xnnpack_weight_cache_model_token"));
   }
   return CreateNullDelegate();
 }
@@ -0,0 +1,182 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Computes the memory plans of a model for a set of input shapes and stores
+// them in the model metadata, so that interpreters loading the model reuse them
+// instead of planning the memory again.
+//
+// Usage:
+//   embed_memory_plans --input_model=model.tflite \
+//     --output_model=model_with_plans.tflite \
+//     --input_shapes="1,224,224,3:1,10;4,224,224,3:4,10"
+//
+// Shape sets are separated by ';' and the shapes of the inputs of a set, in
+// the order of the primary subgraph inputs, by ':'.
+
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/arena_planner.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/interpreter_builder.h"
+#include "tensorflow/lite/core/kernels/register.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/interpreter_options.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/tools/command_line_flags.h"
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace {
+
+using Shape = std::vector<int>;
+
+// Parses `input_shapes` into one list of input shapes per shape set.
+bool ParseInputShapes(absl::string_view input_shapes,
+                      std::vector<std::vector<Shape>>* shape_sets) {
+  for (absl::string_view shape_set :
+       absl::StrSplit(input_shapes, ';', absl::SkipEmpty())) {
+    std::vector<Shape> shapes;
+    for (absl::string_view shape_str : absl::StrSplit(shape_set, ':')) {
+      Shape shape;
+      for (absl::string_view dim_str :
+           absl::StrSplit(shape_str, ',', absl::SkipEmpty())) {
+        int dim;
+        if (!absl::SimpleAtoi(dim_str, &dim) || dim < 0) return false;
+        shape.push_back(dim);
+      }
+      shapes.push_back(std::move(shape));
+    }
+    shape_sets->push_back(std::move(shapes));
+  }
+  return !shape_sets->empty();
+}
+
+// Sets the metadata named `name` of `model` to `data`, replacing any previous
+// value.
+void SetMetadata(const std::string& name, const std::string& data,
+                 ModelT* model) {
+  auto buffer = std::make_unique<BufferT>();
+  buffer->data.assign(data.begin(), data.end());
+  for (const std::unique_ptr<MetadataT>& metadata : model->metadata) {
+    if (metadata->name == name) {
+      model->buffers[metadata->buffer] = std::move(buffer);
+      return;
+    }
+  }
+  auto metadata = std::make_unique<MetadataT>();
+  metadata->name = name;
+  metadata->buffer = model->buffers.size();
+  model->buffers.push_back(std::move(buffer));
+  model->metadata.push_back(std::move(metadata));
+}
+
+int Main(int argc, char** argv) {
+  std::string input_model;
+  std::string output_model;
+  std::string input_shapes;
+  std::vector<Flag> flags = {
+      Flag::CreateFlag("input_model", &input_model,
+                       "Path to the input .tflite model."),
+      Flag::CreateFlag("output_model", &output_model,
+                       "Path of the .tflite model with the memory plans."),
+      Flag::CreateFlag("input_shapes", &input_shapes,
+                       "Input shapes to plan for, e.g. "
+                       "\"1,224,224,3:1,10;4,224,224,3:4,10\"."),
+  };
+  const bool parsed =
+      Flags::Parse(&argc, const_cast<const char**>(argv), flags);
+  std::vector<std::vector<Shape>> shape_sets;
+  if (!parsed || input_model.empty() || output_model.empty() ||
+      !ParseInputShapes(input_shapes, &shape_sets)) {
+    TFLITE_LOG(ERROR) << Flags::Usage(argv[0], flags);
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<FlatBufferModel> model =
+      FlatBufferModel::BuildFromFile(input_model.c_str());
+  if (model == nullptr) {
+    TFLITE_LOG(ERROR) << "Failed to load model " << input_model;
+    return EXIT_FAILURE;
+  }
+  // Keep a plan per shape set. The interpreter is created as applications
+  // create it, so that the plans match the graph they execute.
+  InterpreterOptions options;
+  options.SetMemoryPlanCacheSize(static_cast<int>(shape_sets.size()));
+  ops::builtin::BuiltinOpResolver resolver;
+  std::unique_ptr<Interpreter> interpreter;
+  if (InterpreterBuilder(*model, resolver, &options)(&interpreter) !=
+          kTfLiteOk ||
+      interpreter == nullptr) {
+    TFLITE_LOG(ERROR) << "Failed to create an interpreter for " << input_model;
+    return EXIT_FAILURE;
+  }
+  for (const std::vector<Shape>& shapes : shape_sets) {
+    if (shapes.size() != interpreter->inputs().size()) {
+      TFLITE_LOG(ERROR) << "The model has " << interpreter->inputs().size()
+                        << " inputs, got " << shapes.size() << " shapes.";
+      return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < shapes.size(); ++i) {
+      if (interpreter->ResizeInputTensor(interpreter->inputs()[i],
+                                         shapes[i]) != kTfLiteOk) {
+        TFLITE_LOG(ERROR) << "Failed to resize input " << i;
+        return EXIT_FAILURE;
+      }
+    }
+    if (interpreter->AllocateTensors() != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to allocate tensors for " << input_shapes;
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto model_t = std::make_unique<ModelT>();
+  model->GetModel()->UnPackTo(model_t.get(), nullptr);
+  for (int i = 0; i < static_cast<int>(interpreter->subgraphs_size()); ++i) {
+    std::string plans;
+    if (interpreter->subgraph(i)->SerializeMemoryPlans(&plans) != kTfLiteOk) {
+      TFLITE_LOG(ERROR) << "Failed to serialize the memory plans of subgraph "
+                        << i;
+      return EXIT_FAILURE;
+    }
+    SetMetadata(kArenaPlanCacheMetadataPrefix + std::to_string(i), plans,
+                model_t.get());
+  }
+
+  flatbuffers::FlatBufferBuilder builder;
+  FinishModelBuffer(builder, Model::Pack(builder, model_t.get()));
+  std::ofstream output(output_model, std::ios::binary);
+  output.write(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+               builder.GetSize());
+  if (!output) {
+    TFLITE_LOG(ERROR) << "Failed to write " << output_model;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+}  // namespace tflite
+
+int main(int argc, char** argv) { return tflite::Main(argc, argv); }
@@ -180,6 +180,12 @@ TfLiteDelegatePtr CreateHexagonDelegate(
 TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads) {
   return tools::CreateNullDelegate();
 }
+
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& weight_cache_dir,
+                                        const std::string& model_token) {
+  return tools::CreateNullDelegate();
+}
 #else  // !defined(TFLITE_WITHOUT_XNNPACK)
 // This method replicates the implementation from
 // https://github.com/tensorflow/tensorflow/blob/55e3b5643a791c4cc320746649d455cacfadf6ed/tensorflow/lite/delegates/xnnpack/xnnpack_delegate.cc#L5235
@@ -222,8 +228,16 @@ TfLiteDelegatePtr CreateXNNPACKDelegate(
       0);
   flatbuffers::Offset<tflite::XNNPackSettings> xnnpack_settings =
       xnnpack_settings_builder.Finish();
+  flatbuffers::Offset<tflite::CompilationCachingSettings> caching_settings;
+  if (xnnpack_options->weight_cache_dir != nullptr &&
+      xnnpack_options->model_token != nullptr) {
+    caching_settings = tflite::CreateCompilationCachingSettingsDirect(
+        flatbuffer_builder, xnnpack_options->weight_cache_dir,
+        xnnpack_options->model_token);
+  }
   tflite::TFLiteSettingsBuilder tflite_settings_builder(flatbuffer_builder);
   tflite_settings_builder.add_xnnpack_settings(xnnpack_settings);
+  tflite_settings_builder.add_compilation_caching_settings(caching_settings);
   tflite_settings_builder.add_delegate(tflite::Delegate_XNNPACK);
   flatbuffers::Offset<tflite::TFLiteSettings> tflite_settings =
       tflite_settings_builder.Finish();
@@ -246,6 +260,18 @@ TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads) {
   opts.num_threads = num_threads > 1 ? num_threads : 0;
   return CreateXNNPACKDelegate(&opts);
 }
+
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& weight_cache_dir,
+                                        const std::string& model_token) {
+  auto opts = XNNPackDelegateOptionsDefault();
+  opts.num_threads = num_threads > 1 ? num_threads : 0;
+  if (!weight_cache_dir.empty() && !model_token.empty()) {
+    opts.weight_cache_dir = weight_cache_dir.c_str();
+    opts.model_token = model_token.c_str();
+  }
+  return CreateXNNPACKDelegate(&opts);
+}
 #endif
 
 TfLiteDelegatePtr CreateCoreMlDelegate() {
@@ -106,6 +106,11 @@ TfLiteDelegatePtr CreateXNNPACKDelegate(
     const TfLiteXNNPackDelegateOptions* options);
 #endif  // !defined(TFLITE_WITHOUT_XNNPACK)
 TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads);
+// Packed weights are cached in `weight_cache_dir` if it and `model_token` are
+// not empty. See TfLiteXNNPackDelegateOptions::weight_cache_dir.
+TfLiteDelegatePtr CreateXNNPACKDelegate(int num_threads,
+                                        const std::string& weight_cache_dir,
+                                        const std::string& model_token);
 
 TfLiteDelegatePtr CreateCoreMlDelegate();
 }  // namespace evaluation
@@ -40,6 +40,16 @@ from tensorflow.python.util.tf_export import tf_export
 
 COMPRESSION_AUTO = "AUTO"
 COMPRESSION_NONE = None
+COMPRESSION_SNAPPY = "SNAPPY"
+COMPRESSION_ZSTD = "ZSTD"
+COMPRESSION_ADAPTIVE = "ADAPTIVE"
+# Codec of the `CompressElement` op for each compressing `compression` value.
+_COMPRESSION_CODECS = {
+    COMPRESSION_AUTO: "snappy",
+    COMPRESSION_SNAPPY: "snappy",
+    COMPRESSION_ZSTD: "zstd",
+    COMPRESSION_ADAPTIVE: "auto",
+}
 _PARALLEL_EPOCHS = "parallel_epochs"
 _DISTRIBUTED_EPOCH = "distributed_epoch"
 
@@ -183,7 +193,7 @@ def _validate_job_name(job_name) -> None:
 
 
 def _validate_compression(compression) -> None:
-  valid_compressions = [COMPRESSION_AUTO, COMPRESSION_NONE]
+  valid_compressions = list(_COMPRESSION_CODECS) + [COMPRESSION_NONE]
   if compression not in valid_compressions:
     raise ValueError(f"Invalid `compression` argument: {compression}. "
                      f"Must be one of {valid_compressions}.")
@@ -191,12 +201,14 @@ def _validate_compression(compression) -> None:
 
 def _get_compression_proto(
     compression) -> data_service_pb2.DataServiceMetadata.Compression:
-  if compression == COMPRESSION_AUTO:
+  # Elements record their codec, so all codecs share one metadata value.
+  if compression in _COMPRESSION_CODECS:
     return data_service_pb2.DataServiceMetadata.COMPRESSION_SNAPPY
   if compression == COMPRESSION_NONE:
     return data_service_pb2.DataServiceMetadata.COMPRESSION_OFF
   raise ValueError(f"Invalid `compression` argument: {compression}. "
-                   f"Must be one of {[COMPRESSION_AUTO, COMPRESSION_NONE]}.")
+                   f"Must be one of "
+                   f"{list(_COMPRESSION_CODECS) + [COMPRESSION_NONE]}.")
 
 
 def _to_tensor(dataset_id) -> tensor.Tensor:
@@ -491,7 +503,9 @@ def _distribute(
       data with the tf.data service. By default, data is transferred using gRPC.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. "SNAPPY" and
+      "ZSTD" select a codec, and "ADAPTIVE" picks the codec with the lowest
+      measured CPU and network cost.
     cross_trainer_cache: (Optional.) If a `CrossTrainerCache` object is
       provided, dataset iteration will be shared across concurrently running
       trainers. See
@@ -749,7 +763,9 @@ def distribute(
       data with the tf.data service. By default, data is transferred using gRPC.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. "SNAPPY" and
+      "ZSTD" select a codec, and "ADAPTIVE" picks the codec with the lowest
+      measured CPU and network cost.
     cross_trainer_cache: (Optional.) If a `CrossTrainerCache` object is
       provided, dataset iteration will be shared across concurrently running
       trainers. See
@@ -797,7 +813,9 @@ def _register_dataset(
     dataset: A `tf.data.Dataset` to register with the tf.data service.
     compression: How to compress the dataset's elements before transferring them
       over the network. "AUTO" leaves the decision of how to compress up to the
-      tf.data service runtime. `None` indicates not to compress.
+      tf.data service runtime. `None` indicates not to compress. "SNAPPY" and
+      "ZSTD" select a codec, and "ADAPTIVE" picks the codec with the lowest
+      measured CPU and network cost.
     dataset_id: (Optional.) By default, tf.data service generates a unique
       (string) ID for each registered dataset. If a `dataset_id` is provided, it
       will use the specified ID. If a dataset with a matching ID already exists,
@@ -822,9 +840,10 @@ def _register_dataset(
     encoded_spec = nested_structure_coder.encode_structure(
         dataset.element_spec).SerializeToString()
 
-  if compression == COMPRESSION_AUTO:
+  if compression in _COMPRESSION_CODECS:
+    codec = _COMPRESSION_CODECS[compression]
     dataset = dataset.map(
-        lambda *x: compression_ops.compress(x),
+        lambda *x: compression_ops.compress(x, codec=codec),
         num_parallel_calls=dataset_ops.AUTOTUNE)
   dataset = dataset._apply_debug_options()  # pylint: disable=protected-access
 
@@ -883,7 +902,8 @@ def register_dataset(
     compression: (Optional.) How to compress the dataset's elements before
       transferring them over the network. "AUTO" leaves the decision of how to
       compress up to the tf.data service runtime. `None` indicates not to
-      compress.
+      compress. "SNAPPY" and "ZSTD" select a codec, and "ADAPTIVE" picks the
+      codec with the lowest measured CPU and network cost.
     dataset_id: (Optional.) By default, tf.data service generates a unique
       (string) ID for each registered dataset. If a `dataset_id` is provided, it
       will use the specified ID. If a dataset with a matching ID already exists,
@@ -13,4 +13,4 @@
 # limitations under the License.
 # ==============================================================================
 
-def GenerateCostReport(arg0: bytes, arg1: bool, arg2: bool, arg3) -> bytes: ...
+def GenerateCostReport(arg0: bytes, arg1: bool, arg2: bool, arg3, arg4: str, arg5: bool) -> bytes: ...
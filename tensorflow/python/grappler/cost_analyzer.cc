@@ -16,19 +16,39 @@ limitations under the License.
 #include "tensorflow/python/grappler/cost_analyzer.h"
 
 #include <iomanip>
+#include <memory>
+
 #include "tensorflow/core/grappler/costs/utils.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/lib/core/status.h"
 
 namespace tensorflow {
 namespace grappler {
+namespace {
+
+std::unique_ptr<OpLevelCostEstimator> NodeEstimator(
+    const MeasuredCostDatabase* measured_costs) {
+  auto node_estimator = std::make_unique<OpLevelCostEstimator>();
+  node_estimator->set_measured_costs(measured_costs);
+  return node_estimator;
+}
+
+}  // namespace
 
 CostAnalyzer::CostAnalyzer(const GrapplerItem& item, Cluster* cluster,
-                           const string& suffix)
+                           const string& suffix,
+                           MeasuredCostDatabase* measured_costs)
     : item_(&item),
       measure_estimator_(cluster, 10, 0),
-      analytical_estimator_(cluster, /*use_static_shapes=*/false,
+      analytical_estimator_(cluster, NodeEstimator(nullptr),
+                            ReadyNodeManagerFactory("FirstReady"),
+                            /*use_static_shapes=*/false,
                             /*use_aggressive_shape_inference=*/true),
+      measured_costs_(measured_costs),
+      measured_costs_estimator_(cluster, NodeEstimator(measured_costs),
+                                ReadyNodeManagerFactory("FirstReady"),
+                                /*use_static_shapes=*/false,
+                                /*use_aggressive_shape_inference=*/true),
       suffix_(suffix) {}
 
 Status CostAnalyzer::GenerateReport(std::ostream& os, bool per_node_report,
@@ -59,11 +79,22 @@ void CostAnalyzer::PredictCosts(CostEstimator* cost_estimator,
 }
 
 void CostAnalyzer::GatherCosts() {
+  // Predict the step time from the ops measured so far, before adding the
+  // measurements of this step.
+  total_time_predicted_from_measured_costs_ = 0;
+  if (measured_costs_ != nullptr) {
+    PredictCosts(&measured_costs_estimator_, /*cost_graph=*/nullptr,
+                 &total_time_predicted_from_measured_costs_);
+  }
+
   CostGraphDef cost_graph_measured;
   PredictCosts(&measure_estimator_, &cost_graph_measured,
                &total_time_measured_);
   VLOG(1) << "Graph size: " << item_->graph.node_size();
   VLOG(1) << "cost_graph_measured size: " << cost_graph_measured.node_size();
+  if (measured_costs_ != nullptr) {
+    measured_costs_->AddCostGraph(cost_graph_measured, item_->graph);
+  }
 
   CostGraphDef cost_graph_analytical;
   PredictCosts(&analytical_estimator_, &cost_graph_analytical,
@@ -188,6 +219,18 @@ void CostAnalyzer::PrintAnalysis(std::ostream& os, bool per_node_report,
   os << std::left << std::setw(50)
      << "Overall efficiency (analytical lower/actual): " << std::right
      << std::setw(20) << efficiency_lower << std::endl;
+  if (measured_costs_ != nullptr) {
+    os << std::left << std::setw(50)
+       << "Total time predicted in ns (measured op costs): " << std::right
+       << std::setw(20) << total_time_predicted_from_measured_costs_
+       << std::endl;
+    double prediction_ratio =
+        static_cast<double>(total_time_predicted_from_measured_costs_) /
+        static_cast<double>(total_time_measured_);
+    os << std::left << std::setw(50)
+       << "Prediction accuracy (predicted/actual): " << std::right
+       << std::setw(20) << prediction_ratio << std::endl;
+  }
   os << std::endl;
 
   int width = 35;
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/grappler/clusters/cluster.h"
 #include "tensorflow/core/grappler/costs/analytical_cost_estimator.h"
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/measured_cost_database.h"
 #include "tensorflow/core/grappler/costs/measuring_cost_estimator.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 
@@ -47,10 +48,15 @@ struct OpPerfSummary {
 
 // Generate op-level performance insights on compute/memory
 // efficiency, as well as graph-level aggregated performance statistics.
+//
+// If a measured cost database is given, the report also compares the step time
+// predicted from the measured op costs with the actual step time, and the
+// measured op costs of the step are then added to the database.
 class CostAnalyzer {
  public:
   explicit CostAnalyzer(const GrapplerItem& item, Cluster* cluster,
-                        const string& suffix);
+                        const string& suffix,
+                        MeasuredCostDatabase* measured_costs = nullptr);
   Status GenerateReport(std::ostream& os, bool per_node_report, bool verbose);
 
  private:
@@ -66,10 +72,13 @@ class CostAnalyzer {
   const GrapplerItem* item_;
   MeasuringCostEstimator measure_estimator_;
   AnalyticalCostEstimator analytical_estimator_;
+  MeasuredCostDatabase* measured_costs_;  // Not owned.
+  AnalyticalCostEstimator measured_costs_estimator_;
   OpPerformanceList op_perf_;
   OpPerformanceList op_perf_analytical_;
   int64_t total_time_measured_;
   int64_t total_time_analytical_;
+  int64_t total_time_predicted_from_measured_costs_;
   std::vector<OpPerfSummary> ops_;
   int64_t total_time_measured_serialized_;
   int64_t total_time_analytical_upper_;
@@ -22,7 +22,9 @@ from tensorflow.python.grappler import item as gitem
 def GenerateCostReport(metagraph,
                        per_node_report=False,
                        verbose=False,
-                       cluster=None):
+                       cluster=None,
+                       measured_cost_dir=None,
+                       update_measured_costs=False):
   """Analyze the cost of each TensorFlow op and node in the provided metagraph.
 
   Args:
@@ -33,6 +35,11 @@ def GenerateCostReport(metagraph,
     verbose: Prints out the entire operation proto instead of a summary table.
     cluster: Analyze the costs using the specified cluster, or the local machine
       if no cluster was specified.
+    measured_cost_dir: The directory of a database of measured op costs. If
+      set, the report also compares the step time predicted from the measured
+      op costs with the actual step time.
+    update_measured_costs: Whether to add the op costs measured while
+      generating the report to the database in measured_cost_dir.
 
   Returns:
     A string of cost report.
@@ -42,7 +49,8 @@ def GenerateCostReport(metagraph,
 
   return tf_wrap.GenerateCostReport(metagraph.SerializeToString(),
                                     per_node_report, verbose,
-                                    cluster.tf_cluster)
+                                    cluster.tf_cluster, measured_cost_dir or "",
+                                    update_measured_costs)
 
 
 def GenerateMemoryReport(metagraph, detailed_report=True, cluster=None):
@@ -14,6 +14,7 @@
 # ==============================================================================
 """Tests for the cost analyzer."""
 
+import os
 import re
 
 from tensorflow.python.framework import constant_op
@@ -59,6 +60,30 @@ class CostAnalysisTest(test.TestCase):
     # Also print the report to make it easier to debug
     print("{}".format(report))
 
+  @test_util.run_deprecated_v1
+  def testMeasuredCosts(self):
+    """Make sure the measured op costs are recorded and used."""
+    a = constant_op.constant(10, name="a")
+    b = constant_op.constant(20, name="b")
+    c = math_ops.add_n([a, b], name="c")
+    d = math_ops.add_n([b, c], name="d")
+    train_op = ops.get_collection_ref(ops.GraphKeys.TRAIN_OP)
+    train_op.append(d)
+    mg = meta_graph.create_meta_graph_def(graph=ops.get_default_graph())
+    measured_cost_dir = os.path.join(self.get_temp_dir(), "measured_costs")
+
+    report = cost_analyzer.GenerateCostReport(
+        mg,
+        measured_cost_dir=measured_cost_dir,
+        update_measured_costs=True)
+    self.assertTrue(
+        b"Total time predicted in ns (measured op costs):" in report)
+    self.assertTrue(b"Prediction accuracy (predicted/actual):" in report)
+    self.assertNotEmpty(os.listdir(measured_cost_dir))
+
+    # Also print the report to make it easier to debug
+    print("{}".format(report))
+
   @test_util.run_deprecated_v1
   def testVerbose(self):
     """Make sure the full report is generated with verbose=True."""
@@ -82,8 +82,12 @@ def main(_):
   optimized_graph = tf_optimizer.OptimizeGraph(config, metagraph)
   metagraph.graph_def.CopyFrom(optimized_graph)
 
-  report = cost_analyzer.GenerateCostReport(metagraph, FLAGS.per_node_report,
-                                            FLAGS.verbose)
+  report = cost_analyzer.GenerateCostReport(
+      metagraph,
+      FLAGS.per_node_report,
+      FLAGS.verbose,
+      measured_cost_dir=FLAGS.measured_cost_dir,
+      update_measured_costs=FLAGS.update_measured_costs)
   print(report)
   if FLAGS.memory_report:
     report = cost_analyzer.GenerateMemoryReport(metagraph)
@@ -122,6 +126,19 @@ if __name__ == "__main__":
       "--memory_report",
       action="store_true",
       help="Generate memory usage report.")
+  parser.add_argument(
+      "--measured_cost_dir",
+      type=str,
+      default=None,
+      help="Directory of a database of measured op costs. If set, the report "
+      "compares the step time predicted from the measured op costs with the "
+      "actual step time. Pointing TF_GRAPPLER_MEASURED_COSTS_DIR to this "
+      "directory makes the grappler cost models use the measured op costs.")
+  parser.add_argument(
+      "--update_measured_costs",
+      action="store_true",
+      help="Add the op costs measured while generating the report to the "
+      "database in --measured_cost_dir.")
   parser.add_argument(
       "--verbose",
       action="store_true",
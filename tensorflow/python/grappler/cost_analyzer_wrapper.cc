@@ -30,7 +30,9 @@ namespace py = pybind11;
 PYBIND11_MODULE(_pywrap_cost_analyzer, m) {
   m.def("GenerateCostReport",
         [](const py::bytes& serialized_metagraph, bool per_node_report,
-           bool verbose, tensorflow::grappler::Cluster* cluster) -> py::bytes {
+           bool verbose, tensorflow::grappler::Cluster* cluster,
+           const std::string& measured_cost_dir,
+           bool update_measured_costs) -> py::bytes {
           tensorflow::MetaGraphDef metagraph;
           if (!metagraph.ParseFromString(std::string(serialized_metagraph))) {
             return "The MetaGraphDef could not be parsed as a valid protocol "
@@ -47,12 +49,26 @@ PYBIND11_MODULE(_pywrap_cost_analyzer, m) {
                    "for errors";
           }
 
+          std::unique_ptr<tensorflow::grappler::MeasuredCostDatabase>
+              measured_costs;
+          if (!measured_cost_dir.empty()) {
+            measured_costs =
+                std::make_unique<tensorflow::grappler::MeasuredCostDatabase>();
+            tensorflow::MaybeRaiseFromStatus(
+                measured_costs->Load(measured_cost_dir));
+          }
+
           std::string suffix;
-          tensorflow::grappler::CostAnalyzer analyzer(*item, cluster, suffix);
+          tensorflow::grappler::CostAnalyzer analyzer(*item, cluster, suffix,
+                                                      measured_costs.get());
 
           std::stringstream os;
           tensorflow::MaybeRaiseFromStatus(
               analyzer.GenerateReport(os, per_node_report, verbose));
+          if (measured_costs != nullptr && update_measured_costs) {
+            tensorflow::MaybeRaiseFromStatus(
+                measured_costs->Save(measured_cost_dir));
+          }
           return py::bytes(os.str());
         });
 }
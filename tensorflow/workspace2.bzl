@@ -154,7 +154,10 @@ def _tf_repositories():
         strip_prefix = "XNNPACK-0cbbe74a16e6ca11acf8484ccac85f620336dea4",
         urls = tf_mirror_urls("https://github.com/google/XNNPACK/archive/0cbbe74a16e6ca11acf8484ccac85f620336dea4.zip"),
     )
-    # LINT.ThenChange(//tensorflow/lite/tools/cmake/modules/xnnpack.cmake)
+    # LINT.ThenChange(
+    #     //tensorflow/lite/tools/cmake/modules/xnnpack.cmake,
+    #     //tensorflow/lite/delegates/xnnpack/weight_cache.h:xnnpack_revision,
+    # )
 
     tf_http_archive(
         name = "FXdiv",
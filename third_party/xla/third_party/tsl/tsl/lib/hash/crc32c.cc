@@ -263,6 +263,56 @@ uint32 Extend(uint32 crc, const char *buf, size_t size) {
   return l ^ 0xffffffffu;
 }
 
+// Returns mat * vec over GF(2), where mat is a 32x32 bit matrix stored as
+// one column per word.
+static uint32 GF2MatrixTimes(const uint32 *mat, uint32 vec) {
+  uint32 sum = 0;
+  while (vec != 0) {
+    if (vec & 1) sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void GF2MatrixSquare(uint32 *square, const uint32 *mat) {
+  for (int n = 0; n < 32; n++) {
+    square[n] = GF2MatrixTimes(mat, mat[n]);
+  }
+}
+
+// Appending len2 zero bytes to A is a linear operator on its crc, applied
+// here by repeated squaring as in zlib's crc32_combine().
+uint32 Combine(uint32 crc1, uint32 crc2, size_t len2) {
+  if (len2 == 0) return crc1;
+
+  uint32 even[32];  // Operator for an even power-of-two number of zero bits.
+  uint32 odd[32];   // Operator for an odd power-of-two number of zero bits.
+
+  // Operator for one zero bit: shift right, xor-ing in the reflected
+  // Castagnoli polynomial.
+  odd[0] = 0x82f63b78u;
+  uint32 row = 1;
+  for (int n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+  GF2MatrixSquare(even, odd);  // Two zero bits.
+  GF2MatrixSquare(odd, even);  // Four zero bits.
+
+  // The first squaring below yields the operator for one zero byte.
+  do {
+    GF2MatrixSquare(even, odd);
+    if (len2 & 1) crc1 = GF2MatrixTimes(even, crc1);
+    len2 >>= 1;
+    if (len2 == 0) break;
+    GF2MatrixSquare(odd, even);
+    if (len2 & 1) crc1 = GF2MatrixTimes(odd, crc1);
+    len2 >>= 1;
+  } while (len2 != 0);
+  return crc1 ^ crc2;
+}
+
 #if defined(TF_CORD_SUPPORT)
 uint32 Extend(uint32 crc, const absl::Cord &cord) {
   for (absl::string_view fragment : cord.Chunks()) {
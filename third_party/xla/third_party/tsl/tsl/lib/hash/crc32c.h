@@ -34,6 +34,11 @@ extern uint32 Extend(uint32 init_crc, const char* buf, size_t size);
 extern uint32 Extend(uint32 init_crc, const absl::Cord& cord);
 #endif
 
+// Return the crc32c of concat(A, B) where crc1 is the crc32c of A and crc2 is
+// the crc32c of B, which is len2 bytes long. Lets the crc32c of a buffer be
+// computed over several pieces in parallel.
+extern uint32 Combine(uint32 crc1, uint32 crc2, size_t len2);
+
 // Return the crc32c of data[0,n-1]
 inline uint32 Value(const char* data, size_t n) { return Extend(0, data, n); }
 
@@ -65,6 +65,22 @@ TEST(CRC, Extend) {
   ASSERT_EQ(Value("hello world", 11), Extend(Value("hello ", 6), "world", 5));
 }
 
+TEST(CRC, Combine) {
+  std::string input;
+  for (int i = 0; i < 1000; i++) {
+    input.push_back(static_cast<char>(i * 37 + (i >> 3)));
+  }
+  for (size_t split : {0, 1, 3, 4, 17, 500, 999, 1000}) {
+    const uint32 lhs = Value(input.data(), split);
+    const uint32 rhs = Value(input.data() + split, input.size() - split);
+    EXPECT_EQ(Value(input.data(), input.size()),
+              Combine(lhs, rhs, input.size() - split))
+        << "split " << split;
+  }
+  ASSERT_EQ(Value("hello world", 11),
+            Combine(Value("hello ", 6), Value("world", 5), 5));
+}
+
 TEST(CRC, Mask) {
   uint32 crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
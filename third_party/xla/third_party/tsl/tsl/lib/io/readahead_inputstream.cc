@@ -0,0 +1,209 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/readahead_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+#include "tsl/platform/errors.h"
+
+namespace tsl {
+namespace io {
+
+ReadaheadInputStream::ReadaheadInputStream(RandomAccessFile* file,
+                                           size_t buffer_size, int num_buffers,
+                                           bool owns_file)
+    : file_(file),
+      owns_file_(owns_file),
+      buffer_size_(std::max<size_t>(buffer_size, 1)),
+      buffers_(std::max(num_buffers, 1)) {
+  for (Buffer& buffer : buffers_) {
+    buffer.data.reset(new char[buffer_size_]);
+  }
+}
+
+ReadaheadInputStream::~ReadaheadInputStream() {
+  WaitForReads();
+  if (owns_file_) {
+    delete file_;
+  }
+}
+
+void ReadaheadInputStream::StartReads() {
+  {
+    mutex_lock l(mu_);
+    end_offset_ = -1;
+  }
+  started_ = true;
+  current_ = 0;
+  next_offset_ = pos_;
+  std::vector<int> indices(buffers_.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  IssueReads(indices);
+}
+
+void ReadaheadInputStream::IssueReads(const std::vector<int>& indices) {
+  std::vector<RandomAccessFile::AsyncReadRequest> requests;
+  {
+    mutex_lock l(mu_);
+    for (int index : indices) {
+      Buffer& buffer = buffers_[index];
+      buffer.offset = next_offset_;
+      buffer.size = 0;
+      buffer.consumed = 0;
+      next_offset_ += buffer_size_;
+      if (end_offset_ >= 0 && buffer.offset >= end_offset_) {
+        // Don't read past the end of the file.
+        buffer.status = errors::OutOfRange("reached end of file");
+        continue;
+      }
+      buffer.status = OkStatus();
+      buffer.pending = true;
+      ++pending_;
+
+      RandomAccessFile::AsyncReadRequest request;
+      request.offset = buffer.offset;
+      request.n = buffer_size_;
+      request.scratch = buffer.data.get();
+      request.done = [this, &buffer](const Status& status, StringPiece data) {
+        if (data.data() != buffer.data.get()) {
+          memmove(buffer.data.get(), data.data(), data.size());
+        }
+        mutex_lock l(mu_);
+        buffer.size = data.size();
+        buffer.status = status;
+        buffer.pending = false;
+        if (data.size() < buffer_size_ &&
+            (status.ok() || errors::IsOutOfRange(status))) {
+          const int64_t end_offset = buffer.offset + data.size();
+          end_offset_ =
+              end_offset_ < 0 ? end_offset : std::min(end_offset_, end_offset);
+        }
+        --pending_;
+        cv_.notify_all();
+      };
+      requests.push_back(std::move(request));
+    }
+  }
+  // The callbacks may run in this thread, so `mu_` must not be held.
+  if (!requests.empty()) {
+    file_->ReadAsync(std::move(requests));
+  }
+}
+
+Status ReadaheadInputStream::Consume(int64_t n, char* dst, int64_t* consumed) {
+  *consumed = 0;
+  if (!started_) {
+    StartReads();
+  }
+  while (*consumed < n) {
+    Buffer& buffer = buffers_[current_];
+    {
+      mutex_lock l(mu_);
+      while (buffer.pending) {
+        cv_.wait(l);
+      }
+    }
+    if (buffer.consumed < buffer.size) {
+      const size_t bytes = std::min<int64_t>(buffer.size - buffer.consumed,
+                                             n - *consumed);
+      if (dst != nullptr) {
+        memcpy(dst + *consumed, buffer.data.get() + buffer.consumed, bytes);
+      }
+      buffer.consumed += bytes;
+      *consumed += bytes;
+      pos_ += bytes;
+      continue;
+    }
+    if (!buffer.status.ok() && !errors::IsOutOfRange(buffer.status)) {
+      return buffer.status;
+    }
+    if (buffer.size < buffer_size_) {
+      return errors::OutOfRange("reached end of file");
+    }
+    // The buffer is consumed: start reading the buffer after the last one into
+    // it, and move on to the next one.
+    IssueReads({current_});
+    current_ = (current_ + 1) % buffers_.size();
+  }
+  return OkStatus();
+}
+
+Status ReadaheadInputStream::ReadNBytes(int64_t bytes_to_read,
+                                        tstring* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Cannot read negative number of bytes");
+  }
+  result->clear();
+  result->resize_uninitialized(bytes_to_read);
+  int64_t consumed;
+  Status s = Consume(bytes_to_read, &(*result)[0], &consumed);
+  result->resize(consumed);
+  return s;
+}
+
+Status ReadaheadInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can't skip a negative number of bytes");
+  }
+  const int64_t buffered = started_ ? next_offset_ - pos_ : 0;
+  if (bytes_to_skip > buffered) {
+    // Read the last byte to skip: if it is in the file, restart the reads
+    // after it rather than reading up to it.
+    char scratch;
+    StringPiece data;
+    Status s = file_->Read(pos_ + bytes_to_skip - 1, 1, &data, &scratch);
+    if ((s.ok() || errors::IsOutOfRange(s)) && data.size() == 1) {
+      return Seek(pos_ + bytes_to_skip);
+    }
+  }
+  int64_t consumed;
+  return Consume(bytes_to_skip, nullptr, &consumed);
+}
+
+int64_t ReadaheadInputStream::Tell() const { return pos_; }
+
+Status ReadaheadInputStream::Seek(int64_t position) {
+  if (position < 0) {
+    return errors::InvalidArgument("Seeking to a negative position: ",
+                                   position);
+  }
+  if (started_ && position >= pos_ && position < next_offset_) {
+    int64_t consumed;
+    Status s = Consume(position - pos_, nullptr, &consumed);
+    if (!errors::IsOutOfRange(s)) {
+      return s;
+    }
+  }
+  WaitForReads();
+  started_ = false;
+  pos_ = position;
+  return OkStatus();
+}
+
+Status ReadaheadInputStream::Reset() { return Seek(0); }
+
+void ReadaheadInputStream::WaitForReads() {
+  mutex_lock l(mu_);
+  while (pending_ > 0) {
+    cv_.wait(l);
+  }
+}
+
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,108 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
+#define TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
+
+#include <memory>
+#include <vector>
+
+#include "tsl/lib/io/inputstream_interface.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/mutex.h"
+#include "tsl/platform/status.h"
+#include "tsl/platform/thread_annotations.h"
+
+namespace tsl {
+namespace io {
+
+// Wraps a RandomAccessFile in an InputStreamInterface that keeps the reads of
+// the next `num_buffers` buffers of `buffer_size` bytes in flight, with
+// RandomAccessFile::ReadAsync, while the stream consumes the current buffer.
+//
+// This is meant for files for which RandomAccessFile::SupportsAsyncReads() is
+// true; with other files, the reads are done in the thread that consumes the
+// stream, as with a BufferedInputStream.
+//
+// A given instance of ReadaheadInputStream is NOT safe for concurrent use by
+// multiple threads.
+class ReadaheadInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of 'file' unless owns_file is set to true. 'file'
+  // must outlive *this.
+  ReadaheadInputStream(RandomAccessFile* file, size_t buffer_size,
+                       int num_buffers, bool owns_file = false);
+
+  ~ReadaheadInputStream() override;
+
+  Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  // Seeks to `position` in the file. Drops the buffered data, unless
+  // `position` is in the data that is buffered or being read.
+  Status Seek(int64_t position);
+
+  Status Reset() override;
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> data;
+    // The offset of `data` in the file.
+    int64_t offset = 0;
+    // The number of bytes read into `data`, and consumed from `data`.
+    size_t size = 0;
+    size_t consumed = 0;
+    Status status;
+    bool pending = false;
+  };
+
+  // Starts the reads of all the buffers, from `pos_`.
+  void StartReads();
+
+  // Starts the reads of the buffers at `indices`, from `next_offset_`.
+  void IssueReads(const std::vector<int>& indices);
+
+  // Consumes up to `n` bytes, which are copied to `dst` if not null, and
+  // stores the number of bytes consumed into `consumed`.
+  Status Consume(int64_t n, char* dst, int64_t* consumed);
+
+  void WaitForReads();
+
+  RandomAccessFile* file_;
+  const bool owns_file_;
+  const size_t buffer_size_;
+  // A ring of buffers, the first of which is `buffers_[current_]`.
+  std::vector<Buffer> buffers_;
+  int current_ = 0;
+  bool started_ = false;
+  // The offset of the next byte of the stream, and of the next read to start.
+  int64_t pos_ = 0;
+  int64_t next_offset_ = 0;
+
+  mutex mu_;
+  condition_variable cv_;
+  // The number of reads in flight.
+  int pending_ TF_GUARDED_BY(mu_) = 0;
+  // The end of the file, once a read returned less bytes than requested.
+  int64_t end_offset_ TF_GUARDED_BY(mu_) = -1;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_READAHEAD_INPUTSTREAM_H_
@@ -46,6 +46,12 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If non-zero, and buffer_size is non-zero too, the reads of the next
+  // readahead_buffers buffers of buffer_size bytes are kept in flight while
+  // the current buffer is consumed. Only used with files that support
+  // asynchronous reads (see RandomAccessFile::SupportsAsyncReads).
+  int readahead_buffers = 0;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
@@ -233,6 +233,51 @@ TEST(RecordReaderWriterTest, TestSkipOutOfRange) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestReadahead) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_readahead_test";
+  std::vector<string> records;
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get(), io::RecordWriterOptions());
+    for (int i = 0; i < 100; ++i) {
+      records.push_back(string(i, 'a' + i % 26));
+      TF_EXPECT_OK(writer.WriteRecord(records.back()));
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (auto buf_size : BufferSizes()) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options;
+    options.buffer_size = buf_size;
+    options.readahead_buffers = 4;
+    io::RecordReader reader(read_file.get(), options);
+    uint64 offset = 0;
+    uint64 offset_of_record_10 = 0;
+    tstring record;
+    for (int i = 0; i < records.size(); ++i) {
+      if (i == 10) {
+        offset_of_record_10 = offset;
+      }
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+      EXPECT_EQ(records[i], record);
+    }
+    EXPECT_EQ(error::OUT_OF_RANGE, reader.ReadRecord(&offset, &record).code());
+
+    // Reading an earlier record restarts the reads from it.
+    TF_CHECK_OK(reader.ReadRecord(&offset_of_record_10, &record));
+    EXPECT_EQ(records[10], record);
+    int num_skipped;
+    TF_CHECK_OK(reader.SkipRecords(&offset_of_record_10, 50, &num_skipped));
+    EXPECT_EQ(50, num_skipped);
+    TF_CHECK_OK(reader.ReadRecord(&offset_of_record_10, &record));
+    EXPECT_EQ(records[61], record);
+  }
+}
+
 TEST(RecordReaderWriterTest, TestMalformedInput) {
   Env* env = Env::Default();
   string fname =
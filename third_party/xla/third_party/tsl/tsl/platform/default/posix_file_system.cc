@@ -22,6 +22,8 @@ limitations under the License.
 
 #if defined(__linux__)
 #include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #endif
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -29,13 +31,30 @@ limitations under the License.
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define TSL_POSIX_IO_URING 1
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "tsl/platform/default/posix_file_system.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/file_system_helper.h"
 #include "tsl/platform/logging.h"
+#include "tsl/platform/mutex.h"
 #include "tsl/platform/status.h"
 #include "tsl/platform/strcat.h"
+#include "tsl/platform/threadpool.h"
 #include "tsl/protobuf/error_codes.pb.h"
 
 namespace tsl {
@@ -45,7 +64,359 @@ using ::tsl::errors::IOError;
 // 128KB of copy buffer
 constexpr size_t kPosixCopyFileBufferSize = 128 * 1024;
 
-// pread() based random-access
+namespace {
+
+// Reads `n` bytes of `fd` starting at `offset` into `scratch` with pread(),
+// and adds the number of bytes read to `*bytes_read`.
+Status PreadFully(const string& filename, int fd, uint64 offset, size_t n,
+                  char* scratch, size_t* bytes_read) {
+  Status s;
+  char* dst = scratch;
+  while (n > 0 && s.ok()) {
+    // Some platforms, notably macs, throw EINVAL if pread is asked to read
+    // more than fits in a 32-bit integer.
+    size_t requested_read_length;
+    if (n > INT32_MAX) {
+      requested_read_length = INT32_MAX;
+    } else {
+      requested_read_length = n;
+    }
+    ssize_t r =
+        pread(fd, dst, requested_read_length, static_cast<off_t>(offset));
+    if (r > 0) {
+      dst += r;
+      n -= r;
+      offset += r;
+    } else if (r == 0) {
+      s = Status(absl::StatusCode::kOutOfRange,
+                 "Read less bytes than requested");
+    } else if (errno == EINTR || errno == EAGAIN) {
+      // Retry
+    } else {
+      s = IOError(filename, errno);
+    }
+  }
+  *bytes_read += dst - scratch;
+  return s;
+}
+
+#if defined(TSL_POSIX_IO_URING)
+
+// A read of `PosixRandomAccessFile::ReadAsync`.
+struct IoUringRead {
+  const string* filename;
+  int fd;
+  uint64 offset;
+  size_t n;
+  char* scratch;
+  std::function<void(const Status&, StringPiece)> done;
+  // Number of bytes read so far. Short reads are submitted again for the
+  // remaining bytes.
+  size_t bytes_read = 0;
+  struct iovec iov;
+};
+
+// Submits reads to an io_uring shared by all the files, and completes them on
+// a dedicated thread. The system calls are used directly so that liburing is
+// not needed.
+class IoUringReader {
+ public:
+  // Returns the process-wide reader, or nullptr if io_uring is not available,
+  // e.g. on kernels older than 5.1, when a seccomp policy forbids it, or when
+  // the TF_POSIX_DISABLE_IO_URING environment variable is set. Also returns
+  // nullptr in a child forked after the creation of the reader, which shares
+  // the ring of its parent but not its completion thread, and after the ring
+  // failed.
+  static IoUringReader* Get() {
+    static IoUringReader* reader = Create();
+    if (reader == nullptr || reader->pid_ != getpid() ||
+        reader->broken_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return reader;
+  }
+
+  // Submits the first reads of `reads`, as many as fit in the ring, and
+  // returns how many were submitted. The others are left to the caller. If the
+  // ring fails, the submitted reads that the kernel did not take are completed
+  // with an Internal error.
+  size_t Submit(IoUringRead* const* reads, size_t num_reads) {
+    size_t count;
+    {
+      // Only the filling of the submission queue is serialized, so that
+      // callers do not wait for each other's system calls.
+      mutex_lock l(mu_);
+      if (broken_.load(std::memory_order_relaxed)) return 0;
+      count = std::min<size_t>(num_reads, queue_depth_ - in_flight_);
+      if (count == 0) return 0;
+      const unsigned tail = *sq_tail_;
+      for (size_t i = 0; i < count; ++i) {
+        IoUringRead* read = reads[i];
+        read->iov.iov_base = read->scratch + read->bytes_read;
+        // Like pread(), reads are capped to what fits in a 32-bit integer.
+        read->iov.iov_len = std::min<size_t>(read->n - read->bytes_read,
+                                             INT32_MAX);
+        const unsigned index = (tail + i) & sq_ring_mask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = read->fd;
+        sqe->off = read->offset + read->bytes_read;
+        sqe->addr = reinterpret_cast<uint64_t>(&read->iov);
+        sqe->len = 1;
+        sqe->user_data = reinterpret_cast<uint64_t>(read);
+        sq_array_[index] = index;
+      }
+      __atomic_store_n(sq_tail_, tail + count, __ATOMIC_RELEASE);
+      in_flight_ += count;
+      ++num_submitters_;
+    }
+    // The kernel consumes the queue in order, so a call may submit the entries
+    // of a concurrent caller rather than these ones. As every caller asks for
+    // as many entries as it added, all of them are submitted in the end. The
+    // entries cannot be withdrawn once other callers may have added theirs, so
+    // transient failures are retried.
+    size_t submitted = 0;
+    int error = 0;
+    while (submitted < count && !broken_.load(std::memory_order_acquire)) {
+      const int r = syscall(__NR_io_uring_enter, ring_fd_, count - submitted,
+                            0, 0, nullptr, 0);
+      if (r > 0) {
+        submitted += r;
+      } else if (r < 0 && errno == EINTR) {
+        // Retry
+      } else if (r == 0 || errno == EAGAIN || errno == EBUSY) {
+        Env::Default()->SleepForMicroseconds(kRetryDelayMicros);
+      } else {
+        error = errno;
+        break;
+      }
+    }
+    std::vector<IoUringRead*> failed;
+    {
+      mutex_lock l(mu_);
+      if (error != 0 && !broken_.load(std::memory_order_relaxed)) {
+        LOG(ERROR) << "io_uring_enter() failed, reads fall back to pread(): "
+                   << strerror(error);
+        broken_.store(true, std::memory_order_release);
+      }
+      // Once the ring is broken, the last submitter to leave withdraws the
+      // entries that the kernel did not take, which no other caller submits
+      // anymore.
+      if (--num_submitters_ == 0 && broken_.load(std::memory_order_relaxed)) {
+        WithdrawUnsubmitted(&failed);
+      }
+    }
+    for (IoUringRead* read : failed) {
+      Finish(read, errors::Internal("Read of ", *read->filename,
+                                    " not submitted: io_uring_enter() failed"));
+    }
+    return count;
+  }
+
+  // Reads the rest of `read` with pread() in the calling thread and completes
+  // it.
+  static void ReadSync(IoUringRead* read) {
+    Status s = PreadFully(*read->filename, read->fd,
+                          read->offset + read->bytes_read,
+                          read->n - read->bytes_read,
+                          read->scratch + read->bytes_read, &read->bytes_read);
+    Finish(read, s);
+  }
+
+ private:
+  static IoUringReader* Create() {
+    const char* disable = getenv("TF_POSIX_DISABLE_IO_URING");
+    if (disable != nullptr && strcmp(disable, "0") != 0) return nullptr;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = syscall(__NR_io_uring_setup, kQueueDepth, &params);
+    if (ring_fd < 0) {
+      VLOG(1) << "io_uring is not available: " << strerror(errno);
+      return nullptr;
+    }
+    // Submissions cannot fall back to pread() once queued, so check that they
+    // are allowed, e.g. by seccomp policies, before using the ring.
+    if (syscall(__NR_io_uring_enter, ring_fd, 0, 0, 0, nullptr, 0) < 0) {
+      VLOG(1) << "io_uring_enter() is not available: " << strerror(errno);
+      close(ring_fd);
+      return nullptr;
+    }
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    const size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sq = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    void* cq = single_mmap ? sq
+                           : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd,
+                                  IORING_OFF_CQ_RING);
+    void* sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+      VLOG(1) << "Failed to map the io_uring: " << strerror(errno);
+      if (sq != MAP_FAILED) munmap(sq, sq_size);
+      if (cq != MAP_FAILED && !single_mmap) munmap(cq, cq_size);
+      if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+      close(ring_fd);
+      return nullptr;
+    }
+
+    auto* reader = new IoUringReader();
+    reader->pid_ = getpid();
+    reader->ring_fd_ = ring_fd;
+    // At most `sq_entries` reads are in flight, so the completion queue,
+    // which is larger, never overflows.
+    reader->queue_depth_ = params.sq_entries;
+    char* sq_ring = static_cast<char*>(sq);
+    reader->sq_head_ =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+    reader->sq_tail_ =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    reader->sq_ring_mask_ =
+        *reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    reader->sq_array_ =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    reader->sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+    char* cq_ring = static_cast<char*>(cq);
+    reader->cq_head_ =
+        reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    reader->cq_tail_ =
+        reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    reader->cq_ring_mask_ =
+        *reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    reader->cqes_ =
+        reinterpret_cast<struct io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+    reader->thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "tf_io_uring_reader",
+        [reader]() { reader->ReapCompletions(); }));
+    reader->sync_read_pool_ = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "tf_io_uring_sync_read", kNumSyncReadThreads);
+    return reader;
+  }
+
+  // Waits for completions and runs their callbacks. Never returns: the reader
+  // lives as long as the process.
+  void ReapCompletions() {
+    std::vector<std::pair<IoUringRead*, int>> completions;
+    while (true) {
+      const int r = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                            IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (r < 0 && errno != EINTR) {
+        LOG(ERROR) << "io_uring_enter() failed: " << strerror(errno);
+      }
+      // This thread is the only consumer of the completion queue.
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        const struct io_uring_cqe& cqe = cqes_[head & cq_ring_mask_];
+        completions.emplace_back(reinterpret_cast<IoUringRead*>(cqe.user_data),
+                                 cqe.res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      if (completions.empty()) continue;
+      {
+        mutex_lock l(mu_);
+        in_flight_ -= completions.size();
+      }
+      for (const auto& [read, res] : completions) {
+        Complete(read, res);
+      }
+      completions.clear();
+    }
+  }
+
+  // Handles the result `res` of a submission of `read`.
+  void Complete(IoUringRead* read, int res) {
+    if (res > 0) {
+      read->bytes_read += res;
+      if (read->bytes_read == read->n) {
+        Finish(read, OkStatus());
+      } else {
+        Resubmit(read);
+      }
+    } else if (res == 0) {
+      Finish(read, Status(absl::StatusCode::kOutOfRange,
+                          "Read less bytes than requested"));
+    } else if (res == -EINTR || res == -EAGAIN) {
+      Resubmit(read);
+    } else {
+      Finish(read, IOError(*read->filename, -res));
+    }
+  }
+
+  // Submits the rest of `read` again. If the ring is full, the rest is read in
+  // a thread pool rather than on the completion thread, which would hold up the
+  // other completions.
+  void Resubmit(IoUringRead* read) {
+    if (Submit(&read, 1) == 0) {
+      sync_read_pool_->Schedule([read]() { ReadSync(read); });
+    }
+  }
+
+  // Moves the entries of the submission queue that the kernel did not take to
+  // `reads`. No caller may be submitting entries.
+  void WithdrawUnsubmitted(std::vector<IoUringRead*>* reads)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const unsigned tail = *sq_tail_;
+    for (unsigned i = head; i != tail; ++i) {
+      const struct io_uring_sqe& sqe = sqes_[sq_array_[i & sq_ring_mask_]];
+      reads->push_back(reinterpret_cast<IoUringRead*>(sqe.user_data));
+    }
+    __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+    in_flight_ -= reads->size();
+  }
+
+  static void Finish(IoUringRead* read, const Status& status) {
+    read->done(status, StringPiece(read->scratch, read->bytes_read));
+    delete read;
+  }
+
+  static constexpr unsigned kQueueDepth = 256;
+  // Number of threads that finish the reads which do not fit in the ring when
+  // they are resubmitted.
+  static constexpr int kNumSyncReadThreads = 4;
+  // Delay before submitting again when the kernel is short of resources.
+  static constexpr int64_t kRetryDelayMicros = 100;
+
+  // The process that created the ring.
+  pid_t pid_ = 0;
+  int ring_fd_ = -1;
+  unsigned queue_depth_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_ring_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  struct io_uring_sqe* sqes_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_ring_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+  std::unique_ptr<Thread> thread_;
+  std::unique_ptr<thread::ThreadPool> sync_read_pool_;
+  // Whether io_uring_enter() failed unexpectedly, after which reads are no
+  // longer submitted to the ring. Only set under `mu_`.
+  std::atomic<bool> broken_{false};
+
+  mutex mu_;
+  // Number of submitted reads that have not completed yet.
+  unsigned in_flight_ TF_GUARDED_BY(mu_) = 0;
+  // Number of callers of Submit() that may still enter entries to the kernel.
+  int num_submitters_ TF_GUARDED_BY(mu_) = 0;
+};
+
+#endif  // TSL_POSIX_IO_URING
+
+}  // namespace
+
+// pread() based random-access, with io_uring based asynchronous reads where
+// available.
 class PosixRandomAccessFile : public RandomAccessFile {
  private:
   string filename_;
@@ -67,35 +438,42 @@ class PosixRandomAccessFile : public RandomAccessFile {
 
   Status Read(uint64 offset, size_t n, StringPiece* result,
               char* scratch) const override {
-    Status s;
-    char* dst = scratch;
-    while (n > 0 && s.ok()) {
-      // Some platforms, notably macs, throw EINVAL if pread is asked to read
-      // more than fits in a 32-bit integer.
-      size_t requested_read_length;
-      if (n > INT32_MAX) {
-        requested_read_length = INT32_MAX;
-      } else {
-        requested_read_length = n;
-      }
-      ssize_t r =
-          pread(fd_, dst, requested_read_length, static_cast<off_t>(offset));
-      if (r > 0) {
-        dst += r;
-        n -= r;
-        offset += r;
-      } else if (r == 0) {
-        s = Status(absl::StatusCode::kOutOfRange,
-                   "Read less bytes than requested");
-      } else if (errno == EINTR || errno == EAGAIN) {
-        // Retry
-      } else {
-        s = IOError(filename_, errno);
+    size_t bytes_read = 0;
+    Status s = PreadFully(filename_, fd_, offset, n, scratch, &bytes_read);
+    *result = StringPiece(scratch, bytes_read);
+    return s;
+  }
+
+#if defined(TSL_POSIX_IO_URING)
+  void ReadAsync(std::vector<AsyncReadRequest> requests) const override {
+    IoUringReader* reader = IoUringReader::Get();
+    if (reader == nullptr) {
+      RandomAccessFile::ReadAsync(std::move(requests));
+      return;
+    }
+    std::vector<IoUringRead*> reads;
+    reads.reserve(requests.size());
+    for (AsyncReadRequest& request : requests) {
+      if (request.n == 0) {
+        request.done(OkStatus(), StringPiece(request.scratch, 0));
+        continue;
       }
+      reads.push_back(new IoUringRead{&filename_, fd_, request.offset,
+                                      request.n, request.scratch,
+                                      std::move(request.done)});
     }
-    *result = StringPiece(scratch, dst - scratch);
-    return s;
+    // Reads that do not fit in the ring are done in the calling thread, which
+    // throttles callers that outpace the device.
+    const size_t submitted = reader->Submit(reads.data(), reads.size());
+    for (size_t i = submitted; i < reads.size(); ++i) {
+      IoUringReader::ReadSync(reads[i]);
+    }
+  }
+
+  bool SupportsAsyncReads() const override {
+    return IoUringReader::Get() != nullptr;
   }
+#endif  // TSL_POSIX_IO_URING
 
 #if defined(TF_CORD_SUPPORT)
   Status Read(uint64 offset, size_t n, absl::Cord* cord) const override {
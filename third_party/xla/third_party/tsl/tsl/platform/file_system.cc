@@ -492,4 +492,12 @@ std::string FileSystem::DecodeTransaction(const TransactionToken* token) {
   return "No Transaction";
 }
 
+void RandomAccessFile::ReadAsync(std::vector<AsyncReadRequest> requests) const {
+  for (AsyncReadRequest& request : requests) {
+    StringPiece result;
+    Status status = Read(request.offset, request.n, &result, request.scratch);
+    request.done(status, result);
+  }
+}
+
 }  // namespace tsl
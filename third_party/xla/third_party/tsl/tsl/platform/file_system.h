@@ -771,6 +771,37 @@ class RandomAccessFile {
   }
 #endif
 
+  /// \brief A read of `n` bytes starting at `offset`, for `ReadAsync`.
+  struct AsyncReadRequest {
+    uint64 offset = 0;
+    size_t n = 0;
+    /// `scratch[0..n-1]` may be written by the read, and must be live until
+    /// `done` is called.
+    char* scratch = nullptr;
+    /// Called once the read completes, with the status and the data that
+    /// `Read(offset, n, &result, scratch)` would have returned.
+    std::function<void(const tsl::Status& status, StringPiece result)> done;
+  };
+
+  /// \brief Starts the reads of `requests`, and calls the `done` callback of
+  /// each request once its read completes.
+  ///
+  /// Callbacks may be called before `ReadAsync` returns, by the calling thread
+  /// or by other threads, and concurrently with each other, so they must be
+  /// cheap and thread-safe. The file must be live until all the callbacks
+  /// have been called.
+  ///
+  /// The default implementation reads each request with `Read` in the calling
+  /// thread. Files for which `SupportsAsyncReads()` is true keep many reads in
+  /// flight without blocking the calling thread.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(std::vector<AsyncReadRequest> requests) const;
+
+  /// \brief Returns true if `ReadAsync` does not block the calling thread
+  /// until the reads complete.
+  virtual bool SupportsAsyncReads() const { return false; }
+
  private:
   RandomAccessFile(const RandomAccessFile&) = delete;
   void operator=(const RandomAccessFile&) = delete;